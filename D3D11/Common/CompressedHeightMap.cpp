@@ -0,0 +1,750 @@
+#include "CompressedHeightMap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <windows.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include <ParallelUtils.h>
+
+namespace
+{
+    // "HMCZ"
+    const uint32_t sMagic = 0x5A434D48;
+
+    // Increment it every time the file layout or the encoding changes.
+    const uint32_t sVersion = 1;
+
+    // It is followed by mTileCount + 1 tile offsets (uint64_t, from the
+    // beginning of the file), tile i being the bytes [offset i, offset i + 1),
+    // and by the tiles, row major.
+    struct FileHeader
+    {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        uint32_t mDimension;
+        uint32_t mTileDimension;
+        float mScale;
+        float mOffset;
+        uint32_t mTileCount;
+        uint32_t mReserved;
+    };
+
+    // A tile is its predictor (a byte), its sample step (the greatest
+    // common divisor of its samples, in 2 bytes) and the Rice coded
+    // residuals of its samples divided by the step, row major.
+    // 8-bit RAW samples expanded to 16 bits have a step of 257.
+    enum struct Predictor
+    {
+        DELTA,
+        PAETH,
+        GRADIENT
+    };
+
+    const uint32_t sPredictorCount = 3;
+
+    // Residuals sharing a Rice parameter, that is stored in
+    // sRiceParameterBits bits before them.
+    const uint32_t sRiceBlockSize = 32;
+    const uint32_t sRiceParameterBits = 5;
+    const uint32_t sMaxRiceParameter = 16;
+
+    // A residual is coded as its quotient (residual >> parameter) in
+    // unary (quotient 0 bits and a 1 bit) and its parameter low bits.
+    // Quotients from sMaxQuotient on are escaped: sMaxQuotient 0 bits,
+    // a 1 bit and the residual in 16 bits.
+    const uint32_t sMaxQuotient = 24;
+
+    // Bits are written and read from the least significant one.
+    struct BitWriter
+    {
+        BitWriter(std::vector<uint8_t>& bytes)
+            : mBytes(bytes)
+            , mBuffer(0)
+            , mBitCount(0)
+        {
+
+        }
+
+        std::vector<uint8_t>& mBytes;
+        uint64_t mBuffer;
+        uint32_t mBitCount;
+
+    private:
+        const BitWriter& operator=(const BitWriter&);
+    };
+
+    // count <= 32
+    void writeBits(BitWriter& writer,
+                   const uint32_t bits,
+                   const uint32_t count)
+    {
+        writer.mBuffer |= static_cast<uint64_t> (bits) << writer.mBitCount;
+        writer.mBitCount += count;
+        while(writer.mBitCount >= 8) {
+            writer.mBytes.push_back(static_cast<uint8_t> (writer.mBuffer));
+            writer.mBuffer >>= 8;
+            writer.mBitCount -= 8;
+        }
+    }
+
+    void flushBits(BitWriter& writer)
+    {
+        if(writer.mBitCount > 0) {
+            writer.mBytes.push_back(static_cast<uint8_t> (writer.mBuffer));
+            writer.mBuffer = 0;
+            writer.mBitCount = 0;
+        }
+    }
+
+    struct BitReader
+    {
+        BitReader(const uint8_t* begin,
+                  const uint8_t* end)
+            : mBytes(begin)
+            , mEnd(end)
+            , mBuffer(0)
+            , mBitCount(0)
+            , mPaddingBits(0)
+        {
+
+        }
+
+        const uint8_t* mBytes;
+        const uint8_t* mEnd;
+        uint64_t mBuffer;
+        uint32_t mBitCount;
+
+        // 0 bits read past the end
+        uint32_t mPaddingBits;
+    };
+
+    // Fills the buffer up to at least 56 bits.
+    void refill(BitReader& reader)
+    {
+        if(reader.mEnd - reader.mBytes >= 8) {
+            uint64_t word;
+            memcpy(&word, reader.mBytes, sizeof(word));
+            const uint32_t byteCount = (63 - reader.mBitCount) >> 3;
+            reader.mBuffer |= word << reader.mBitCount;
+            reader.mBytes += byteCount;
+            reader.mBitCount += byteCount * 8;
+
+            // Clear the bits of the next byte, that is not consumed yet.
+            reader.mBuffer &= (static_cast<uint64_t> (1) << reader.mBitCount) - 1;
+            return;
+        }
+
+        while(reader.mBitCount <= 56) {
+            if(reader.mBytes < reader.mEnd) {
+                reader.mBuffer |= static_cast<uint64_t> (*reader.mBytes++) << reader.mBitCount;
+            } else {
+                reader.mPaddingBits += 8;
+            }
+
+            reader.mBitCount += 8;
+        }
+    }
+
+    // count <= 16, with at least count bits in the buffer.
+    uint32_t readBits(BitReader& reader,
+                      const uint32_t count)
+    {
+        const uint32_t bits = static_cast<uint32_t> (reader.mBuffer) & ((1U << count) - 1);
+        reader.mBuffer >>= count;
+        reader.mBitCount -= count;
+
+        return bits;
+    }
+
+    uint32_t countTrailingZeros(const uint32_t value)
+    {
+        assert(value != 0);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    // left, top and topLeft are the sample neighbors
+    uint16_t predict(const Predictor predictor,
+                     const int32_t left,
+                     const int32_t top,
+                     const int32_t topLeft)
+    {
+        const int32_t gradient = left + top - topLeft;
+        switch(predictor) {
+        case Predictor::DELTA:
+            return static_cast<uint16_t> (left);
+        case Predictor::PAETH:
+            {
+                const int32_t leftDistance = abs(gradient - left);
+                const int32_t topDistance = abs(gradient - top);
+                const int32_t topLeftDistance = abs(gradient - topLeft);
+                if(leftDistance <= topDistance && leftDistance <= topLeftDistance) {
+                    return static_cast<uint16_t> (left);
+                }
+
+                return static_cast<uint16_t> (topDistance <= topLeftDistance ? top : topLeft);
+            }
+        default:
+            return static_cast<uint16_t> ((std::min)((std::max)(gradient, 0), 0xFFFF));
+        }
+    }
+
+    // Residuals wrap around, so they always fit in 16 bits, and are
+    // zigzag encoded (0, -1, 1, -2, ...) to have small codes for small
+    // magnitudes.
+    uint16_t encodeResidual(const uint16_t sample,
+                            const uint16_t prediction)
+    {
+        const int16_t residual = static_cast<int16_t> (sample - prediction);
+        return static_cast<uint16_t> ((residual << 1) ^ (residual >> 15));
+    }
+
+    uint16_t decodeResidual(const uint16_t sample,
+                            const uint16_t code)
+    {
+        const uint16_t residual = static_cast<uint16_t> ((code >> 1) ^ (0 - (code & 1)));
+        return static_cast<uint16_t> (sample + residual);
+    }
+
+    // Residual codes of a tile of samples, with no row padding.
+    void computeResiduals(const uint16_t* samples,
+                          const uint32_t tileWidth,
+                          const uint32_t tileHeight,
+                          const Predictor predictor,
+                          uint16_t* residuals)
+    {
+        for(uint32_t row = 0; row < tileHeight; ++row) {
+            const uint16_t* rowSamples = samples + row * tileWidth;
+            uint16_t* rowResiduals = residuals + row * tileWidth;
+            if(row == 0) {
+                rowResiduals[0] = encodeResidual(rowSamples[0], 0);
+                for(uint32_t column = 1; column < tileWidth; ++column) {
+                    rowResiduals[column] = encodeResidual(rowSamples[column], rowSamples[column - 1]);
+                }
+
+                continue;
+            }
+
+            const uint16_t* topSamples = rowSamples - tileWidth;
+            rowResiduals[0] = encodeResidual(rowSamples[0], topSamples[0]);
+            for(uint32_t column = 1; column < tileWidth; ++column) {
+                const uint16_t prediction = predict(predictor, rowSamples[column - 1], topSamples[column], topSamples[column - 1]);
+                rowResiduals[column] = encodeResidual(rowSamples[column], prediction);
+            }
+        }
+    }
+
+    // Inverse of computeResiduals, in place, for a tile with no row padding.
+    template<Predictor predictor>
+    void reconstructSamples(const uint32_t tileWidth,
+                            const uint32_t tileHeight,
+                            uint16_t* samples)
+    {
+        samples[0] = decodeResidual(0, samples[0]);
+        for(uint32_t column = 1; column < tileWidth; ++column) {
+            samples[column] = decodeResidual(samples[column - 1], samples[column]);
+        }
+
+        for(uint32_t row = 1; row < tileHeight; ++row) {
+            uint16_t* rowSamples = samples + row * tileWidth;
+            const uint16_t* topSamples = rowSamples - tileWidth;
+            rowSamples[0] = decodeResidual(topSamples[0], rowSamples[0]);
+            for(uint32_t column = 1; column < tileWidth; ++column) {
+                const uint16_t prediction = predict(predictor, rowSamples[column - 1], topSamples[column], topSamples[column - 1]);
+                rowSamples[column] = decodeResidual(prediction, rowSamples[column]);
+            }
+        }
+    }
+
+    uint32_t computeCodeLength(const uint32_t residual,
+                               const uint32_t riceParameter)
+    {
+        const uint32_t quotient = residual >> riceParameter;
+        return quotient < sMaxQuotient ? quotient + 1 + riceParameter : sMaxQuotient + 1 + 16;
+    }
+
+    // Rice parameter with the shortest codes for the residuals. The best
+    // one is near log2 of their mean, so only the parameters around it
+    // are tried.
+    uint32_t selectRiceParameter(const uint16_t* residuals,
+                                 const uint32_t count)
+    {
+        uint32_t sum = 0;
+        for(uint32_t i = 0; i < count; ++i) {
+            sum += residuals[i];
+        }
+
+        uint32_t meanLog2 = 0;
+        while(meanLog2 < sMaxRiceParameter && (count << (meanLog2 + 1)) <= sum) {
+            ++meanLog2;
+        }
+
+        uint32_t bestParameter = 0;
+        uint32_t bestLength = UINT32_MAX;
+        const uint32_t fromParameter = meanLog2 > 0 ? meanLog2 - 1 : 0;
+        const uint32_t toParameter = (std::min)(meanLog2 + 1, sMaxRiceParameter);
+        for(uint32_t riceParameter = fromParameter; riceParameter <= toParameter; ++riceParameter) {
+            uint32_t length = 0;
+            for(uint32_t i = 0; i < count; ++i) {
+                length += computeCodeLength(residuals[i], riceParameter);
+            }
+
+            if(length < bestLength) {
+                bestLength = length;
+                bestParameter = riceParameter;
+            }
+        }
+
+        return bestParameter;
+    }
+
+    void encodeResiduals(const uint16_t* residuals,
+                         const uint32_t count,
+                         BitWriter& writer)
+    {
+        for(uint32_t blockBegin = 0; blockBegin < count; blockBegin += sRiceBlockSize) {
+            const uint32_t blockEnd = (std::min)(blockBegin + sRiceBlockSize, count);
+            const uint32_t riceParameter = selectRiceParameter(residuals + blockBegin, blockEnd - blockBegin);
+            writeBits(writer, riceParameter, sRiceParameterBits);
+            for(uint32_t i = blockBegin; i < blockEnd; ++i) {
+                const uint32_t quotient = residuals[i] >> riceParameter;
+                if(quotient < sMaxQuotient) {
+                    writeBits(writer, 1U << quotient, quotient + 1);
+                    writeBits(writer, residuals[i] & ((1U << riceParameter) - 1), riceParameter);
+                } else {
+                    writeBits(writer, 1U << sMaxQuotient, sMaxQuotient + 1);
+                    writeBits(writer, residuals[i], 16);
+                }
+            }
+        }
+
+        flushBits(writer);
+    }
+
+    // Returns false if the residuals are not a valid Rice code.
+    bool decodeResiduals(BitReader& reader,
+                         const uint32_t count,
+                         uint16_t* residuals)
+    {
+        for(uint32_t blockBegin = 0; blockBegin < count; blockBegin += sRiceBlockSize) {
+            const uint32_t blockEnd = (std::min)(blockBegin + sRiceBlockSize, count);
+            refill(reader);
+            const uint32_t riceParameter = readBits(reader, sRiceParameterBits);
+            if(riceParameter > sMaxRiceParameter) {
+                return false;
+            }
+
+            for(uint32_t i = blockBegin; i < blockEnd; ++i) {
+                // The longest code has sMaxQuotient + 1 + 16 bits.
+                if(reader.mBitCount < sMaxQuotient + 1 + 16) {
+                    refill(reader);
+                }
+
+                // Bits after sMaxQuotient do not change the quotient.
+                const uint32_t quotient = countTrailingZeros(static_cast<uint32_t> (reader.mBuffer) | (1U << sMaxQuotient));
+                readBits(reader, quotient + 1);
+                if(quotient < sMaxQuotient) {
+                    residuals[i] = static_cast<uint16_t> ((quotient << riceParameter) | readBits(reader, riceParameter));
+                } else {
+                    residuals[i] = static_cast<uint16_t> (readBits(reader, 16));
+                }
+            }
+        }
+
+        // Codes can not end in the padding.
+        return reader.mPaddingBits <= reader.mBitCount;
+    }
+
+    uint32_t computeGreatestCommonDivisor(uint32_t value1,
+                                          uint32_t value2)
+    {
+        while(value2 != 0) {
+            const uint32_t remainder = value1 % value2;
+            value1 = value2;
+            value2 = remainder;
+        }
+
+        return value1;
+    }
+
+    // Compresses the tile (with rowPitch samples between rows) with
+    // every predictor and keeps the shortest one.
+    void compressTile(const uint16_t* samples,
+                      const uint32_t rowPitch,
+                      const uint32_t tileWidth,
+                      const uint32_t tileHeight,
+                      std::vector<uint8_t>& tileBytes)
+    {
+        uint32_t sampleStep = 0;
+        for(uint32_t row = 0; row < tileHeight && sampleStep != 1; ++row) {
+            for(uint32_t column = 0; column < tileWidth; ++column) {
+                sampleStep = computeGreatestCommonDivisor(sampleStep, samples[row * rowPitch + column]);
+            }
+        }
+
+        // A tile of 0 samples
+        sampleStep = (std::max)(sampleStep, 1U);
+
+        std::vector<uint16_t> steps(tileWidth * tileHeight);
+        for(uint32_t row = 0; row < tileHeight; ++row) {
+            for(uint32_t column = 0; column < tileWidth; ++column) {
+                steps[row * tileWidth + column] = static_cast<uint16_t> (samples[row * rowPitch + column] / sampleStep);
+            }
+        }
+
+        std::vector<uint16_t> residuals(tileWidth * tileHeight);
+        std::vector<uint8_t> candidateBytes;
+        tileBytes.clear();
+        for(uint32_t predictorIndex = 0; predictorIndex < sPredictorCount; ++predictorIndex) {
+            const Predictor predictor = static_cast<Predictor> (predictorIndex);
+            computeResiduals(&steps[0], tileWidth, tileHeight, predictor, &residuals[0]);
+
+            candidateBytes.clear();
+            candidateBytes.push_back(static_cast<uint8_t> (predictorIndex));
+            candidateBytes.push_back(static_cast<uint8_t> (sampleStep));
+            candidateBytes.push_back(static_cast<uint8_t> (sampleStep >> 8));
+            BitWriter writer(candidateBytes);
+            encodeResiduals(&residuals[0], static_cast<uint32_t> (residuals.size()), writer);
+            if(tileBytes.empty() || candidateBytes.size() < tileBytes.size()) {
+                tileBytes.swap(candidateBytes);
+            }
+        }
+    }
+
+    // Decodes a tile to samples, with no row padding.
+    bool decompressTile(const uint8_t* begin,
+                        const uint8_t* end,
+                        const uint32_t tileWidth,
+                        const uint32_t tileHeight,
+                        uint16_t* samples)
+    {
+        if(end - begin < 3 || *begin >= sPredictorCount) {
+            return false;
+        }
+
+        const uint16_t sampleStep = static_cast<uint16_t> (begin[1] | (begin[2] << 8));
+        BitReader reader(begin + 3, end);
+        if(!decodeResiduals(reader, tileWidth * tileHeight, samples)) {
+            return false;
+        }
+
+        switch(static_cast<Predictor> (*begin)) {
+        case Predictor::DELTA:
+            reconstructSamples<Predictor::DELTA>(tileWidth, tileHeight, samples);
+            break;
+        case Predictor::PAETH:
+            reconstructSamples<Predictor::PAETH>(tileWidth, tileHeight, samples);
+            break;
+        default:
+            reconstructSamples<Predictor::GRADIENT>(tileWidth, tileHeight, samples);
+            break;
+        }
+
+        if(sampleStep > 1) {
+            for(uint32_t i = 0; i < tileWidth * tileHeight; ++i) {
+                samples[i] = static_cast<uint16_t> (samples[i] * sampleStep);
+            }
+        }
+
+        return true;
+    }
+
+    uint32_t computeTilesPerSide(const uint32_t dimension,
+                                 const uint32_t tileDimension)
+    {
+        return (dimension + tileDimension - 1) / tileDimension;
+    }
+
+    // Reads the whole file and checks its header and tile offsets.
+    bool readFile(const std::string& filePath,
+                  std::vector<uint8_t>& bytes,
+                  FileHeader& header,
+                  const uint64_t*& tileOffsets,
+                  std::string* errorMessage)
+    {
+        std::ifstream file(filePath.c_str(), std::ios::binary | std::ios::ate);
+        if(!file) {
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to open " + filePath;
+            }
+
+            return false;
+        }
+
+        const uint64_t fileSize = static_cast<uint64_t> (file.tellg());
+        bytes.resize(static_cast<size_t> ((std::max)(fileSize, static_cast<uint64_t> (sizeof(FileHeader)))));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*> (&bytes[0]), fileSize);
+        memcpy(&header, &bytes[0], sizeof(header));
+
+        bool validFile = file &&
+                         fileSize >= sizeof(FileHeader) &&
+                         header.mMagic == sMagic &&
+                         header.mVersion == sVersion &&
+                         header.mTileDimension > 0 &&
+                         header.mDimension < 0x10000;
+        if(validFile) {
+            const uint32_t tilesPerSide = computeTilesPerSide(header.mDimension, header.mTileDimension);
+            const uint64_t tilesBegin = sizeof(FileHeader) + (header.mTileCount + 1ULL) * sizeof(uint64_t);
+            validFile = header.mTileCount == tilesPerSide * tilesPerSide && tilesBegin <= fileSize;
+            if(validFile) {
+                tileOffsets = reinterpret_cast<const uint64_t*> (&bytes[sizeof(FileHeader)]);
+                validFile = tileOffsets[0] == tilesBegin && tileOffsets[header.mTileCount] <= fileSize;
+                for(uint32_t tileIndex = 0; validFile && tileIndex < header.mTileCount; ++tileIndex) {
+                    validFile = tileOffsets[tileIndex] < tileOffsets[tileIndex + 1];
+                }
+            }
+        }
+
+        if(!validFile) {
+            if(errorMessage != nullptr) {
+                *errorMessage = filePath + " is not a compressed height map file of the current version";
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    // Decodes the tiles, calling storeTile(samples, tileRow, tileColumn,
+    // tileWidth, tileHeight) with the samples of every tile. Tiles are
+    // split across numThreads threads.
+    template<typename StoreTile>
+    bool decompressTiles(const std::vector<uint8_t>& bytes,
+                         const FileHeader& header,
+                         const uint64_t* tileOffsets,
+                         const uint32_t numThreads,
+                         const StoreTile& storeTile)
+    {
+        const uint32_t dimension = header.mDimension;
+        const uint32_t tileDimension = header.mTileDimension;
+        const uint32_t tilesPerSide = computeTilesPerSide(dimension, tileDimension);
+        std::vector<uint8_t> validTiles(header.mTileCount, 0);
+        ParallelUtils::parallelFor(0,
+                                   header.mTileCount,
+                                   numThreads,
+                                   [&](const uint32_t fromTile, const uint32_t toTile) {
+            std::vector<uint16_t> samples(tileDimension * tileDimension);
+            for(uint32_t tileIndex = fromTile; tileIndex < toTile; ++tileIndex) {
+                const uint32_t tileRow = tileIndex / tilesPerSide;
+                const uint32_t tileColumn = tileIndex % tilesPerSide;
+                const uint32_t tileWidth = (std::min)(tileDimension, dimension - tileColumn * tileDimension);
+                const uint32_t tileHeight = (std::min)(tileDimension, dimension - tileRow * tileDimension);
+                const uint8_t* begin = &bytes[0] + tileOffsets[tileIndex];
+                const uint8_t* end = &bytes[0] + tileOffsets[tileIndex + 1];
+                if(decompressTile(begin, end, tileWidth, tileHeight, &samples[0])) {
+                    storeTile(&samples[0], tileRow * tileDimension, tileColumn * tileDimension, tileWidth, tileHeight);
+                    validTiles[tileIndex] = 1;
+                }
+            }
+        });
+
+        return std::find(validTiles.begin(), validTiles.end(), 0) == validTiles.end();
+    }
+}
+
+namespace CompressedHeightMapUtils
+{
+    bool saveToFile(const std::string& filePath,
+                    const QuantizedHeightMap& heightMap,
+                    const uint32_t tileDimension,
+                    const uint32_t numThreads,
+                    std::string* errorMessage)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+        assert(heightMap.mDimension < 0x10000);
+        assert(tileDimension > 0);
+
+        const uint32_t dimension = heightMap.mDimension;
+        const uint32_t tilesPerSide = computeTilesPerSide(dimension, tileDimension);
+        const uint32_t tileCount = tilesPerSide * tilesPerSide;
+        std::vector<std::vector<uint8_t>> tiles(tileCount);
+        ParallelUtils::parallelFor(0,
+                                   tileCount,
+                                   numThreads,
+                                   [&](const uint32_t fromTile, const uint32_t toTile) {
+            for(uint32_t tileIndex = fromTile; tileIndex < toTile; ++tileIndex) {
+                const uint32_t fromRow = (tileIndex / tilesPerSide) * tileDimension;
+                const uint32_t fromColumn = (tileIndex % tilesPerSide) * tileDimension;
+                compressTile(&heightMap.mData[fromRow * dimension + fromColumn],
+                             dimension,
+                             (std::min)(tileDimension, dimension - fromColumn),
+                             (std::min)(tileDimension, dimension - fromRow),
+                             tiles[tileIndex]);
+            }
+        });
+
+        FileHeader header;
+        header.mMagic = sMagic;
+        header.mVersion = sVersion;
+        header.mDimension = dimension;
+        header.mTileDimension = tileDimension;
+        header.mScale = heightMap.mScale;
+        header.mOffset = heightMap.mOffset;
+        header.mTileCount = tileCount;
+        header.mReserved = 0;
+
+        std::vector<uint64_t> tileOffsets(tileCount + 1);
+        tileOffsets[0] = sizeof(FileHeader) + tileOffsets.size() * sizeof(uint64_t);
+        for(uint32_t tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+            tileOffsets[tileIndex + 1] = tileOffsets[tileIndex] + tiles[tileIndex].size();
+        }
+
+        // Write to a temporary file and rename it, so other runs never
+        // see a partially written file.
+        const std::string temporaryFilePath = filePath + ".tmp";
+        {
+            std::ofstream file(temporaryFilePath.c_str(), std::ios::binary | std::ios::trunc);
+            if(file) {
+                file.write(reinterpret_cast<const char*> (&header), sizeof(header));
+                file.write(reinterpret_cast<const char*> (&tileOffsets[0]), tileOffsets.size() * sizeof(uint64_t));
+                for(uint32_t tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+                    file.write(reinterpret_cast<const char*> (&tiles[tileIndex][0]), tiles[tileIndex].size());
+                }
+            }
+
+            if(!file) {
+                file.close();
+                DeleteFileA(temporaryFilePath.c_str());
+                if(errorMessage != nullptr) {
+                    *errorMessage = "Unable to write " + temporaryFilePath;
+                }
+
+                return false;
+            }
+        }
+
+        if(!MoveFileExA(temporaryFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileA(temporaryFilePath.c_str());
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to replace " + filePath;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    bool compressRAWFile(const std::string& rawFilePath,
+                         const uint32_t dimension,
+                         const float scaleFactor,
+                         const RAWFormat format,
+                         const std::string& filePath,
+                         const uint32_t tileDimension,
+                         std::string* errorMessage)
+    {
+        QuantizedHeightMap heightMap(dimension);
+        if(!HeightMapUtils::loadFromRAWFile(rawFilePath, scaleFactor, heightMap, format, errorMessage)) {
+            return false;
+        }
+
+        return saveToFile(filePath, heightMap, tileDimension, 0, errorMessage);
+    }
+
+    bool loadFromFile(const std::string& filePath,
+                      HeightMap& heightMap,
+                      const uint32_t numThreads,
+                      std::string* errorMessage)
+    {
+        std::vector<uint8_t> bytes;
+        FileHeader header;
+        const uint64_t* tileOffsets = nullptr;
+        if(!readFile(filePath, bytes, header, tileOffsets, errorMessage)) {
+            return false;
+        }
+
+        const uint32_t dimension = header.mDimension;
+        const float scale = header.mScale;
+        const float offset = header.mOffset;
+        heightMap.mDimension = dimension;
+        heightMap.mData.resize(dimension * dimension);
+        float* heights = heightMap.mData.empty() ? nullptr : &heightMap.mData[0];
+        const bool validTiles = decompressTiles(bytes,
+                                                header,
+                                                tileOffsets,
+                                                numThreads,
+                                                [&](const uint16_t* samples,
+                                                    const uint32_t fromRow,
+                                                    const uint32_t fromColumn,
+                                                    const uint32_t tileWidth,
+                                                    const uint32_t tileHeight) {
+            for(uint32_t row = 0; row < tileHeight; ++row) {
+                const uint16_t* rowSamples = samples + row * tileWidth;
+                float* rowHeights = heights + (fromRow + row) * dimension + fromColumn;
+                for(uint32_t column = 0; column < tileWidth; ++column) {
+                    rowHeights[column] = offset + scale * rowSamples[column];
+                }
+            }
+        });
+
+        if(!validTiles) {
+            if(errorMessage != nullptr) {
+                *errorMessage = filePath + " has corrupted tiles";
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    bool loadFromFile(const std::string& filePath,
+                      QuantizedHeightMap& heightMap,
+                      const uint32_t numThreads,
+                      std::string* errorMessage)
+    {
+        std::vector<uint8_t> bytes;
+        FileHeader header;
+        const uint64_t* tileOffsets = nullptr;
+        if(!readFile(filePath, bytes, header, tileOffsets, errorMessage)) {
+            return false;
+        }
+
+        const uint32_t dimension = header.mDimension;
+        heightMap.mDimension = dimension;
+        heightMap.mScale = header.mScale;
+        heightMap.mOffset = header.mOffset;
+        heightMap.mData.resize(dimension * dimension);
+        uint16_t* quantizedSamples = heightMap.mData.empty() ? nullptr : &heightMap.mData[0];
+        const bool validTiles = decompressTiles(bytes,
+                                                header,
+                                                tileOffsets,
+                                                numThreads,
+                                                [&](const uint16_t* samples,
+                                                    const uint32_t fromRow,
+                                                    const uint32_t fromColumn,
+                                                    const uint32_t tileWidth,
+                                                    const uint32_t tileHeight) {
+            for(uint32_t row = 0; row < tileHeight; ++row) {
+                memcpy(quantizedSamples + (fromRow + row) * dimension + fromColumn,
+                       samples + row * tileWidth,
+                       tileWidth * sizeof(uint16_t));
+            }
+        });
+
+        if(!validTiles) {
+            if(errorMessage != nullptr) {
+                *errorMessage = filePath + " has corrupted tiles";
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+}
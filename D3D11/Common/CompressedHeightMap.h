@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Compressed height map files.
+//
+// Samples of a QuantizedHeightMap are stored in square tiles that
+// are compressed independently, so they are decoded in parallel.
+// Every tile divides its samples by their greatest common divisor
+// (257 for 8-bit RAW samples), predicts each one from its left, top
+// and top left neighbors (delta, Paeth or gradient predictor, the one
+// that compresses the tile best) and Rice codes the prediction
+// residuals, with a Rice parameter per block of residuals. Samples
+// are stored with no loss.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <HeightMap.h>
+
+namespace CompressedHeightMapUtils
+{
+    // Tiles have tileDimension x tileDimension samples (less in the last
+    // row and column of tiles). Tiles are compressed with numThreads
+    // threads (0 uses all hardware threads).
+    // Return false (and fill errorMessage if it is not nullptr) if a
+    // file can not be read or written.
+    bool saveToFile(const std::string& filePath,
+                    const QuantizedHeightMap& heightMap,
+                    const uint32_t tileDimension = 128,
+                    const uint32_t numThreads = 0,
+                    std::string* errorMessage = nullptr);
+
+    // Compresses a RAW file loaded as HeightMapUtils::loadFromRAWFile does.
+    bool compressRAWFile(const std::string& rawFilePath,
+                         const uint32_t dimension,
+                         const float scaleFactor,
+                         const RAWFormat format,
+                         const std::string& filePath,
+                         const uint32_t tileDimension = 128,
+                         std::string* errorMessage = nullptr);
+
+    // The height map dimension is set from the file, and tiles are decoded
+    // by numThreads threads (0 uses all hardware threads) straight into
+    // its data. Return false (and fill errorMessage if it is not nullptr)
+    // if the file can not be read or it is not a valid file for the
+    // current version.
+    bool loadFromFile(const std::string& filePath,
+                      HeightMap& heightMap,
+                      const uint32_t numThreads = 0,
+                      std::string* errorMessage = nullptr);
+
+    bool loadFromFile(const std::string& filePath,
+                      QuantizedHeightMap& heightMap,
+                      const uint32_t numThreads = 0,
+                      std::string* errorMessage = nullptr);
+}
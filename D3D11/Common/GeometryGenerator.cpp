@@ -1,23 +1,73 @@
 #include "GeometryGenerator.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
 #include <DirectXMath.h>
+#include <unordered_map>
 
+#include <HeightMap.h>
 #include <MathHelper.h>
+#include <ParallelUtils.h>
+#include <ShapeBuilders.h>
 
 namespace
 {
-    void subdivide(MeshData& meshData)
+    // Icosahedron generateGeosphere starts from.
+    const float sIcosahedronFactor0 = 0.525731f;
+    const float sIcosahedronFactor1 = 0.850651f;
+
+    const size_t sIcosahedronVertexCount = 12;
+    const DirectX::XMFLOAT3 sIcosahedronPositions[sIcosahedronVertexCount] =
     {
-        // Save a copy of the input geometry.
-        MeshData inputCopy = meshData;
+        DirectX::XMFLOAT3(-sIcosahedronFactor0, 0.0f, sIcosahedronFactor1),
+        DirectX::XMFLOAT3(sIcosahedronFactor0, 0.0f, sIcosahedronFactor1),
+        DirectX::XMFLOAT3(-sIcosahedronFactor0, 0.0f, -sIcosahedronFactor1),
+        DirectX::XMFLOAT3(sIcosahedronFactor0, 0.0f, -sIcosahedronFactor1),
+        DirectX::XMFLOAT3(0.0f, sIcosahedronFactor1, sIcosahedronFactor0),
+        DirectX::XMFLOAT3(0.0f, sIcosahedronFactor1, -sIcosahedronFactor0),
+        DirectX::XMFLOAT3(0.0f, -sIcosahedronFactor1, sIcosahedronFactor0),
+        DirectX::XMFLOAT3(0.0f, -sIcosahedronFactor1, -sIcosahedronFactor0),
+        DirectX::XMFLOAT3(sIcosahedronFactor1, sIcosahedronFactor0, 0.0f),
+        DirectX::XMFLOAT3(-sIcosahedronFactor1, sIcosahedronFactor0, 0.0f),
+        DirectX::XMFLOAT3(sIcosahedronFactor1, -sIcosahedronFactor0, 0.0f),
+        DirectX::XMFLOAT3(-sIcosahedronFactor1, -sIcosahedronFactor0, 0.0f)
+    };
+
+    const size_t sIcosahedronIndexCount = 60;
+    const uint32_t sIcosahedronIndices[sIcosahedronIndexCount] =
+    {
+        1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+        1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+        3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+        10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+    };
+
+    DirectX::XMFLOAT3 computeMidpoint(const DirectX::XMFLOAT3& position0,
+                                      const DirectX::XMFLOAT3& position1)
+    {
+        return DirectX::XMFLOAT3(
+            0.5f * (position0.x + position1.x),
+            0.5f * (position0.y + position1.y),
+            0.5f * (position0.z + position1.z)
+        );
+    }
 
-        const uint32_t numTriangles = static_cast<uint32_t> (inputCopy.mIndices.size() / 3);
+    // For subdivision, we just care about the position component.
+    // We derive the other vertex components in buildGeosphereVertices.
+    void subdivide(std::vector<DirectX::XMFLOAT3>& positions,
+                   std::vector<uint32_t>& indices)
+    {
+        // Save a copy of the input geometry.
+        std::vector<DirectX::XMFLOAT3> inputPositions;
+        inputPositions.swap(positions);
+        std::vector<uint32_t> inputIndices;
+        inputIndices.swap(indices);
 
-        meshData.mVertices.clear();
-        meshData.mVertices.reserve(numTriangles * 6);
+        const uint32_t numTriangles = static_cast<uint32_t> (inputIndices.size() / 3);
 
-        meshData.mIndices.clear();
-        meshData.mIndices.reserve(numTriangles * 12);
+        positions.reserve(numTriangles * 6);
+        indices.reserve(numTriangles * 12);
 
         //       v1
         //       *
@@ -29,521 +79,626 @@ namespace
         // *-----*-----*
         // v0    m2     v2
 
-        VertexData v0, v1, v2, m0, m1, m2;
         for(uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex) {
-            v0 = inputCopy.mVertices[ inputCopy.mIndices[triangleIndex * 3 + 0] ];
-            v1 = inputCopy.mVertices[ inputCopy.mIndices[triangleIndex * 3 + 1] ];
-            v2 = inputCopy.mVertices[ inputCopy.mIndices[triangleIndex * 3 + 2] ];
-
-            // Generate the midpoints.
-            // For subdivision, we just care about the position component.  
-            // We derive the other vertex components in CreateGeosphere.
-            m0.mPosition = DirectX::XMFLOAT3A(
-                0.5f * (v0.mPosition.x + v1.mPosition.x),
-                0.5f * (v0.mPosition.y + v1.mPosition.y),
-                0.5f * (v0.mPosition.z + v1.mPosition.z)
-            );
-
-            m1.mPosition = DirectX::XMFLOAT3A(
-                0.5f * (v1.mPosition.x + v2.mPosition.x),
-                0.5f * (v1.mPosition.y + v2.mPosition.y),
-                0.5f * (v1.mPosition.z + v2.mPosition.z)
-            );
-
-            m2.mPosition = DirectX::XMFLOAT3A(
-                0.5f * (v0.mPosition.x + v2.mPosition.x),
-                0.5f * (v0.mPosition.y + v2.mPosition.y),
-                0.5f * (v0.mPosition.z + v2.mPosition.z)
-            );
+            const DirectX::XMFLOAT3& v0 = inputPositions[ inputIndices[triangleIndex * 3 + 0] ];
+            const DirectX::XMFLOAT3& v1 = inputPositions[ inputIndices[triangleIndex * 3 + 1] ];
+            const DirectX::XMFLOAT3& v2 = inputPositions[ inputIndices[triangleIndex * 3 + 2] ];
 
             // Add new geometry.
-            meshData.mVertices.push_back(v0); // 0
-            meshData.mVertices.push_back(v1); // 1
-            meshData.mVertices.push_back(v2); // 2
-            meshData.mVertices.push_back(m0); // 3
-            meshData.mVertices.push_back(m1); // 4
-            meshData.mVertices.push_back(m2); // 5
-
-            meshData.mIndices.push_back(triangleIndex * 6 + 0);
-            meshData.mIndices.push_back(triangleIndex * 6 + 3);
-            meshData.mIndices.push_back(triangleIndex * 6 + 5);
-
-            meshData.mIndices.push_back(triangleIndex * 6 + 3);
-            meshData.mIndices.push_back(triangleIndex * 6 + 4);
-            meshData.mIndices.push_back(triangleIndex * 6 + 5);
-
-            meshData.mIndices.push_back(triangleIndex * 6 + 5);
-            meshData.mIndices.push_back(triangleIndex * 6 + 4);
-            meshData.mIndices.push_back(triangleIndex * 6 + 2);
-
-            meshData.mIndices.push_back(triangleIndex * 6 + 3);
-            meshData.mIndices.push_back(triangleIndex * 6 + 1);
-            meshData.mIndices.push_back(triangleIndex * 6 + 4);
+            positions.push_back(v0); // 0
+            positions.push_back(v1); // 1
+            positions.push_back(v2); // 2
+            positions.push_back(computeMidpoint(v0, v1)); // 3
+            positions.push_back(computeMidpoint(v1, v2)); // 4
+            positions.push_back(computeMidpoint(v0, v2)); // 5
+
+            indices.push_back(triangleIndex * 6 + 0);
+            indices.push_back(triangleIndex * 6 + 3);
+            indices.push_back(triangleIndex * 6 + 5);
+
+            indices.push_back(triangleIndex * 6 + 3);
+            indices.push_back(triangleIndex * 6 + 4);
+            indices.push_back(triangleIndex * 6 + 5);
+
+            indices.push_back(triangleIndex * 6 + 5);
+            indices.push_back(triangleIndex * 6 + 4);
+            indices.push_back(triangleIndex * 6 + 2);
+
+            indices.push_back(triangleIndex * 6 + 3);
+            indices.push_back(triangleIndex * 6 + 1);
+            indices.push_back(triangleIndex * 6 + 4);
         }
     }
 
+    // Returns the index of the midpoint of the edge (index0, index1).
+    // The midpoint is appended to positions only the first time
+    // the edge is visited, so both triangles sharing the edge reuse it.
+    uint32_t edgeMidpoint(const uint32_t index0,
+                          const uint32_t index1,
+                          std::unordered_map<uint64_t, uint32_t>& midpointCache,
+                          std::vector<DirectX::XMFLOAT3>& positions)
+    {
+        // Key must not depend on the edge direction.
+        const uint64_t minIndex = MathHelper::computeMin(index0, index1);
+        const uint64_t maxIndex = MathHelper::computeMax(index0, index1);
+        const uint64_t key = (minIndex << 32) | maxIndex;
+
+        const std::unordered_map<uint64_t, uint32_t>::const_iterator it = midpointCache.find(key);
+        if(it != midpointCache.end()) {
+            return it->second;
+        }
 
-    void buildCylinderTopCap(const float bottomRadius, 
-                             const float topRadius, 
-                             const float height,
-                             const uint32_t sliceCount, 
-                             const uint32_t stackCount, 
-                             MeshData& meshData)
+        const uint32_t midpointIndex = static_cast<uint32_t> (positions.size());
+        positions.push_back(computeMidpoint(positions[index0], positions[index1]));
+        midpointCache.insert(std::make_pair(key, midpointIndex));
+
+        return midpointIndex;
+    }
+
+    // Same triangle split than subdivide() but vertices are shared
+    // between adjacent triangles. Input vertices keep their indices and
+    // each edge adds a single midpoint vertex, so the mesh ends with
+    // V + E vertices instead of 6 * T.
+    void subdivideWelded(std::vector<DirectX::XMFLOAT3>& positions,
+                         std::vector<uint32_t>& indices)
     {
-        const uint32_t baseIndex = static_cast<uint32_t> (meshData.mVertices.size());
+        // Move input indices out, positions are extended in place.
+        std::vector<uint32_t> inputIndices;
+        inputIndices.swap(indices);
 
-        const float y = 0.5f * height;
-        const float dTheta = 2.0f * DirectX::XM_PI / sliceCount;
+        const uint32_t numTriangles = static_cast<uint32_t> (inputIndices.size() / 3);
 
-        // Duplicate cap ring vertices because the texture coordinates and normals differ.
-        for(size_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
-            const float x = topRadius * cosf(sliceIndex * dTheta);
-            const float z = topRadius * sinf(sliceIndex * dTheta);
+        // In a closed triangle mesh every edge is shared by 2 triangles,
+        // so there are 3 * T / 2 edges.
+        const size_t numEdges = (numTriangles * 3) / 2;
+        positions.reserve(positions.size() + numEdges);
 
-            // Scale down by the height to try and make top cap texture coord area
-            // proportional to base.
-            const float u = x / height + 0.5f;
-            const float v = z / height + 0.5f;
+        indices.reserve(numTriangles * 12);
 
-            const VertexData newVertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v);
-            meshData.mVertices.push_back(newVertex);
-        }
+        std::unordered_map<uint64_t, uint32_t> midpointCache;
+        midpointCache.reserve(numEdges);
 
-        // Cap center vertex.
-        const VertexData newVertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f);
-        meshData.mVertices.push_back(newVertex);
+        //       v1
+        //       *
+        //      / \
+        //     /   \
+        //  m0*-----*m1
+        //   / \   / \
+        //  /   \ /   \
+        // *-----*-----*
+        // v0    m2     v2
 
-        // Index of center vertex.
-        const uint32_t centerIndex = static_cast<uint32_t> (meshData.mVertices.size() - 1);
-        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
-            meshData.mIndices.push_back(centerIndex);
-            meshData.mIndices.push_back(baseIndex + sliceIndex + 1);
-            meshData.mIndices.push_back(baseIndex + sliceIndex);
-        }
-    }
+        for(uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex) {
+            const uint32_t v0 = inputIndices[triangleIndex * 3 + 0];
+            const uint32_t v1 = inputIndices[triangleIndex * 3 + 1];
+            const uint32_t v2 = inputIndices[triangleIndex * 3 + 2];
 
-    void buildCylinderBottomCap(const float bottomRadius, 
-                                const float topRadius, 
-                                const float height,
-                                const uint32_t sliceCount, 
-                                const uint32_t stackCount, 
-                                MeshData& meshData)
-    {	 
-        // Build bottom cap.
-        const uint32_t baseIndex = static_cast<uint32_t> (meshData.mVertices.size());
-        const float y = -0.5f * height;
-
-        // vertices of ring
-        const float dTheta = 2.0f * DirectX::XM_PI / sliceCount;
-        for(uint32_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
-            const float x = bottomRadius * cosf(sliceIndex * dTheta);
-            const float z = bottomRadius * sinf(sliceIndex * dTheta);
-
-            // Scale down by the height to try and make top cap texture coord area
-            // proportional to base.
-            const float u = x / height + 0.5f;
-            const float v = z / height + 0.5f;
-
-            const VertexData newVertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v);
-            meshData.mVertices.push_back(newVertex);
-        }
+            const uint32_t m0 = edgeMidpoint(v0, v1, midpointCache, positions);
+            const uint32_t m1 = edgeMidpoint(v1, v2, midpointCache, positions);
+            const uint32_t m2 = edgeMidpoint(v0, v2, midpointCache, positions);
+
+            indices.push_back(v0);
+            indices.push_back(m0);
+            indices.push_back(m2);
 
-        // Cap center vertex.
-        const VertexData newVertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f);
-        meshData.mVertices.push_back(newVertex);
+            indices.push_back(m0);
+            indices.push_back(m1);
+            indices.push_back(m2);
 
-        // Cache the index of center vertex.
-        const uint32_t centerIndex = static_cast<uint32_t> (meshData.mVertices.size() - 1);
-        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
-            meshData.mIndices.push_back(centerIndex);
-            meshData.mIndices.push_back(baseIndex + sliceIndex);
-            meshData.mIndices.push_back(baseIndex + sliceIndex + 1);
+            indices.push_back(m2);
+            indices.push_back(m1);
+            indices.push_back(v2);
+
+            indices.push_back(m0);
+            indices.push_back(v1);
+            indices.push_back(m1);
         }
     }
-}
 
-namespace GeometryGenerator
-{
-    void generateBox(const float width, 
-                     const float height, 
-                     const float depth, 
-                     MeshData& meshData)
+    // Subdivided icosahedron of generateGeosphere, before it is
+    // projected onto the sphere.
+    void buildGeospherePositions(const uint32_t numSubdivisions,
+                                 const GeometryGenerator::SubdivisionMode subdivisionMode,
+                                 std::vector<DirectX::XMFLOAT3>& positions,
+                                 std::vector<uint32_t>& indices)
     {
-        // Create the vertices.
-        VertexData vertices[24];
-
-        const float halfWidth = 0.5f * width;
-        const float halfHeight = 0.5f * height;
-        const float halfDepth = 0.5f * depth;
-
-        // Fill in the front face vertex data.
-        vertices[0] = VertexData(-halfWidth, -halfHeight, -halfDepth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-        vertices[1] = VertexData(-halfWidth, +halfHeight, -halfDepth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-        vertices[2] = VertexData(+halfWidth, +halfHeight, -halfDepth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-        vertices[3] = VertexData(+halfWidth, -halfHeight, -halfDepth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-
-        // Fill in the back face vertex data.
-        vertices[4] = VertexData(-halfWidth, -halfHeight, +halfDepth, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-        vertices[5] = VertexData(+halfWidth, -halfHeight, +halfDepth, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-        vertices[6] = VertexData(+halfWidth, +halfHeight, +halfDepth, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-        vertices[7] = VertexData(-halfWidth, +halfHeight, +halfDepth, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-
-        // Fill in the top face vertex data.
-        vertices[8]  = VertexData(-halfWidth, +halfHeight, -halfDepth, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-        vertices[9]  = VertexData(-halfWidth, +halfHeight, +halfDepth, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-        vertices[10] = VertexData(+halfWidth, +halfHeight, +halfDepth, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-        vertices[11] = VertexData(+halfWidth, +halfHeight, -halfDepth, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-
-        // Fill in the bottom face vertex data.
-        vertices[12] = VertexData(-halfWidth, -halfHeight, -halfDepth, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-        vertices[13] = VertexData(+halfWidth, -halfHeight, -halfDepth, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-        vertices[14] = VertexData(+halfWidth, -halfHeight, +halfDepth, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-        vertices[15] = VertexData(-halfWidth, -halfHeight, +halfDepth, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-
-        // Fill in the left face vertex data.
-        vertices[16] = VertexData(-halfWidth, -halfHeight, +halfDepth, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f);
-        vertices[17] = VertexData(-halfWidth, +halfHeight, +halfDepth, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f);
-        vertices[18] = VertexData(-halfWidth, +halfHeight, -halfDepth, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f);
-        vertices[19] = VertexData(-halfWidth, -halfHeight, -halfDepth, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f);
-
-        // Fill in the right face vertex data.
-        vertices[20] = VertexData(+halfWidth, -halfHeight, -halfDepth, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f);
-        vertices[21] = VertexData(+halfWidth, +halfHeight, -halfDepth, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
-        vertices[22] = VertexData(+halfWidth, +halfHeight, +halfDepth, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
-        vertices[23] = VertexData(+halfWidth, -halfHeight, +halfDepth, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
-
-        meshData.mVertices.assign(&vertices[0], &vertices[24]);
+        positions.assign(&sIcosahedronPositions[0], &sIcosahedronPositions[sIcosahedronVertexCount]);
+        indices.assign(&sIcosahedronIndices[0], &sIcosahedronIndices[sIcosahedronIndexCount]);
 
-        // Create the indices.
-        uint32_t indices[36];
-
-        // Fill in the front face index data
-        indices[0] = 0; indices[1] = 1; indices[2] = 2;
-        indices[3] = 0; indices[4] = 2; indices[5] = 3;
+        for(size_t subdivisionIndex = 0; 
+                   subdivisionIndex < numSubdivisions; 
+                   ++subdivisionIndex) {
+            if(subdivisionMode == GeometryGenerator::SubdivisionMode::WELDED) {
+                subdivideWelded(positions, indices);
+            } else {
+                subdivide(positions, indices);
+            }
+        }
+    }
 
-        // Fill in the back face index data
-        indices[6] = 4; indices[7]  = 5; indices[8]  = 6;
-        indices[9] = 4; indices[10] = 6; indices[11] = 7;
+    // Resizes the arrays of the streams included in streamMask 
+    // and releases the memory of the rest.
+    void resizeStreams(const uint32_t vertexCount,
+                       const uint32_t streamMask,
+                       MeshStreams& meshStreams)
+    {
+        meshStreams.mVertexCount = vertexCount;
+        meshStreams.mStreamMask = streamMask;
 
-        // Fill in the top face index data
-        indices[12] = 8; indices[13] =  9; indices[14] = 10;
-        indices[15] = 8; indices[16] = 10; indices[17] = 11;
+        std::vector<float>* const streams[] = 
+        {
+            &meshStreams.mPositionX, &meshStreams.mPositionY, &meshStreams.mPositionZ,
+            &meshStreams.mNormalX, &meshStreams.mNormalY, &meshStreams.mNormalZ,
+            &meshStreams.mTangentUX, &meshStreams.mTangentUY, &meshStreams.mTangentUZ,
+            &meshStreams.mTexCoordU, &meshStreams.mTexCoordV
+        };
 
-        // Fill in the bottom face index data
-        indices[18] = 12; indices[19] = 13; indices[20] = 14;
-        indices[21] = 12; indices[22] = 14; indices[23] = 15;
+        const uint32_t streamFlags[] = 
+        {
+            MeshStream::POSITION, MeshStream::POSITION, MeshStream::POSITION,
+            MeshStream::NORMAL, MeshStream::NORMAL, MeshStream::NORMAL,
+            MeshStream::TANGENT_U, MeshStream::TANGENT_U, MeshStream::TANGENT_U,
+            MeshStream::TEXCOORD, MeshStream::TEXCOORD
+        };
 
-        // Fill in the left face index data
-        indices[24] = 16; indices[25] = 17; indices[26] = 18;
-        indices[27] = 16; indices[28] = 18; indices[29] = 19;
+        const size_t numStreams = sizeof(streamFlags) / sizeof(streamFlags[0]);
+        for(size_t streamIndex = 0; streamIndex < numStreams; ++streamIndex) {
+            if(streamMask & streamFlags[streamIndex]) {
+                streams[streamIndex]->resize(vertexCount);
+            } else {
+                std::vector<float>().swap(*streams[streamIndex]);
+            }
+        }
+    }
 
-        // Fill in the right face index data
-        indices[30] = 20; indices[31] = 21; indices[32] = 22;
-        indices[33] = 20; indices[34] = 22; indices[35] = 23;
+    void storePosition(const size_t vertexIndex, 
+                       const DirectX::XMFLOAT3& position, 
+                       MeshStreams& meshStreams)
+    {
+        meshStreams.mPositionX[vertexIndex] = position.x;
+        meshStreams.mPositionY[vertexIndex] = position.y;
+        meshStreams.mPositionZ[vertexIndex] = position.z;
+    }
 
-        meshData.mIndices.assign(&indices[0], &indices[36]);
+    void storeNormal(const size_t vertexIndex, 
+                     const DirectX::XMFLOAT3& normal, 
+                     MeshStreams& meshStreams)
+    {
+        meshStreams.mNormalX[vertexIndex] = normal.x;
+        meshStreams.mNormalY[vertexIndex] = normal.y;
+        meshStreams.mNormalZ[vertexIndex] = normal.z;
     }
 
-    void generateSphere(const float radius, 
-                        const uint32_t sliceCount, 
-                        const uint32_t stackCount, 
-                        MeshData& meshData)
+    void storeTangentU(const size_t vertexIndex, 
+                       const DirectX::XMFLOAT3& tangentU, 
+                       MeshStreams& meshStreams)
     {
-        meshData.mVertices.clear();
-        meshData.mVertices.reserve(stackCount * (sliceCount - 1));
+        meshStreams.mTangentUX[vertexIndex] = tangentU.x;
+        meshStreams.mTangentUY[vertexIndex] = tangentU.y;
+        meshStreams.mTangentUZ[vertexIndex] = tangentU.z;
+    }
 
-        meshData.mIndices.clear();
-        meshData.mIndices.reserve(sliceCount + ((stackCount - 1) * (sliceCount)) + sliceCount);
+    void storeTexCoord(const size_t vertexIndex, 
+                       const DirectX::XMFLOAT2& texCoord,
+                       MeshStreams& meshStreams)
+    {
+        meshStreams.mTexCoordU[vertexIndex] = texCoord.x;
+        meshStreams.mTexCoordV[vertexIndex] = texCoord.y;
+    }
 
-        // Compute the vertices stating at the top pole and moving down the stacks.
-        // Poles: note that there will be texture coordinate distortion as there is
-        // not a unique point on the texture map to assign to the pole when mapping
-        // a rectangular texture onto a sphere.
-        VertexData topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-        VertexData bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    //
+    // Vertex writers of the ShapeBuilders builders, that hand them
+    // a vertex at a time with writer(vertexIndex, vertex).
+    //
 
-        meshData.mVertices.push_back(topVertex);
+    // Writes to the vertices of meshData, that must be already sized.
+    struct MeshDataWriter
+    {
+        explicit MeshDataWriter(MeshData& meshData)
+            : mVertices(meshData.mVertices.empty() ? nullptr : &meshData.mVertices[0])
+        {
 
-        const float phiStep = DirectX::XM_PI / stackCount;
-        const float thetaStep = 2.0f * DirectX::XM_PI / sliceCount;
+        }
 
+        void operator()(const size_t vertexIndex,
+                        const VertexData& vertex) const
         {
-            // Compute vertices for each stack ring (do not count the poles as rings).
-            DirectX::XMVECTOR tangentU;
-            DirectX::XMVECTOR position;
-            for(size_t stackIndex = 1; stackIndex <= stackCount - 1; ++stackIndex) {
-                const float phi = stackIndex * phiStep;
+            mVertices[vertexIndex] = vertex;
+        }
 
-                // Vertices of ring.
-                VertexData vertex;		
-                for(size_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
-                    const float theta = sliceIndex * thetaStep;
+        VertexData* mVertices;
+    };
 
-                    // spherical to cartesian
-                    vertex.mPosition.x = radius * sinf(phi) * cosf(theta);
-                    vertex.mPosition.y = radius * cosf(phi);
-                    vertex.mPosition.z = radius * sinf(phi) * sinf(theta);
+    // Writes the streams of meshStreams (that must be already sized)
+    // included in its stream mask.
+    struct MeshStreamsWriter
+    {
+        explicit MeshStreamsWriter(MeshStreams& meshStreams)
+            : mMeshStreams(&meshStreams)
+        {
 
-                    // Partial derivative of P with respect to theta
-                    vertex.mTangentU.x = -radius * sinf(phi) * sinf(theta);
-                    vertex.mTangentU.y = 0.0f;
-                    vertex.mTangentU.z = +radius * sinf(phi) * cosf(theta);
+        }
 
-                    tangentU = DirectX::XMLoadFloat3(&vertex.mTangentU);
-                    DirectX::XMStoreFloat3(&vertex.mTangentU, DirectX::XMVector3Normalize(tangentU));
+        void operator()(const size_t vertexIndex,
+                        const VertexData& vertex) const
+        {
+            const uint32_t streamMask = mMeshStreams->mStreamMask;
+            if(streamMask & MeshStream::POSITION) {
+                storePosition(vertexIndex, vertex.mPosition, *mMeshStreams);
+            }
 
-                    position = DirectX::XMLoadFloat3(&vertex.mPosition);
-                    DirectX::XMStoreFloat3(&vertex.mNormal, DirectX::XMVector3Normalize(position));
+            if(streamMask & MeshStream::NORMAL) {
+                storeNormal(vertexIndex, vertex.mNormal, *mMeshStreams);
+            }
 
-                    vertex.mTexCoord.x = theta / DirectX::XM_2PI;
-                    vertex.mTexCoord.y = phi / DirectX::XM_PI;
+            if(streamMask & MeshStream::TANGENT_U) {
+                storeTangentU(vertexIndex, vertex.mTangentU, *mMeshStreams);
+            }
 
-                    meshData.mVertices.push_back(vertex);
-                }
+            if(streamMask & MeshStream::TEXCOORD) {
+                storeTexCoord(vertexIndex, vertex.mTexCoord, *mMeshStreams);
             }
         }
 
-        meshData.mVertices.push_back(bottomVertex);
+        MeshStreams* mMeshStreams;
+    };
 
-        // Compute indices for top stack.  The top stack was written first to the vertex buffer
-        // and connects the top pole to the first ring.
-        for(uint32_t sliceIndex = 1; sliceIndex <= sliceCount; ++sliceIndex) {
-            meshData.mIndices.push_back(0);
-            meshData.mIndices.push_back(sliceIndex+1);
-            meshData.mIndices.push_back(sliceIndex);
-        }
+    // Sphere vertex of generateGeosphere of the subdivided icosahedron vertex position.
+    template<typename VertexWriter>
+    void buildGeosphereVertex(const float radius,
+                              const DirectX::XMFLOAT3& position,
+                              const uint32_t streamMask,
+                              const size_t vertexIndex,
+                              const VertexWriter& vertexWriter)
+    {
+        VertexData vertex;
 
-        // Compute indices for inner stacks (not connected to poles).
-        // Offset the indices to the index of the first vertex in the first ring.
-        // This is just skipping the top pole vertex.
-        uint32_t baseIndex = 1;
-        const uint32_t ringVertexCount = sliceCount + 1;
-        for(uint32_t stackIndex = 0; stackIndex < stackCount - 2; ++stackIndex) {
-            for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
-                meshData.mIndices.push_back(baseIndex + stackIndex * ringVertexCount + sliceIndex);
-                meshData.mIndices.push_back(baseIndex + stackIndex * ringVertexCount + sliceIndex+1);
-                meshData.mIndices.push_back(baseIndex + (stackIndex + 1) * ringVertexCount + sliceIndex);
-
-                meshData.mIndices.push_back(baseIndex + (stackIndex + 1) * ringVertexCount + sliceIndex);
-                meshData.mIndices.push_back(baseIndex + stackIndex * ringVertexCount + sliceIndex + 1);
-                meshData.mIndices.push_back(baseIndex + (stackIndex + 1) * ringVertexCount + sliceIndex + 1);
-            }
-        }
+        // Project onto unit sphere.
+        DirectX::XMStoreFloat3(&vertex.mNormal, DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&position)));
 
-        // Compute indices for bottom stack. The bottom stack was written last to the vertex buffer
-        // and connects the bottom pole to the bottom ring.
-        // South pole vertex was added last.
-        const uint32_t southPoleIndex = static_cast<uint32_t> (meshData.mVertices.size() - 1);
+        // Project onto sphere.
+        vertex.mPosition = DirectX::XMFLOAT3(vertex.mNormal.x * radius,
+                                             vertex.mNormal.y * radius,
+                                             vertex.mNormal.z * radius);
 
-        // Offset the indices to the index of the first vertex in the last ring.
-        baseIndex = southPoleIndex - ringVertexCount;
+        if(streamMask & (MeshStream::TANGENT_U | MeshStream::TEXCOORD)) {
+            // Derive texture coordinates from spherical coordinates.
+            const float theta = MathHelper::angle(vertex.mPosition.x, vertex.mPosition.z);
+            const float phi = acosf(vertex.mPosition.y / radius);
 
-        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
-            meshData.mIndices.push_back(southPoleIndex);
-            meshData.mIndices.push_back(baseIndex + sliceIndex);
-            meshData.mIndices.push_back(baseIndex + sliceIndex + 1);
+            vertex.mTexCoord.x = theta / DirectX::XM_2PI;
+            vertex.mTexCoord.y = phi / DirectX::XM_PI;
+
+            if(streamMask & MeshStream::TANGENT_U) {
+                // Partial derivative of P with respect to theta
+                vertex.mTangentU.x = -radius * sinf(phi) * sinf(theta);
+                vertex.mTangentU.y = 0.0f;
+                vertex.mTangentU.z = +radius * sinf(phi) * cosf(theta);
+
+                const DirectX::XMVECTOR tangentU = DirectX::XMLoadFloat3(&vertex.mTangentU);
+                DirectX::XMStoreFloat3(&vertex.mTangentU, DirectX::XMVector3Normalize(tangentU));
+            }
         }
+
+        vertexWriter(vertexIndex, vertex);
     }
 
-    void generateGeosphere(const float radius, 
-                           const uint32_t numSubdivisions, 
-                           MeshData& meshData)
+    void resizeGrid(const uint32_t numRows, 
+                    const uint32_t numColumns, 
+                    MeshData& meshData)
     {
-        // Approximate a sphere by tessellating an icosahedron.
-        const float factor0 = 0.525731f; 
-        const float factor1 = 0.850651f;
+        const MeshSize meshSize = GeometryGenerator::computeGridSize(numRows, numColumns);
+        meshData.mVertices.resize(meshSize.mVertexCount);
+        meshData.mIndices.resize(meshSize.mIndexCount);
+    }
 
-        const size_t numPositions = 12;
-        DirectX::XMFLOAT3A positions[numPositions] = 
-        {
-            DirectX::XMFLOAT3A(-factor0, 0.0f, factor1), 
-            DirectX::XMFLOAT3A(factor0, 0.0f, factor1),  
-            DirectX::XMFLOAT3A(-factor0, 0.0f, -factor1), 
-            DirectX::XMFLOAT3A(factor0, 0.0f, -factor1),    
-            DirectX::XMFLOAT3A(0.0f, factor1, factor0), 
-            DirectX::XMFLOAT3A(0.0f, factor1, -factor0), 
-            DirectX::XMFLOAT3A(0.0f, -factor1, factor0),  
-            DirectX::XMFLOAT3A(0.0f, -factor1, -factor0),    
-            DirectX::XMFLOAT3A(factor1, factor0, 0.0f), 
-            DirectX::XMFLOAT3A(-factor1, factor0, 0.0f), 
-            DirectX::XMFLOAT3A(factor1, -factor0, 0.0f),
-            DirectX::XMFLOAT3A(-factor1, -factor0, 0.0f)
-        };
+    const uint32_t sInterlockingTilesControlPoints = 12;
 
-        const size_t numIndices = 60;
-        uint32_t indices[numIndices] = 
-        {
-            1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,    
-            1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,    
-            3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0, 
-            10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7 
-        };
+    // Control points of the interlocking tiles patch of quad (rowIndex, columnIndex).
+    void buildInterlockingTilesPatch(const uint32_t numRows, 
+                                     const uint32_t numColumns, 
+                                     const uint32_t rowIndex, 
+                                     const uint32_t columnIndex, 
+                                     uint32_t* controlPoints)
+    {
+        const uint32_t vexterPerColumn = numColumns + 1;
 
-        meshData.mVertices.resize(numPositions);
-        meshData.mIndices.resize(numIndices);
+        // Neighbor rows and columns are clamped to the grid. 
+        // Signed, so -1 is clamped to 0.
+        const int32_t row = static_cast<int32_t> (rowIndex);
+        const int32_t column = static_cast<int32_t> (columnIndex);
+        const int32_t lastRow = static_cast<int32_t> (numRows);
+        const int32_t lastColumn = static_cast<int32_t> (numColumns);
+
+        const uint32_t rowMinus1 = MathHelper::clamp<int32_t>(row - 1, 0, lastRow) * vexterPerColumn;
+        const uint32_t row0 = rowIndex * vexterPerColumn;
+        const uint32_t row1 = (rowIndex + 1) * vexterPerColumn;
+        const uint32_t row2 = MathHelper::clamp<int32_t>(row + 2, 0, lastRow) * vexterPerColumn;
+
+        const uint32_t columnMinus1 = MathHelper::clamp<int32_t>(column - 1, 0, lastColumn);
+        const uint32_t column0 = columnIndex;
+        const uint32_t column1 = columnIndex + 1;
+        const uint32_t column2 = MathHelper::clamp<int32_t>(column + 2, 0, lastColumn);
+
+        // 0-3 are the actual quad vertices
+        controlPoints[0] = column0 + row0;
+        controlPoints[1] = column1 + row0;
+        controlPoints[2] = column0 + row1;
+        controlPoints[3] = column1 + row1;
+
+        // 4-5 are +z
+        controlPoints[4] = column0 + row2;
+        controlPoints[5] = column1 + row2;
+
+        // 6-7 are +x
+        controlPoints[6] = column2 + row0;
+        controlPoints[7] = column2 + row1;
+
+        // 8-9 are -z
+        controlPoints[8] = column0 + rowMinus1;
+        controlPoints[9] = column1 + rowMinus1;
+
+        // 10-11 are -x
+        controlPoints[10] = columnMinus1 + row0;
+        controlPoints[11] = columnMinus1 + row1;
+    }
 
-        for(size_t positionIndex = 0; positionIndex < numPositions; ++positionIndex) {
-            meshData.mVertices[positionIndex].mPosition = positions[positionIndex];
+    // Control points of all the patches of row rowIndex.
+    void buildInterlockingTilesRow(const uint32_t numRows, 
+                                   const uint32_t numColumns, 
+                                   const uint32_t rowIndex, 
+                                   uint32_t* controlPoints)
+    {
+        // Only the first and last columns need their neighbor columns clamped.
+        buildInterlockingTilesPatch(numRows, numColumns, rowIndex, 0, controlPoints);
+        if(numColumns < 2) {
+            return;
         }
 
-        for(size_t indicesIndex = 0; indicesIndex < numIndices; ++indicesIndex) {
-            meshData.mIndices[indicesIndex] = indices[indicesIndex];
+        buildInterlockingTilesPatch(numRows, 
+                                    numColumns, 
+                                    rowIndex, 
+                                    numColumns - 1, 
+                                    controlPoints + (numColumns - 1) * sInterlockingTilesControlPoints);
+        if(numColumns < 3) {
+            return;
         }
 
-        for(size_t subdivisionIndex = 0; 
-                   subdivisionIndex < numSubdivisions; 
-                   ++subdivisionIndex) {
-            subdivide(meshData);
-        }
+        // Inner patches are the ones of column 1 shifted by a vertex per column,
+        // so they are computed adding 1 to its 12 control points, 4 at a time.
+        uint32_t firstPatch[sInterlockingTilesControlPoints];
+        buildInterlockingTilesPatch(numRows, numColumns, rowIndex, 1, firstPatch);
 
-        {
-            // Project vertices onto sphere and scale.
-            DirectX::XMVECTOR normal;
-            DirectX::XMVECTOR position;
-            DirectX::XMVECTOR tangentU;
-            DirectX::XMFLOAT3A normalAux;
-            const size_t numVertices = meshData.mVertices.size();
-            for(size_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
-                // Project onto unit sphere.
-                normal = DirectX::XMVector3Normalize(DirectX::XMLoadFloat3(&meshData.mVertices[vertexIndex].mPosition));
-                DirectX::XMStoreFloat3(&meshData.mVertices[vertexIndex].mNormal, normal);
-
-                // Project onto sphere.
-                normalAux = DirectX::XMFLOAT3A(meshData.mVertices[vertexIndex].mNormal.x * radius,
-                    meshData.mVertices[vertexIndex].mNormal.y * radius,
-                    meshData.mVertices[vertexIndex].mNormal.z * radius);
-                position = DirectX::XMLoadFloat3A(&normalAux);
-                DirectX::XMStoreFloat3(&meshData.mVertices[vertexIndex].mPosition, position);
-
-                // Derive texture coordinates from spherical coordinates.
-                const float theta = MathHelper::angle(
-                    meshData.mVertices[vertexIndex].mPosition.x, 
-                    meshData.mVertices[vertexIndex].mPosition.z);
-
-                const float phi = acosf(meshData.mVertices[vertexIndex].mPosition.y / radius);
-
-                meshData.mVertices[vertexIndex].mTexCoord.x = theta / DirectX::XM_2PI;
-                meshData.mVertices[vertexIndex].mTexCoord.y = phi / DirectX::XM_PI;
+        DirectX::XMVECTOR controlPoints0 = DirectX::XMLoadInt4(&firstPatch[0]);
+        DirectX::XMVECTOR controlPoints1 = DirectX::XMLoadInt4(&firstPatch[4]);
+        DirectX::XMVECTOR controlPoints2 = DirectX::XMLoadInt4(&firstPatch[8]);
+        const DirectX::XMVECTOR one = DirectX::XMVectorReplicateInt(1);
 
-                // Partial derivative of P with respect to theta
-                meshData.mVertices[vertexIndex].mTangentU.x = -radius * sinf(phi) * sinf(theta);
-                meshData.mVertices[vertexIndex].mTangentU.y = 0.0f;
-                meshData.mVertices[vertexIndex].mTangentU.z = +radius * sinf(phi) * cosf(theta);
+        uint32_t* patch = controlPoints + sInterlockingTilesControlPoints;
+        for(uint32_t columnIndex = 1; columnIndex < numColumns - 1; ++columnIndex) {
+            DirectX::XMStoreInt4(patch + 0, controlPoints0);
+            DirectX::XMStoreInt4(patch + 4, controlPoints1);
+            DirectX::XMStoreInt4(patch + 8, controlPoints2);
 
-                tangentU = DirectX::XMLoadFloat3(&meshData.mVertices[vertexIndex].mTangentU);
-                DirectX::XMStoreFloat3(&meshData.mVertices[vertexIndex].mTangentU, 
-                                       DirectX::XMVector3Normalize(tangentU));
-            }
+            controlPoints0 = DirectX::XMVectorAddInt(controlPoints0, one);
+            controlPoints1 = DirectX::XMVectorAddInt(controlPoints1, one);
+            controlPoints2 = DirectX::XMVectorAddInt(controlPoints2, one);
+
+            patch += sInterlockingTilesControlPoints;
         }
     }
 
-    void GeometryGenerator::generateCylinder(const float bottomRadius, 
-                                             const float topRadius, 
-                                             const float height, 
-                                             const uint32_t sliceCount, 
-                                             const uint32_t stackCount,
-                                             MeshData& meshData)
+    // Vertex of the height map texel (row, column), clamped to the height map.
+    VertexData buildTerrainVertex(const HeightMap& heightMap,
+                                  const float cellSpacing,
+                                  const uint32_t row,
+                                  const uint32_t column)
     {
-        meshData.mVertices.clear();
-        const uint32_t ringCount = stackCount + 1;
-        meshData.mVertices.reserve(ringCount * (sliceCount + 1));
-
-        meshData.mIndices.clear();
-        meshData.mIndices.reserve(6 * stackCount * sliceCount);
-
-        // Build Stacks.
-        const float stackHeight = height / stackCount;
+        const uint32_t dimension = heightMap.mDimension;
+        const uint32_t lastIndex = dimension - 1;
+        const uint32_t clampedRow = std::min(row, lastIndex);
+        const uint32_t clampedColumn = std::min(column, lastIndex);
+        const float* heights = &heightMap.mData[0];
+
+        // Central differences, one sided on the border.
+        // Rows go along -z.
+        const uint32_t leftColumn = clampedColumn > 0 ? clampedColumn - 1 : 0;
+        const uint32_t rightColumn = std::min(clampedColumn + 1, lastIndex);
+        const uint32_t topRow = clampedRow > 0 ? clampedRow - 1 : 0;
+        const uint32_t bottomRow = std::min(clampedRow + 1, lastIndex);
+        const float* rowHeights = heights + clampedRow * dimension;
+        const float heightDx = rightColumn > leftColumn ? 
+            (rowHeights[rightColumn] - rowHeights[leftColumn]) / ((rightColumn - leftColumn) * cellSpacing) : 
+            0.0f;
+        const float heightDz = bottomRow > topRow ? 
+            (heights[topRow * dimension + clampedColumn] - heights[bottomRow * dimension + clampedColumn]) / ((bottomRow - topRow) * cellSpacing) : 
+            0.0f;
+
+        const float halfSize = 0.5f * lastIndex * cellSpacing;
+        const float texCoordScale = lastIndex > 0 ? 1.0f / lastIndex : 0.0f;
+
+        VertexData vertex;
+        vertex.mPosition = DirectX::XMFLOAT3(-halfSize + clampedColumn * cellSpacing, 
+                                             rowHeights[clampedColumn], 
+                                             halfSize - clampedRow * cellSpacing);
+        DirectX::XMStoreFloat3(&vertex.mNormal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(-heightDx, 1.0f, -heightDz, 0.0f)));
+        DirectX::XMStoreFloat3(&vertex.mTangentU, DirectX::XMVector3Normalize(DirectX::XMVectorSet(1.0f, heightDx, 0.0f, 0.0f)));
+        vertex.mTexCoord = DirectX::XMFLOAT2(clampedColumn * texCoordScale, clampedRow * texCoordScale);
+
+        return vertex;
+    }
 
-        // Amount to increment radius as we move up each stack level from bottom to top.
-        const float radiusStep = (topRadius - bottomRadius) / stackCount;
+    // Grid vertex of the chunk border loop vertex borderIndex. The loop is
+    // clockwise seen from above: row 0 from left to right, the last column
+    // from top to bottom, the last row from right to left and column 0 from
+    // bottom to top, chunkSize + 1 vertices each.
+    uint32_t computeTerrainBorderVertex(const uint32_t chunkSize,
+                                        const uint32_t borderIndex)
+    {
+        const uint32_t verticesPerSide = chunkSize + 1;
+        const uint32_t sideIndex = borderIndex % verticesPerSide;
+        switch(borderIndex / verticesPerSide) {
+        case 0:
+            return sideIndex;
+        case 1:
+            return sideIndex * verticesPerSide + chunkSize;
+        case 2:
+            return chunkSize * verticesPerSide + chunkSize - sideIndex;
+        default:
+            return (chunkSize - sideIndex) * verticesPerSide;
+        }
+    }
 
-        // Compute vertices for each stack ring starting at the bottom and moving up.
-        {
-            VertexData vertex;	
-            DirectX::XMVECTOR tangentU;
-            DirectX::XMVECTOR biTangentU;
-            DirectX::XMVECTOR normal;
-            DirectX::XMFLOAT3 bitangent;
-            for(size_t ringIndex = 0; ringIndex < ringCount; ++ringIndex) {
-                const float y = -0.5f * height + ringIndex * stackHeight;
-                const float r = bottomRadius + ringIndex * radiusStep;
-
-                // vertices of ring
-                const float dTheta = 2.0f * DirectX::XM_PI / sliceCount;		
-                for(size_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
-                    const float c = cosf(sliceIndex * dTheta);
-                    const float s = sinf(sliceIndex * dTheta);
-
-                    vertex.mPosition = DirectX::XMFLOAT3(r * c, y, r * s);
-
-                    vertex.mTexCoord.x = static_cast<float> (sliceIndex) / sliceCount;
-                    vertex.mTexCoord.y = 1.0f - static_cast<float> (ringIndex) / stackCount;
-
-                    // Cylinder can be parameterized as follows, where we introduce v
-                    // parameter that goes in the same direction as the v tex-coord
-                    // so that the bitangent goes in the same direction as the v tex-coord.
-                    //   Let r0 be the bottom radius and let r1 be the top radius.
-                    //   y(v) = h - hv for v in [0,1].
-                    //   r(v) = r1 + (r0-r1)v
-                    //
-                    //   x(t, v) = r(v)*cos(t)
-                    //   y(t, v) = h - hv
-                    //   z(t, v) = r(v)*sin(t)
-                    // 
-                    //  dx/dt = -r(v)*sin(t)
-                    //  dy/dt = 0
-                    //  dz/dt = +r(v)*cos(t)
-                    //
-                    //  dx/dv = (r0-r1)*cos(t)
-                    //  dy/dv = -h
-                    //  dz/dv = (r0-r1)*sin(t)
-
-                    // This is unit length.
-                    vertex.mTangentU = DirectX::XMFLOAT3(-s, 0.0f, c);
-
-                    const float dr = bottomRadius - topRadius;
-                    bitangent = DirectX::XMFLOAT3(dr * c, -height, dr * s);
-
-                    tangentU = DirectX::XMLoadFloat3(&vertex.mTangentU);
-                    biTangentU = DirectX::XMLoadFloat3(&bitangent);
-                    normal = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(tangentU, biTangentU));
-                    DirectX::XMStoreFloat3(&vertex.mNormal, normal);
-
-                    meshData.mVertices.push_back(vertex);
-                }
+    // Writes the grid and skirt vertices of the chunk and computes its bounds.
+    void buildTerrainChunk(const HeightMap& heightMap,
+                           const uint32_t chunkSize,
+                           const float cellSpacing,
+                           const float skirtDepth,
+                           const uint32_t chunkRow,
+                           const uint32_t chunkColumn,
+                           VertexData* vertices,
+                           TerrainChunk& chunk)
+    {
+        const uint32_t verticesPerSide = chunkSize + 1;
+        DirectX::XMVECTOR minPosition = DirectX::XMVectorReplicate(FLT_MAX);
+        DirectX::XMVECTOR maxPosition = DirectX::XMVectorReplicate(-FLT_MAX);
+        for(uint32_t row = 0; row < verticesPerSide; ++row) {
+            for(uint32_t column = 0; column < verticesPerSide; ++column) {
+                VertexData& vertex = vertices[row * verticesPerSide + column];
+                vertex = buildTerrainVertex(heightMap, 
+                                            cellSpacing, 
+                                            chunkRow * chunkSize + row, 
+                                            chunkColumn * chunkSize + column);
+
+                const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&vertex.mPosition);
+                minPosition = DirectX::XMVectorMin(minPosition, position);
+                maxPosition = DirectX::XMVectorMax(maxPosition, position);
             }
         }
 
-        // Add one because we duplicate the first and last vertex per ring
-        // since the texture coordinates are different.
-        const uint32_t ringVertexCount = sliceCount + 1;
+        // Skirt vertices are the border loop ones, skirtDepth below.
+        VertexData* skirtVertices = vertices + verticesPerSide * verticesPerSide;
+        for(uint32_t borderIndex = 0; borderIndex < 4 * verticesPerSide; ++borderIndex) {
+            skirtVertices[borderIndex] = vertices[computeTerrainBorderVertex(chunkSize, borderIndex)];
+            skirtVertices[borderIndex].mPosition.y -= skirtDepth;
+        }
 
-        // Compute indices for each stack.
-        for(uint32_t stackIndex = 0; stackIndex < stackCount; ++stackIndex) {
-            for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
-                meshData.mIndices.push_back(stackIndex * ringVertexCount + sliceIndex);
-                meshData.mIndices.push_back((stackIndex + 1) * ringVertexCount + sliceIndex);
-                meshData.mIndices.push_back((stackIndex + 1) * ringVertexCount + sliceIndex + 1);
+        minPosition = DirectX::XMVectorSubtract(minPosition, DirectX::XMVectorSet(0.0f, skirtDepth, 0.0f, 0.0f));
+        DirectX::XMStoreFloat3(&chunk.mMinPosition, minPosition);
+        DirectX::XMStoreFloat3(&chunk.mMaxPosition, maxPosition);
+    }
 
-                meshData.mIndices.push_back(stackIndex * ringVertexCount + sliceIndex);
-                meshData.mIndices.push_back((stackIndex + 1) * ringVertexCount + sliceIndex + 1);
-                meshData.mIndices.push_back(stackIndex * ringVertexCount + sliceIndex + 1);
+    // Appends the indices of a chunk with a grid vertex every step.
+    void buildTerrainLodIndices(const uint32_t chunkSize,
+                                const uint32_t step,
+                                std::vector<uint32_t>& indices)
+    {
+        // Same triangles as generateGrid, with quads step x step.
+        const uint32_t verticesPerSide = chunkSize + 1;
+        for(uint32_t row = 0; row < chunkSize; row += step) {
+            for(uint32_t column = 0; column < chunkSize; column += step) {
+                const uint32_t topLeft = row * verticesPerSide + column;
+                const uint32_t bottomLeft = topLeft + step * verticesPerSide;
+                indices.push_back(topLeft);
+                indices.push_back(topLeft + step);
+                indices.push_back(bottomLeft);
+
+                indices.push_back(bottomLeft);
+                indices.push_back(topLeft + step);
+                indices.push_back(bottomLeft + step);
             }
         }
 
-        buildCylinderTopCap(bottomRadius, 
-                            topRadius, 
-                            height, 
-                            sliceCount, 
-                            stackCount, 
-                            meshData);
+        // A quad, facing out of the chunk, between every pair of 
+        // border vertices step apart and their skirt vertices.
+        const uint32_t firstSkirtVertex = verticesPerSide * verticesPerSide;
+        for(uint32_t side = 0; side < 4; ++side) {
+            for(uint32_t sideIndex = 0; sideIndex < chunkSize; sideIndex += step) {
+                const uint32_t borderIndex = side * verticesPerSide + sideIndex;
+                const uint32_t top0 = computeTerrainBorderVertex(chunkSize, borderIndex);
+                const uint32_t top1 = computeTerrainBorderVertex(chunkSize, borderIndex + step);
+                const uint32_t bottom0 = firstSkirtVertex + borderIndex;
+                const uint32_t bottom1 = firstSkirtVertex + borderIndex + step;
+                indices.push_back(top1);
+                indices.push_back(top0);
+                indices.push_back(bottom0);
+
+                indices.push_back(top1);
+                indices.push_back(bottom0);
+                indices.push_back(bottom1);
+            }
+        }
+    }
+}
+
+namespace GeometryGenerator
+{
+    void generateBox(const float width, 
+                     const float height, 
+                     const float depth, 
+                     MeshData& meshData)
+    {
+        const MeshSize meshSize = computeBoxSize();
+        meshData.mVertices.resize(meshSize.mVertexCount);
+        meshData.mIndices.resize(meshSize.mIndexCount);
+
+        ShapeBuilders::buildBoxVertices(width, height, depth, MeshStream::ALL, MeshDataWriter(meshData));
+        ShapeBuilders::buildBoxIndices(&meshData.mIndices[0]);
+    }
+
+    void generateSphere(const float radius, 
+                        const uint32_t sliceCount, 
+                        const uint32_t stackCount, 
+                        MeshData& meshData)
+    {
+        meshData.mVertices.resize(ShapeBuilders::sphereVertexCount(sliceCount, stackCount));
+        meshData.mIndices.resize(ShapeBuilders::sphereIndexCount(sliceCount, stackCount));
+
+        ShapeBuilders::buildSphere(radius,
+                                   sliceCount,
+                                   stackCount,
+                                   MeshStream::ALL,
+                                   MeshDataWriter(meshData),
+                                   &meshData.mIndices[0]);
+    }
+
+    void generateGeosphere(const float radius, 
+                           const uint32_t numSubdivisions, 
+                           MeshData& meshData,
+                           const SubdivisionMode subdivisionMode)
+    {
+        // Approximate a sphere by tessellating an icosahedron.
+        std::vector<DirectX::XMFLOAT3> positions;
+        buildGeospherePositions(numSubdivisions, subdivisionMode, positions, meshData.mIndices);
+
+        // Project vertices onto sphere and scale.
+        const size_t numVertices = positions.size();
+        meshData.mVertices.resize(numVertices);
+        const MeshDataWriter vertexWriter(meshData);
+        for(size_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            buildGeosphereVertex(radius, positions[vertexIndex], MeshStream::ALL, vertexIndex, vertexWriter);
+        }
+    }
 
-        buildCylinderBottomCap(bottomRadius, 
-                               topRadius, 
-                               height, 
-                               sliceCount, 
-                               stackCount, 
-                               meshData);
+    void GeometryGenerator::generateCylinder(const float bottomRadius, 
+                                             const float topRadius, 
+                                             const float height, 
+                                             const uint32_t sliceCount, 
+                                             const uint32_t stackCount,
+                                             MeshData& meshData)
+    {
+        // Caps are after the stacks.
+        meshData.mVertices.resize(ShapeBuilders::cylinderVertexCount(sliceCount, stackCount));
+        meshData.mIndices.resize(ShapeBuilders::cylinderIndexCount(sliceCount, stackCount));
+
+        ShapeBuilders::buildCylinder(bottomRadius,
+                                     topRadius,
+                                     height,
+                                     sliceCount,
+                                     stackCount,
+                                     MeshStream::ALL,
+                                     MeshDataWriter(meshData),
+                                     &meshData.mIndices[0]);
     }
 
     void generateGrid(const float width, 
@@ -552,64 +707,14 @@ namespace GeometryGenerator
                       const uint32_t numColumns, 
                       MeshData& meshData)
     {
-        const uint32_t vexterPerColumn = numColumns + 1;
-        const uint32_t vexterPerRow = numRows + 1;
-        const uint32_t vertexCount = vexterPerRow * vexterPerColumn;
-        const uint32_t faceCount   = (vexterPerRow) * (vexterPerColumn) * 2;
-
-        // Create the vertices.
-        const float halfWidth = 0.5f * width;
-        const float halfDepth = 0.5f * depth;
-
-        const float dx = width / (vexterPerColumn);
-        const float dz = depth / (vexterPerRow);
-
-        const float du = 1.0f / (vexterPerColumn);
-        const float dv = 1.0f / (vexterPerRow);
-
-        meshData.mVertices.resize(vertexCount);
-        for(size_t vertexPerRowIndex = 0; 
-                   vertexPerRowIndex < vexterPerRow; 
-                   ++vertexPerRowIndex) {
-            const float z = halfDepth - vertexPerRowIndex * dz;
-            for(size_t vertexPerColumnIndex = 0; 
-                       vertexPerColumnIndex < vexterPerColumn; 
-                       ++vertexPerColumnIndex) {
-                const float x = -halfWidth + vertexPerColumnIndex * dx;
-
-                const size_t vertexIndex = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex;
-                meshData.mVertices[vertexIndex].mPosition = DirectX::XMFLOAT3(x, 0.0f, z);
-                meshData.mVertices[vertexIndex].mNormal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
-                meshData.mVertices[vertexIndex].mTangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-                // Stretch texture over grid.
-                meshData.mVertices[vertexIndex].mTexCoord.x = vertexPerColumnIndex * du;
-                meshData.mVertices[vertexIndex].mTexCoord.y = vertexPerRowIndex * dv;
-            }
-        }
-
-        // Create the indices.
-        meshData.mIndices.resize(faceCount * 3); // 3 indices per face
-
-        // Iterate over each quad and compute indices.
-        uint32_t k = 0;
-        for(uint32_t vertexPerRowIndex = 0; 
-                     vertexPerRowIndex < vexterPerRow - 1; 
-                     ++vertexPerRowIndex) {
-            for(uint32_t vertexPerColumnIndex = 0; 
-                         vertexPerColumnIndex < vexterPerColumn - 1; 
-                         ++vertexPerColumnIndex) {
-                meshData.mIndices[k] = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex;
-                meshData.mIndices[k + 1] = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex + 1;
-                meshData.mIndices[k + 2] = (vertexPerRowIndex + 1) * vexterPerColumn + vertexPerColumnIndex;
-
-                meshData.mIndices[k + 3] = (vertexPerRowIndex + 1) * vexterPerColumn + vertexPerColumnIndex;
-                meshData.mIndices[k + 4] = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex + 1;
-                meshData.mIndices[k + 5] = (vertexPerRowIndex + 1) * vexterPerColumn + vertexPerColumnIndex + 1;
-
-                k += 6; // next quad
-            }
-        }
+        resizeGrid(numRows, numColumns, meshData);
+        ShapeBuilders::buildGrid(width,
+                                 depth,
+                                 numRows,
+                                 numColumns,
+                                 MeshStream::ALL,
+                                 MeshDataWriter(meshData),
+                                 meshData.mIndices.empty() ? nullptr : &meshData.mIndices[0]);
     }
 
     void generateGridForInterlockingTiles(const float width, 
@@ -618,77 +723,53 @@ namespace GeometryGenerator
                                           const uint32_t numColumns, 
                                           MeshData& meshData)
     {
+        // Create the vertices. They are the same ones of generateGrid.
         const uint32_t vexterPerColumn = numColumns + 1;
-        const uint32_t vexterPerRow = numRows + 1;
-        const uint32_t vertexCount = vexterPerRow * vexterPerColumn;
-        const uint32_t faceCount = (vexterPerRow) * (vexterPerColumn) * 2;
+        meshData.mVertices.resize((numRows + 1) * vexterPerColumn);
+        ShapeBuilders::buildGrid(width, depth, numRows, numColumns, MeshStream::ALL, MeshDataWriter(meshData), nullptr);
 
-        // Create the vertices.
-        const float halfWidth = 0.5f * width;
-        const float halfDepth = 0.5f * depth;
-
-        const float dx = width / vexterPerColumn;
-        const float dz = depth / vexterPerRow;
-
-        const float du = 1.0f / vexterPerColumn;
-        const float dv = 1.0f / vexterPerRow;
-
-        meshData.mVertices.resize(vertexCount);
-        for(size_t vertexPerRowIndex = 0; 
-                   vertexPerRowIndex < vexterPerRow; 
-                   ++vertexPerRowIndex) {
-            const float zValue = halfDepth - vertexPerRowIndex * dz;
-            for(size_t vertexPerColumnIndex = 0; 
-                       vertexPerColumnIndex < vexterPerColumn; 
-                       ++vertexPerColumnIndex) {
-                const float xValue = -halfWidth + vertexPerColumnIndex * dx;
-
-                const size_t vertexIndex = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex;
-                meshData.mVertices[vertexIndex].mPosition = DirectX::XMFLOAT3(xValue, 0.0f, zValue);
-                meshData.mVertices[vertexIndex].mNormal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
-                meshData.mVertices[vertexIndex].mTangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-                // Stretch texture over grid.
-                meshData.mVertices[vertexIndex].mTexCoord.x = vertexPerColumnIndex * du;
-                meshData.mVertices[vertexIndex].mTexCoord.y = vertexPerRowIndex * dv;
-            }
+        // Create the indices.
+        meshData.mIndices.resize(numRows * numColumns * sInterlockingTilesControlPoints);
+        for(uint32_t rowIndex = 0; rowIndex < numRows; ++rowIndex) {
+            buildInterlockingTilesRow(numRows, 
+                                      numColumns, 
+                                      rowIndex, 
+                                      &meshData.mIndices[rowIndex * numColumns * sInterlockingTilesControlPoints]);
         }
+    }
 
-        // Create the indices.
-        const uint32_t controlPointsPerQuad = 12;
-        meshData.mIndices.resize(numRows * numColumns * controlPointsPerQuad);
+    void generateGridForInterlockingTilesCompact(const float width, 
+                                                 const float depth, 
+                                                 const uint32_t numRows, 
+                                                 const uint32_t numColumns, 
+                                                 MeshData& meshData)
+    {
+        const uint32_t vexterPerColumn = numColumns + 1;
+        meshData.mVertices.resize((numRows + 1) * vexterPerColumn);
+        ShapeBuilders::buildGrid(width, depth, numRows, numColumns, MeshStream::ALL, MeshDataWriter(meshData), nullptr);
 
-        // Iterate over each quad and compute indices.
-        uint32_t k = 0;
+        // A single index per patch: its first quad vertex.
+        meshData.mIndices.resize(numRows * numColumns);
         for(uint32_t rowIndex = 0; rowIndex < numRows; ++rowIndex) {
             for(uint32_t columnIndex = 0; columnIndex < numColumns; ++columnIndex) {
-                // 0-3 are the actual quad vertices
-                meshData.mIndices[k + 0] = (columnIndex + 0) + (rowIndex + 0) * vexterPerColumn;
-                meshData.mIndices[k + 1] = (columnIndex + 1) + (rowIndex + 0) * vexterPerColumn;
-                meshData.mIndices[k + 2] = (columnIndex + 0) + (rowIndex + 1) * vexterPerColumn;
-                meshData.mIndices[k + 3] = (columnIndex + 1) + (rowIndex + 1) * vexterPerColumn;
-
-                // 4-5 are +z
-                meshData.mIndices[k + 4] = MathHelper::clamp<uint32_t>(columnIndex + 0, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex + 2, 0, numRows) * vexterPerColumn;
-                meshData.mIndices[k + 5] = MathHelper::clamp<uint32_t>(columnIndex + 1, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex + 2, 0, numRows) * vexterPerColumn;
-
-                // 6-7 are +x
-                meshData.mIndices[k + 6] = MathHelper::clamp<uint32_t>(columnIndex + 2, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex + 0, 0, numRows) * vexterPerColumn;
-                meshData.mIndices[k + 7] = MathHelper::clamp<uint32_t>(columnIndex + 2, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex + 1, 0, numRows) * vexterPerColumn;
-
-                // 8-9 are -z
-                meshData.mIndices[k + 8] = MathHelper::clamp<uint32_t>(columnIndex + 0, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex - 1, 0, numRows) * vexterPerColumn;
-                meshData.mIndices[k + 9] = MathHelper::clamp<uint32_t>(columnIndex + 1, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex - 1, 0, numRows) * vexterPerColumn;
-
-                // 10-11 are -x
-                meshData.mIndices[k + 10] = MathHelper::clamp<uint32_t>(columnIndex - 1, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex + 0, 0, numRows) * vexterPerColumn;
-                meshData.mIndices[k + 11] = MathHelper::clamp<uint32_t>(columnIndex - 1, 0, numColumns) + MathHelper::clamp<uint32_t>(rowIndex + 1, 0, numRows) * vexterPerColumn;
-
-                k += controlPointsPerQuad; // 12 control points per quad
+                meshData.mIndices[rowIndex * numColumns + columnIndex] = columnIndex + rowIndex * vexterPerColumn;
             }
         }
     }
 
+    void computeInterlockingTilesControlPoints(const uint32_t numRows, 
+                                               const uint32_t numColumns, 
+                                               const uint32_t patchBaseIndex, 
+                                               uint32_t* controlPoints)
+    {
+        const uint32_t vexterPerColumn = numColumns + 1;
+        buildInterlockingTilesPatch(numRows, 
+                                    numColumns, 
+                                    patchBaseIndex / vexterPerColumn, 
+                                    patchBaseIndex % vexterPerColumn, 
+                                    controlPoints);
+    }
+
     void generateFullscreenQuad(MeshData& meshData)
     {
         meshData.mVertices.resize(4);
@@ -731,4 +812,358 @@ namespace GeometryGenerator
         meshData.mIndices[4] = 2;
         meshData.mIndices[5] = 3;
     }
+
+    void generateSphereParallel(const float radius, 
+                                const uint32_t sliceCount, 
+                                const uint32_t stackCount, 
+                                const uint32_t numThreads,
+                                MeshData& meshData)
+    {
+        const uint32_t vertexCount = ShapeBuilders::sphereVertexCount(sliceCount, stackCount);
+        const uint32_t indexCount = ShapeBuilders::sphereIndexCount(sliceCount, stackCount);
+        meshData.mVertices.resize(vertexCount);
+        meshData.mIndices.resize(indexCount);
+
+        const float phiStep = DirectX::XM_PI / stackCount;
+        const float thetaStep = 2.0f * DirectX::XM_PI / sliceCount;
+        const uint32_t ringVertexCount = sliceCount + 1;
+        const MeshDataWriter vertexWriter(meshData);
+
+        // Every stack writes its ring and, if it is an inner stack, its indices.
+        ParallelUtils::parallelFor(1, 
+                                   stackCount, 
+                                   numThreads, 
+                                   [&](const uint32_t rangeBegin, const uint32_t rangeEnd) {
+            for(uint32_t stackIndex = rangeBegin; stackIndex < rangeEnd; ++stackIndex) {
+                ShapeBuilders::buildSphereRing(radius, 
+                                               sliceCount, 
+                                               phiStep, 
+                                               thetaStep, 
+                                               stackIndex, 
+                                               MeshStream::ALL,
+                                               1 + (stackIndex - 1) * ringVertexCount,
+                                               vertexWriter);
+
+                if(stackIndex < stackCount - 1) {
+                    ShapeBuilders::buildSphereStackIndices(sliceCount, 
+                                                           stackIndex - 1, 
+                                                           &meshData.mIndices[3 * sliceCount + (stackIndex - 1) * 6 * sliceCount]);
+                }
+            }
+        });
+
+        ShapeBuilders::buildSpherePoleVertices(radius, vertexCount, vertexWriter);
+        ShapeBuilders::buildSpherePoleIndices(sliceCount, vertexCount, indexCount, &meshData.mIndices[0]);
+    }
+
+    void generateCylinderParallel(const float bottomRadius, 
+                                  const float topRadius, 
+                                  const float height, 
+                                  const uint32_t sliceCount, 
+                                  const uint32_t stackCount,
+                                  const uint32_t numThreads,
+                                  MeshData& meshData)
+    {
+        const uint32_t ringCount = stackCount + 1;
+        const uint32_t ringVertexCount = sliceCount + 1;
+
+        // Caps are after the stacks.
+        meshData.mVertices.resize(ShapeBuilders::cylinderVertexCount(sliceCount, stackCount));
+        meshData.mIndices.resize(ShapeBuilders::cylinderIndexCount(sliceCount, stackCount));
+        const MeshDataWriter vertexWriter(meshData);
+
+        // Every ring writes its vertices and the indices of the stack above it.
+        ParallelUtils::parallelFor(0, 
+                                   ringCount, 
+                                   numThreads, 
+                                   [&](const uint32_t rangeBegin, const uint32_t rangeEnd) {
+            for(uint32_t ringIndex = rangeBegin; ringIndex < rangeEnd; ++ringIndex) {
+                ShapeBuilders::buildCylinderRing(bottomRadius, 
+                                                 topRadius, 
+                                                 height, 
+                                                 sliceCount, 
+                                                 stackCount, 
+                                                 ringIndex, 
+                                                 MeshStream::ALL,
+                                                 ringIndex * ringVertexCount,
+                                                 vertexWriter);
+
+                if(ringIndex < stackCount) {
+                    ShapeBuilders::buildCylinderStackIndices(sliceCount, 
+                                                             ringIndex, 
+                                                             &meshData.mIndices[ringIndex * 6 * sliceCount]);
+                }
+            }
+        });
+
+        ShapeBuilders::buildCylinderCaps(bottomRadius,
+                                         topRadius,
+                                         height,
+                                         sliceCount,
+                                         stackCount,
+                                         vertexWriter,
+                                         &meshData.mIndices[0]);
+    }
+
+    void generateGridParallel(const float width, 
+                              const float depth, 
+                              const uint32_t numRows, 
+                              const uint32_t numColumns, 
+                              const uint32_t numThreads,
+                              MeshData& meshData)
+    {
+        resizeGrid(numRows, numColumns, meshData);
+
+        // Every row writes its vertices and the indices of the quads below it.
+        const uint32_t vexterPerColumn = numColumns + 1;
+        const MeshDataWriter vertexWriter(meshData);
+        ParallelUtils::parallelFor(0, 
+                                   numRows + 1, 
+                                   numThreads, 
+                                   [&](const uint32_t rangeBegin, const uint32_t rangeEnd) {
+            for(uint32_t vertexPerRowIndex = rangeBegin; vertexPerRowIndex < rangeEnd; ++vertexPerRowIndex) {
+                ShapeBuilders::buildGridRow(width, 
+                                            depth, 
+                                            numRows, 
+                                            numColumns, 
+                                            vertexPerRowIndex, 
+                                            MeshStream::ALL,
+                                            vertexPerRowIndex * vexterPerColumn,
+                                            vertexWriter);
+
+                if(vertexPerRowIndex < numRows) {
+                    ShapeBuilders::buildGridRowIndices(numColumns, 
+                                                       vertexPerRowIndex, 
+                                                       &meshData.mIndices[vertexPerRowIndex * 6 * numColumns]);
+                }
+            }
+        });
+    }
+
+    void generateTerrainChunks(const HeightMap& heightMap,
+                               const uint32_t chunkSize,
+                               const float cellSpacing,
+                               const float skirtDepth,
+                               const uint32_t numThreads,
+                               TerrainMeshData& terrainMeshData)
+    {
+        assert(heightMap.mDimension > 0);
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+        assert(chunkSize > 0 && (chunkSize & (chunkSize - 1)) == 0);
+
+        const uint32_t verticesPerSide = chunkSize + 1;
+        const uint32_t cellsPerSide = std::max(heightMap.mDimension - 1, 1U);
+        const uint32_t chunksPerSide = (cellsPerSide + chunkSize - 1) / chunkSize;
+        const uint32_t chunkCount = chunksPerSide * chunksPerSide;
+        terrainMeshData.mChunkSize = chunkSize;
+        terrainMeshData.mChunksPerSide = chunksPerSide;
+        terrainMeshData.mVerticesPerChunk = verticesPerSide * verticesPerSide + 4 * verticesPerSide;
+        terrainMeshData.mVertices.resize(chunkCount * terrainMeshData.mVerticesPerChunk);
+        terrainMeshData.mChunks.resize(chunkCount);
+
+        // Indices are shared by all the chunks.
+        terrainMeshData.mIndices.clear();
+        terrainMeshData.mLods.clear();
+        for(uint32_t step = 1; step <= chunkSize; step *= 2) {
+            TerrainLod lod;
+            lod.mStartIndex = static_cast<uint32_t> (terrainMeshData.mIndices.size());
+            buildTerrainLodIndices(chunkSize, step, terrainMeshData.mIndices);
+            lod.mIndexCount = static_cast<uint32_t> (terrainMeshData.mIndices.size()) - lod.mStartIndex;
+            terrainMeshData.mLods.push_back(lod);
+        }
+
+        ParallelUtils::parallelFor(0, 
+                                   chunkCount, 
+                                   numThreads, 
+                                   [&](const uint32_t fromChunk, const uint32_t toChunk) {
+            for(uint32_t chunkIndex = fromChunk; chunkIndex < toChunk; ++chunkIndex) {
+                TerrainChunk& chunk = terrainMeshData.mChunks[chunkIndex];
+                chunk.mBaseVertex = chunkIndex * terrainMeshData.mVerticesPerChunk;
+                buildTerrainChunk(heightMap, 
+                                  chunkSize, 
+                                  cellSpacing, 
+                                  skirtDepth, 
+                                  chunkIndex / chunksPerSide, 
+                                  chunkIndex % chunksPerSide, 
+                                  &terrainMeshData.mVertices[chunk.mBaseVertex], 
+                                  chunk);
+            }
+        });
+    }
+
+    MeshSize computeBoxSize()
+    {
+        return MeshSize(24, 36);
+    }
+
+    MeshSize computeSphereSize(const uint32_t sliceCount, 
+                               const uint32_t stackCount)
+    {
+        return MeshSize(ShapeBuilders::sphereVertexCount(sliceCount, stackCount), 
+                        ShapeBuilders::sphereIndexCount(sliceCount, stackCount));
+    }
+
+    MeshSize computeCylinderSize(const uint32_t sliceCount, 
+                                 const uint32_t stackCount)
+    {
+        return MeshSize(ShapeBuilders::cylinderVertexCount(sliceCount, stackCount),
+                        ShapeBuilders::cylinderIndexCount(sliceCount, stackCount));
+    }
+
+    MeshSize computeGridSize(const uint32_t numRows, 
+                             const uint32_t numColumns)
+    {
+        return MeshSize((numRows + 1) * (numColumns + 1), 
+                        6 * numRows * numColumns);
+    }
+}
+
+namespace MeshStreamsUtils
+{
+    void toMeshData(const MeshStreams& meshStreams, 
+                    MeshData& meshData)
+    {
+        const uint32_t vertexCount = meshStreams.mVertexCount;
+        const uint32_t streamMask = meshStreams.mStreamMask;
+
+        meshData.mVertices.assign(vertexCount, VertexData());
+        for(uint32_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            VertexData& vertex = meshData.mVertices[vertexIndex];
+            if(streamMask & MeshStream::POSITION) {
+                vertex.mPosition = DirectX::XMFLOAT3(meshStreams.mPositionX[vertexIndex], 
+                                                     meshStreams.mPositionY[vertexIndex], 
+                                                     meshStreams.mPositionZ[vertexIndex]);
+            }
+
+            if(streamMask & MeshStream::NORMAL) {
+                vertex.mNormal = DirectX::XMFLOAT3(meshStreams.mNormalX[vertexIndex], 
+                                                   meshStreams.mNormalY[vertexIndex], 
+                                                   meshStreams.mNormalZ[vertexIndex]);
+            }
+
+            if(streamMask & MeshStream::TANGENT_U) {
+                vertex.mTangentU = DirectX::XMFLOAT3(meshStreams.mTangentUX[vertexIndex], 
+                                                     meshStreams.mTangentUY[vertexIndex], 
+                                                     meshStreams.mTangentUZ[vertexIndex]);
+            }
+
+            if(streamMask & MeshStream::TEXCOORD) {
+                vertex.mTexCoord = DirectX::XMFLOAT2(meshStreams.mTexCoordU[vertexIndex], 
+                                                     meshStreams.mTexCoordV[vertexIndex]);
+            }
+        }
+
+        meshData.mIndices = meshStreams.mIndices;
+    }
+
+    void fromMeshData(const MeshData& meshData, 
+                      const uint32_t streamMask,
+                      MeshStreams& meshStreams)
+    {
+        const uint32_t vertexCount = static_cast<uint32_t> (meshData.mVertices.size());
+        resizeStreams(vertexCount, streamMask, meshStreams);
+
+        const MeshStreamsWriter vertexWriter(meshStreams);
+        for(uint32_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            vertexWriter(vertexIndex, meshData.mVertices[vertexIndex]);
+        }
+
+        meshStreams.mIndices = meshData.mIndices;
+    }
+}
+
+namespace GeometryGenerator
+{
+    void generateBox(const float width, 
+                     const float height, 
+                     const float depth, 
+                     const uint32_t streamMask,
+                     MeshStreams& meshStreams)
+    {
+        const MeshSize meshSize = computeBoxSize();
+        resizeStreams(meshSize.mVertexCount, streamMask | MeshStream::POSITION, meshStreams);
+        meshStreams.mIndices.resize(meshSize.mIndexCount);
+
+        ShapeBuilders::buildBoxVertices(width, height, depth, meshStreams.mStreamMask, MeshStreamsWriter(meshStreams));
+        ShapeBuilders::buildBoxIndices(&meshStreams.mIndices[0]);
+    }
+
+    void generateSphere(const float radius, 
+                        const uint32_t sliceCount, 
+                        const uint32_t stackCount, 
+                        const uint32_t streamMask,
+                        MeshStreams& meshStreams)
+    {
+        const MeshSize meshSize = computeSphereSize(sliceCount, stackCount);
+        resizeStreams(meshSize.mVertexCount, streamMask | MeshStream::POSITION, meshStreams);
+        meshStreams.mIndices.resize(meshSize.mIndexCount);
+
+        ShapeBuilders::buildSphere(radius,
+                                   sliceCount,
+                                   stackCount,
+                                   meshStreams.mStreamMask,
+                                   MeshStreamsWriter(meshStreams),
+                                   &meshStreams.mIndices[0]);
+    }
+
+    void generateGeosphere(const float radius, 
+                           const uint32_t numSubdivisions, 
+                           const uint32_t streamMask,
+                           MeshStreams& meshStreams,
+                           const SubdivisionMode subdivisionMode)
+    {
+        // Approximate a sphere by tessellating an icosahedron.
+        std::vector<DirectX::XMFLOAT3> positions;
+        buildGeospherePositions(numSubdivisions, subdivisionMode, positions, meshStreams.mIndices);
+
+        // Project vertices onto sphere and scale.
+        const uint32_t numVertices = static_cast<uint32_t> (positions.size());
+        resizeStreams(numVertices, streamMask | MeshStream::POSITION, meshStreams);
+        const MeshStreamsWriter vertexWriter(meshStreams);
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            buildGeosphereVertex(radius, positions[vertexIndex], meshStreams.mStreamMask, vertexIndex, vertexWriter);
+        }
+    }
+
+    void generateCylinder(const float bottomRadius, 
+                          const float topRadius, 
+                          const float height, 
+                          const uint32_t sliceCount, 
+                          const uint32_t stackCount, 
+                          const uint32_t streamMask,
+                          MeshStreams& meshStreams)
+    {
+        const MeshSize meshSize = computeCylinderSize(sliceCount, stackCount);
+        resizeStreams(meshSize.mVertexCount, streamMask | MeshStream::POSITION, meshStreams);
+        meshStreams.mIndices.resize(meshSize.mIndexCount);
+
+        ShapeBuilders::buildCylinder(bottomRadius,
+                                     topRadius,
+                                     height,
+                                     sliceCount,
+                                     stackCount,
+                                     meshStreams.mStreamMask,
+                                     MeshStreamsWriter(meshStreams),
+                                     &meshStreams.mIndices[0]);
+    }
+
+    void generateGrid(const float width, 
+                      const float depth, 
+                      const uint32_t numRows, 
+                      const uint32_t numColumns, 
+                      const uint32_t streamMask,
+                      MeshStreams& meshStreams)
+    {
+        const MeshSize meshSize = computeGridSize(numRows, numColumns);
+        resizeStreams(meshSize.mVertexCount, streamMask | MeshStream::POSITION, meshStreams);
+        meshStreams.mIndices.resize(meshSize.mIndexCount);
+
+        ShapeBuilders::buildGrid(width,
+                                 depth,
+                                 numRows,
+                                 numColumns,
+                                 meshStreams.mStreamMask,
+                                 MeshStreamsWriter(meshStreams),
+                                 meshStreams.mIndices.empty() ? nullptr : &meshStreams.mIndices[0]);
+    }
 }
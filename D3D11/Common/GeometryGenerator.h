@@ -17,6 +17,8 @@
 #include <DirectXMath.h>
 #include <vector>
 
+struct HeightMap;
+
 struct BoundingSphere
 {
     BoundingSphere() 
@@ -83,8 +85,164 @@ struct MeshData
     std::vector<uint32_t> mIndices;
 };
 
+// Number of vertices and indices written by a generator
+struct MeshSize
+{
+    MeshSize(const uint32_t vertexCount, 
+             const uint32_t indexCount)
+        : mVertexCount(vertexCount)
+        , mIndexCount(indexCount)
+    {
+
+    }
+
+    uint32_t mVertexCount;
+    uint32_t mIndexCount;
+};
+
+// Square chunk of a TerrainMeshData
+struct TerrainChunk
+{
+    TerrainChunk()
+        : mBaseVertex(0)
+        , mMinPosition(0.0f, 0.0f, 0.0f)
+        , mMaxPosition(0.0f, 0.0f, 0.0f)
+    {
+
+    }
+
+    // Index of its first vertex in TerrainMeshData::mVertices
+    uint32_t mBaseVertex;
+
+    // Axis aligned bounds of its vertices, skirts included
+    DirectX::XMFLOAT3 mMinPosition;
+    DirectX::XMFLOAT3 mMaxPosition;
+};
+
+// Range of TerrainMeshData::mIndices of a level of detail
+struct TerrainLod
+{
+    TerrainLod()
+        : mStartIndex(0)
+        , mIndexCount(0)
+    {
+
+    }
+
+    uint32_t mStartIndex;
+    uint32_t mIndexCount;
+};
+
+// Terrain mesh split in square chunks of mChunkSize x mChunkSize quads.
+// Every chunk has the same vertex layout: (mChunkSize + 1)^2 row major
+// grid vertices followed by its skirt vertices, so all of them share
+// the indices of every LOD, that are relative to the chunk base vertex
+// (the base vertex location of DrawIndexed). LOD i uses a grid vertex
+// every 2^i. Skirts hang skirtDepth below the chunk border, to hide
+// the cracks between chunks of different LODs.
+struct TerrainMeshData
+{
+    TerrainMeshData()
+        : mChunkSize(0)
+        , mChunksPerSide(0)
+        , mVerticesPerChunk(0)
+    {
+
+    }
+
+    std::vector<VertexData> mVertices;
+    std::vector<uint32_t> mIndices;
+
+    // Row major
+    std::vector<TerrainChunk> mChunks;
+
+    std::vector<TerrainLod> mLods;
+
+    uint32_t mChunkSize;
+    uint32_t mChunksPerSide;
+    uint32_t mVerticesPerChunk;
+};
+
+// Bit flags to select which vertex attributes are computed and
+// stored in a MeshStreams.
+namespace MeshStream
+{
+    enum : uint32_t
+    {
+        POSITION = 1 << 0,
+        NORMAL = 1 << 1,
+        TANGENT_U = 1 << 2,
+        TEXCOORD = 1 << 3,
+        ALL = POSITION | NORMAL | TANGENT_U | TEXCOORD
+    };
+}
+
+// Structure of arrays version of MeshData.
+// Every attribute component lives in its own contiguous float array,
+// so passes over a single component (bounds, transforms, normals 
+// recomputation) can run linearly over it. Arrays of attributes
+// not included in mStreamMask are empty.
+struct MeshStreams
+{
+    MeshStreams()
+        : mVertexCount(0)
+        , mStreamMask(0)
+    {
+
+    }
+
+    std::vector<float> mPositionX;
+    std::vector<float> mPositionY;
+    std::vector<float> mPositionZ;
+
+    std::vector<float> mNormalX;
+    std::vector<float> mNormalY;
+    std::vector<float> mNormalZ;
+
+    std::vector<float> mTangentUX;
+    std::vector<float> mTangentUY;
+    std::vector<float> mTangentUZ;
+
+    std::vector<float> mTexCoordU;
+    std::vector<float> mTexCoordV;
+
+    std::vector<uint32_t> mIndices;
+
+    uint32_t mVertexCount;
+    uint32_t mStreamMask;
+};
+
+namespace MeshStreamsUtils
+{
+    // Converts to the interleaved layout. Attributes missing 
+    // in meshStreams are left zero initialized.
+    void toMeshData(const MeshStreams& meshStreams, 
+                    MeshData& meshData);
+
+    // Copies only the attributes requested in streamMask.
+    void fromMeshData(const MeshData& meshData, 
+                      const uint32_t streamMask,
+                      MeshStreams& meshStreams);
+}
+
 namespace GeometryGenerator
 {
+    // Increment it every time the generated meshes change, so
+    // meshes cached with MeshCacheUtils are generated again.
+    const uint32_t sVersion = 2;
+
+    // Controls how generateGeosphere splits each triangle in 4.
+    enum struct SubdivisionMode
+    {
+        // Every triangle emits its own 6 vertices, so vertices
+        // are duplicated between adjacent triangles.
+        SPLIT,
+
+        // Edge midpoints are shared between adjacent triangles
+        // through a cache keyed on the edge's vertex pair.
+        WELDED
+    };
+
     // Creates a box centered at the origin with the given dimensions.
     void generateBox(const float width, 
                      const float height, 
@@ -102,7 +260,8 @@ namespace GeometryGenerator
     // The depth controls the level of tessellation.
     void generateGeosphere(const float radius, 
                            const uint32_t numSubdivisions, 
-                           MeshData& meshData);
+                           MeshData& meshData,
+                           const SubdivisionMode subdivisionMode = SubdivisionMode::SPLIT);
 
     // Creates a cylinder parallel to the y-axis, and centered about the origin.  
     // The bottom and top radius can vary to form various cone shapes rather than true
@@ -130,7 +289,123 @@ namespace GeometryGenerator
                                           const uint32_t numColumns, 
                                           MeshData& meshData);
 
+    // Same vertices as generateGridForInterlockingTiles, but a single index 
+    // per patch (its first quad vertex) instead of its 12 control points, that
+    // are reconstructed with computeInterlockingTilesControlPoints.
+    // Without an index buffer, the base index of patch patchId 
+    // (SV_PrimitiveID) is patchId + patchId / numColumns.
+    void generateGridForInterlockingTilesCompact(const float width, 
+                                                 const float depth, 
+                                                 const uint32_t numRows, 
+                                                 const uint32_t numColumns, 
+                                                 MeshData& meshData);
+
+    // Computes the 12 control points of the patch with base index patchBaseIndex:
+    // 0-3 are the quad vertices and 4-5, 6-7, 8-9 and 10-11 the vertices of the 
+    // +z, +x, -z and -x neighbors, clamped to the grid.
+    void computeInterlockingTilesControlPoints(const uint32_t numRows, 
+                                               const uint32_t numColumns, 
+                                               const uint32_t patchBaseIndex, 
+                                               uint32_t* controlPoints);
+
     // Creates a quad covering the screen in NDC coordinates.  
     // This is useful for postprocessing effects.
     void generateFullscreenQuad(MeshData& meshData);
+
+    // Creates a terrain mesh from the height map, centered at the origin,
+    // with a vertex per height map texel, cellSpacing apart (row 0 being 
+    // the +z border). chunkSize must be a power of 2. Chunks past the height
+    // map border (if its dimension - 1 is not a multiple of chunkSize)
+    // repeat its last row and column. Normals are computed with central
+    // differences. Chunks are split across numThreads threads (0 uses
+    // all hardware threads).
+    void generateTerrainChunks(const HeightMap& heightMap,
+                               const uint32_t chunkSize,
+                               const float cellSpacing,
+                               const float skirtDepth,
+                               const uint32_t numThreads,
+                               TerrainMeshData& terrainMeshData);
+
+    //
+    // Multithreaded versions for very large tessellations. Stacks, rings
+    // or rows are split across numThreads threads (0 uses all hardware
+    // threads), that write directly to the preallocated vertices and
+    // indices. Results are bit-identical to the serial versions.
+    //
+
+    void generateSphereParallel(const float radius, 
+                                const uint32_t sliceCount, 
+                                const uint32_t stackCount, 
+                                const uint32_t numThreads,
+                                MeshData& meshData);
+
+    void generateCylinderParallel(const float bottomRadius, 
+                                  const float topRadius, 
+                                  const float height, 
+                                  const uint32_t sliceCount, 
+                                  const uint32_t stackCount, 
+                                  const uint32_t numThreads,
+                                  MeshData& meshData);
+
+    void generateGridParallel(const float width, 
+                              const float depth, 
+                              const uint32_t numRows, 
+                              const uint32_t numColumns, 
+                              const uint32_t numThreads,
+                              MeshData& meshData);
+
+    //
+    // Sizes of the MeshSink versions of MeshSink.h, that
+    // generate into memory provided by the caller.
+    //
+
+    MeshSize computeBoxSize();
+
+    MeshSize computeSphereSize(const uint32_t sliceCount, 
+                               const uint32_t stackCount);
+
+    MeshSize computeCylinderSize(const uint32_t sliceCount, 
+                                 const uint32_t stackCount);
+
+    MeshSize computeGridSize(const uint32_t numRows, 
+                             const uint32_t numColumns);
+
+    //
+    // Structure of arrays versions. Only the attributes in streamMask
+    // (MeshStream flags) are computed and stored. Positions are always
+    // generated, as the rest of the attributes are derived from them.
+    //
+
+    void generateBox(const float width, 
+                     const float height, 
+                     const float depth, 
+                     const uint32_t streamMask,
+                     MeshStreams& meshStreams);
+
+    void generateSphere(const float radius, 
+                        const uint32_t sliceCount, 
+                        const uint32_t stackCount, 
+                        const uint32_t streamMask,
+                        MeshStreams& meshStreams);
+
+    void generateGeosphere(const float radius, 
+                           const uint32_t numSubdivisions, 
+                           const uint32_t streamMask,
+                           MeshStreams& meshStreams,
+                           const SubdivisionMode subdivisionMode = SubdivisionMode::SPLIT);
+
+    void generateCylinder(const float bottomRadius, 
+                          const float topRadius, 
+                          const float height, 
+                          const uint32_t sliceCount, 
+                          const uint32_t stackCount, 
+                          const uint32_t streamMask,
+                          MeshStreams& meshStreams);
+
+    void generateGrid(const float width, 
+                      const float depth, 
+                      const uint32_t numRows, 
+                      const uint32_t numColumns, 
+                      const uint32_t streamMask,
+                      MeshStreams& meshStreams);
 }
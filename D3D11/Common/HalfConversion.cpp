@@ -0,0 +1,152 @@
+#include "HalfConversion.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__F16C__)
+#define HALF_CONVERSION_F16C
+#include <immintrin.h>
+#endif
+
+#include <ParallelUtils.h>
+
+namespace
+{
+    // Smaller arrays are not worth a thread.
+    const uint32_t sMinValuesPerThread = 64 * 1024;
+
+    uint32_t computeThreadCount(const uint32_t count,
+                                const uint32_t numThreads)
+    {
+        const uint32_t requestedThreads = numThreads == 0 ? ParallelUtils::defaultThreadCount() : numThreads;
+        const uint32_t usefulThreads = (count + sMinValuesPerThread - 1) / sMinValuesPerThread;
+        return std::max(1U, std::min(requestedThreads, usefulThreads));
+    }
+
+    void convertFloatToHalfRange(const float* source,
+                                 const uint32_t count,
+                                 uint16_t* destination)
+    {
+        uint32_t i = 0;
+#ifdef HALF_CONVERSION_F16C
+        for(; i + 8 <= count; i += 8) {
+            const __m256 values = _mm256_loadu_ps(source + i);
+            const __m128i halfValues = _mm256_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i*> (destination + i), halfValues);
+        }
+#endif
+        for(; i < count; ++i) {
+            destination[i] = HalfConversionUtils::convertFloatToHalf(source[i]);
+        }
+    }
+
+    void convertHalfToFloatRange(const uint16_t* source,
+                                 const uint32_t count,
+                                 float* destination)
+    {
+        uint32_t i = 0;
+#ifdef HALF_CONVERSION_F16C
+        for(; i + 8 <= count; i += 8) {
+            const __m128i halfValues = _mm_loadu_si128(reinterpret_cast<const __m128i*> (source + i));
+            _mm256_storeu_ps(destination + i, _mm256_cvtph_ps(halfValues));
+        }
+#endif
+        for(; i < count; ++i) {
+            destination[i] = HalfConversionUtils::convertHalfToFloat(source[i]);
+        }
+    }
+}
+
+namespace HalfConversionUtils
+{
+    uint16_t convertFloatToHalf(const float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        const uint16_t sign = static_cast<uint16_t> ((bits >> 16) & 0x8000);
+        const uint32_t absoluteBits = bits & 0x7FFFFFFF;
+
+        // Infinity, or NaN made quiet with its upper mantissa bits kept.
+        if(absoluteBits >= 0x7F800000) {
+            const uint32_t nan = absoluteBits > 0x7F800000 ? 0x200 | ((absoluteBits >> 13) & 0x3FF) : 0;
+            return static_cast<uint16_t> (sign | 0x7C00 | nan);
+        }
+
+        // 65520 and above round to infinity.
+        if(absoluteBits >= 0x477FF000) {
+            return static_cast<uint16_t> (sign | 0x7C00);
+        }
+
+        // Normal half (2^-14 and above): rebias the exponent and round
+        // the 13 dropped mantissa bits to nearest even. A mantissa carry
+        // correctly increments the exponent.
+        if(absoluteBits >= 0x38800000) {
+            const uint32_t rebiased = absoluteBits - 0x38000000;
+            return static_cast<uint16_t> (sign | ((rebiased + 0xFFF + ((rebiased >> 13) & 1)) >> 13));
+        }
+
+        // 2^-25 and below round to zero.
+        if(absoluteBits <= 0x33000000) {
+            return sign;
+        }
+
+        // Denormal half, in units of 2^-24.
+        const uint32_t exponent = absoluteBits >> 23;
+        const uint32_t mantissa = (absoluteBits & 0x7FFFFF) | 0x800000;
+        const uint32_t shift = 126 - exponent;
+        const uint32_t remainder = mantissa & ((1U << shift) - 1);
+        const uint32_t halfway = 1U << (shift - 1);
+        uint32_t result = mantissa >> shift;
+        if(remainder > halfway || (remainder == halfway && (result & 1))) {
+            ++result;
+        }
+
+        return static_cast<uint16_t> (sign | result);
+    }
+
+    float convertHalfToFloat(const uint16_t value)
+    {
+        const uint32_t sign = static_cast<uint32_t> (value & 0x8000) << 16;
+        const uint32_t exponent = (value >> 10) & 0x1F;
+        const uint32_t mantissa = value & 0x3FF;
+
+        uint32_t bits;
+        if(exponent == 0x1F) {
+            // Infinity, or NaN made quiet
+            bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa != 0 ? 0x400000 : 0);
+        } else if(exponent == 0) {
+            // Zero or denormal: mantissa * 2^-24 is exact in float.
+            const float magnitude = mantissa * (1.0f / 16777216.0f);
+            memcpy(&bits, &magnitude, sizeof(bits));
+            bits |= sign;
+        } else {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+
+        return result;
+    }
+
+    void convertFloatToHalf(const float* source,
+                            const uint32_t count,
+                            uint16_t* destination,
+                            const uint32_t numThreads)
+    {
+        ParallelUtils::parallelFor(0, count, computeThreadCount(count, numThreads), [source, destination](const uint32_t rangeBegin, const uint32_t rangeEnd) {
+            convertFloatToHalfRange(source + rangeBegin, rangeEnd - rangeBegin, destination + rangeBegin);
+        });
+    }
+
+    void convertHalfToFloat(const uint16_t* source,
+                            const uint32_t count,
+                            float* destination,
+                            const uint32_t numThreads)
+    {
+        ParallelUtils::parallelFor(0, count, computeThreadCount(count, numThreads), [source, destination](const uint32_t rangeBegin, const uint32_t rangeEnd) {
+            convertHalfToFloatRange(source + rangeBegin, rangeEnd - rangeBegin, destination + rangeBegin);
+        });
+    }
+}
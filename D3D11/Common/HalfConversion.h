@@ -0,0 +1,32 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Bulk conversion between 32-bit and 16-bit (half) floats.
+//
+// Floats are rounded to the nearest half (ties to even), with
+// denormals, infinities and NaNs preserved, so results are the same
+// with the F16C instructions (used when the build targets AVX2 or
+// F16C) and without them.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+namespace HalfConversionUtils
+{
+    uint16_t convertFloatToHalf(const float value);
+    float convertHalfToFloat(const uint16_t value);
+
+    // Convert count values from source to destination. Large arrays are
+    // split across numThreads threads (0 uses all hardware threads).
+    void convertFloatToHalf(const float* source,
+                            const uint32_t count,
+                            uint16_t* destination,
+                            const uint32_t numThreads = 0);
+
+    void convertHalfToFloat(const uint16_t* source,
+                            const uint32_t count,
+                            float* destination,
+                            const uint32_t numThreads = 0);
+}
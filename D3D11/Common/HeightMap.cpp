@@ -2,16 +2,18 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <d3d11.h>
 #include <DirectXPackedVector.h>
-#include <fstream>
+#include <windows.h>
 
 #include <DxErrorChecker.h>
+#include <HalfConversion.h>
+#include <ParallelUtils.h>
 
 namespace 
 {
-    // Function computes the average height of the ij element of a height map.
-    // It averages itself with its eight neighbor pixels. Note
+    // The filter averages every pixel with its eight neighbor pixels. Note
     // that if a pixel is missing neighbor, we just do not include it
     // in the average.
     //
@@ -22,102 +24,591 @@ namespace
     // ----------
     // | 7| 8| 9|
     // ----------
-    float computeAverageHeight(const HeightMap& heightMap,
-                               const uint32_t rowIndex,
-                               const uint32_t columnIndex)
-    {
-        float average = 0.0f;
-        float numNeighbors = 0.0f;
-
-        // Cache information
-        const int fromRow = static_cast<int> (rowIndex) - 1;
-        const int toRow = static_cast<int> (rowIndex) + 1;
-        const int fromColumn = static_cast<int> (columnIndex) - 1;
-        const int toColumn = static_cast<int> (columnIndex) + 1;
-        const int heightMapDimension = static_cast<int> (heightMap.mDimension);
-
-        for(int row = fromRow; row <= toRow; ++row) {
-            for(int column = fromColumn; column <= toColumn; ++column) {                
-                const bool inBounds = row >= 0 
-                                   && row < heightMapDimension 
-                                   && column >= 0 
-                                   && column < heightMapDimension;
-                if(inBounds) {
-                    const size_t index = row * heightMap.mDimension + column;
-                    average += heightMap.mData[index];
-                    numNeighbors += 1.0f;
-                }
+    //
+    // It is separable: rows are summed vertically first, and then
+    // the sums of every 3 columns are averaged.
+
+    DirectX::XMVECTOR loadSamples(const float* samples)
+    {
+        return DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (samples));
+    }
+
+    DirectX::XMVECTOR loadSamples(const uint16_t* samples)
+    {
+        DirectX::PackedVector::XMUSHORT4 packedSamples;
+        memcpy(&packedSamples, samples, sizeof(packedSamples));
+        return DirectX::PackedVector::XMLoadUShort4(&packedSamples);
+    }
+
+    // Sums previousRow, row and nextRow. previousRow and nextRow
+    // are nullptr for rows out of the height map.
+    template<typename Sample>
+    void sumRows(const Sample* previousRow,
+                 const Sample* row,
+                 const Sample* nextRow,
+                 const uint32_t dimension,
+                 float* verticalSum)
+    {
+        uint32_t columnIndex = 0;
+        for(; columnIndex + 4 <= dimension; columnIndex += 4) {
+            DirectX::XMVECTOR sum = loadSamples(row + columnIndex);
+            if(previousRow != nullptr) {
+                sum = DirectX::XMVectorAdd(sum, loadSamples(previousRow + columnIndex));
+            }
+
+            if(nextRow != nullptr) {
+                sum = DirectX::XMVectorAdd(sum, loadSamples(nextRow + columnIndex));
+            }
+
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (verticalSum + columnIndex), sum);
+        }
+
+        for(; columnIndex < dimension; ++columnIndex) {
+            float sum = static_cast<float> (row[columnIndex]);
+            if(previousRow != nullptr) {
+                sum += static_cast<float> (previousRow[columnIndex]);
             }
+
+            if(nextRow != nullptr) {
+                sum += static_cast<float> (nextRow[columnIndex]);
+            }
+
+            verticalSum[columnIndex] = sum;
+        }
+    }
+
+    // Averages every 3 columns of verticalSum, that is the sum of numRows rows.
+    void averageColumns(const float* verticalSum,
+                        const uint32_t dimension,
+                        const float numRows,
+                        float* row)
+    {
+        if(dimension == 1) {
+            row[0] = verticalSum[0] / numRows;
+            return;
+        }
+
+        // Border pixels miss a column.
+        const uint32_t lastColumn = dimension - 1;
+        row[0] = (verticalSum[0] + verticalSum[1]) / (2.0f * numRows);
+        row[lastColumn] = (verticalSum[lastColumn - 1] + verticalSum[lastColumn]) / (2.0f * numRows);
+
+        // Inner pixels have all their neighbors, so they are branch free.
+        const float inverseNumNeighbors = 1.0f / (3.0f * numRows);
+        const DirectX::XMVECTOR inverseNumNeighborsVector = DirectX::XMVectorReplicate(inverseNumNeighbors);
+        uint32_t columnIndex = 1;
+        for(; columnIndex + 4 <= lastColumn; columnIndex += 4) {
+            const DirectX::XMVECTOR left = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (verticalSum + columnIndex - 1));
+            const DirectX::XMVECTOR center = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (verticalSum + columnIndex));
+            const DirectX::XMVECTOR right = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (verticalSum + columnIndex + 1));
+            const DirectX::XMVECTOR sum = DirectX::XMVectorAdd(DirectX::XMVectorAdd(left, center), right);
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (row + columnIndex), 
+                                   DirectX::XMVectorMultiply(sum, inverseNumNeighborsVector));
         }
 
-        return average / numNeighbors;
+        for(; columnIndex < lastColumn; ++columnIndex) {
+            const float sum = verticalSum[columnIndex - 1] + verticalSum[columnIndex] + verticalSum[columnIndex + 1];
+            row[columnIndex] = sum * inverseNumNeighbors;
+        }
     }
-}
 
-namespace HeightMapUtils
-{
-    void loadFromRAWFile(const std::string& filePath,  
-                         const float scaleFactor,
-                         HeightMap& heightMap)
+    // Rounds values to the nearest samples (halfway values to the even one), 4 at a time.
+    void storeSamples(const float* values,
+                      const uint32_t count,
+                      uint16_t* samples)
     {
-        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+        uint32_t index = 0;
+        for(; index + 4 <= count; index += 4) {
+            DirectX::PackedVector::XMUSHORT4 packedSamples;
+            DirectX::PackedVector::XMStoreUShort4(&packedSamples, loadSamples(values + index));
+            memcpy(samples + index, &packedSamples, sizeof(packedSamples));
+        }
+
+        // Remaining values are padded to 4, so they are rounded the same way.
+        if(index < count) {
+            float remainingValues[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            std::copy(values + index, values + count, remainingValues);
+            DirectX::PackedVector::XMUSHORT4 packedSamples;
+            DirectX::PackedVector::XMStoreUShort4(&packedSamples, loadSamples(remainingValues));
+            memcpy(samples + index, &packedSamples, (count - index) * sizeof(uint16_t));
+        }
+    }
+
+    // Writes the averaged row. Float rows are averaged in place
+    // and sample rows through averagedRow.
+    void averageRow(const float* verticalSum,
+                    const uint32_t dimension,
+                    const float numRows,
+                    std::vector<float>& /* averagedRow */,
+                    float* row)
+    {
+        averageColumns(verticalSum, dimension, numRows, row);
+    }
+
+    void averageRow(const float* verticalSum,
+                    const uint32_t dimension,
+                    const float numRows,
+                    std::vector<float>& averagedRow,
+                    uint16_t* row)
+    {
+        averagedRow.resize(dimension);
+        averageColumns(verticalSum, dimension, numRows, &averagedRow[0]);
+        storeSamples(&averagedRow[0], dimension, row);
+    }
+
+    // Rows of the height map filtered by a thread
+    template<typename Sample>
+    struct FilterChunk
+    {
+        uint32_t mFromRow;
+        uint32_t mToRow;
+
+        // Original rows mFromRow - 1 and mToRow, that other 
+        // chunks overwrite. Empty if they are out of the height map.
+        std::vector<Sample> mPreviousRow;
+        std::vector<Sample> mNextRow;
+    };
+
+    // Filters the chunk rows in place.
+    template<typename Sample>
+    void filterRows(FilterChunk<Sample>& chunk, 
+                    const uint32_t dimension,
+                    Sample* samples)
+    {
+        std::vector<float> verticalSum(dimension);
+        std::vector<float> averagedRow;
+
+        // Original previous row, as the height map one is already filtered.
+        std::vector<Sample>& previousRow = chunk.mPreviousRow;
+        bool hasPreviousRow = !previousRow.empty();
+        previousRow.resize(dimension);
+
+        for(uint32_t rowIndex = chunk.mFromRow; rowIndex < chunk.mToRow; ++rowIndex) {
+            Sample* row = samples + rowIndex * dimension;
+
+            const Sample* nextRow = nullptr;
+            if(rowIndex + 1 < chunk.mToRow) {
+                nextRow = row + dimension;
+            } else if(!chunk.mNextRow.empty()) {
+                nextRow = &chunk.mNextRow[0];
+            }
+
+            sumRows(hasPreviousRow ? &previousRow[0] : nullptr, 
+                    row, 
+                    nextRow, 
+                    dimension, 
+                    &verticalSum[0]);
+
+            const float numRows = 1.0f + (hasPreviousRow ? 1.0f : 0.0f) + (nextRow != nullptr ? 1.0f : 0.0f);
+            std::copy(row, row + dimension, previousRow.begin());
+            hasPreviousRow = true;
+
+            averageRow(&verticalSum[0], dimension, numRows, averagedRow, row);
+        }
+    }
+
+    // Filters the dimension x dimension samples in place,
+    // with rows split across numThreads threads.
+    template<typename Sample>
+    void filterSamples(Sample* samples,
+                       const uint32_t dimension,
+                       const uint32_t numThreads)
+    {
+        if(dimension == 0) {
+            return;
+        }
+
+        // Split rows in chunks, the same way parallelFor does.
+        const uint32_t requestedThreads = numThreads == 0 ? ParallelUtils::defaultThreadCount() : numThreads;
+        const uint32_t numChunks = (std::min)(requestedThreads, dimension);
+        const uint32_t chunkSize = dimension / numChunks;
+        const uint32_t remainder = dimension % numChunks;
+
+        // Save the rows around every chunk before any of them is filtered.
+        std::vector<FilterChunk<Sample>> chunks(numChunks);
+        uint32_t fromRow = 0;
+        for(uint32_t chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex) {
+            FilterChunk<Sample>& chunk = chunks[chunkIndex];
+            chunk.mFromRow = fromRow;
+            chunk.mToRow = fromRow + chunkSize + (chunkIndex < remainder ? 1 : 0);
+            fromRow = chunk.mToRow;
+
+            if(chunk.mFromRow > 0) {
+                const Sample* previousRow = samples + (chunk.mFromRow - 1) * dimension;
+                chunk.mPreviousRow.assign(previousRow, previousRow + dimension);
+            }
+
+            if(chunk.mToRow < dimension) {
+                const Sample* nextRow = samples + chunk.mToRow * dimension;
+                chunk.mNextRow.assign(nextRow, nextRow + dimension);
+            }
+        }
+
+        ParallelUtils::parallelFor(0, 
+                                   numChunks, 
+                                   numChunks, 
+                                   [&](const uint32_t fromChunk, const uint32_t toChunk) {
+            for(uint32_t chunkIndex = fromChunk; chunkIndex < toChunk; ++chunkIndex) {
+                filterRows(chunks[chunkIndex], dimension, samples);
+            }
+        });
+    }
+
+    // Read only view of a whole file
+    struct MappedFile
+    {
+        MappedFile()
+            : mFile(INVALID_HANDLE_VALUE)
+            , mFileMapping(nullptr)
+            , mView(nullptr)
+            , mSize(0)
+        {
+
+        }
+
+        ~MappedFile()
+        {
+            if(mView != nullptr) {
+                UnmapViewOfFile(mView);
+            }
+
+            if(mFileMapping != nullptr) {
+                CloseHandle(mFileMapping);
+            }
+
+            if(mFile != INVALID_HANDLE_VALUE) {
+                CloseHandle(mFile);
+            }
+        }
+
+        HANDLE mFile;
+        HANDLE mFileMapping;
+        const void* mView;
+        uint64_t mSize;
+
+    private:
+        MappedFile(const MappedFile&);
+        const MappedFile& operator=(const MappedFile&);
+    };
+
+    bool mapFile(const std::string& filePath,
+                 MappedFile& mappedFile,
+                 std::string& errorMessage)
+    {
+        mappedFile.mFile = CreateFileA(filePath.c_str(),
+                                       GENERIC_READ,
+                                       FILE_SHARE_READ,
+                                       nullptr,
+                                       OPEN_EXISTING,
+                                       FILE_ATTRIBUTE_NORMAL,
+                                       nullptr);
+        if(mappedFile.mFile == INVALID_HANDLE_VALUE) {
+            errorMessage = "Unable to open " + filePath;
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(mappedFile.mFile, &fileSize)) {
+            errorMessage = "Unable to get the size of " + filePath;
+            return false;
+        }
+
+        mappedFile.mSize = static_cast<uint64_t> (fileSize.QuadPart);
+        if(mappedFile.mSize == 0) {
+            errorMessage = filePath + " is empty";
+            return false;
+        }
+
+        mappedFile.mFileMapping = CreateFileMappingA(mappedFile.mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mappedFile.mFileMapping == nullptr) {
+            errorMessage = "Unable to map " + filePath;
+            return false;
+        }
+
+        mappedFile.mView = MapViewOfFile(mappedFile.mFileMapping, FILE_MAP_READ, 0, 0, 0);
+        if(mappedFile.mView == nullptr) {
+            errorMessage = "Unable to map " + filePath;
+            return false;
+        }
+
+        return true;
+    }
+
+    uint16_t swapBytes(const uint16_t value)
+    {
+        return static_cast<uint16_t> ((value >> 8) | (value << 8));
+    }
+
+    // Maps a RAW file and checks it has a sample per height map pixel.
+    bool mapRAWFile(const std::string& filePath,
+                    const uint32_t dimension,
+                    const RAWFormat format,
+                    MappedFile& mappedFile,
+                    std::string* errorMessage)
+    {
+        std::string error;
+        if(!mapFile(filePath, mappedFile, error)) {
+            if(errorMessage != nullptr) {
+                *errorMessage = error;
+            }
+
+            return false;
+        }
 
         // A height for each vertex
-        const uint32_t numberOfPixels = heightMap.mDimension * heightMap.mDimension;
-        std::vector<uint8_t> fileData(numberOfPixels);
+        const uint64_t numberOfPixels = static_cast<uint64_t> (dimension) * dimension;
+        const uint64_t bytesPerSample = format == RAWFormat::UINT8 ? 1 : 2;
+        if(mappedFile.mSize < numberOfPixels * bytesPerSample) {
+            if(errorMessage != nullptr) {
+                *errorMessage = filePath + " is too small for the height map dimension";
+            }
 
-        // Open the file.
-        std::ifstream file;
-        file.open(filePath.c_str(), std::ios_base::binary);
-        assert(file);
+            return false;
+        }
 
-        // Read the RAW bytes.
-        file.read(reinterpret_cast<char*> (&fileData[0]), 
-                  static_cast<std::streamsize> (fileData.size()));
+        return true;
+    }
 
-        // Done with file.
-        file.close();
+    // Expands RAW samples [begin, end) to 16 bits.
+    void expandRAWSamples(const uint8_t* samples,
+                          const RAWFormat format,
+                          const uint32_t begin,
+                          const uint32_t end,
+                          uint16_t* quantizedSamples)
+    {
+        if(format == RAWFormat::UINT8) {
+            for(uint32_t pixelIndex = begin; pixelIndex < end; ++pixelIndex) {
+                quantizedSamples[pixelIndex] = static_cast<uint16_t> (samples[pixelIndex] * 257);
+            }
+        } else {
+            memcpy(quantizedSamples + begin, samples + 2 * begin, (end - begin) * sizeof(uint16_t));
+            if(format == RAWFormat::UINT16_BIG_ENDIAN) {
+                for(uint32_t pixelIndex = begin; pixelIndex < end; ++pixelIndex) {
+                    quantizedSamples[pixelIndex] = swapBytes(quantizedSamples[pixelIndex]);
+                }
+            }
+        }
+    }
 
-        // Copy the array data into a float array and scale it.
-        for(size_t pixelIndex = 0; pixelIndex < numberOfPixels; ++pixelIndex) {
-            heightMap.mData[pixelIndex] = (fileData[pixelIndex] / 255.0f) * scaleFactor;
+    // heights = offset + scale * samples, 4 at a time
+    void dequantizeSamples(const uint16_t* samples,
+                           const uint32_t count,
+                           const float scale,
+                           const float offset,
+                           float* heights)
+    {
+        const DirectX::XMVECTOR scaleVector = DirectX::XMVectorReplicate(scale);
+        const DirectX::XMVECTOR offsetVector = DirectX::XMVectorReplicate(offset);
+        uint32_t index = 0;
+        for(; index + 4 <= count; index += 4) {
+            const DirectX::XMVECTOR heightVector = DirectX::XMVectorMultiplyAdd(loadSamples(samples + index), scaleVector, offsetVector);
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (heights + index), heightVector);
+        }
+
+        for(; index < count; ++index) {
+            heights[index] = offset + scale * samples[index];
         }
     }
 
-    void applyNeighborsFilter(HeightMap& heightMap)
+    // Levels every thread reduces its rows through.
+    // Bands of 2^sBandLevels rows stay in cache while they are reduced.
+    const uint32_t sBandLevels = 5;
+
+    DirectX::XMVECTOR reduce(const MipReducer reducer,
+                             DirectX::FXMVECTOR value1,
+                             DirectX::FXMVECTOR value2)
     {
-        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+        switch(reducer) {
+        case MipReducer::MIN:
+            return DirectX::XMVectorMin(value1, value2);
+        case MipReducer::MAX:
+            return DirectX::XMVectorMax(value1, value2);
+        default:
+            return DirectX::XMVectorAdd(value1, value2);
+        }
+    }
+
+    float reduce(const MipReducer reducer,
+                 const float value1,
+                 const float value2)
+    {
+        switch(reducer) {
+        case MipReducer::MIN:
+            return (std::min)(value1, value2);
+        case MipReducer::MAX:
+            return (std::max)(value1, value2);
+        default:
+            return value1 + value2;
+        }
+    }
+
+    // Reduces rows [fromRow, toRow) of the next mip level.
+    // Reduced values are stored as offset + scale * value
+    // (averages are divided by the texels they cover first).
+    template<typename Sample>
+    void reduceRows(const Sample* samples,
+                    const uint32_t dimension,
+                    const float scale,
+                    const float offset,
+                    const MipReducer reducer,
+                    const uint32_t fromRow,
+                    const uint32_t toRow,
+                    HeightMap& mipLevel)
+    {
+        const uint32_t mipDimension = mipLevel.mDimension;
+        const uint32_t lastIndex = mipDimension - 1;
+        const bool hasExtraTexel = (dimension & 1) != 0;
+        const DirectX::XMVECTOR offsetVector = DirectX::XMVectorReplicate(offset);
+        std::vector<float> verticalReduction(dimension);
+        for(uint32_t mipRow = fromRow; mipRow < toRow; ++mipRow) {
+            // The last row of odd levels also reduces the extra source row.
+            const Sample* rows[3];
+            rows[0] = samples + 2 * mipRow * dimension;
+            rows[1] = rows[0] + dimension;
+            rows[2] = rows[1] + dimension;
+            const uint32_t numRows = mipRow == lastIndex && hasExtraTexel ? 3 : 2;
+
+            uint32_t column = 0;
+            for(; column + 4 <= dimension; column += 4) {
+                DirectX::XMVECTOR value = reduce(reducer, loadSamples(rows[0] + column), loadSamples(rows[1] + column));
+                if(numRows == 3) {
+                    value = reduce(reducer, value, loadSamples(rows[2] + column));
+                }
 
-        // Filter heightmap
-        const uint32_t heightMapDimension = heightMap.mDimension;
-        HeightMap filteredHeightMap(heightMapDimension);
-        for(uint32_t rowIndex = 0; rowIndex < heightMapDimension; ++rowIndex) {
-            for(uint32_t columnIndex = 0; 
-                         columnIndex < heightMapDimension; 
-                         ++columnIndex) {
-                const size_t index = rowIndex * heightMapDimension + columnIndex;
-                filteredHeightMap.mData[index] = computeAverageHeight(heightMap,
-                                                                      rowIndex, 
-                                                                      columnIndex);
+                DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (&verticalReduction[column]), value);
             }
+
+            for(; column < dimension; ++column) {
+                float value = reduce(reducer, static_cast<float> (rows[0][column]), static_cast<float> (rows[1][column]));
+                if(numRows == 3) {
+                    value = reduce(reducer, value, static_cast<float> (rows[2][column]));
+                }
+
+                verticalReduction[column] = value;
+            }
+
+            // Pairs of columns. The last column is reduced apart,
+            // as it can cover 3 of them.
+            const float rowScale = reducer == MipReducer::AVERAGE ? scale / (2.0f * numRows) : scale;
+            const DirectX::XMVECTOR rowScaleVector = DirectX::XMVectorReplicate(rowScale);
+            float* mipHeights = &mipLevel.mData[mipRow * mipDimension];
+            uint32_t mipColumn = 0;
+            for(; mipColumn + 4 <= lastIndex; mipColumn += 4) {
+                const DirectX::XMVECTOR values1 = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (&verticalReduction[2 * mipColumn]));
+                const DirectX::XMVECTOR values2 = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (&verticalReduction[2 * mipColumn + 4]));
+                const DirectX::XMVECTOR evenColumns = DirectX::XMVectorPermute<0, 2, 4, 6>(values1, values2);
+                const DirectX::XMVECTOR oddColumns = DirectX::XMVectorPermute<1, 3, 5, 7>(values1, values2);
+                const DirectX::XMVECTOR value = reduce(reducer, evenColumns, oddColumns);
+                DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (mipHeights + mipColumn), 
+                                       DirectX::XMVectorMultiplyAdd(value, rowScaleVector, offsetVector));
+            }
+
+            for(; mipColumn < lastIndex; ++mipColumn) {
+                const float value = reduce(reducer, verticalReduction[2 * mipColumn], verticalReduction[2 * mipColumn + 1]);
+                mipHeights[mipColumn] = offset + rowScale * value;
+            }
+
+            float value = reduce(reducer, verticalReduction[2 * lastIndex], verticalReduction[2 * lastIndex + 1]);
+            float lastScale = rowScale;
+            if(hasExtraTexel) {
+                value = reduce(reducer, value, verticalReduction[2 * lastIndex + 2]);
+                lastScale = reducer == MipReducer::AVERAGE ? scale / (3.0f * numRows) : scale;
+            }
+
+            mipHeights[lastIndex] = offset + lastScale * value;
+        }
+    }
+
+    template<typename Sample>
+    void buildMipLevels(const Sample* samples,
+                        const uint32_t dimension,
+                        const float scale,
+                        const float offset,
+                        const MipReducer reducer,
+                        std::vector<HeightMap>& mipLevels,
+                        const uint32_t numThreads)
+    {
+        mipLevels.clear();
+        for(uint32_t mipDimension = dimension / 2; mipDimension > 0; mipDimension /= 2) {
+            mipLevels.push_back(HeightMap(mipDimension));
+        }
+
+        if(mipLevels.empty()) {
+            return;
         }
 
-        // Replace the old height map with the filtered one.
-        heightMap = filteredHeightMap;
+        // Every band of 2^bandLevels rows is reduced through bandLevels
+        // levels by the same thread, as its rows only depend on the band.
+        // The last band takes the rows left, so it is at least as
+        // large as the others and it owns the last row of every level, 
+        // that can reduce an extra row.
+        const uint32_t bandLevels = (std::min)(sBandLevels, static_cast<uint32_t> (mipLevels.size()));
+        const uint32_t bandRows = 1 << bandLevels;
+        const uint32_t numBands = dimension / bandRows;
+        ParallelUtils::parallelFor(0, 
+                                   numBands, 
+                                   numThreads, 
+                                   [&](const uint32_t fromBand, const uint32_t toBand) {
+            for(uint32_t band = fromBand; band < toBand; ++band) {
+                const uint32_t fromRow = band * bandRows;
+                const uint32_t toRow = band + 1 < numBands ? fromRow + bandRows : dimension;
+                for(uint32_t level = 1; level <= bandLevels; ++level) {
+                    HeightMap& mipLevel = mipLevels[level - 1];
+                    const uint32_t mipToRow = band + 1 < numBands ? toRow >> level : mipLevel.mDimension;
+                    if(level == 1) {
+                        reduceRows(samples, dimension, scale, offset, reducer, fromRow >> level, mipToRow, mipLevel);
+                    } else {
+                        const HeightMap& previousLevel = mipLevels[level - 2];
+                        reduceRows(&previousLevel.mData[0], previousLevel.mDimension, 1.0f, 0.0f, reducer, fromRow >> level, mipToRow, mipLevel);
+                    }
+                }
+            }
+        });
+
+        // Levels left are at most 1 / 2^bandLevels of the height map.
+        for(uint32_t level = bandLevels + 1; level <= mipLevels.size(); ++level) {
+            const HeightMap& previousLevel = mipLevels[level - 2];
+            HeightMap& mipLevel = mipLevels[level - 1];
+            ParallelUtils::parallelFor(0, 
+                                       mipLevel.mDimension, 
+                                       numThreads, 
+                                       [&](const uint32_t fromRow, const uint32_t toRow) {
+                reduceRows(&previousLevel.mData[0], previousLevel.mDimension, 1.0f, 0.0f, reducer, fromRow, toRow, mipLevel);
+            });
+        }
     }
 
-    ID3D11ShaderResourceView* buildSRV(ID3D11Device& device,
-                                       const HeightMap& heightMap,
-                                       const uint32_t texture2DDescBindFlags)
+    // Half heights of every mip level, the first one being the height map.
+    // Levels are converted a thread each.
+    typedef std::vector<std::vector<DirectX::PackedVector::HALF>> HalfMipLevels;
+
+    void convertMipLevels(const std::vector<HeightMap>& mipLevels,
+                          HalfMipLevels& halfMipLevels)
     {
-        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+        halfMipLevels.resize(mipLevels.size() + 1);
+        ParallelUtils::parallelFor(0, 
+                                   static_cast<uint32_t> (mipLevels.size()), 
+                                   0, 
+                                   [&](const uint32_t fromLevel, const uint32_t toLevel) {
+            for(uint32_t level = fromLevel; level < toLevel; ++level) {
+                const std::vector<float>& heights = mipLevels[level].mData;
+                std::vector<DirectX::PackedVector::HALF>& halfHeights = halfMipLevels[level + 1];
+                halfHeights.resize(heights.size());
+                HalfConversionUtils::convertFloatToHalf(&heights[0], static_cast<uint32_t> (heights.size()), &halfHeights[0], 1);
+            }
+        });
+    }
 
+    ID3D11ShaderResourceView* buildHalfSRV(ID3D11Device& device,
+                                           const uint32_t heightMapDimension,
+                                           const HalfMipLevels& halfMipLevels,
+                                           const uint32_t texture2DDescBindFlags)
+    {
         // Fill texture 2D description
-        const uint32_t heightMapDimension = heightMap.mDimension;
         D3D11_TEXTURE2D_DESC texture2DDesc;
         texture2DDesc.Width = heightMapDimension;
         texture2DDesc.Height = heightMapDimension;
-        texture2DDesc.MipLevels = 1;
+        texture2DDesc.MipLevels = static_cast<uint32_t> (halfMipLevels.size());
         texture2DDesc.ArraySize = 1;
         texture2DDesc.Format = DXGI_FORMAT_R16_FLOAT;
         texture2DDesc.SampleDesc.Count = 1;
@@ -127,24 +618,19 @@ namespace HeightMapUtils
         texture2DDesc.CPUAccessFlags = 0;
         texture2DDesc.MiscFlags = 0;
 
-        // HALF is defined for storing 16-bit float.
-        std::vector<DirectX::PackedVector::HALF> halfHeightMap(heightMap.mData.size());
-        std::transform(heightMap.mData.begin(), 
-                       heightMap.mData.end(), 
-                       halfHeightMap.begin(), 
-                       DirectX::PackedVector::XMConvertFloatToHalf);
-
-        // Fill subresource data
-        D3D11_SUBRESOURCE_DATA subResourceData;
-        subResourceData.pSysMem = &halfHeightMap[0];
-        subResourceData.SysMemPitch = 
-            static_cast<uint32_t> (heightMapDimension) * sizeof(DirectX::PackedVector::HALF);
-        subResourceData.SysMemSlicePitch = 0;
+        // Fill subresource data of every mip level
+        std::vector<D3D11_SUBRESOURCE_DATA> subResourceData(halfMipLevels.size());
+        for(uint32_t level = 0; level < halfMipLevels.size(); ++level) {
+            subResourceData[level].pSysMem = &halfMipLevels[level][0];
+            subResourceData[level].SysMemPitch = 
+                (std::max)(heightMapDimension >> level, 1U) * sizeof(DirectX::PackedVector::HALF);
+            subResourceData[level].SysMemSlicePitch = 0;
+        }
 
         // Create height map texture 2D
         ID3D11Texture2D* heightMapTexture;
         HRESULT result = device.CreateTexture2D(&texture2DDesc,
-                                                &subResourceData, 
+                                                &subResourceData[0], 
                                                 &heightMapTexture);
         DxErrorChecker(result);
 
@@ -166,4 +652,292 @@ namespace HeightMapUtils
 
         return heightMapSRV;
     }
+}
+
+namespace HeightMapUtils
+{
+    void convertRAWSamples(const uint8_t* samples,
+                           const RAWFormat format,
+                           const float scaleFactor,
+                           const uint32_t begin,
+                           const uint32_t end,
+                           float* heights)
+    {
+        const bool is8Bit = format == RAWFormat::UINT8;
+        const float maxSample = is8Bit ? 255.0f : 65535.0f;
+        const DirectX::XMVECTOR maxSampleVector = DirectX::XMVectorReplicate(maxSample);
+        const DirectX::XMVECTOR scaleVector = DirectX::XMVectorReplicate(scaleFactor);
+
+        uint32_t pixelIndex = begin;
+        for(; pixelIndex + 4 <= end; pixelIndex += 4) {
+            DirectX::XMVECTOR sampleVector;
+            if(is8Bit) {
+                DirectX::PackedVector::XMUBYTE4 packedSamples;
+                memcpy(&packedSamples, samples + pixelIndex, sizeof(packedSamples));
+                sampleVector = DirectX::PackedVector::XMLoadUByte4(&packedSamples);
+            } else {
+                DirectX::PackedVector::XMUSHORT4 packedSamples;
+                memcpy(&packedSamples, samples + 2 * pixelIndex, sizeof(packedSamples));
+                if(format == RAWFormat::UINT16_BIG_ENDIAN) {
+                    packedSamples.x = swapBytes(packedSamples.x);
+                    packedSamples.y = swapBytes(packedSamples.y);
+                    packedSamples.z = swapBytes(packedSamples.z);
+                    packedSamples.w = swapBytes(packedSamples.w);
+                }
+
+                sampleVector = DirectX::PackedVector::XMLoadUShort4(&packedSamples);
+            }
+
+            const DirectX::XMVECTOR heightVector = DirectX::XMVectorMultiply(DirectX::XMVectorDivide(sampleVector, maxSampleVector), 
+                                                                             scaleVector);
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (heights + pixelIndex), heightVector);
+        }
+
+        // Remaining samples
+        for(; pixelIndex < end; ++pixelIndex) {
+            float sample;
+            if(is8Bit) {
+                sample = samples[pixelIndex];
+            } else {
+                uint16_t packedSample;
+                memcpy(&packedSample, samples + 2 * pixelIndex, sizeof(packedSample));
+                sample = format == RAWFormat::UINT16_BIG_ENDIAN ? swapBytes(packedSample) : packedSample;
+            }
+
+            heights[pixelIndex] = (sample / maxSample) * scaleFactor;
+        }
+    }
+
+    bool loadFromRAWFile(const std::string& filePath,  
+                         const float scaleFactor,
+                         HeightMap& heightMap,
+                         const RAWFormat format,
+                         std::string* errorMessage)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        MappedFile mappedFile;
+        if(!mapRAWFile(filePath, heightMap.mDimension, format, mappedFile, errorMessage)) {
+            return false;
+        }
+
+        // Convert the RAW samples in chunks of rows.
+        const uint8_t* samples = static_cast<const uint8_t*> (mappedFile.mView);
+        float* heights = &heightMap.mData[0];
+        const uint32_t dimension = heightMap.mDimension;
+        ParallelUtils::parallelFor(0, 
+                                   dimension, 
+                                   0, 
+                                   [&](const uint32_t fromRow, const uint32_t toRow) {
+            convertRAWSamples(samples, format, scaleFactor, fromRow * dimension, toRow * dimension, heights);
+        });
+
+        return true;
+    }
+
+    bool loadFromRAWFile(const std::string& filePath,  
+                         const float scaleFactor,
+                         QuantizedHeightMap& heightMap,
+                         const RAWFormat format,
+                         std::string* errorMessage)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        MappedFile mappedFile;
+        if(!mapRAWFile(filePath, heightMap.mDimension, format, mappedFile, errorMessage)) {
+            return false;
+        }
+
+        // 65535 is the 8-bit 255 expanded.
+        heightMap.mScale = scaleFactor / 65535.0f;
+        heightMap.mOffset = 0.0f;
+
+        const uint8_t* samples = static_cast<const uint8_t*> (mappedFile.mView);
+        uint16_t* quantizedSamples = &heightMap.mData[0];
+        const uint32_t dimension = heightMap.mDimension;
+        ParallelUtils::parallelFor(0, 
+                                   dimension, 
+                                   0, 
+                                   [&](const uint32_t fromRow, const uint32_t toRow) {
+            expandRAWSamples(samples, format, fromRow * dimension, toRow * dimension, quantizedSamples);
+        });
+
+        return true;
+    }
+
+    void applyNeighborsFilter(HeightMap& heightMap, 
+                              const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        if(heightMap.mDimension > 0) {
+            filterSamples(&heightMap.mData[0], heightMap.mDimension, numThreads);
+        }
+    }
+
+    void applyNeighborsFilter(QuantizedHeightMap& heightMap, 
+                              const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        if(heightMap.mDimension > 0) {
+            filterSamples(&heightMap.mData[0], heightMap.mDimension, numThreads);
+        }
+    }
+
+    void quantize(const HeightMap& heightMap,
+                  QuantizedHeightMap& quantizedHeightMap,
+                  const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        const uint32_t dimension = heightMap.mDimension;
+        quantizedHeightMap.mDimension = dimension;
+        quantizedHeightMap.mData.resize(heightMap.mData.size());
+        if(heightMap.mData.empty()) {
+            return;
+        }
+
+        const std::pair<std::vector<float>::const_iterator, std::vector<float>::const_iterator> range = 
+            std::minmax_element(heightMap.mData.begin(), heightMap.mData.end());
+        const float minHeight = *range.first;
+        const float maxHeight = *range.second;
+
+        // A flat height map keeps the default scale, with every sample 0.
+        quantizedHeightMap.mOffset = minHeight;
+        quantizedHeightMap.mScale = maxHeight > minHeight ? (maxHeight - minHeight) / 65535.0f : 1.0f / 65535.0f;
+
+        const float offset = quantizedHeightMap.mOffset;
+        const float inverseScale = maxHeight > minHeight ? 65535.0f / (maxHeight - minHeight) : 0.0f;
+        const float* heights = &heightMap.mData[0];
+        uint16_t* samples = &quantizedHeightMap.mData[0];
+        ParallelUtils::parallelFor(0, 
+                                   dimension, 
+                                   numThreads, 
+                                   [&](const uint32_t fromRow, const uint32_t toRow) {
+            const DirectX::XMVECTOR offsetVector = DirectX::XMVectorReplicate(offset);
+            const DirectX::XMVECTOR inverseScaleVector = DirectX::XMVectorReplicate(inverseScale);
+            const uint32_t end = toRow * dimension;
+            uint32_t index = fromRow * dimension;
+            for(; index + 4 <= end; index += 4) {
+                const DirectX::XMVECTOR values = DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(loadSamples(heights + index), offsetVector), 
+                                                                           inverseScaleVector);
+                DirectX::PackedVector::XMUSHORT4 packedSamples;
+                DirectX::PackedVector::XMStoreUShort4(&packedSamples, values);
+                memcpy(samples + index, &packedSamples, sizeof(packedSamples));
+            }
+
+            for(; index < end; ++index) {
+                const float value = (heights[index] - offset) * inverseScale;
+                storeSamples(&value, 1, samples + index);
+            }
+        });
+    }
+
+    void dequantize(const QuantizedHeightMap& quantizedHeightMap,
+                    HeightMap& heightMap,
+                    const uint32_t numThreads)
+    {
+        assert(quantizedHeightMap.mData.size() == quantizedHeightMap.mDimension * quantizedHeightMap.mDimension);
+
+        const uint32_t dimension = quantizedHeightMap.mDimension;
+        heightMap.mDimension = dimension;
+        heightMap.mData.resize(quantizedHeightMap.mData.size());
+        if(heightMap.mData.empty()) {
+            return;
+        }
+
+        const uint16_t* samples = &quantizedHeightMap.mData[0];
+        float* heights = &heightMap.mData[0];
+        ParallelUtils::parallelFor(0, 
+                                   dimension, 
+                                   numThreads, 
+                                   [&](const uint32_t fromRow, const uint32_t toRow) {
+            dequantizeSamples(samples + fromRow * dimension, 
+                              (toRow - fromRow) * dimension, 
+                              quantizedHeightMap.mScale, 
+                              quantizedHeightMap.mOffset, 
+                              heights + fromRow * dimension);
+        });
+    }
+
+    void buildMipChain(const HeightMap& heightMap,
+                       const MipReducer reducer,
+                       std::vector<HeightMap>& mipLevels,
+                       const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        if(heightMap.mDimension > 0) {
+            buildMipLevels(&heightMap.mData[0], heightMap.mDimension, 1.0f, 0.0f, reducer, mipLevels, numThreads);
+        } else {
+            mipLevels.clear();
+        }
+    }
+
+    void buildMipChain(const QuantizedHeightMap& heightMap,
+                       const MipReducer reducer,
+                       std::vector<HeightMap>& mipLevels,
+                       const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        if(heightMap.mDimension > 0) {
+            buildMipLevels(&heightMap.mData[0], heightMap.mDimension, heightMap.mScale, heightMap.mOffset, reducer, mipLevels, numThreads);
+        } else {
+            mipLevels.clear();
+        }
+    }
+
+    ID3D11ShaderResourceView* buildSRV(ID3D11Device& device,
+                                       const HeightMap& heightMap,
+                                       const uint32_t texture2DDescBindFlags,
+                                       const MipReducer reducer)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        std::vector<HeightMap> mipLevels;
+        buildMipChain(heightMap, reducer, mipLevels);
+
+        // HALF is defined for storing 16-bit float.
+        HalfMipLevels halfMipLevels;
+        convertMipLevels(mipLevels, halfMipLevels);
+        halfMipLevels[0].resize(heightMap.mData.size());
+        HalfConversionUtils::convertFloatToHalf(&heightMap.mData[0],
+                                                static_cast<uint32_t> (heightMap.mData.size()),
+                                                &halfMipLevels[0][0]);
+
+        return buildHalfSRV(device, heightMap.mDimension, halfMipLevels, texture2DDescBindFlags);
+    }
+
+    ID3D11ShaderResourceView* buildSRV(ID3D11Device& device,
+                                       const QuantizedHeightMap& heightMap,
+                                       const uint32_t texture2DDescBindFlags,
+                                       const MipReducer reducer)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        std::vector<HeightMap> mipLevels;
+        buildMipChain(heightMap, reducer, mipLevels);
+        HalfMipLevels halfMipLevels;
+        convertMipLevels(mipLevels, halfMipLevels);
+
+        // Samples are converted to heights a row at a time,
+        // so the float height map is never built.
+        const uint32_t dimension = heightMap.mDimension;
+        std::vector<DirectX::PackedVector::HALF>& halfHeightMap = halfMipLevels[0];
+        halfHeightMap.resize(heightMap.mData.size());
+        ParallelUtils::parallelFor(0, 
+                                   dimension, 
+                                   0, 
+                                   [&](const uint32_t fromRow, const uint32_t toRow) {
+            std::vector<float> rowHeights(dimension);
+            for(uint32_t row = fromRow; row < toRow; ++row) {
+                dequantizeSamples(&heightMap.mData[row * dimension], dimension, heightMap.mScale, heightMap.mOffset, &rowHeights[0]);
+                HalfConversionUtils::convertFloatToHalf(&rowHeights[0], dimension, &halfHeightMap[row * dimension], 1);
+            }
+        });
+
+        return buildHalfSRV(device, dimension, halfMipLevels, texture2DDescBindFlags);
+    }
 }
\ No newline at end of file
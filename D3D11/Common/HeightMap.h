@@ -32,17 +32,122 @@ struct HeightMap
     uint32_t mDimension;
 };
 
+// Heights stored as 16-bit unsigned normalized samples, with
+// height = mOffset + mScale * sample. It takes half the memory of 
+// HeightMap, and RAW files are stored with no precision loss.
+struct QuantizedHeightMap
+{
+    QuantizedHeightMap(const uint32_t dimension)
+        : mData(dimension * dimension, 0) 
+        , mDimension(dimension)
+        , mScale(1.0f / 65535.0f)
+        , mOffset(0.0f)
+    {
+
+    }
+
+    std::vector<uint16_t> mData;
+    uint32_t mDimension;
+    float mScale;
+    float mOffset;
+};
+
+// How a mip texel reduces the texels it covers
+enum struct MipReducer
+{
+    MIN,
+    MAX,
+    AVERAGE
+};
+
+// Sample layout of RAW height map files
+enum struct RAWFormat
+{
+    UINT8,
+    UINT16_LITTLE_ENDIAN,
+    UINT16_BIG_ENDIAN
+};
+
 namespace HeightMapUtils
 {
-    void loadFromRAWFile(const std::string& filePath, 
+    // Memory maps the file and converts its samples to heights
+    // in [0, scaleFactor]. The file must have at least a sample per 
+    // height map pixel. Returns false (and fills errorMessage if it 
+    // is not nullptr) if the file can not be opened or is too small.
+    bool loadFromRAWFile(const std::string& filePath, 
+                         const float scaleFactor,
+                         HeightMap& heightMap,
+                         const RAWFormat format = RAWFormat::UINT8,
+                         std::string* errorMessage = nullptr);
+
+    // 8-bit samples are expanded to 16 bits (sample * 257) and 16-bit 
+    // ones are copied, with mScale = scaleFactor / 65535 and mOffset = 0,
+    // so heights are the same as the HeightMap ones.
+    bool loadFromRAWFile(const std::string& filePath, 
                          const float scaleFactor,
-                         HeightMap& heightMap);
+                         QuantizedHeightMap& heightMap,
+                         const RAWFormat format = RAWFormat::UINT8,
+                         std::string* errorMessage = nullptr);
+
+    // Converts RAW samples [begin, end) to heights[begin, end) in 
+    // [0, scaleFactor], 4 at a time. Heights are 
+    // (sample / maxSample) * scaleFactor.
+    void convertRAWSamples(const uint8_t* samples,
+                           const RAWFormat format,
+                           const float scaleFactor,
+                           const uint32_t begin,
+                           const uint32_t end,
+                           float* heights);
 
     // Apply a filter to make height map smoother
     // taking into account its neighbors pixels.
-    void applyNeighborsFilter(HeightMap& heightMap);
+    // It filters in place, with rows split across numThreads
+    // threads (0 uses all hardware threads).
+    void applyNeighborsFilter(HeightMap& heightMap, 
+                              const uint32_t numThreads = 0);
+
+    // Filters the samples, rounding the averages to the nearest sample.
+    void applyNeighborsFilter(QuantizedHeightMap& heightMap, 
+                              const uint32_t numThreads = 0);
 
+    // Conversions between the storages. quantize maps the height range
+    // of heightMap to the whole sample range.
+    void quantize(const HeightMap& heightMap,
+                  QuantizedHeightMap& quantizedHeightMap,
+                  const uint32_t numThreads = 0);
+
+    void dequantize(const QuantizedHeightMap& quantizedHeightMap,
+                    HeightMap& heightMap,
+                    const uint32_t numThreads = 0);
+
+    // Mip levels 1 to log2(dimension) of the height map, that is,
+    // mipLevels[i] is level i + 1 and the last one is 1x1. Every level
+    // halves the previous one (rounding down), and every texel reduces
+    // the 2x2 texels it covers, or 3 in the last row and column of odd
+    // levels, so MIN and MAX levels are conservative bounds of the height
+    // map. Rows are split across numThreads threads (0 uses all hardware
+    // threads), and every thread reduces its rows through several levels.
+    void buildMipChain(const HeightMap& heightMap,
+                       const MipReducer reducer,
+                       std::vector<HeightMap>& mipLevels,
+                       const uint32_t numThreads = 0);
+
+    // Levels are reduced from the samples and stored as heights.
+    void buildMipChain(const QuantizedHeightMap& heightMap,
+                       const MipReducer reducer,
+                       std::vector<HeightMap>& mipLevels,
+                       const uint32_t numThreads = 0);
+
+    // The texture has the whole mip chain, built with reducer.
     ID3D11ShaderResourceView* buildSRV(ID3D11Device& device,
                                        const HeightMap& heightMap,
-                                       const uint32_t texture2DDescBindFlags);
-}
\ No newline at end of file
+                                       const uint32_t texture2DDescBindFlags,
+                                       const MipReducer reducer = MipReducer::AVERAGE);
+
+    // Same R16_FLOAT heights texture, converted from the samples
+    // a row at a time.
+    ID3D11ShaderResourceView* buildSRV(ID3D11Device& device,
+                                       const QuantizedHeightMap& heightMap,
+                                       const uint32_t texture2DDescBindFlags,
+                                       const MipReducer reducer = MipReducer::AVERAGE);
+}
\ No newline at end of file
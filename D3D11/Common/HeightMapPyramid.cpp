@@ -0,0 +1,435 @@
+#include "HeightMapPyramid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <HeightMap.h>
+#include <ParallelUtils.h>
+
+namespace
+{
+    void merge(const HeightRange& source,
+               HeightRange& destination)
+    {
+        destination.mMin = std::min(destination.mMin, source.mMin);
+        destination.mMax = std::max(destination.mMax, source.mMax);
+    }
+
+    // Cells [fromCell, toCell) whose corners are the samples [fromSample, toSample]
+    // of a row or column. A single sample uses the cells around it.
+    void computeCellInterval(const uint32_t cellDimension,
+                             const uint32_t fromSample,
+                             const uint32_t toSample,
+                             uint32_t& fromCell,
+                             uint32_t& toCell)
+    {
+        assert(fromSample <= toSample);
+
+        if(toSample > fromSample) {
+            fromCell = std::min(fromSample, cellDimension - 1);
+            toCell = std::min(toSample, cellDimension);
+        } else {
+            fromCell = std::min(fromSample > 0 ? fromSample - 1 : 0, cellDimension - 1);
+            toCell = std::min(fromSample + 1, cellDimension);
+        }
+    }
+
+    // Merges the ranges of the cells [fromRow, toRow) x [fromColumn, toColumn)
+    // inside node (row, column) of level.
+    void mergeRange(const HeightMapPyramid& pyramid,
+                    const uint32_t level,
+                    const uint32_t row,
+                    const uint32_t column,
+                    const uint32_t fromRow,
+                    const uint32_t fromColumn,
+                    const uint32_t toRow,
+                    const uint32_t toColumn,
+                    HeightRange& range)
+    {
+        const uint32_t levelDimension = pyramid.mLevelDimensions[level];
+        const HeightRange& node = pyramid.mLevels[level][row * levelDimension + column];
+
+        // The node can not extend the range.
+        if(node.mMin >= range.mMin && node.mMax <= range.mMax) {
+            return;
+        }
+
+        const uint32_t nodeFromRow = row << level;
+        const uint32_t nodeFromColumn = column << level;
+        const uint32_t nodeToRow = std::min((row + 1) << level, pyramid.mCellDimension);
+        const uint32_t nodeToColumn = std::min((column + 1) << level, pyramid.mCellDimension);
+
+        const bool outside = nodeToRow <= fromRow ||
+                             nodeFromRow >= toRow ||
+                             nodeToColumn <= fromColumn ||
+                             nodeFromColumn >= toColumn;
+        if(outside) {
+            return;
+        }
+
+        const bool inside = nodeFromRow >= fromRow &&
+                            nodeToRow <= toRow &&
+                            nodeFromColumn >= fromColumn &&
+                            nodeToColumn <= toColumn;
+        if(inside) {
+            merge(node, range);
+            return;
+        }
+
+        // Level 0 nodes are single cells, so they are inside or outside.
+        assert(level > 0);
+        const uint32_t childLevelDimension = pyramid.mLevelDimensions[level - 1];
+        const uint32_t toChildRow = std::min(2 * row + 2, childLevelDimension);
+        const uint32_t toChildColumn = std::min(2 * column + 2, childLevelDimension);
+        for(uint32_t childRow = 2 * row; childRow < toChildRow; ++childRow) {
+            for(uint32_t childColumn = 2 * column; childColumn < toChildColumn; ++childColumn) {
+                mergeRange(pyramid, level - 1, childRow, childColumn, fromRow, fromColumn, toRow, toColumn, range);
+            }
+        }
+    }
+
+    struct Ray
+    {
+        DirectX::XMFLOAT3 mOrigin;
+        DirectX::XMFLOAT3 mDirection;
+        DirectX::XMFLOAT3 mInverseDirection;
+    };
+
+    // Distance where the ray enters the box, or a negative
+    // value if it misses it before maxDistance.
+    float intersectBox(const Ray& ray,
+                       const DirectX::XMFLOAT3& minCorner,
+                       const DirectX::XMFLOAT3& maxCorner,
+                       const float maxDistance)
+    {
+        const float origin[3] = { ray.mOrigin.x, ray.mOrigin.y, ray.mOrigin.z };
+        const float direction[3] = { ray.mDirection.x, ray.mDirection.y, ray.mDirection.z };
+        const float inverseDirection[3] = { ray.mInverseDirection.x, ray.mInverseDirection.y, ray.mInverseDirection.z };
+        const float minValues[3] = { minCorner.x, minCorner.y, minCorner.z };
+        const float maxValues[3] = { maxCorner.x, maxCorner.y, maxCorner.z };
+
+        float enter = 0.0f;
+        float exit = maxDistance;
+        for(uint32_t axis = 0; axis < 3; ++axis) {
+            if(direction[axis] == 0.0f) {
+                if(origin[axis] < minValues[axis] || origin[axis] > maxValues[axis]) {
+                    return -1.0f;
+                }
+
+                continue;
+            }
+
+            float t0 = (minValues[axis] - origin[axis]) * inverseDirection[axis];
+            float t1 = (maxValues[axis] - origin[axis]) * inverseDirection[axis];
+            if(t0 > t1) {
+                std::swap(t0, t1);
+            }
+
+            enter = std::max(enter, t0);
+            exit = std::min(exit, t1);
+            if(enter > exit) {
+                return -1.0f;
+            }
+        }
+
+        return enter;
+    }
+
+    // Moller-Trumbore, for both faces. Returns a negative value if missed.
+    float intersectTriangle(const Ray& ray,
+                            const DirectX::XMFLOAT3& p0,
+                            const DirectX::XMFLOAT3& p1,
+                            const DirectX::XMFLOAT3& p2)
+    {
+        const DirectX::XMVECTOR origin = DirectX::XMLoadFloat3(&ray.mOrigin);
+        const DirectX::XMVECTOR direction = DirectX::XMLoadFloat3(&ray.mDirection);
+        const DirectX::XMVECTOR v0 = DirectX::XMLoadFloat3(&p0);
+        const DirectX::XMVECTOR edge1 = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&p1), v0);
+        const DirectX::XMVECTOR edge2 = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&p2), v0);
+
+        const DirectX::XMVECTOR p = DirectX::XMVector3Cross(direction, edge2);
+        const float determinant = DirectX::XMVectorGetX(DirectX::XMVector3Dot(edge1, p));
+        if(fabsf(determinant) < 1.0e-12f) {
+            return -1.0f;
+        }
+
+        const float inverseDeterminant = 1.0f / determinant;
+        const DirectX::XMVECTOR s = DirectX::XMVectorSubtract(origin, v0);
+        const float u = DirectX::XMVectorGetX(DirectX::XMVector3Dot(s, p)) * inverseDeterminant;
+        if(u < 0.0f || u > 1.0f) {
+            return -1.0f;
+        }
+
+        const DirectX::XMVECTOR q = DirectX::XMVector3Cross(s, edge1);
+        const float v = DirectX::XMVectorGetX(DirectX::XMVector3Dot(direction, q)) * inverseDeterminant;
+        if(v < 0.0f || u + v > 1.0f) {
+            return -1.0f;
+        }
+
+        return DirectX::XMVectorGetX(DirectX::XMVector3Dot(edge2, q)) * inverseDeterminant;
+    }
+
+    DirectX::XMFLOAT3 samplePosition(const HeightMap& heightMap,
+                                     const uint32_t row,
+                                     const uint32_t column)
+    {
+        return DirectX::XMFLOAT3(static_cast<float> (column),
+                                 heightMap.mData[row * heightMap.mDimension + column],
+                                 static_cast<float> (row));
+    }
+
+    void intersectNode(const HeightMap& heightMap,
+                       const HeightMapPyramid& pyramid,
+                       const Ray& ray,
+                       const uint32_t level,
+                       const uint32_t row,
+                       const uint32_t column,
+                       float& nearestDistance)
+    {
+        if(level == 0) {
+            // Same triangles as the ones of GeometryGenerator::generateGrid
+            const DirectX::XMFLOAT3 p00 = samplePosition(heightMap, row, column);
+            const DirectX::XMFLOAT3 p01 = samplePosition(heightMap, row, column + 1);
+            const DirectX::XMFLOAT3 p10 = samplePosition(heightMap, row + 1, column);
+            const DirectX::XMFLOAT3 p11 = samplePosition(heightMap, row + 1, column + 1);
+
+            const float distances[2] =
+            {
+                intersectTriangle(ray, p00, p01, p10),
+                intersectTriangle(ray, p10, p01, p11)
+            };
+
+            for(uint32_t i = 0; i < 2; ++i) {
+                if(distances[i] >= 0.0f && distances[i] < nearestDistance) {
+                    nearestDistance = distances[i];
+                }
+            }
+
+            return;
+        }
+
+        // Visit children front to back, so farther ones
+        // are skipped once a hit is found.
+        const uint32_t childLevel = level - 1;
+        const uint32_t childLevelDimension = pyramid.mLevelDimensions[childLevel];
+        const uint32_t toChildRow = std::min(2 * row + 2, childLevelDimension);
+        const uint32_t toChildColumn = std::min(2 * column + 2, childLevelDimension);
+
+        uint32_t numChildren = 0;
+        float childDistances[4];
+        uint32_t childIndices[4];
+        for(uint32_t childRow = 2 * row; childRow < toChildRow; ++childRow) {
+            for(uint32_t childColumn = 2 * column; childColumn < toChildColumn; ++childColumn) {
+                const HeightRange& child = pyramid.mLevels[childLevel][childRow * childLevelDimension + childColumn];
+                const DirectX::XMFLOAT3 minCorner(static_cast<float> (childColumn << childLevel),
+                                                  child.mMin,
+                                                  static_cast<float> (childRow << childLevel));
+                const DirectX::XMFLOAT3 maxCorner(static_cast<float> (std::min((childColumn + 1) << childLevel, pyramid.mCellDimension)),
+                                                  child.mMax,
+                                                  static_cast<float> (std::min((childRow + 1) << childLevel, pyramid.mCellDimension)));
+                const float enterDistance = intersectBox(ray, minCorner, maxCorner, nearestDistance);
+                if(enterDistance < 0.0f) {
+                    continue;
+                }
+
+                // Insertion sort by distance
+                uint32_t i = numChildren++;
+                for(; i > 0 && childDistances[i - 1] > enterDistance; --i) {
+                    childDistances[i] = childDistances[i - 1];
+                    childIndices[i] = childIndices[i - 1];
+                }
+
+                childDistances[i] = enterDistance;
+                childIndices[i] = childRow * childLevelDimension + childColumn;
+            }
+        }
+
+        for(uint32_t i = 0; i < numChildren; ++i) {
+            if(childDistances[i] > nearestDistance) {
+                break;
+            }
+
+            intersectNode(heightMap,
+                          pyramid,
+                          ray,
+                          childLevel,
+                          childIndices[i] / childLevelDimension,
+                          childIndices[i] % childLevelDimension,
+                          nearestDistance);
+        }
+    }
+}
+
+namespace HeightMapPyramidUtils
+{
+    void build(const HeightMap& heightMap,
+               HeightMapPyramid& pyramid,
+               const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        pyramid.mLevelDimensions.clear();
+        pyramid.mLevels.clear();
+        pyramid.mCellDimension = heightMap.mDimension > 1 ? heightMap.mDimension - 1 : 0;
+        if(pyramid.mCellDimension == 0) {
+            return;
+        }
+
+        // Level 0: range of the 4 corners of every cell.
+        const uint32_t cellDimension = pyramid.mCellDimension;
+        const uint32_t heightMapDimension = heightMap.mDimension;
+        pyramid.mLevelDimensions.push_back(cellDimension);
+        pyramid.mLevels.push_back(std::vector<HeightRange>(cellDimension * cellDimension));
+        {
+            HeightRange* cells = &pyramid.mLevels.back()[0];
+            const float* heights = &heightMap.mData[0];
+            ParallelUtils::parallelFor(0,
+                                       cellDimension,
+                                       numThreads,
+                                       [&](const uint32_t fromRow, const uint32_t toRow) {
+                for(uint32_t row = fromRow; row < toRow; ++row) {
+                    const float* topRow = heights + row * heightMapDimension;
+                    const float* bottomRow = topRow + heightMapDimension;
+                    HeightRange* rowCells = cells + row * cellDimension;
+                    for(uint32_t column = 0; column < cellDimension; ++column) {
+                        const float min0 = std::min(topRow[column], topRow[column + 1]);
+                        const float max0 = std::max(topRow[column], topRow[column + 1]);
+                        const float min1 = std::min(bottomRow[column], bottomRow[column + 1]);
+                        const float max1 = std::max(bottomRow[column], bottomRow[column + 1]);
+                        rowCells[column] = HeightRange(std::min(min0, min1), std::max(max0, max1));
+                    }
+                }
+            });
+        }
+
+        // Next levels: range of 2x2 nodes of the previous one.
+        while(pyramid.mLevelDimensions.back() > 1) {
+            const uint32_t childLevelDimension = pyramid.mLevelDimensions.back();
+            const uint32_t levelDimension = (childLevelDimension + 1) / 2;
+            pyramid.mLevelDimensions.push_back(levelDimension);
+            pyramid.mLevels.push_back(std::vector<HeightRange>(levelDimension * levelDimension));
+
+            const HeightRange* children = &pyramid.mLevels[pyramid.mLevels.size() - 2][0];
+            HeightRange* nodes = &pyramid.mLevels.back()[0];
+            ParallelUtils::parallelFor(0,
+                                       levelDimension,
+                                       numThreads,
+                                       [&](const uint32_t fromRow, const uint32_t toRow) {
+                for(uint32_t row = fromRow; row < toRow; ++row) {
+                    const uint32_t toChildRow = std::min(2 * row + 2, childLevelDimension);
+                    for(uint32_t column = 0; column < levelDimension; ++column) {
+                        const uint32_t toChildColumn = std::min(2 * column + 2, childLevelDimension);
+                        HeightRange range;
+                        for(uint32_t childRow = 2 * row; childRow < toChildRow; ++childRow) {
+                            for(uint32_t childColumn = 2 * column; childColumn < toChildColumn; ++childColumn) {
+                                merge(children[childRow * childLevelDimension + childColumn], range);
+                            }
+                        }
+
+                        nodes[row * levelDimension + column] = range;
+                    }
+                }
+            });
+        }
+    }
+
+    HeightRange computeRange(const HeightMapPyramid& pyramid,
+                             const uint32_t fromRow,
+                             const uint32_t fromColumn,
+                             const uint32_t toRow,
+                             const uint32_t toColumn)
+    {
+        HeightRange range;
+        if(pyramid.mLevels.empty()) {
+            return range;
+        }
+
+        uint32_t fromCellRow;
+        uint32_t toCellRow;
+        uint32_t fromCellColumn;
+        uint32_t toCellColumn;
+        computeCellInterval(pyramid.mCellDimension, fromRow, toRow, fromCellRow, toCellRow);
+        computeCellInterval(pyramid.mCellDimension, fromColumn, toColumn, fromCellColumn, toCellColumn);
+
+        const uint32_t topLevel = static_cast<uint32_t> (pyramid.mLevels.size() - 1);
+        mergeRange(pyramid, topLevel, 0, 0, fromCellRow, fromCellColumn, toCellRow, toCellColumn, range);
+
+        return range;
+    }
+
+    HeightRange computeConservativeRange(const HeightMapPyramid& pyramid,
+                                         const uint32_t fromRow,
+                                         const uint32_t fromColumn,
+                                         const uint32_t toRow,
+                                         const uint32_t toColumn)
+    {
+        HeightRange range;
+        if(pyramid.mLevels.empty()) {
+            return range;
+        }
+
+        uint32_t fromCellRow;
+        uint32_t toCellRow;
+        uint32_t fromCellColumn;
+        uint32_t toCellColumn;
+        computeCellInterval(pyramid.mCellDimension, fromRow, toRow, fromCellRow, toCellRow);
+        computeCellInterval(pyramid.mCellDimension, fromColumn, toColumn, fromCellColumn, toCellColumn);
+
+        // First level where the rectangle spans at most 2 nodes per side.
+        uint32_t level = 0;
+        while(((toCellRow - 1) >> level) - (fromCellRow >> level) > 1 ||
+              ((toCellColumn - 1) >> level) - (fromCellColumn >> level) > 1) {
+            ++level;
+        }
+
+        const uint32_t levelDimension = pyramid.mLevelDimensions[level];
+        const std::vector<HeightRange>& nodes = pyramid.mLevels[level];
+        for(uint32_t row = fromCellRow >> level; row <= (toCellRow - 1) >> level; ++row) {
+            for(uint32_t column = fromCellColumn >> level; column <= (toCellColumn - 1) >> level; ++column) {
+                merge(nodes[row * levelDimension + column], range);
+            }
+        }
+
+        return range;
+    }
+
+    bool intersectRay(const HeightMap& heightMap,
+                      const HeightMapPyramid& pyramid,
+                      const DirectX::XMFLOAT3& origin,
+                      const DirectX::XMFLOAT3& direction,
+                      const float maxDistance,
+                      float& distance)
+    {
+        assert(heightMap.mDimension == pyramid.mCellDimension + 1);
+        if(pyramid.mLevels.empty()) {
+            return false;
+        }
+
+        // Infinite inverses of zero components are never used by intersectBox.
+        Ray ray;
+        ray.mOrigin = origin;
+        ray.mDirection = direction;
+        ray.mInverseDirection = DirectX::XMFLOAT3(direction.x != 0.0f ? 1.0f / direction.x : 0.0f,
+                                                  direction.y != 0.0f ? 1.0f / direction.y : 0.0f,
+                                                  direction.z != 0.0f ? 1.0f / direction.z : 0.0f);
+
+        const HeightRange& root = pyramid.mLevels.back()[0];
+        const float cellDimension = static_cast<float> (pyramid.mCellDimension);
+        const DirectX::XMFLOAT3 minCorner(0.0f, root.mMin, 0.0f);
+        const DirectX::XMFLOAT3 maxCorner(cellDimension, root.mMax, cellDimension);
+        if(intersectBox(ray, minCorner, maxCorner, maxDistance) < 0.0f) {
+            return false;
+        }
+
+        float nearestDistance = maxDistance;
+        const uint32_t topLevel = static_cast<uint32_t> (pyramid.mLevels.size() - 1);
+        intersectNode(heightMap, pyramid, ray, topLevel, 0, 0, nearestDistance);
+        if(nearestDistance >= maxDistance) {
+            return false;
+        }
+
+        distance = nearestDistance;
+        return true;
+    }
+}
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Min/max pyramid (quadtree) of a HeightMap.
+//
+// Level 0 stores the height range of every height map cell (the quad
+// between 2x2 adjacent samples) and every next level the range of 2x2
+// nodes of the previous one, up to a single node for the whole map.
+// It is used to answer height range, patch bounds and ray queries
+// touching a few nodes instead of every sample.
+//
+// Queries are in height map space: x is the column, z is the row and
+// y is the height, so world space rays must be scaled and offset by
+// the terrain cell spacing before they are intersected.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <DirectXMath.h>
+#include <vector>
+
+struct HeightMap;
+
+struct HeightRange
+{
+    HeightRange()
+        : mMin(FLT_MAX)
+        , mMax(-FLT_MAX)
+    {
+
+    }
+
+    HeightRange(const float min,
+                const float max)
+        : mMin(min)
+        , mMax(max)
+    {
+
+    }
+
+    // mMin > mMax if the range is empty.
+    float mMin;
+    float mMax;
+};
+
+struct HeightMapPyramid
+{
+    HeightMapPyramid()
+        : mCellDimension(0)
+    {
+
+    }
+
+    // Cells per side, that is, height map dimension - 1.
+    uint32_t mCellDimension;
+
+    // Nodes per side of every level
+    std::vector<uint32_t> mLevelDimensions;
+
+    // Row major node ranges of every level
+    std::vector<std::vector<HeightRange>> mLevels;
+};
+
+namespace HeightMapPyramidUtils
+{
+    // Levels are built with rows split across numThreads
+    // threads (0 uses all hardware threads).
+    void build(const HeightMap& heightMap,
+               HeightMapPyramid& pyramid,
+               const uint32_t numThreads = 0);
+
+    // Exact height range of the samples in rows [fromRow, toRow] and
+    // columns [fromColumn, toColumn]. It only descends into nodes crossed
+    // by the rectangle border. Rectangles of a single row or column
+    // return the range of the cells around them.
+    HeightRange computeRange(const HeightMapPyramid& pyramid,
+                             const uint32_t fromRow,
+                             const uint32_t fromColumn,
+                             const uint32_t toRow,
+                             const uint32_t toColumn);
+
+    // Conservative height range of the same rectangle, from the at most
+    // 2x2 nodes of the first level that covers it. Meant for patch
+    // culling, where a looser range is cheaper than an exact one.
+    HeightRange computeConservativeRange(const HeightMapPyramid& pyramid,
+                                         const uint32_t fromRow,
+                                         const uint32_t fromColumn,
+                                         const uint32_t toRow,
+                                         const uint32_t toColumn);
+
+    // Intersects a ray with the terrain triangles (every cell is split
+    // in the 2 triangles of GeometryGenerator::generateGrid). Nodes are
+    // visited front to back and skipped if the ray misses their bounds.
+    // Returns true and the distance (in direction units) to the nearest
+    // hit in distance if the ray hits the terrain before maxDistance.
+    bool intersectRay(const HeightMap& heightMap,
+                      const HeightMapPyramid& pyramid,
+                      const DirectX::XMFLOAT3& origin,
+                      const DirectX::XMFLOAT3& direction,
+                      const float maxDistance,
+                      float& distance);
+}
@@ -0,0 +1,292 @@
+#include "HeightMapSampler.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include <HeightMap.h>
+
+namespace
+{
+    // Positions sampled at a time
+    const uint32_t sBlockSize = 4;
+
+    template<typename Sample>
+    DirectX::XMVECTOR gather(const Sample* samples,
+                             const uint32_t* indices)
+    {
+        return DirectX::XMVectorSet(static_cast<float> (samples[indices[0]]),
+                                    static_cast<float> (samples[indices[1]]),
+                                    static_cast<float> (samples[indices[2]]),
+                                    static_cast<float> (samples[indices[3]]));
+    }
+
+    // Catmull-Rom weights of the 4 taps around t (in [0, 1]) and their derivatives
+    void computeCubicWeights(DirectX::FXMVECTOR t,
+                             DirectX::XMVECTOR* weights,
+                             DirectX::XMVECTOR* derivativeWeights)
+    {
+        const DirectX::XMVECTOR t2 = DirectX::XMVectorMultiply(t, t);
+        const DirectX::XMVECTOR t3 = DirectX::XMVectorMultiply(t2, t);
+        const DirectX::XMVECTOR half = DirectX::XMVectorReplicate(0.5f);
+
+        // w0 = (-t + 2t^2 - t^3) / 2
+        // w1 = (2 - 5t^2 + 3t^3) / 2
+        // w2 = (t + 4t^2 - 3t^3) / 2
+        // w3 = (-t^2 + t^3) / 2
+        weights[0] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(DirectX::XMVectorSubtract(DirectX::XMVectorScale(t2, 2.0f), t), t3));
+        weights[1] = DirectX::XMVectorMultiply(half, DirectX::XMVectorAdd(DirectX::XMVectorSubtract(DirectX::XMVectorReplicate(2.0f), DirectX::XMVectorScale(t2, 5.0f)), DirectX::XMVectorScale(t3, 3.0f)));
+        weights[2] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(DirectX::XMVectorAdd(t, DirectX::XMVectorScale(t2, 4.0f)), DirectX::XMVectorScale(t3, 3.0f)));
+        weights[3] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(t3, t2));
+
+        // Derivatives with respect to t
+        derivativeWeights[0] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(DirectX::XMVectorSubtract(DirectX::XMVectorScale(t, 4.0f), DirectX::XMVectorSplatOne()), DirectX::XMVectorScale(t2, 3.0f)));
+        derivativeWeights[1] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(DirectX::XMVectorScale(t2, 9.0f), DirectX::XMVectorScale(t, 10.0f)));
+        derivativeWeights[2] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(DirectX::XMVectorAdd(DirectX::XMVectorSplatOne(), DirectX::XMVectorScale(t, 8.0f)), DirectX::XMVectorScale(t2, 9.0f)));
+        derivativeWeights[3] = DirectX::XMVectorMultiply(half, DirectX::XMVectorSubtract(DirectX::XMVectorScale(t2, 3.0f), DirectX::XMVectorScale(t, 2.0f)));
+    }
+
+    // Samples a block of positions. heightDu and heightDv are the height
+    // derivatives with respect to the column and row coordinates.
+    // All of them are in sample units.
+    template<typename Sample>
+    void sampleBlock(const Sample* heights,
+                     const uint32_t dimension,
+                     const HeightMapMapping& mapping,
+                     const HeightFilter filter,
+                     DirectX::FXMVECTOR x,
+                     DirectX::FXMVECTOR z,
+                     DirectX::XMVECTOR& height,
+                     DirectX::XMVECTOR& heightDu,
+                     DirectX::XMVECTOR& heightDv)
+    {
+        // Texel coordinates clamped to the height map
+        const DirectX::XMVECTOR maxCoordinate = DirectX::XMVectorReplicate(static_cast<float> (dimension - 1));
+        const DirectX::XMVECTOR u = DirectX::XMVectorClamp(DirectX::XMVectorScale(DirectX::XMVectorSubtract(x, DirectX::XMVectorReplicate(mapping.mOriginX)),
+                                                                                  1.0f / mapping.mTexelSizeX),
+                                                           DirectX::XMVectorZero(),
+                                                           maxCoordinate);
+        const DirectX::XMVECTOR v = DirectX::XMVectorClamp(DirectX::XMVectorScale(DirectX::XMVectorSubtract(z, DirectX::XMVectorReplicate(mapping.mOriginZ)),
+                                                                                  1.0f / mapping.mTexelSizeZ),
+                                                           DirectX::XMVectorZero(),
+                                                           maxCoordinate);
+
+        // Cell of every position. The last row and column
+        // belong to the cells before them.
+        const DirectX::XMVECTOR maxCell = DirectX::XMVectorReplicate(static_cast<float> (dimension - 2));
+        const DirectX::XMVECTOR cellU = DirectX::XMVectorMin(DirectX::XMVectorFloor(u), maxCell);
+        const DirectX::XMVECTOR cellV = DirectX::XMVectorMin(DirectX::XMVectorFloor(v), maxCell);
+        const DirectX::XMVECTOR fractionU = DirectX::XMVectorSubtract(u, cellU);
+        const DirectX::XMVECTOR fractionV = DirectX::XMVectorSubtract(v, cellV);
+
+        DirectX::XMFLOAT4 cellColumns;
+        DirectX::XMFLOAT4 cellRows;
+        DirectX::XMStoreFloat4(&cellColumns, cellU);
+        DirectX::XMStoreFloat4(&cellRows, cellV);
+        const int32_t columns[sBlockSize] =
+        {
+            static_cast<int32_t> (cellColumns.x),
+            static_cast<int32_t> (cellColumns.y),
+            static_cast<int32_t> (cellColumns.z),
+            static_cast<int32_t> (cellColumns.w)
+        };
+        const int32_t rows[sBlockSize] =
+        {
+            static_cast<int32_t> (cellRows.x),
+            static_cast<int32_t> (cellRows.y),
+            static_cast<int32_t> (cellRows.z),
+            static_cast<int32_t> (cellRows.w)
+        };
+
+        if(filter == HeightFilter::BILINEAR) {
+            uint32_t indices00[sBlockSize];
+            uint32_t indices01[sBlockSize];
+            uint32_t indices10[sBlockSize];
+            uint32_t indices11[sBlockSize];
+            for(uint32_t i = 0; i < sBlockSize; ++i) {
+                indices00[i] = rows[i] * dimension + columns[i];
+                indices01[i] = indices00[i] + 1;
+                indices10[i] = indices00[i] + dimension;
+                indices11[i] = indices10[i] + 1;
+            }
+
+            const DirectX::XMVECTOR h00 = gather(heights, indices00);
+            const DirectX::XMVECTOR h01 = gather(heights, indices01);
+            const DirectX::XMVECTOR h10 = gather(heights, indices10);
+            const DirectX::XMVECTOR h11 = gather(heights, indices11);
+
+            const DirectX::XMVECTOR top = DirectX::XMVectorLerpV(h00, h01, fractionU);
+            const DirectX::XMVECTOR bottom = DirectX::XMVectorLerpV(h10, h11, fractionU);
+            height = DirectX::XMVectorLerpV(top, bottom, fractionV);
+            heightDu = DirectX::XMVectorLerpV(DirectX::XMVectorSubtract(h01, h00), DirectX::XMVectorSubtract(h11, h10), fractionV);
+            heightDv = DirectX::XMVectorSubtract(bottom, top);
+            return;
+        }
+
+        // Bicubic: 4x4 taps around the cell, clamped to the height map.
+        DirectX::XMVECTOR weightsU[4];
+        DirectX::XMVECTOR derivativeWeightsU[4];
+        DirectX::XMVECTOR weightsV[4];
+        DirectX::XMVECTOR derivativeWeightsV[4];
+        computeCubicWeights(fractionU, weightsU, derivativeWeightsU);
+        computeCubicWeights(fractionV, weightsV, derivativeWeightsV);
+
+        const int32_t lastIndex = static_cast<int32_t> (dimension - 1);
+        height = DirectX::XMVectorZero();
+        heightDu = DirectX::XMVectorZero();
+        heightDv = DirectX::XMVectorZero();
+        for(int32_t tapRow = 0; tapRow < 4; ++tapRow) {
+            DirectX::XMVECTOR rowHeight = DirectX::XMVectorZero();
+            DirectX::XMVECTOR rowHeightDu = DirectX::XMVectorZero();
+            for(int32_t tapColumn = 0; tapColumn < 4; ++tapColumn) {
+                uint32_t indices[sBlockSize];
+                for(uint32_t i = 0; i < sBlockSize; ++i) {
+                    const int32_t row = std::min(std::max(rows[i] + tapRow - 1, 0), lastIndex);
+                    const int32_t column = std::min(std::max(columns[i] + tapColumn - 1, 0), lastIndex);
+                    indices[i] = row * dimension + column;
+                }
+
+                const DirectX::XMVECTOR tap = gather(heights, indices);
+                rowHeight = DirectX::XMVectorMultiplyAdd(weightsU[tapColumn], tap, rowHeight);
+                rowHeightDu = DirectX::XMVectorMultiplyAdd(derivativeWeightsU[tapColumn], tap, rowHeightDu);
+            }
+
+            height = DirectX::XMVectorMultiplyAdd(weightsV[tapRow], rowHeight, height);
+            heightDu = DirectX::XMVectorMultiplyAdd(weightsV[tapRow], rowHeightDu, heightDu);
+            heightDv = DirectX::XMVectorMultiplyAdd(derivativeWeightsV[tapRow], rowHeight, heightDv);
+        }
+    }
+
+    // heights = offset + scale * samples
+    template<typename Sample>
+    void sampleSurface(const Sample* samples,
+                       const uint32_t dimension,
+                       const float scale,
+                       const float offset,
+                       const HeightMapMapping& mapping,
+                       const HeightFilter filter,
+                       const float* x,
+                       const float* z,
+                       const uint32_t count,
+                       float* heights,
+                       DirectX::XMFLOAT3* normals)
+    {
+        assert(dimension > 0);
+
+        // A single texel is a flat height map.
+        if(dimension == 1) {
+            std::fill(heights, heights + count, offset + scale * samples[0]);
+            if(normals != nullptr) {
+                std::fill(normals, normals + count, DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+            }
+
+            return;
+        }
+
+        // Texel derivatives in sample units to world derivatives
+        const float inverseTexelSizeX = scale / mapping.mTexelSizeX;
+        const float inverseTexelSizeZ = scale / mapping.mTexelSizeZ;
+        const DirectX::XMVECTOR scaleVector = DirectX::XMVectorReplicate(scale);
+        const DirectX::XMVECTOR offsetVector = DirectX::XMVectorReplicate(offset);
+
+        for(uint32_t blockBegin = 0; blockBegin < count; blockBegin += sBlockSize) {
+            // The last block repeats its last position.
+            const uint32_t blockSize = std::min(sBlockSize, count - blockBegin);
+            DirectX::XMFLOAT4 blockX;
+            DirectX::XMFLOAT4 blockZ;
+            float* blockXValues = &blockX.x;
+            float* blockZValues = &blockZ.x;
+            for(uint32_t i = 0; i < sBlockSize; ++i) {
+                const uint32_t index = blockBegin + std::min(i, blockSize - 1);
+                blockXValues[i] = x[index];
+                blockZValues[i] = z[index];
+            }
+
+            DirectX::XMVECTOR height;
+            DirectX::XMVECTOR heightDu;
+            DirectX::XMVECTOR heightDv;
+            sampleBlock(samples,
+                        dimension,
+                        mapping,
+                        filter,
+                        DirectX::XMLoadFloat4(&blockX),
+                        DirectX::XMLoadFloat4(&blockZ),
+                        height,
+                        heightDu,
+                        heightDv);
+
+            DirectX::XMFLOAT4 blockHeights;
+            DirectX::XMStoreFloat4(&blockHeights, DirectX::XMVectorMultiplyAdd(height, scaleVector, offsetVector));
+            std::copy(&blockHeights.x, &blockHeights.x + blockSize, heights + blockBegin);
+
+            if(normals != nullptr) {
+                // n = normalize(-dh/dx, 1, -dh/dz)
+                const DirectX::XMVECTOR normalX = DirectX::XMVectorScale(heightDu, -inverseTexelSizeX);
+                const DirectX::XMVECTOR normalZ = DirectX::XMVectorScale(heightDv, -inverseTexelSizeZ);
+                const DirectX::XMVECTOR lengthSquared = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMVectorMultiply(normalX, normalX),
+                                                                                                  DirectX::XMVectorMultiply(normalZ, normalZ)),
+                                                                             DirectX::XMVectorSplatOne());
+                const DirectX::XMVECTOR inverseLength = DirectX::XMVectorReciprocalSqrt(lengthSquared);
+
+                DirectX::XMFLOAT4 blockNormalX;
+                DirectX::XMFLOAT4 blockNormalY;
+                DirectX::XMFLOAT4 blockNormalZ;
+                DirectX::XMStoreFloat4(&blockNormalX, DirectX::XMVectorMultiply(normalX, inverseLength));
+                DirectX::XMStoreFloat4(&blockNormalY, inverseLength);
+                DirectX::XMStoreFloat4(&blockNormalZ, DirectX::XMVectorMultiply(normalZ, inverseLength));
+                for(uint32_t i = 0; i < blockSize; ++i) {
+                    normals[blockBegin + i] = DirectX::XMFLOAT3((&blockNormalX.x)[i],
+                                                                (&blockNormalY.x)[i],
+                                                                (&blockNormalZ.x)[i]);
+                }
+            }
+        }
+    }
+
+}
+
+namespace HeightMapSamplerUtils
+{
+    HeightMapMapping computeGridMapping(const float width,
+                                        const float depth,
+                                        const uint32_t heightMapDimension)
+    {
+        // generateGrid places vertex (row, column) at
+        // x = -width / 2 + column * width / dimension
+        // z = depth / 2 - row * depth / dimension
+        HeightMapMapping mapping;
+        mapping.mOriginX = -0.5f * width;
+        mapping.mOriginZ = 0.5f * depth;
+        mapping.mTexelSizeX = width / heightMapDimension;
+        mapping.mTexelSizeZ = -depth / heightMapDimension;
+
+        return mapping;
+    }
+
+    void sampleHeights(const HeightMap& heightMap,
+                       const HeightMapMapping& mapping,
+                       const HeightFilter filter,
+                       const float* x,
+                       const float* z,
+                       const uint32_t count,
+                       float* heights,
+                       DirectX::XMFLOAT3* normals)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        sampleSurface(&heightMap.mData[0], heightMap.mDimension, 1.0f, 0.0f, mapping, filter, x, z, count, heights, normals);
+    }
+
+    void sampleHeights(const QuantizedHeightMap& heightMap,
+                       const HeightMapMapping& mapping,
+                       const HeightFilter filter,
+                       const float* x,
+                       const float* z,
+                       const uint32_t count,
+                       float* heights,
+                       DirectX::XMFLOAT3* normals)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        sampleSurface(&heightMap.mData[0], heightMap.mDimension, heightMap.mScale, heightMap.mOffset, mapping, filter, x, z, count, heights, normals);
+    }
+}
@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Batched height map sampling.
+//
+// Heights (and optionally normals) are sampled at arrays of world xz
+// positions, 4 positions at a time, with bilinear or bicubic
+// (Catmull-Rom) filtering. Positions out of the height map are
+// clamped to its border.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+
+struct HeightMap;
+struct QuantizedHeightMap;
+
+// Maps world xz positions to height map texels:
+// column = (x - mOriginX) / mTexelSizeX
+// row = (z - mOriginZ) / mTexelSizeZ
+struct HeightMapMapping
+{
+    HeightMapMapping()
+        : mOriginX(0.0f)
+        , mOriginZ(0.0f)
+        , mTexelSizeX(1.0f)
+        , mTexelSizeZ(1.0f)
+    {
+
+    }
+
+    // World position of texel (0, 0)
+    float mOriginX;
+    float mOriginZ;
+
+    // World distance between adjacent columns and rows.
+    // Negative if world coordinates decrease along them.
+    float mTexelSizeX;
+    float mTexelSizeZ;
+};
+
+enum struct HeightFilter
+{
+    BILINEAR,
+    BICUBIC
+};
+
+namespace HeightMapSamplerUtils
+{
+    // Mapping where height map texel (row, column) is the vertex (row, column)
+    // of GeometryGenerator::generateGrid(width, depth, dimension - 1, dimension - 1).
+    HeightMapMapping computeGridMapping(const float width,
+                                        const float depth,
+                                        const uint32_t heightMapDimension);
+
+    // Samples count heights at positions (x[i], z[i]). If normals is not
+    // nullptr, it also stores the world space normals of the filtered surface.
+    void sampleHeights(const HeightMap& heightMap,
+                       const HeightMapMapping& mapping,
+                       const HeightFilter filter,
+                       const float* x,
+                       const float* z,
+                       const uint32_t count,
+                       float* heights,
+                       DirectX::XMFLOAT3* normals = nullptr);
+
+    // Quantized samples are interpolated and then scaled, so results
+    // match the dequantized height map.
+    void sampleHeights(const QuantizedHeightMap& heightMap,
+                       const HeightMapMapping& mapping,
+                       const HeightFilter filter,
+                       const float* x,
+                       const float* z,
+                       const uint32_t count,
+                       float* heights,
+                       DirectX::XMFLOAT3* normals = nullptr);
+}
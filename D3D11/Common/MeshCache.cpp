@@ -0,0 +1,406 @@
+#include "MeshCache.h"
+
+#include <cassert>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <windows.h>
+
+#include <MeshOptimizer.h>
+
+namespace
+{
+    // "MESH"
+    const uint32_t sMagic = 0x4853454D;
+
+    // Increment it every time the file layout changes.
+    const uint32_t sVersion = 2;
+
+    struct FileHeader
+    {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        uint64_t mKey;
+
+        uint32_t mVertexStride;
+        uint32_t mVertexCount;
+        uint32_t mIndexCount;
+
+        // In bytes, from the beginning of the file
+        uint32_t mVertexOffset;
+        uint32_t mIndexOffset;
+
+        DirectX::XMFLOAT3 mMinPosition;
+        DirectX::XMFLOAT3 mMaxPosition;
+
+        uint32_t mReserved;
+    };
+
+    static_assert(sizeof(FileHeader) % 16 == 0, "Vertex stream must start 16 bytes aligned");
+
+    // Vertex layouts start with the position.
+    void computeBounds(const void* vertices,
+                       const uint32_t vertexStride,
+                       const uint32_t vertexCount,
+                       DirectX::XMFLOAT3& minPosition,
+                       DirectX::XMFLOAT3& maxPosition)
+    {
+        const uint8_t* vertexBytes = static_cast<const uint8_t*> (vertices);
+        DirectX::XMVECTOR minVector = DirectX::XMVectorReplicate(FLT_MAX);
+        DirectX::XMVECTOR maxVector = DirectX::XMVectorReplicate(-FLT_MAX);
+        for(uint32_t i = 0; i < vertexCount; ++i) {
+            const DirectX::XMFLOAT3* vertexPosition = reinterpret_cast<const DirectX::XMFLOAT3*> (vertexBytes + i * vertexStride);
+            const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(vertexPosition);
+            minVector = DirectX::XMVectorMin(minVector, position);
+            maxVector = DirectX::XMVectorMax(maxVector, position);
+        }
+
+        if(vertexCount == 0) {
+            minVector = DirectX::XMVectorZero();
+            maxVector = DirectX::XMVectorZero();
+        }
+
+        DirectX::XMStoreFloat3(&minPosition, minVector);
+        DirectX::XMStoreFloat3(&maxPosition, maxVector);
+    }
+
+    // Makes mappedMeshData point to its own mMeshData.
+    void useOwnMeshData(MappedMeshData& mappedMeshData)
+    {
+        CachedMeshData& meshData = mappedMeshData.mMeshData;
+        mappedMeshData.mVertexStride = meshData.mVertexStride;
+        mappedMeshData.mVertexCount = meshData.mVertexStride > 0 ?
+            static_cast<uint32_t> (meshData.mVertices.size() / meshData.mVertexStride) :
+            0;
+        mappedMeshData.mIndexCount = static_cast<uint32_t> (meshData.mIndices.size());
+        mappedMeshData.mVertices = meshData.mVertices.empty() ? nullptr : &meshData.mVertices[0];
+        mappedMeshData.mIndices = meshData.mIndices.empty() ? nullptr : &meshData.mIndices[0];
+        computeBounds(mappedMeshData.mVertices,
+                      mappedMeshData.mVertexStride,
+                      mappedMeshData.mVertexCount,
+                      mappedMeshData.mMinPosition,
+                      mappedMeshData.mMaxPosition);
+    }
+
+    // 64 bits FNV-1a
+    void hashBytes(const void* data,
+                   const size_t size,
+                   uint64_t& hash)
+    {
+        const uint64_t prime = 1099511628211ULL;
+        const uint8_t* bytes = static_cast<const uint8_t*> (data);
+        for(size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * prime;
+        }
+    }
+
+    // Strings are followed by a byte no string has, so consecutive
+    // strings and parameters hash differently when they are split differently.
+    void hashString(const std::string& string,
+                    uint64_t& hash)
+    {
+        const uint8_t separator = 0xFF;
+        hashBytes(string.data(), string.size(), hash);
+        hashBytes(&separator, sizeof(separator), hash);
+    }
+
+    // Parameters are preceded by their count.
+    void hashParameters(const std::vector<float>& parameters,
+                        uint64_t& hash)
+    {
+        const uint32_t count = static_cast<uint32_t> (parameters.size());
+        hashBytes(&count, sizeof(count), hash);
+        if(count > 0) {
+            hashBytes(&parameters[0], count * sizeof(float), hash);
+        }
+    }
+
+    double currentTime()
+    {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        return static_cast<double> (counter.QuadPart) / frequency.QuadPart;
+    }
+}
+
+MappedMeshData::MappedMeshData()
+    : mVertices(nullptr)
+    , mIndices(nullptr)
+    , mVertexStride(0)
+    , mVertexCount(0)
+    , mIndexCount(0)
+    , mMinPosition(0.0f, 0.0f, 0.0f)
+    , mMaxPosition(0.0f, 0.0f, 0.0f)
+    , mFile(INVALID_HANDLE_VALUE)
+    , mFileMapping(nullptr)
+    , mView(nullptr)
+{
+
+}
+
+MappedMeshData::~MappedMeshData()
+{
+    MeshCacheUtils::unmapFile(*this);
+}
+
+namespace MeshCacheUtils
+{
+    uint64_t computeKey(const std::string& generatorName,
+                        const std::vector<float>& parameters,
+                        const CachedVertexLayout& vertexLayout)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        hashString(generatorName, hash);
+
+        // Meshes generated by other versions of the code are not used.
+        const uint32_t versions[] = { GeometryGenerator::sVersion, MeshOptimizer::sVersion };
+        hashBytes(versions, sizeof(versions), hash);
+        hashParameters(parameters, hash);
+
+        // Nor meshes cached in other vertex layouts or projected differently.
+        hashString(vertexLayout.mName, hash);
+        hashBytes(&vertexLayout.mVertexStride, sizeof(vertexLayout.mVertexStride), hash);
+        hashParameters(vertexLayout.mParameters, hash);
+
+        return hash;
+    }
+
+    CachedVertexLayout computeVertexDataLayout()
+    {
+        return CachedVertexLayout("VertexData", sizeof(VertexData));
+    }
+
+    std::string computeFilePath(const std::string& cacheDirectory,
+                                const std::string& generatorName,
+                                const uint64_t key)
+    {
+        char keyString[17];
+        sprintf_s(keyString, "%016llx", static_cast<unsigned long long> (key));
+
+        return cacheDirectory + "/" + generatorName + "_" + keyString + ".mesh";
+    }
+
+    void fromMeshData(const MeshData& meshData,
+                      CachedMeshData& cachedMeshData)
+    {
+        const size_t vertexBytes = meshData.mVertices.size() * sizeof(VertexData);
+        cachedMeshData.mVertexStride = sizeof(VertexData);
+        cachedMeshData.mVertices.resize(vertexBytes);
+        if(vertexBytes > 0) {
+            memcpy(&cachedMeshData.mVertices[0], &meshData.mVertices[0], vertexBytes);
+        }
+
+        cachedMeshData.mIndices = meshData.mIndices;
+    }
+
+    bool writeFile(const std::string& filePath,
+                   const uint64_t key,
+                   const CachedMeshData& cachedMeshData)
+    {
+        assert(cachedMeshData.mVertexStride >= sizeof(DirectX::XMFLOAT3));
+        assert(cachedMeshData.mVertices.size() % cachedMeshData.mVertexStride == 0);
+
+        FileHeader header;
+        header.mMagic = sMagic;
+        header.mVersion = sVersion;
+        header.mKey = key;
+        header.mVertexStride = cachedMeshData.mVertexStride;
+        header.mVertexCount = static_cast<uint32_t> (cachedMeshData.mVertices.size() / cachedMeshData.mVertexStride);
+        header.mIndexCount = static_cast<uint32_t> (cachedMeshData.mIndices.size());
+        header.mVertexOffset = sizeof(FileHeader);
+        header.mIndexOffset = header.mVertexOffset + static_cast<uint32_t> (cachedMeshData.mVertices.size());
+        header.mReserved = 0;
+        computeBounds(cachedMeshData.mVertices.empty() ? nullptr : &cachedMeshData.mVertices[0],
+                      header.mVertexStride,
+                      header.mVertexCount,
+                      header.mMinPosition,
+                      header.mMaxPosition);
+
+        // Write to a temporary file and rename it, so other runs never
+        // see a partially written cache file.
+        const std::string temporaryFilePath = filePath + ".tmp";
+        {
+            std::ofstream file(temporaryFilePath.c_str(), std::ios::binary | std::ios::trunc);
+            if(!file) {
+                return false;
+            }
+
+            file.write(reinterpret_cast<const char*> (&header), sizeof(header));
+            if(header.mVertexCount > 0) {
+                file.write(reinterpret_cast<const char*> (&cachedMeshData.mVertices[0]), cachedMeshData.mVertices.size());
+            }
+
+            if(header.mIndexCount > 0) {
+                file.write(reinterpret_cast<const char*> (&cachedMeshData.mIndices[0]), header.mIndexCount * sizeof(uint32_t));
+            }
+
+            if(!file) {
+                return false;
+            }
+        }
+
+        if(!MoveFileExA(temporaryFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileA(temporaryFilePath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool mapFile(const std::string& filePath,
+                 const uint64_t key,
+                 const uint32_t vertexStride,
+                 MappedMeshData& mappedMeshData)
+    {
+        unmapFile(mappedMeshData);
+
+        HANDLE file = CreateFileA(filePath.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  nullptr);
+        if(file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG> (sizeof(FileHeader))) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(fileMapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+
+        const void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+        if(view == nullptr) {
+            CloseHandle(fileMapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        mappedMeshData.mFile = file;
+        mappedMeshData.mFileMapping = fileMapping;
+        mappedMeshData.mView = view;
+
+        // Sizes are computed in 64 bits, so counts of malformed files can not overflow them.
+        const FileHeader& header = *static_cast<const FileHeader*> (view);
+        const uint64_t expectedIndexOffset = static_cast<uint64_t> (header.mVertexOffset) + static_cast<uint64_t> (header.mVertexCount) * vertexStride;
+        const uint64_t expectedSize = static_cast<uint64_t> (header.mIndexOffset) + static_cast<uint64_t> (header.mIndexCount) * sizeof(uint32_t);
+        const bool validHeader = header.mMagic == sMagic &&
+                                 header.mVersion == sVersion &&
+                                 header.mKey == key &&
+                                 header.mVertexStride == vertexStride &&
+                                 header.mVertexOffset == sizeof(FileHeader) &&
+                                 header.mIndexOffset == expectedIndexOffset &&
+                                 expectedSize == static_cast<uint64_t> (fileSize.QuadPart);
+        if(!validHeader) {
+            unmapFile(mappedMeshData);
+            return false;
+        }
+
+        const uint8_t* bytes = static_cast<const uint8_t*> (view);
+        mappedMeshData.mVertices = bytes + header.mVertexOffset;
+        mappedMeshData.mIndices = reinterpret_cast<const uint32_t*> (bytes + header.mIndexOffset);
+        mappedMeshData.mVertexStride = header.mVertexStride;
+        mappedMeshData.mVertexCount = header.mVertexCount;
+        mappedMeshData.mIndexCount = header.mIndexCount;
+        mappedMeshData.mMinPosition = header.mMinPosition;
+        mappedMeshData.mMaxPosition = header.mMaxPosition;
+
+        return true;
+    }
+
+    void unmapFile(MappedMeshData& mappedMeshData)
+    {
+        if(mappedMeshData.mView != nullptr) {
+            UnmapViewOfFile(mappedMeshData.mView);
+            mappedMeshData.mView = nullptr;
+
+            mappedMeshData.mVertices = nullptr;
+            mappedMeshData.mIndices = nullptr;
+            mappedMeshData.mVertexStride = 0;
+            mappedMeshData.mVertexCount = 0;
+            mappedMeshData.mIndexCount = 0;
+        }
+
+        if(mappedMeshData.mFileMapping != nullptr) {
+            CloseHandle(mappedMeshData.mFileMapping);
+            mappedMeshData.mFileMapping = nullptr;
+        }
+
+        if(mappedMeshData.mFile != INVALID_HANDLE_VALUE) {
+            CloseHandle(mappedMeshData.mFile);
+            mappedMeshData.mFile = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    std::string computeDefaultDirectory()
+    {
+        char modulePath[MAX_PATH];
+        const DWORD length = GetModuleFileNameA(nullptr, modulePath, MAX_PATH);
+        if(length == 0 || length == MAX_PATH) {
+            return "MeshCache";
+        }
+
+        const std::string executablePath(modulePath, length);
+        const size_t separator = executablePath.find_last_of("\\/");
+        if(separator == std::string::npos) {
+            return "MeshCache";
+        }
+
+        return executablePath.substr(0, separator + 1) + "MeshCache";
+    }
+
+    void mapOrGenerate(const std::string& cacheDirectory,
+                       const std::string& generatorName,
+                       const std::vector<float>& parameters,
+                       const CachedVertexLayout& vertexLayout,
+                       const std::function<bool(CachedMeshData&)>& generator,
+                       MappedMeshData& mappedMeshData,
+                       MeshCacheStatistics* statistics)
+    {
+        const double startTime = currentTime();
+
+        const uint32_t vertexStride = vertexLayout.mVertexStride;
+        const uint64_t key = computeKey(generatorName, parameters, vertexLayout);
+        const std::string filePath = computeFilePath(cacheDirectory, generatorName, key);
+
+        const bool cacheHit = mapFile(filePath, key, vertexStride, mappedMeshData);
+        if(!cacheHit) {
+            CachedMeshData& meshData = mappedMeshData.mMeshData;
+            meshData = CachedMeshData();
+            const bool generated = generator(meshData);
+            assert(!generated || meshData.mVertexStride == vertexStride);
+            if(!generated) {
+                meshData = CachedMeshData();
+                meshData.mVertexStride = vertexStride;
+            }
+
+            // It fails if the directory already exists.
+            CreateDirectoryA(cacheDirectory.c_str(), nullptr);
+
+            if(generated && writeFile(filePath, key, meshData) && mapFile(filePath, key, vertexStride, mappedMeshData)) {
+                // Release the generated mesh, as the mapped one is used.
+                std::vector<uint8_t>().swap(meshData.mVertices);
+                std::vector<uint32_t>().swap(meshData.mIndices);
+            } else {
+                useOwnMeshData(mappedMeshData);
+            }
+        }
+
+        if(statistics != nullptr) {
+            statistics->mCacheHit = cacheHit;
+            statistics->mLoadTime = currentTime() - startTime;
+        }
+    }
+}
@@ -0,0 +1,184 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Binary cache of generated meshes.
+//
+// A mesh is written once to a versioned binary file (header with the
+// cache key and bounds, a vertex stream and an index stream) and
+// memory mapped on later runs. Vertices are stored in the layout of the
+// vertex buffer they fill, so mapped vertices and indices can be used
+// directly to initialize buffers, with no parsing or copying.
+//
+// The cache key is a hash of the generator name, its parameters, the
+// vertex layout and projection of the cached vertices and the versions
+// of GeometryGenerator and MeshOptimizer, so changing any parameter,
+// the vertex layout or the code that generates the mesh creates a new
+// cache file.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <MeshSink.h>
+
+// Generated mesh to cache, with its vertices in the layout of the vertex
+// buffer they fill (mVertexStride bytes per vertex). Vertex layouts must
+// start with the position (3 floats), that is used to compute the bounds.
+struct CachedMeshData
+{
+    CachedMeshData()
+        : mVertexStride(0)
+    {
+
+    }
+
+    std::vector<uint8_t> mVertices;
+    std::vector<uint32_t> mIndices;
+    uint32_t mVertexStride;
+};
+
+// Vertex layout of the cached vertices and how generated vertices are
+// projected to it. mName names both, so it must change when the layout
+// or the projection code change. mParameters are the values the projection
+// uses (like a constant color), so changing them creates a new cache file too.
+struct CachedVertexLayout
+{
+    CachedVertexLayout(const std::string& name,
+                       const uint32_t vertexStride,
+                       const std::vector<float>& parameters = std::vector<float>())
+        : mName(name)
+        , mParameters(parameters)
+        , mVertexStride(vertexStride)
+    {
+
+    }
+
+    std::string mName;
+    std::vector<float> mParameters;
+    uint32_t mVertexStride;
+};
+
+// Mesh data of a mapped cache file. If the file could not be mapped,
+// it points to mMeshData instead, so it can be used the same way.
+struct MappedMeshData
+{
+    MappedMeshData();
+    ~MappedMeshData();
+
+    const void* mVertices;
+    const uint32_t* mIndices;
+    uint32_t mVertexStride;
+    uint32_t mVertexCount;
+    uint32_t mIndexCount;
+
+    // Axis aligned bounds of the vertex positions
+    DirectX::XMFLOAT3 mMinPosition;
+    DirectX::XMFLOAT3 mMaxPosition;
+
+    CachedMeshData mMeshData;
+
+    // Windows handles (HANDLE) and view of the mapped file.
+    void* mFile;
+    void* mFileMapping;
+    const void* mView;
+
+private:
+    MappedMeshData(const MappedMeshData&);
+    const MappedMeshData& operator=(const MappedMeshData&);
+};
+
+// Cold (generated and written) or warm (mapped) load information
+struct MeshCacheStatistics
+{
+    MeshCacheStatistics()
+        : mCacheHit(false)
+        , mLoadTime(0.0)
+    {
+
+    }
+
+    bool mCacheHit;
+
+    // In seconds
+    double mLoadTime;
+};
+
+namespace MeshCacheUtils
+{
+    // Generators that depend on code other than GeometryGenerator and
+    // MeshOptimizer must change their name or parameters when it changes.
+    uint64_t computeKey(const std::string& generatorName,
+                        const std::vector<float>& parameters,
+                        const CachedVertexLayout& vertexLayout);
+
+    // Layout of the vertices of fromMeshData.
+    CachedVertexLayout computeVertexDataLayout();
+
+    // Path of the cache file of generatorName with key in cacheDirectory.
+    std::string computeFilePath(const std::string& cacheDirectory,
+                                const std::string& generatorName,
+                                const uint64_t key);
+
+    // Keeps VertexData as the vertex layout.
+    void fromMeshData(const MeshData& meshData,
+                      CachedMeshData& cachedMeshData);
+
+    // Sizes cachedMeshData for meshSize vertices of the Vertex layout and
+    // their indices, and returns a sink that generates straight into it.
+    template<typename Vertex, typename Projection>
+    MeshSink<Vertex, Projection> makeMeshSink(const MeshSize& meshSize,
+                                              const Projection& projection,
+                                              CachedMeshData& cachedMeshData,
+                                              const uint32_t streamMask = MeshStream::ALL)
+    {
+        cachedMeshData.mVertexStride = sizeof(Vertex);
+        cachedMeshData.mVertices.resize(meshSize.mVertexCount * sizeof(Vertex));
+        cachedMeshData.mIndices.resize(meshSize.mIndexCount);
+
+        Vertex* vertices = reinterpret_cast<Vertex*> (cachedMeshData.mVertices.empty() ? nullptr : &cachedMeshData.mVertices[0]);
+        uint32_t* indices = cachedMeshData.mIndices.empty() ? nullptr : &cachedMeshData.mIndices[0];
+        return GeometryGenerator::makeMeshSink(vertices,
+                                               meshSize.mVertexCount,
+                                               indices,
+                                               meshSize.mIndexCount,
+                                               projection,
+                                               streamMask);
+    }
+
+    bool writeFile(const std::string& filePath,
+                   const uint64_t key,
+                   const CachedMeshData& cachedMeshData);
+
+    // Returns false if the file does not exist, it is not a valid cache file
+    // for the current version, its key is not the expected one or its
+    // vertices are not vertexStride bytes.
+    bool mapFile(const std::string& filePath,
+                 const uint64_t key,
+                 const uint32_t vertexStride,
+                 MappedMeshData& mappedMeshData);
+
+    void unmapFile(MappedMeshData& mappedMeshData);
+
+    // MeshCache directory next to the executable, so the cache does
+    // not depend on the working directory the application is run from.
+    std::string computeDefaultDirectory();
+
+    // Maps the cache file of the generator, its parameters and the vertex layout
+    // from cacheDirectory. If it does not exist, it calls generator, writes the
+    // result and maps it. If the cache can not be written, the generated mesh is
+    // used directly. Generated vertices must be in vertexLayout. If generator
+    // returns false, nothing is written and mappedMeshData is empty.
+    void mapOrGenerate(const std::string& cacheDirectory,
+                       const std::string& generatorName,
+                       const std::vector<float>& parameters,
+                       const CachedVertexLayout& vertexLayout,
+                       const std::function<bool(CachedMeshData&)>& generator,
+                       MappedMeshData& mappedMeshData,
+                       MeshCacheStatistics* statistics = nullptr);
+}
@@ -0,0 +1,549 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <DirectXMath.h>
+#include <vector>
+
+#include <GeometryGenerator.h>
+
+namespace
+{
+    // Cache size the triangle scores are tuned for.
+    // It does not need to match the GPU cache size.
+    const uint32_t sMaxCacheSize = 32;
+
+    const uint32_t sInvalidTriangle = ~0U;
+
+    // Scores a vertex based on its position in the simulated LRU cache
+    // and on the number of triangles that still use it (so vertices
+    // with few remaining triangles are finished first).
+    float computeVertexScore(const int32_t cachePosition,
+                             const uint32_t remainingTriangles)
+    {
+        // No triangle needs this vertex.
+        if(remainingTriangles == 0) {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if(cachePosition >= 0) {
+            if(cachePosition < 3) {
+                // This vertex was used in the last triangle, so it has
+                // a fixed score whichever of the three it is in.
+                score = 0.75f;
+            } else {
+                // Points for being high in the cache.
+                const float scaler = 1.0f / (sMaxCacheSize - 3);
+                score = 1.0f - (cachePosition - 3) * scaler;
+                score = powf(score, 1.5f);
+            }
+        }
+
+        // Bonus points for having a low number of triangles left to use the vertex.
+        score += 2.0f * powf(static_cast<float> (remainingTriangles), -0.5f);
+
+        return score;
+    }
+
+    // Returns the first triangle starting in cursor that was not emitted yet.
+    uint32_t findNextTriangle(const std::vector<char>& emittedTriangles,
+                              uint32_t& cursor)
+    {
+        const uint32_t numTriangles = static_cast<uint32_t> (emittedTriangles.size());
+        for(; cursor < numTriangles; ++cursor) {
+            if(!emittedTriangles[cursor]) {
+                return cursor;
+            }
+        }
+
+        return sInvalidTriangle;
+    }
+
+    // Vertices of any layout (mVertexStride bytes each, starting with
+    // the position) and indices the optimizations work on.
+    struct MeshView
+    {
+        MeshView(void* vertices,
+                 const uint32_t vertexStride,
+                 const uint32_t vertexCount,
+                 uint32_t* indices,
+                 const uint32_t indexCount)
+            : mVertices(static_cast<uint8_t*> (vertices))
+            , mVertexStride(vertexStride)
+            , mVertexCount(vertexCount)
+            , mIndices(indices)
+            , mIndexCount(indexCount)
+        {
+
+        }
+
+        uint8_t* mVertices;
+        uint32_t mVertexStride;
+        uint32_t mVertexCount;
+        uint32_t* mIndices;
+        uint32_t mIndexCount;
+    };
+
+    MeshView makeMeshView(const MeshData& meshData)
+    {
+        // Views of a const MeshData are only read.
+        MeshData& mutableMeshData = const_cast<MeshData&> (meshData);
+        return MeshView(mutableMeshData.mVertices.empty() ? nullptr : &mutableMeshData.mVertices[0],
+                        sizeof(VertexData),
+                        static_cast<uint32_t> (meshData.mVertices.size()),
+                        mutableMeshData.mIndices.empty() ? nullptr : &mutableMeshData.mIndices[0],
+                        static_cast<uint32_t> (meshData.mIndices.size()));
+    }
+
+    DirectX::XMVECTOR loadPosition(const MeshView& meshView,
+                                   const uint32_t index)
+    {
+        const uint8_t* vertex = meshView.mVertices + index * meshView.mVertexStride;
+        return DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*> (vertex));
+    }
+
+    struct TriangleCluster
+    {
+        TriangleCluster()
+            : mArea(0.0f)
+            , mFirstTriangle(0)
+            , mNumTriangles(0)
+            , mSortKey(0.0f)
+        {
+
+        }
+
+        DirectX::XMFLOAT3 mCentroid;
+        DirectX::XMFLOAT3 mNormal;
+        float mArea;
+        uint32_t mFirstTriangle;
+        uint32_t mNumTriangles;
+        float mSortKey;
+    };
+
+    bool compareClusters(const TriangleCluster& lhs, const TriangleCluster& rhs)
+    {
+        return lhs.mSortKey > rhs.mSortKey;
+    }
+
+    VertexCacheStatistics simulateVertexCache(const MeshView& meshView,
+                                              const uint32_t cacheSize,
+                                              const MeshOptimizer::CacheModel cacheModel)
+    {
+        assert(cacheSize > 0);
+
+        VertexCacheStatistics statistics;
+        const size_t numIndices = meshView.mIndexCount;
+        const size_t numTriangles = numIndices / 3;
+        if(numTriangles == 0) {
+            return statistics;
+        }
+
+        const uint32_t numVertices = meshView.mVertexCount;
+        std::vector<char> referencedVertices(numVertices, 0);
+        uint32_t numReferencedVertices = 0;
+
+        uint32_t cacheMisses = 0;
+        if(cacheModel == MeshOptimizer::CacheModel::FIFO) {
+            // A vertex is in the cache if less than cacheSize misses
+            // happened since it was inserted.
+            std::vector<uint32_t> insertionTime(numVertices, 0);
+            for(size_t i = 0; i < numIndices; ++i) {
+                const uint32_t index = meshView.mIndices[i];
+                const bool hit = referencedVertices[index] && (cacheMisses - insertionTime[index]) < cacheSize;
+                if(!hit) {
+                    insertionTime[index] = cacheMisses;
+                    ++cacheMisses;
+                }
+
+                if(!referencedVertices[index]) {
+                    referencedVertices[index] = 1;
+                    ++numReferencedVertices;
+                }
+            }
+        } else {
+            // Most recently used vertex first.
+            std::vector<uint32_t> cache;
+            cache.reserve(cacheSize + 1);
+            for(size_t i = 0; i < numIndices; ++i) {
+                const uint32_t index = meshView.mIndices[i];
+                std::vector<uint32_t>::iterator it = std::find(cache.begin(), cache.end(), index);
+                if(it != cache.end()) {
+                    cache.erase(it);
+                } else {
+                    ++cacheMisses;
+                }
+
+                cache.insert(cache.begin(), index);
+                if(cache.size() > cacheSize) {
+                    cache.pop_back();
+                }
+
+                if(!referencedVertices[index]) {
+                    referencedVertices[index] = 1;
+                    ++numReferencedVertices;
+                }
+            }
+        }
+
+        statistics.mCacheMisses = cacheMisses;
+        statistics.mACMR = static_cast<float> (cacheMisses) / numTriangles;
+        statistics.mATVR = static_cast<float> (cacheMisses) / numReferencedVertices;
+
+        return statistics;
+    }
+
+    void reorderForVertexCache(MeshView& meshView)
+    {
+        const uint32_t numVertices = meshView.mVertexCount;
+        const uint32_t numTriangles = meshView.mIndexCount / 3;
+        if(numTriangles == 0) {
+            return;
+        }
+
+        const uint32_t* indices = meshView.mIndices;
+
+        // Build vertex to triangles adjacency. Triangles of vertex v
+        // are stored in [adjacencyOffsets[v], adjacencyOffsets[v + 1]).
+        // The first remainingTriangles[v] of them were not emitted yet.
+        std::vector<uint32_t> remainingTriangles(numVertices, 0);
+        for(size_t i = 0; i < numTriangles * 3; ++i) {
+            assert(indices[i] < numVertices);
+            ++remainingTriangles[indices[i]];
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            adjacencyOffsets[vertexIndex + 1] = adjacencyOffsets[vertexIndex] + remainingTriangles[vertexIndex];
+        }
+
+        std::vector<uint32_t> adjacency(numTriangles * 3);
+        {
+            std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for(uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex) {
+                for(uint32_t corner = 0; corner < 3; ++corner) {
+                    const uint32_t vertexIndex = indices[triangleIndex * 3 + corner];
+                    adjacency[fillOffsets[vertexIndex]++] = triangleIndex;
+                }
+            }
+        }
+
+        // Initial scores.
+        std::vector<int32_t> cachePositions(numVertices, -1);
+        std::vector<float> vertexScores(numVertices);
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            vertexScores[vertexIndex] = computeVertexScore(-1, remainingTriangles[vertexIndex]);
+        }
+
+        std::vector<float> triangleScores(numTriangles);
+        uint32_t bestTriangle = 0;
+        for(uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex) {
+            triangleScores[triangleIndex] = vertexScores[indices[triangleIndex * 3 + 0]]
+                                          + vertexScores[indices[triangleIndex * 3 + 1]]
+                                          + vertexScores[indices[triangleIndex * 3 + 2]];
+            if(triangleScores[triangleIndex] > triangleScores[bestTriangle]) {
+                bestTriangle = triangleIndex;
+            }
+        }
+
+        std::vector<char> emittedTriangles(numTriangles, 0);
+        std::vector<uint32_t> newIndices;
+        newIndices.reserve(numTriangles * 3);
+
+        // Simulated LRU cache. It has 3 extra slots to hold
+        // the vertices pushed out by the last triangle.
+        uint32_t cache[sMaxCacheSize + 3];
+        uint32_t cacheCount = 0;
+        uint32_t newCache[sMaxCacheSize + 3];
+        uint32_t scanCursor = 0;
+
+        while(bestTriangle != sInvalidTriangle) {
+            emittedTriangles[bestTriangle] = 1;
+
+            const uint32_t* triangle = &indices[bestTriangle * 3];
+            newIndices.push_back(triangle[0]);
+            newIndices.push_back(triangle[1]);
+            newIndices.push_back(triangle[2]);
+
+            // Remove the triangle from the remaining ones of its vertices.
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                const uint32_t vertexIndex = triangle[corner];
+                uint32_t* const begin = &adjacency[adjacencyOffsets[vertexIndex]];
+                uint32_t* const end = begin + remainingTriangles[vertexIndex];
+                uint32_t* const it = std::find(begin, end, bestTriangle);
+                assert(it != end);
+                std::swap(*it, *(end - 1));
+                --remainingTriangles[vertexIndex];
+            }
+
+            // Triangle vertices go to the front of the cache, followed
+            // by the previous entries in the same order.
+            uint32_t newCacheCount = 0;
+            newCache[newCacheCount++] = triangle[0];
+            newCache[newCacheCount++] = triangle[1];
+            newCache[newCacheCount++] = triangle[2];
+            for(uint32_t cacheIndex = 0; cacheIndex < cacheCount; ++cacheIndex) {
+                const uint32_t vertexIndex = cache[cacheIndex];
+                if(vertexIndex != triangle[0] && vertexIndex != triangle[1] && vertexIndex != triangle[2]) {
+                    newCache[newCacheCount++] = vertexIndex;
+                }
+            }
+
+            // Update scores of the vertices in the cache, including the evicted ones.
+            for(uint32_t cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex) {
+                const uint32_t vertexIndex = newCache[cacheIndex];
+                cachePositions[vertexIndex] = cacheIndex < sMaxCacheSize ? static_cast<int32_t> (cacheIndex) : -1;
+                vertexScores[vertexIndex] = computeVertexScore(cachePositions[vertexIndex], remainingTriangles[vertexIndex]);
+            }
+
+            // Update scores of the triangles that use those vertices
+            // and pick the best one as the next triangle.
+            bestTriangle = sInvalidTriangle;
+            float bestScore = -1.0f;
+            for(uint32_t cacheIndex = 0; cacheIndex < newCacheCount; ++cacheIndex) {
+                const uint32_t vertexIndex = newCache[cacheIndex];
+                const uint32_t begin = adjacencyOffsets[vertexIndex];
+                const uint32_t end = begin + remainingTriangles[vertexIndex];
+                for(uint32_t adjacencyIndex = begin; adjacencyIndex < end; ++adjacencyIndex) {
+                    const uint32_t triangleIndex = adjacency[adjacencyIndex];
+                    const float score = vertexScores[indices[triangleIndex * 3 + 0]]
+                                      + vertexScores[indices[triangleIndex * 3 + 1]]
+                                      + vertexScores[indices[triangleIndex * 3 + 2]];
+                    triangleScores[triangleIndex] = score;
+                    if(score > bestScore) {
+                        bestScore = score;
+                        bestTriangle = triangleIndex;
+                    }
+                }
+            }
+
+            cacheCount = std::min(newCacheCount, sMaxCacheSize);
+            std::copy(newCache, newCache + cacheCount, cache);
+
+            // Nothing in the cache has remaining triangles,
+            // so continue with the next one not emitted yet.
+            if(bestTriangle == sInvalidTriangle) {
+                bestTriangle = findNextTriangle(emittedTriangles, scanCursor);
+            }
+        }
+
+        std::copy(newIndices.begin(), newIndices.end(), meshView.mIndices);
+    }
+
+    void reorderForOverdraw(MeshView& meshView,
+                            const float threshold)
+    {
+        const uint32_t numTriangles = meshView.mIndexCount / 3;
+        if(numTriangles == 0) {
+            return;
+        }
+
+        const uint32_t* indices = meshView.mIndices;
+
+        // Split the triangles in clusters. A cluster ends where the
+        // cache optimized order restarts, that is, where a triangle
+        // misses all its 3 vertices in a simulated FIFO cache.
+        // Reordering clusters keeps most of the cache efficiency.
+        const uint32_t cacheSize = 16;
+        const uint32_t numVertices = meshView.mVertexCount;
+        std::vector<uint32_t> insertionTime(numVertices, 0);
+        std::vector<char> seenVertices(numVertices, 0);
+        uint32_t cacheMisses = 0;
+
+        std::vector<TriangleCluster> clusters;
+        for(uint32_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex) {
+            uint32_t triangleMisses = 0;
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                const uint32_t index = indices[triangleIndex * 3 + corner];
+                const bool hit = seenVertices[index] && (cacheMisses - insertionTime[index]) < cacheSize;
+                if(!hit) {
+                    seenVertices[index] = 1;
+                    insertionTime[index] = cacheMisses;
+                    ++cacheMisses;
+                    ++triangleMisses;
+                }
+            }
+
+            if(clusters.empty() || triangleMisses == 3) {
+                clusters.push_back(TriangleCluster());
+                clusters.back().mFirstTriangle = triangleIndex;
+            }
+
+            ++clusters.back().mNumTriangles;
+        }
+
+        if(clusters.size() < 2) {
+            return;
+        }
+
+        // Compute area weighted centroid and normal of each cluster.
+        DirectX::XMVECTOR meshCentroid = DirectX::XMVectorZero();
+        float meshArea = 0.0f;
+        for(size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+            TriangleCluster& cluster = clusters[clusterIndex];
+            DirectX::XMVECTOR centroid = DirectX::XMVectorZero();
+            DirectX::XMVECTOR normal = DirectX::XMVectorZero();
+            float area = 0.0f;
+
+            const uint32_t lastTriangle = cluster.mFirstTriangle + cluster.mNumTriangles;
+            for(uint32_t triangleIndex = cluster.mFirstTriangle; triangleIndex < lastTriangle; ++triangleIndex) {
+                const DirectX::XMVECTOR p0 = loadPosition(meshView, indices[triangleIndex * 3 + 0]);
+                const DirectX::XMVECTOR p1 = loadPosition(meshView, indices[triangleIndex * 3 + 1]);
+                const DirectX::XMVECTOR p2 = loadPosition(meshView, indices[triangleIndex * 3 + 2]);
+
+                // Length of the cross product is twice the triangle area.
+                const DirectX::XMVECTOR crossProduct =
+                    DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p1, p0), DirectX::XMVectorSubtract(p2, p0));
+                const float triangleArea = 0.5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(crossProduct));
+
+                const DirectX::XMVECTOR triangleCentroid =
+                    DirectX::XMVectorScale(DirectX::XMVectorAdd(DirectX::XMVectorAdd(p0, p1), p2), 1.0f / 3.0f);
+                centroid = DirectX::XMVectorAdd(centroid, DirectX::XMVectorScale(triangleCentroid, triangleArea));
+                normal = DirectX::XMVectorAdd(normal, crossProduct);
+                area += triangleArea;
+            }
+
+            meshCentroid = DirectX::XMVectorAdd(meshCentroid, centroid);
+            meshArea += area;
+
+            centroid = area > 0.0f ? DirectX::XMVectorScale(centroid, 1.0f / area) : centroid;
+            DirectX::XMStoreFloat3(&cluster.mCentroid, centroid);
+            DirectX::XMStoreFloat3(&cluster.mNormal, DirectX::XMVector3Normalize(normal));
+            cluster.mArea = area;
+        }
+
+        if(meshArea <= 0.0f) {
+            return;
+        }
+
+        meshCentroid = DirectX::XMVectorScale(meshCentroid, 1.0f / meshArea);
+
+        // Clusters that face away from the mesh center are more likely
+        // to occlude the rest, so they are drawn first.
+        for(size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+            TriangleCluster& cluster = clusters[clusterIndex];
+            const DirectX::XMVECTOR offset =
+                DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&cluster.mCentroid), meshCentroid);
+            cluster.mSortKey = DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&cluster.mNormal)));
+        }
+
+        std::stable_sort(clusters.begin(), clusters.end(), compareClusters);
+
+        std::vector<uint32_t> sortedIndices;
+        sortedIndices.reserve(meshView.mIndexCount);
+        for(size_t clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex) {
+            const TriangleCluster& cluster = clusters[clusterIndex];
+            sortedIndices.insert(sortedIndices.end(),
+                                 indices + cluster.mFirstTriangle * 3,
+                                 indices + (cluster.mFirstTriangle + cluster.mNumTriangles) * 3);
+        }
+
+        const MeshView sortedMeshView(meshView.mVertices, 
+                                      meshView.mVertexStride, 
+                                      meshView.mVertexCount, 
+                                      &sortedIndices[0], 
+                                      static_cast<uint32_t> (sortedIndices.size()));
+        const float currentACMR = simulateVertexCache(meshView, 16, MeshOptimizer::CacheModel::FIFO).mACMR;
+        const float sortedACMR = simulateVertexCache(sortedMeshView, 16, MeshOptimizer::CacheModel::FIFO).mACMR;
+        if(sortedACMR <= threshold * currentACMR) {
+            std::copy(sortedIndices.begin(), sortedIndices.end(), meshView.mIndices);
+        }
+    }
+
+    void reorderForVertexFetch(MeshView& meshView)
+    {
+        const uint32_t numVertices = meshView.mVertexCount;
+        const uint32_t vertexStride = meshView.mVertexStride;
+        const uint32_t unassigned = ~0U;
+        std::vector<uint32_t> remap(numVertices, unassigned);
+
+        std::vector<uint8_t> newVertices(numVertices * vertexStride);
+        uint32_t newVertexCount = 0;
+
+        // New vertex order is the order of first use.
+        for(uint32_t i = 0; i < meshView.mIndexCount; ++i) {
+            uint32_t& index = meshView.mIndices[i];
+            if(remap[index] == unassigned) {
+                remap[index] = newVertexCount;
+                memcpy(&newVertices[newVertexCount * vertexStride], meshView.mVertices + index * vertexStride, vertexStride);
+                ++newVertexCount;
+            }
+
+            index = remap[index];
+        }
+
+        // Keep unreferenced vertices so the vertex count does not change.
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            if(remap[vertexIndex] == unassigned) {
+                memcpy(&newVertices[newVertexCount * vertexStride], meshView.mVertices + vertexIndex * vertexStride, vertexStride);
+                ++newVertexCount;
+            }
+        }
+
+        if(!newVertices.empty()) {
+            memcpy(meshView.mVertices, &newVertices[0], newVertices.size());
+        }
+    }
+}
+
+namespace MeshOptimizer
+{
+    VertexCacheStatistics computeVertexCacheStatistics(const MeshData& meshData,
+                                                       const uint32_t cacheSize,
+                                                       const CacheModel cacheModel)
+    {
+        return simulateVertexCache(makeMeshView(meshData), cacheSize, cacheModel);
+    }
+
+    void optimizeVertexCache(MeshData& meshData)
+    {
+        MeshView meshView = makeMeshView(meshData);
+        reorderForVertexCache(meshView);
+    }
+
+    void optimizeOverdraw(MeshData& meshData,
+                          const float threshold)
+    {
+        MeshView meshView = makeMeshView(meshData);
+        reorderForOverdraw(meshView, threshold);
+    }
+
+    void optimizeVertexFetch(MeshData& meshData)
+    {
+        MeshView meshView = makeMeshView(meshData);
+        reorderForVertexFetch(meshView);
+    }
+
+    void optimize(MeshData& meshData)
+    {
+        optimizeVertexCache(meshData);
+        optimizeOverdraw(meshData);
+        optimizeVertexFetch(meshData);
+    }
+
+    void optimize(MeshData& meshData,
+                  VertexCacheStatistics& statisticsBefore,
+                  VertexCacheStatistics& statisticsAfter)
+    {
+        statisticsBefore = computeVertexCacheStatistics(meshData);
+        optimize(meshData);
+        statisticsAfter = computeVertexCacheStatistics(meshData);
+    }
+
+    void optimize(void* vertices,
+                  const uint32_t vertexStride,
+                  const uint32_t vertexCount,
+                  uint32_t* indices,
+                  const uint32_t indexCount)
+    {
+        assert(vertexStride >= sizeof(DirectX::XMFLOAT3));
+
+        MeshView meshView(vertices, vertexStride, vertexCount, indices, indexCount);
+        reorderForVertexCache(meshView);
+        reorderForOverdraw(meshView, 1.05f);
+        reorderForVertexFetch(meshView);
+    }
+}
@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Reorders triangles and vertices of MeshData (or of any vertex layout)
+// to make better use of the GPU post-transform vertex cache and of
+// vertex fetch.
+//
+// Triangles are reordered using Tom Forsyth's "Linear-Speed Vertex
+// Cache Optimisation". Overdraw is then reduced by sorting clusters
+// of the cache optimized triangles so outward facing ones are drawn
+// first, as long as cache efficiency is not degraded beyond a threshold.
+// Finally vertices are reordered by first use in the index buffer.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+struct MeshData;
+
+// Result of simulating a post-transform vertex cache
+// over a mesh's index buffer.
+struct VertexCacheStatistics
+{
+    VertexCacheStatistics()
+        : mACMR(0.0f)
+        , mATVR(0.0f)
+        , mCacheMisses(0)
+    {
+
+    }
+
+    // Average cache miss ratio: transformed vertices per triangle.
+    // 0.5 is the ideal for large regular meshes and 3.0 is the worst case.
+    float mACMR;
+
+    // Average transformed vertex ratio: transformed vertices per
+    // referenced vertex. 1.0 is the ideal.
+    float mATVR;
+
+    uint32_t mCacheMisses;
+};
+
+namespace MeshOptimizer
+{
+    // Increment it every time the optimized meshes change, so
+    // meshes cached with MeshCacheUtils are generated again.
+    const uint32_t sVersion = 1;
+
+    enum struct CacheModel
+    {
+        // Hits do not modify the order of the cache entries (most GPUs).
+        FIFO,
+
+        // Hits move the entry to the front of the cache.
+        LRU
+    };
+
+    VertexCacheStatistics computeVertexCacheStatistics(const MeshData& meshData,
+                                                       const uint32_t cacheSize = 16,
+                                                       const CacheModel cacheModel = CacheModel::FIFO);
+
+    // Reorders meshData.mIndices for post-transform vertex cache locality.
+    void optimizeVertexCache(MeshData& meshData);
+
+    // Reorders clusters of triangles of a cache optimized index buffer
+    // to reduce overdraw. The new order is discarded if its FIFO ACMR is
+    // greater than threshold times the current one.
+    void optimizeOverdraw(MeshData& meshData,
+                          const float threshold = 1.05f);
+
+    // Reorders meshData.mVertices in the order they are first
+    // referenced by meshData.mIndices and remaps the indices.
+    // Unreferenced vertices are moved to the end.
+    void optimizeVertexFetch(MeshData& meshData);
+
+    // Runs all the previous optimizations in order.
+    void optimize(MeshData& meshData);
+
+    // Same as above, but it also returns the vertex cache statistics
+    // before and after the optimizations.
+    void optimize(MeshData& meshData,
+                  VertexCacheStatistics& statisticsBefore,
+                  VertexCacheStatistics& statisticsAfter);
+
+    // Runs all the optimizations on vertexCount vertices of any layout,
+    // vertexStride bytes each and starting with the position (3 floats),
+    // and their indexCount indices. For example, vertices generated
+    // straight into the vertex buffer layout through a MeshSink.
+    void optimize(void* vertices,
+                  const uint32_t vertexStride,
+                  const uint32_t vertexCount,
+                  uint32_t* indices,
+                  const uint32_t indexCount);
+}
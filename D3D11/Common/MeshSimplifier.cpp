@@ -0,0 +1,717 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <DirectXMath.h>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include <Camera.h>
+
+namespace
+{
+    // Position (3), scaled normal (3) and scaled texture coordinates (2)
+    const uint32_t sNumComponents = 8;
+
+    // Upper triangle of a symmetric sNumComponents x sNumComponents matrix
+    const uint32_t sNumMatrixEntries = sNumComponents * (sNumComponents + 1) / 2;
+
+    // Weight of the planes that keep border vertices on the border,
+    // relative to the weight of the triangle planes.
+    const double sBorderWeight = 10.0;
+
+    struct Quadric
+    {
+        Quadric()
+            : mC(0.0)
+            , mWeight(0.0)
+        {
+            std::fill(mA, mA + sNumMatrixEntries, 0.0);
+            std::fill(mB, mB + sNumComponents, 0.0);
+        }
+
+        // Error of x is x^T * A * x + 2 * b^T * x + c
+        double mA[sNumMatrixEntries];
+        double mB[sNumComponents];
+        double mC;
+
+        // Sum of the areas of the triangles in the quadric,
+        // used to convert the error to an average distance.
+        double mWeight;
+    };
+
+    // Collapse of mFrom vertex into mTo vertex.
+    // It is outdated if any of the vertex versions changed since it was computed.
+    struct Candidate
+    {
+        double mCost;
+        float mError;
+        uint32_t mFrom;
+        uint32_t mTo;
+        uint32_t mFromVersion;
+        uint32_t mToVersion;
+    };
+
+    struct CompareCandidates
+    {
+        bool operator()(const Candidate& lhs, const Candidate& rhs) const
+        {
+            return lhs.mCost > rhs.mCost;
+        }
+    };
+
+    typedef std::priority_queue<Candidate, std::vector<Candidate>, CompareCandidates> CandidateQueue;
+
+    uint32_t matrixEntry(const uint32_t row,
+                         const uint32_t column)
+    {
+        assert(row <= column);
+        return row * sNumComponents - row * (row - 1) / 2 + (column - row);
+    }
+
+    double dot(const double* lhs,
+               const double* rhs,
+               const uint32_t numComponents)
+    {
+        double result = 0.0;
+        for(uint32_t i = 0; i < numComponents; ++i) {
+            result += lhs[i] * rhs[i];
+        }
+
+        return result;
+    }
+
+    void cross(const double* lhs,
+               const double* rhs,
+               double* result)
+    {
+        result[0] = lhs[1] * rhs[2] - lhs[2] * rhs[1];
+        result[1] = lhs[2] * rhs[0] - lhs[0] * rhs[2];
+        result[2] = lhs[0] * rhs[1] - lhs[1] * rhs[0];
+    }
+
+    void computeFaceNormal(const double* p0,
+                           const double* p1,
+                           const double* p2,
+                           double* normal)
+    {
+        const double edge1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        const double edge2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        cross(edge1, edge2, normal);
+    }
+
+    // Returns false if the vector has zero length.
+    bool normalize(double* vector,
+                   const uint32_t numComponents)
+    {
+        const double length = sqrt(dot(vector, vector, numComponents));
+        if(length <= 0.0) {
+            return false;
+        }
+
+        for(uint32_t i = 0; i < numComponents; ++i) {
+            vector[i] /= length;
+        }
+
+        return true;
+    }
+
+    double evaluateQuadric(const Quadric& quadric,
+                           const double* x)
+    {
+        double result = quadric.mC;
+        for(uint32_t row = 0; row < sNumComponents; ++row) {
+            result += quadric.mA[matrixEntry(row, row)] * x[row] * x[row];
+            for(uint32_t column = row + 1; column < sNumComponents; ++column) {
+                result += 2.0 * quadric.mA[matrixEntry(row, column)] * x[row] * x[column];
+            }
+
+            result += 2.0 * quadric.mB[row] * x[row];
+        }
+
+        return result;
+    }
+
+    void addQuadric(const Quadric& source,
+                    Quadric& destination)
+    {
+        for(uint32_t i = 0; i < sNumMatrixEntries; ++i) {
+            destination.mA[i] += source.mA[i];
+        }
+
+        for(uint32_t i = 0; i < sNumComponents; ++i) {
+            destination.mB[i] += source.mB[i];
+        }
+
+        destination.mC += source.mC;
+        destination.mWeight += source.mWeight;
+    }
+
+    // Adds the squared distance to the plane through p, q and r
+    // in the sNumComponents dimensional space (Garland and Heckbert,
+    // "Simplifying Surfaces with Color and Texture using Quadric Error Metrics").
+    void addTriangleQuadric(const double* p,
+                            const double* q,
+                            const double* r,
+                            const double weight,
+                            Quadric& quadric)
+    {
+        double e1[sNumComponents];
+        double e2[sNumComponents];
+        for(uint32_t i = 0; i < sNumComponents; ++i) {
+            e1[i] = q[i] - p[i];
+            e2[i] = r[i] - p[i];
+        }
+
+        if(!normalize(e1, sNumComponents)) {
+            return;
+        }
+
+        const double projection = dot(e1, e2, sNumComponents);
+        for(uint32_t i = 0; i < sNumComponents; ++i) {
+            e2[i] -= projection * e1[i];
+        }
+
+        if(!normalize(e2, sNumComponents)) {
+            return;
+        }
+
+        const double pe1 = dot(p, e1, sNumComponents);
+        const double pe2 = dot(p, e2, sNumComponents);
+        for(uint32_t row = 0; row < sNumComponents; ++row) {
+            for(uint32_t column = row; column < sNumComponents; ++column) {
+                const double identity = row == column ? 1.0 : 0.0;
+                quadric.mA[matrixEntry(row, column)] += weight * (identity - e1[row] * e1[column] - e2[row] * e2[column]);
+            }
+
+            quadric.mB[row] += weight * (pe1 * e1[row] + pe2 * e2[row] - p[row]);
+        }
+
+        quadric.mC += weight * (dot(p, p, sNumComponents) - pe1 * pe1 - pe2 * pe2);
+    }
+
+    // Adds the squared distance to a plane that only depends on positions.
+    void addPlaneQuadric(const double* normal,
+                         const double* point,
+                         const double weight,
+                         Quadric& quadric)
+    {
+        const double distance = dot(normal, point, 3);
+        for(uint32_t row = 0; row < 3; ++row) {
+            for(uint32_t column = row; column < 3; ++column) {
+                quadric.mA[matrixEntry(row, column)] += weight * normal[row] * normal[column];
+            }
+
+            quadric.mB[row] -= weight * distance * normal[row];
+        }
+
+        quadric.mC += weight * distance * distance;
+    }
+
+    // Some generated vertices have undefined attributes (for example, texture
+    // coordinates at geosphere poles). They must not poison the quadrics.
+    double finiteOrZero(const float value)
+    {
+        return std::isfinite(value) ? value : 0.0;
+    }
+
+    uint64_t edgeKey(const uint32_t index0,
+                     const uint32_t index1)
+    {
+        return (static_cast<uint64_t> (std::min(index0, index1)) << 32) | std::max(index0, index1);
+    }
+
+    bool comparePositions(const DirectX::XMFLOAT3& lhs,
+                          const DirectX::XMFLOAT3& rhs)
+    {
+        if(lhs.x != rhs.x) {
+            return lhs.x < rhs.x;
+        }
+
+        if(lhs.y != rhs.y) {
+            return lhs.y < rhs.y;
+        }
+
+        return lhs.z < rhs.z;
+    }
+
+    struct Simplifier
+    {
+        Simplifier(const MeshData& meshData,
+                   const MeshSimplifier::AttributeWeights& attributeWeights);
+
+        // Collapses edges until the triangle count is not greater than
+        // targetTriangleCount or there are no valid collapses left.
+        void run(const uint32_t targetTriangleCount);
+
+        // Builds the current mesh, only with the vertices still referenced.
+        void extract(MeshData& meshData) const;
+
+        void pushCandidates(const uint32_t vertexIndex);
+        void pushCandidate(const uint32_t from,
+                           const uint32_t to);
+        bool isCollapseValid(const uint32_t from,
+                             const uint32_t to) const;
+        void collapse(const uint32_t from,
+                      const uint32_t to);
+        bool containsVertex(const uint32_t triangleIndex,
+                            const uint32_t vertexIndex) const;
+
+        const MeshData& mMeshData;
+
+        // Vertex components used by the quadrics
+        std::vector<double> mVertexComponents;
+        std::vector<Quadric> mQuadrics;
+        std::vector<uint32_t> mVersions;
+        std::vector<char> mLockedVertices;
+        std::vector<char> mBorderVertices;
+
+        std::vector<uint32_t> mIndices;
+        std::vector<char> mRemovedTriangles;
+        std::vector<std::vector<uint32_t>> mVertexTriangles;
+
+        CandidateQueue mCandidates;
+        uint32_t mTriangleCount;
+        float mError;
+    };
+
+    Simplifier::Simplifier(const MeshData& meshData,
+                           const MeshSimplifier::AttributeWeights& attributeWeights)
+        : mMeshData(meshData)
+        , mTriangleCount(0)
+        , mError(0.0f)
+    {
+        const uint32_t numVertices = static_cast<uint32_t> (meshData.mVertices.size());
+
+        // Degenerate triangles are dropped.
+        mIndices.reserve(meshData.mIndices.size());
+        for(size_t i = 0; i + 2 < meshData.mIndices.size(); i += 3) {
+            const uint32_t* triangle = &meshData.mIndices[i];
+            if(triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]) {
+                mIndices.insert(mIndices.end(), triangle, triangle + 3);
+            }
+        }
+
+        mTriangleCount = static_cast<uint32_t> (mIndices.size() / 3);
+        mRemovedTriangles.resize(mTriangleCount, 0);
+        mVertexTriangles.resize(numVertices);
+        for(uint32_t triangleIndex = 0; triangleIndex < mTriangleCount; ++triangleIndex) {
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                mVertexTriangles[mIndices[triangleIndex * 3 + corner]].push_back(triangleIndex);
+            }
+        }
+
+        // Vertices that share their position with other vertices are on
+        // an attribute seam. Moving them would open a crack.
+        mLockedVertices.resize(numVertices, 0);
+        {
+            std::vector<uint32_t> sortedVertices(numVertices);
+            for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+                sortedVertices[vertexIndex] = vertexIndex;
+            }
+
+            std::sort(sortedVertices.begin(), sortedVertices.end(),
+                      [&meshData](const uint32_t lhs, const uint32_t rhs) {
+                          return comparePositions(meshData.mVertices[lhs].mPosition, meshData.mVertices[rhs].mPosition);
+                      });
+
+            for(uint32_t i = 1; i < numVertices; ++i) {
+                const DirectX::XMFLOAT3& previous = meshData.mVertices[sortedVertices[i - 1]].mPosition;
+                const DirectX::XMFLOAT3& current = meshData.mVertices[sortedVertices[i]].mPosition;
+                if(previous.x == current.x && previous.y == current.y && previous.z == current.z) {
+                    mLockedVertices[sortedVertices[i - 1]] = 1;
+                    mLockedVertices[sortedVertices[i]] = 1;
+                }
+            }
+        }
+
+        // Attribute errors are scaled by the mesh extent.
+        DirectX::XMVECTOR minPosition = DirectX::XMVectorReplicate(FLT_MAX);
+        DirectX::XMVECTOR maxPosition = DirectX::XMVectorReplicate(-FLT_MAX);
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&meshData.mVertices[vertexIndex].mPosition);
+            minPosition = DirectX::XMVectorMin(minPosition, position);
+            maxPosition = DirectX::XMVectorMax(maxPosition, position);
+        }
+
+        const float extent = numVertices > 0 ?
+            DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(maxPosition, minPosition))) :
+            0.0f;
+        const double normalScale = attributeWeights.mNormalWeight * extent;
+        const double texCoordScale = attributeWeights.mTexCoordWeight * extent;
+
+        mVertexComponents.resize(numVertices * sNumComponents);
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            const VertexData& vertex = meshData.mVertices[vertexIndex];
+            double* components = &mVertexComponents[vertexIndex * sNumComponents];
+            components[0] = vertex.mPosition.x;
+            components[1] = vertex.mPosition.y;
+            components[2] = vertex.mPosition.z;
+            components[3] = finiteOrZero(vertex.mNormal.x) * normalScale;
+            components[4] = finiteOrZero(vertex.mNormal.y) * normalScale;
+            components[5] = finiteOrZero(vertex.mNormal.z) * normalScale;
+            components[6] = finiteOrZero(vertex.mTexCoord.x) * texCoordScale;
+            components[7] = finiteOrZero(vertex.mTexCoord.y) * texCoordScale;
+        }
+
+        // Triangle quadrics, weighted by area.
+        mQuadrics.resize(numVertices);
+        std::unordered_map<uint64_t, uint32_t> edgeTriangleCount;
+        for(uint32_t triangleIndex = 0; triangleIndex < mTriangleCount; ++triangleIndex) {
+            const uint32_t* triangle = &mIndices[triangleIndex * 3];
+            const double* p0 = &mVertexComponents[triangle[0] * sNumComponents];
+            const double* p1 = &mVertexComponents[triangle[1] * sNumComponents];
+            const double* p2 = &mVertexComponents[triangle[2] * sNumComponents];
+
+            double normal[3];
+            computeFaceNormal(p0, p1, p2, normal);
+            const double area = 0.5 * sqrt(dot(normal, normal, 3));
+
+            Quadric quadric;
+            addTriangleQuadric(p0, p1, p2, area, quadric);
+            quadric.mWeight = area;
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                addQuadric(quadric, mQuadrics[triangle[corner]]);
+                ++edgeTriangleCount[edgeKey(triangle[corner], triangle[(corner + 1) % 3])];
+            }
+        }
+
+        // Edges used by a single triangle are on an open border. Their vertices
+        // get a plane perpendicular to the triangle through the edge, so they
+        // do not move away from the border.
+        mBorderVertices.resize(numVertices, 0);
+        for(uint32_t triangleIndex = 0; triangleIndex < mTriangleCount; ++triangleIndex) {
+            const uint32_t* triangle = &mIndices[triangleIndex * 3];
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                const uint32_t index0 = triangle[corner];
+                const uint32_t index1 = triangle[(corner + 1) % 3];
+                if(edgeTriangleCount[edgeKey(index0, index1)] != 1) {
+                    continue;
+                }
+
+                mBorderVertices[index0] = 1;
+                mBorderVertices[index1] = 1;
+
+                const double* p0 = &mVertexComponents[triangle[0] * sNumComponents];
+                const double* p1 = &mVertexComponents[triangle[1] * sNumComponents];
+                const double* p2 = &mVertexComponents[triangle[2] * sNumComponents];
+                double faceNormal[3];
+                computeFaceNormal(p0, p1, p2, faceNormal);
+
+                const double* edgeStart = &mVertexComponents[index0 * sNumComponents];
+                const double* edgeEnd = &mVertexComponents[index1 * sNumComponents];
+                double edge[3] = { edgeEnd[0] - edgeStart[0], edgeEnd[1] - edgeStart[1], edgeEnd[2] - edgeStart[2] };
+                const double edgeLengthSq = dot(edge, edge, 3);
+
+                double planeNormal[3];
+                cross(edge, faceNormal, planeNormal);
+                if(!normalize(planeNormal, 3)) {
+                    continue;
+                }
+
+                Quadric quadric;
+                addPlaneQuadric(planeNormal, edgeStart, sBorderWeight * edgeLengthSq, quadric);
+                addQuadric(quadric, mQuadrics[index0]);
+                addQuadric(quadric, mQuadrics[index1]);
+            }
+        }
+
+        mVersions.resize(numVertices, 0);
+        for(uint32_t triangleIndex = 0; triangleIndex < mTriangleCount; ++triangleIndex) {
+            const uint32_t* triangle = &mIndices[triangleIndex * 3];
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                pushCandidate(triangle[corner], triangle[(corner + 1) % 3]);
+                pushCandidate(triangle[(corner + 1) % 3], triangle[corner]);
+            }
+        }
+    }
+
+    void Simplifier::pushCandidate(const uint32_t from,
+                                   const uint32_t to)
+    {
+        if(mLockedVertices[from]) {
+            return;
+        }
+
+        const double* position = &mVertexComponents[to * sNumComponents];
+        const double cost = std::max(0.0, evaluateQuadric(mQuadrics[from], position) + evaluateQuadric(mQuadrics[to], position));
+        const double weight = mQuadrics[from].mWeight + mQuadrics[to].mWeight;
+
+        Candidate candidate;
+        candidate.mCost = cost;
+        candidate.mError = weight > 0.0 ? static_cast<float> (sqrt(cost / weight)) : 0.0f;
+        candidate.mFrom = from;
+        candidate.mTo = to;
+        candidate.mFromVersion = mVersions[from];
+        candidate.mToVersion = mVersions[to];
+        mCandidates.push(candidate);
+    }
+
+    void Simplifier::pushCandidates(const uint32_t vertexIndex)
+    {
+        const std::vector<uint32_t>& triangles = mVertexTriangles[vertexIndex];
+        for(size_t i = 0; i < triangles.size(); ++i) {
+            const uint32_t* triangle = &mIndices[triangles[i] * 3];
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                if(triangle[corner] != vertexIndex) {
+                    pushCandidate(vertexIndex, triangle[corner]);
+                    pushCandidate(triangle[corner], vertexIndex);
+                }
+            }
+        }
+    }
+
+    bool Simplifier::containsVertex(const uint32_t triangleIndex,
+                                    const uint32_t vertexIndex) const
+    {
+        const uint32_t* triangle = &mIndices[triangleIndex * 3];
+        return triangle[0] == vertexIndex || triangle[1] == vertexIndex || triangle[2] == vertexIndex;
+    }
+
+    bool Simplifier::isCollapseValid(const uint32_t from,
+                                     const uint32_t to) const
+    {
+        const std::vector<uint32_t>& fromTriangles = mVertexTriangles[from];
+
+        uint32_t sharedTriangles = 0;
+        for(size_t i = 0; i < fromTriangles.size(); ++i) {
+            if(containsVertex(fromTriangles[i], to)) {
+                ++sharedTriangles;
+            }
+        }
+
+        // Vertices are not neighbors anymore.
+        if(sharedTriangles == 0) {
+            return false;
+        }
+
+        // Border vertices can only move along a border edge.
+        if(mBorderVertices[from] && (!mBorderVertices[to] || sharedTriangles != 1)) {
+            return false;
+        }
+
+        // Link condition: the only neighbors shared by both vertices are the ones
+        // of the triangles that contain the edge. Otherwise, the collapse
+        // creates non manifold edges.
+        std::vector<uint32_t> fromNeighbors;
+        std::vector<uint32_t> toNeighbors;
+        for(size_t i = 0; i < fromTriangles.size(); ++i) {
+            const uint32_t* triangle = &mIndices[fromTriangles[i] * 3];
+            fromNeighbors.insert(fromNeighbors.end(), triangle, triangle + 3);
+        }
+
+        const std::vector<uint32_t>& toTriangles = mVertexTriangles[to];
+        for(size_t i = 0; i < toTriangles.size(); ++i) {
+            const uint32_t* triangle = &mIndices[toTriangles[i] * 3];
+            toNeighbors.insert(toNeighbors.end(), triangle, triangle + 3);
+        }
+
+        std::sort(fromNeighbors.begin(), fromNeighbors.end());
+        fromNeighbors.erase(std::unique(fromNeighbors.begin(), fromNeighbors.end()), fromNeighbors.end());
+        std::sort(toNeighbors.begin(), toNeighbors.end());
+        toNeighbors.erase(std::unique(toNeighbors.begin(), toNeighbors.end()), toNeighbors.end());
+
+        std::vector<uint32_t> commonNeighbors;
+        std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(),
+                              toNeighbors.begin(), toNeighbors.end(),
+                              std::back_inserter(commonNeighbors));
+
+        // Common neighbors include both edge vertices.
+        if(commonNeighbors.size() != sharedTriangles + 2) {
+            return false;
+        }
+
+        // Triangles must not flip.
+        const double* toPosition = &mVertexComponents[to * sNumComponents];
+        for(size_t i = 0; i < fromTriangles.size(); ++i) {
+            if(containsVertex(fromTriangles[i], to)) {
+                continue;
+            }
+
+            const uint32_t* triangle = &mIndices[fromTriangles[i] * 3];
+            const double* positions[3];
+            const double* newPositions[3];
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                positions[corner] = &mVertexComponents[triangle[corner] * sNumComponents];
+                newPositions[corner] = triangle[corner] == from ? toPosition : positions[corner];
+            }
+
+            double normal[3];
+            double newNormal[3];
+            computeFaceNormal(positions[0], positions[1], positions[2], normal);
+            computeFaceNormal(newPositions[0], newPositions[1], newPositions[2], newNormal);
+            if(dot(normal, newNormal, 3) <= 0.0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void Simplifier::collapse(const uint32_t from,
+                              const uint32_t to)
+    {
+        std::vector<uint32_t>& fromTriangles = mVertexTriangles[from];
+        std::vector<uint32_t>& toTriangles = mVertexTriangles[to];
+        for(size_t i = 0; i < fromTriangles.size(); ++i) {
+            const uint32_t triangleIndex = fromTriangles[i];
+            uint32_t* triangle = &mIndices[triangleIndex * 3];
+
+            if(containsVertex(triangleIndex, to)) {
+                // Triangle degenerates. Remove it from its other vertices.
+                mRemovedTriangles[triangleIndex] = 1;
+                --mTriangleCount;
+                for(uint32_t corner = 0; corner < 3; ++corner) {
+                    if(triangle[corner] != from) {
+                        std::vector<uint32_t>& triangles = mVertexTriangles[triangle[corner]];
+                        triangles.erase(std::find(triangles.begin(), triangles.end(), triangleIndex));
+                    }
+                }
+            } else {
+                for(uint32_t corner = 0; corner < 3; ++corner) {
+                    if(triangle[corner] == from) {
+                        triangle[corner] = to;
+                    }
+                }
+
+                toTriangles.push_back(triangleIndex);
+            }
+        }
+
+        fromTriangles.clear();
+        addQuadric(mQuadrics[from], mQuadrics[to]);
+        ++mVersions[from];
+        ++mVersions[to];
+
+        pushCandidates(to);
+    }
+
+    void Simplifier::run(const uint32_t targetTriangleCount)
+    {
+        while(mTriangleCount > targetTriangleCount && !mCandidates.empty()) {
+            const Candidate candidate = mCandidates.top();
+            mCandidates.pop();
+
+            if(candidate.mFromVersion != mVersions[candidate.mFrom] ||
+               candidate.mToVersion != mVersions[candidate.mTo] ||
+               !isCollapseValid(candidate.mFrom, candidate.mTo)) {
+                continue;
+            }
+
+            collapse(candidate.mFrom, candidate.mTo);
+            mError = std::max(mError, candidate.mError);
+        }
+    }
+
+    void Simplifier::extract(MeshData& meshData) const
+    {
+        const uint32_t numVertices = static_cast<uint32_t> (mMeshData.mVertices.size());
+        const uint32_t unassigned = ~0U;
+        std::vector<uint32_t> remap(numVertices, unassigned);
+
+        meshData.mVertices.clear();
+        meshData.mIndices.clear();
+        meshData.mIndices.reserve(mTriangleCount * 3);
+
+        // Keep the relative order of the original vertices.
+        for(uint32_t vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex) {
+            if(!mVertexTriangles[vertexIndex].empty()) {
+                remap[vertexIndex] = static_cast<uint32_t> (meshData.mVertices.size());
+                meshData.mVertices.push_back(mMeshData.mVertices[vertexIndex]);
+            }
+        }
+
+        for(uint32_t triangleIndex = 0; triangleIndex < mRemovedTriangles.size(); ++triangleIndex) {
+            if(mRemovedTriangles[triangleIndex]) {
+                continue;
+            }
+
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                meshData.mIndices.push_back(remap[mIndices[triangleIndex * 3 + corner]]);
+            }
+        }
+    }
+}
+
+namespace MeshSimplifier
+{
+    float simplify(const MeshData& meshData,
+                   const uint32_t targetTriangleCount,
+                   MeshData& simplifiedMeshData,
+                   const AttributeWeights& attributeWeights)
+    {
+        Simplifier simplifier(meshData, attributeWeights);
+        simplifier.run(targetTriangleCount);
+        simplifier.extract(simplifiedMeshData);
+
+        return simplifier.mError;
+    }
+
+    void generateLodChain(const MeshData& meshData,
+                          const std::vector<float>& triangleRatios,
+                          std::vector<LodLevel>& lods,
+                          const AttributeWeights& attributeWeights)
+    {
+        lods.clear();
+        lods.resize(triangleRatios.size());
+
+        Simplifier simplifier(meshData, attributeWeights);
+        const uint32_t numTriangles = simplifier.mTriangleCount;
+        for(size_t lodIndex = 0; lodIndex < triangleRatios.size(); ++lodIndex) {
+            const float ratio = triangleRatios[lodIndex];
+            assert(ratio > 0.0f && ratio <= 1.0f);
+            assert(lodIndex == 0 || ratio <= triangleRatios[lodIndex - 1]);
+
+            simplifier.run(static_cast<uint32_t> (numTriangles * ratio));
+            simplifier.extract(lods[lodIndex].mMeshData);
+            lods[lodIndex].mError = simplifier.mError;
+        }
+    }
+
+    float computeScreenHeight(const BoundingSphere& boundingSphere,
+                              const Camera& camera)
+    {
+        const DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&boundingSphere.mCenter),
+                                                                   DirectX::XMLoadFloat3(&camera.mPosition));
+        const float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(offset));
+        if(distance <= boundingSphere.mRadius) {
+            return 1.0f;
+        }
+
+        // Visible height at the sphere distance is 2 * distance * tan(fovY / 2)
+        const float visibleHeight = 2.0f * distance * tanf(0.5f * camera.mFieldOfViewY);
+
+        return std::min(1.0f, 2.0f * boundingSphere.mRadius / visibleHeight);
+    }
+
+    uint32_t selectLod(const std::vector<LodLevel>& lods,
+                       const BoundingSphere& boundingSphere,
+                       const Camera& camera,
+                       const float viewportHeight,
+                       const float maxPixelError)
+    {
+        assert(camera.mNearWindowHeight > 0.0f);
+
+        const DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&boundingSphere.mCenter),
+                                                                   DirectX::XMLoadFloat3(&camera.mPosition));
+        const float centerDistance = DirectX::XMVectorGetX(DirectX::XMVector3Length(offset));
+        const float distance = std::max(centerDistance - boundingSphere.mRadius, camera.mNearZ);
+
+        // An object space length l at distance d projects to
+        // l * (nearZ / d) on the near window.
+        const float pixelsPerUnit = viewportHeight * camera.mNearZ / (distance * camera.mNearWindowHeight);
+
+        for(size_t lodIndex = lods.size(); lodIndex > 0; --lodIndex) {
+            if(lods[lodIndex - 1].mError * pixelsPerUnit <= maxPixelError) {
+                return static_cast<uint32_t> (lodIndex - 1);
+            }
+        }
+
+        return 0;
+    }
+}
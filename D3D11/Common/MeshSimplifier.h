@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Simplifies MeshData with edge collapses driven by quadric error
+// metrics (Garland and Heckbert) and selects a level of detail
+// for a camera.
+//
+// Quadrics are built over positions, normals and texture coordinates,
+// so collapses that distort shading or texturing are more expensive
+// than the ones that only move flat geometry.
+// Collapses are half edge collapses (a vertex is merged into one of its
+// neighbors), so surviving vertices keep their original attributes.
+// Vertices on attribute seams (same position, different attributes)
+// are never removed, and vertices on open borders can only slide
+// along the border, so the simplified mesh does not crack.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GeometryGenerator.h>
+
+struct Camera;
+
+struct LodLevel
+{
+    LodLevel()
+        : mError(0.0f)
+    {
+
+    }
+
+    MeshData mMeshData;
+
+    // Approximate geometric error with respect to the original mesh,
+    // in object space units.
+    float mError;
+};
+
+namespace MeshSimplifier
+{
+    // Relative importance of normals and texture coordinates with respect
+    // to positions. Attribute errors are scaled by the mesh extent, so the
+    // weights do not depend on the mesh size.
+    struct AttributeWeights
+    {
+        AttributeWeights()
+            : mNormalWeight(0.5f)
+            , mTexCoordWeight(0.5f)
+        {
+
+        }
+
+        float mNormalWeight;
+        float mTexCoordWeight;
+    };
+
+    // Simplifies meshData until it has targetTriangleCount triangles or
+    // no more collapses are allowed. Returns the error of the result.
+    float simplify(const MeshData& meshData,
+                   const uint32_t targetTriangleCount,
+                   MeshData& simplifiedMeshData,
+                   const AttributeWeights& attributeWeights = AttributeWeights());
+
+    // Generates a level of detail per triangle ratio (relative to the triangle
+    // count of meshData), in a single simplification pass.
+    // Ratios must be in (0, 1] and in decreasing order.
+    // lods[0] is usually generated with ratio 1 to keep the original mesh.
+    void generateLodChain(const MeshData& meshData,
+                          const std::vector<float>& triangleRatios,
+                          std::vector<LodLevel>& lods,
+                          const AttributeWeights& attributeWeights = AttributeWeights());
+
+    // Fraction of the viewport height covered by the bounding sphere.
+    // Based on the camera vertical field of view.
+    float computeScreenHeight(const BoundingSphere& boundingSphere,
+                              const Camera& camera);
+
+    // Returns the index of the coarsest level of detail whose error,
+    // projected on a viewport of viewportHeight pixels, is not greater
+    // than maxPixelError. boundingSphere must be in the camera space
+    // (usually world space).
+    uint32_t selectLod(const std::vector<LodLevel>& lods,
+                       const BoundingSphere& boundingSphere,
+                       const Camera& camera,
+                       const float viewportHeight,
+                       const float maxPixelError = 1.0f);
+}
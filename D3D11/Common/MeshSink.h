@@ -0,0 +1,192 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Versions of the GeometryGenerator shapes that generate into memory
+// provided by the caller (for example, the vertices of the application
+// layout that are going to initialize a buffer, or a mapped buffer).
+//
+// The projection that converts every generated vertex to the caller
+// layout is a template parameter, so it is inlined into the shape
+// builders and every vertex is written once, straight to its
+// destination, with no intermediate VertexData storage and no
+// indirect call per vertex.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <ShapeBuilders.h>
+
+// Caller provided memory the sink versions of the generators write to.
+// projection(const VertexData& vertex, Vertex& destination) converts
+// every generated vertex. mIndices can be nullptr to generate vertices only.
+// Builders only compute positions and the attributes in mStreamMask
+// (MeshStream flags), so the projection must not read the rest.
+template<typename Vertex, typename Projection>
+struct MeshSink
+{
+    MeshSink(Vertex* vertices,
+             const uint32_t vertexCapacity,
+             uint32_t* indices,
+             const uint32_t indexCapacity,
+             const Projection& projection,
+             const uint32_t streamMask)
+        : mVertices(vertices)
+        , mVertexCapacity(vertexCapacity)
+        , mIndices(indices)
+        , mIndexCapacity(indexCapacity)
+        , mProjection(projection)
+        , mStreamMask(streamMask)
+    {
+
+    }
+
+    // Vertex writer of the shape builders, that projects
+    // every vertex straight to its place in the sink.
+    void operator()(const size_t vertexIndex,
+                    const VertexData& vertex) const
+    {
+        mProjection(vertex, mVertices[vertexIndex]);
+    }
+
+    bool fits(const MeshSize& meshSize) const
+    {
+        return mVertices != nullptr &&
+               meshSize.mVertexCount <= mVertexCapacity &&
+               (mIndices == nullptr || meshSize.mIndexCount <= mIndexCapacity);
+    }
+
+    Vertex* mVertices;
+    uint32_t mVertexCapacity;
+
+    uint32_t* mIndices;
+    uint32_t mIndexCapacity;
+
+    Projection mProjection;
+    uint32_t mStreamMask;
+};
+
+namespace GeometryGenerator
+{
+    // Sink that writes to vertexCapacity vertices and indexCapacity
+    // indices (indices can be nullptr), for example a mapped buffer.
+    template<typename Vertex, typename Projection>
+    MeshSink<Vertex, Projection> makeMeshSink(Vertex* vertices,
+                                              const uint32_t vertexCapacity,
+                                              uint32_t* indices,
+                                              const uint32_t indexCapacity,
+                                              const Projection& projection,
+                                              const uint32_t streamMask = MeshStream::ALL)
+    {
+        return MeshSink<Vertex, Projection>(vertices, vertexCapacity, indices, indexCapacity, projection, streamMask);
+    }
+
+    // Sink that writes to vertices and indices, that must be already sized.
+    template<typename Vertex, typename Projection>
+    MeshSink<Vertex, Projection> makeMeshSink(std::vector<Vertex>& vertices,
+                                              std::vector<uint32_t>& indices,
+                                              const Projection& projection,
+                                              const uint32_t streamMask = MeshStream::ALL)
+    {
+        return makeMeshSink(vertices.empty() ? nullptr : &vertices[0],
+                            static_cast<uint32_t> (vertices.size()),
+                            indices.empty() ? nullptr : &indices[0],
+                            static_cast<uint32_t> (indices.size()),
+                            projection,
+                            streamMask);
+    }
+
+    //
+    // The compute functions of GeometryGenerator.h return the size the
+    // sink needs, and the generators return false (and write nothing)
+    // if it is too small. Results match the MeshData versions.
+    //
+
+    template<typename Vertex, typename Projection>
+    bool generateBox(const float width,
+                     const float height,
+                     const float depth,
+                     const MeshSink<Vertex, Projection>& meshSink)
+    {
+        if(!meshSink.fits(computeBoxSize())) {
+            return false;
+        }
+
+        ShapeBuilders::buildBoxVertices(width, height, depth, meshSink.mStreamMask, meshSink);
+        if(meshSink.mIndices != nullptr) {
+            ShapeBuilders::buildBoxIndices(meshSink.mIndices);
+        }
+
+        return true;
+    }
+
+    template<typename Vertex, typename Projection>
+    bool generateSphere(const float radius,
+                        const uint32_t sliceCount,
+                        const uint32_t stackCount,
+                        const MeshSink<Vertex, Projection>& meshSink)
+    {
+        if(!meshSink.fits(computeSphereSize(sliceCount, stackCount))) {
+            return false;
+        }
+
+        ShapeBuilders::buildSphere(radius,
+                                   sliceCount,
+                                   stackCount,
+                                   meshSink.mStreamMask,
+                                   meshSink,
+                                   meshSink.mIndices);
+
+        return true;
+    }
+
+    template<typename Vertex, typename Projection>
+    bool generateCylinder(const float bottomRadius,
+                          const float topRadius,
+                          const float height,
+                          const uint32_t sliceCount,
+                          const uint32_t stackCount,
+                          const MeshSink<Vertex, Projection>& meshSink)
+    {
+        if(!meshSink.fits(computeCylinderSize(sliceCount, stackCount))) {
+            return false;
+        }
+
+        ShapeBuilders::buildCylinder(bottomRadius,
+                                     topRadius,
+                                     height,
+                                     sliceCount,
+                                     stackCount,
+                                     meshSink.mStreamMask,
+                                     meshSink,
+                                     meshSink.mIndices);
+
+        return true;
+    }
+
+    template<typename Vertex, typename Projection>
+    bool generateGrid(const float width,
+                      const float depth,
+                      const uint32_t numRows,
+                      const uint32_t numColumns,
+                      const MeshSink<Vertex, Projection>& meshSink)
+    {
+        if(!meshSink.fits(computeGridSize(numRows, numColumns))) {
+            return false;
+        }
+
+        ShapeBuilders::buildGrid(width,
+                                 depth,
+                                 numRows,
+                                 numColumns,
+                                 meshSink.mStreamMask,
+                                 meshSink,
+                                 meshSink.mIndices);
+
+        return true;
+    }
+}
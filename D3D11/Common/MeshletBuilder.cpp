@@ -0,0 +1,316 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <Camera.h>
+
+namespace
+{
+    const uint32_t sUnassigned = ~0U;
+
+    // Below this value the triangle normals are spread over more than
+    // a hemisphere (roughly), so the cone would never reject anything.
+    const float sMinConeDot = 0.1f;
+
+    DirectX::XMVECTOR loadVertexPosition(const MeshData& meshData,
+                                         const MeshletData& meshletData,
+                                         const Meshlet& meshlet,
+                                         const uint32_t localIndex)
+    {
+        const uint32_t vertexIndex = meshletData.mVertices[meshlet.mVertexOffset + localIndex];
+        return DirectX::XMLoadFloat3(&meshData.mVertices[vertexIndex].mPosition);
+    }
+
+    void computeBoundingSphere(const MeshData& meshData,
+                               const MeshletData& meshletData,
+                               Meshlet& meshlet)
+    {
+        // Center of the bounding box and the farthest vertex from it.
+        DirectX::XMVECTOR minPosition = loadVertexPosition(meshData, meshletData, meshlet, 0);
+        DirectX::XMVECTOR maxPosition = minPosition;
+        for(uint32_t localIndex = 1; localIndex < meshlet.mVertexCount; ++localIndex) {
+            const DirectX::XMVECTOR position = loadVertexPosition(meshData, meshletData, meshlet, localIndex);
+            minPosition = DirectX::XMVectorMin(minPosition, position);
+            maxPosition = DirectX::XMVectorMax(maxPosition, position);
+        }
+
+        const DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(minPosition, maxPosition), 0.5f);
+        float radiusSq = 0.0f;
+        for(uint32_t localIndex = 0; localIndex < meshlet.mVertexCount; ++localIndex) {
+            const DirectX::XMVECTOR position = loadVertexPosition(meshData, meshletData, meshlet, localIndex);
+            const DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(position, center);
+            radiusSq = std::max(radiusSq, DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(offset)));
+        }
+
+        DirectX::XMStoreFloat3(&meshlet.mBoundingSphere.mCenter, center);
+        meshlet.mBoundingSphere.mRadius = sqrtf(radiusSq);
+    }
+
+    void computeNormalCone(const MeshData& meshData,
+                           const MeshletData& meshletData,
+                           Meshlet& meshlet)
+    {
+        const uint8_t* triangles = &meshletData.mTriangles[meshlet.mTriangleOffset * 3];
+
+        // Unit face normals. Degenerate triangles are skipped.
+        std::vector<DirectX::XMFLOAT3> normals;
+        normals.reserve(meshlet.mTriangleCount);
+        std::vector<uint32_t> normalTriangles;
+        normalTriangles.reserve(meshlet.mTriangleCount);
+
+        DirectX::XMVECTOR axis = DirectX::XMVectorZero();
+        for(uint32_t triangleIndex = 0; triangleIndex < meshlet.mTriangleCount; ++triangleIndex) {
+            const DirectX::XMVECTOR p0 = loadVertexPosition(meshData, meshletData, meshlet, triangles[triangleIndex * 3 + 0]);
+            const DirectX::XMVECTOR p1 = loadVertexPosition(meshData, meshletData, meshlet, triangles[triangleIndex * 3 + 1]);
+            const DirectX::XMVECTOR p2 = loadVertexPosition(meshData, meshletData, meshlet, triangles[triangleIndex * 3 + 2]);
+
+            // Triangles are generated with this winding for outward facing normals.
+            const DirectX::XMVECTOR crossProduct =
+                DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p1, p0), DirectX::XMVectorSubtract(p2, p0));
+            const float length = DirectX::XMVectorGetX(DirectX::XMVector3Length(crossProduct));
+            if(length <= 0.0f) {
+                continue;
+            }
+
+            const DirectX::XMVECTOR normal = DirectX::XMVectorScale(crossProduct, 1.0f / length);
+            normals.push_back(DirectX::XMFLOAT3());
+            DirectX::XMStoreFloat3(&normals.back(), normal);
+            normalTriangles.push_back(triangleIndex);
+            axis = DirectX::XMVectorAdd(axis, normal);
+        }
+
+        // Leave the default cone, that never rejects.
+        const float axisLength = DirectX::XMVectorGetX(DirectX::XMVector3Length(axis));
+        if(normals.empty() || axisLength <= 0.0f) {
+            return;
+        }
+
+        axis = DirectX::XMVectorScale(axis, 1.0f / axisLength);
+
+        // Minimum cosine between the axis and every normal.
+        float minDot = 1.0f;
+        for(size_t i = 0; i < normals.size(); ++i) {
+            const float dot = DirectX::XMVectorGetX(DirectX::XMVector3Dot(axis, DirectX::XMLoadFloat3(&normals[i])));
+            minDot = std::min(minDot, dot);
+        }
+
+        if(minDot <= sMinConeDot) {
+            return;
+        }
+
+        // Move the apex back along the axis until it is behind
+        // every triangle plane, so the test is conservative from
+        // any view position and not only from far away.
+        const DirectX::XMVECTOR center = DirectX::XMLoadFloat3(&meshlet.mBoundingSphere.mCenter);
+        float maxT = 0.0f;
+        for(size_t i = 0; i < normals.size(); ++i) {
+            const DirectX::XMVECTOR normal = DirectX::XMLoadFloat3(&normals[i]);
+            const DirectX::XMVECTOR p0 = loadVertexPosition(meshData, meshletData, meshlet, triangles[normalTriangles[i] * 3]);
+            const float centerDistance = DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMVectorSubtract(center, p0), normal));
+            const float axisDot = DirectX::XMVectorGetX(DirectX::XMVector3Dot(axis, normal));
+            maxT = std::max(maxT, centerDistance / axisDot);
+        }
+
+        DirectX::XMStoreFloat3(&meshlet.mConeApex, DirectX::XMVectorSubtract(center, DirectX::XMVectorScale(axis, maxT)));
+        DirectX::XMStoreFloat3(&meshlet.mConeAxis, axis);
+
+        // The cone contains the directions whose angle with the axis
+        // is less than 90 - acos(minDot) degrees.
+        meshlet.mConeCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+
+    void finishMeshlet(const MeshData& meshData,
+                       MeshletData& meshletData,
+                       Meshlet& meshlet,
+                       std::vector<uint32_t>& localIndices)
+    {
+        if(meshlet.mTriangleCount == 0) {
+            return;
+        }
+
+        computeBoundingSphere(meshData, meshletData, meshlet);
+        computeNormalCone(meshData, meshletData, meshlet);
+        meshletData.mMeshlets.push_back(meshlet);
+
+        for(uint32_t localIndex = 0; localIndex < meshlet.mVertexCount; ++localIndex) {
+            localIndices[meshletData.mVertices[meshlet.mVertexOffset + localIndex]] = sUnassigned;
+        }
+
+        meshlet = Meshlet();
+        meshlet.mVertexOffset = static_cast<uint32_t> (meshletData.mVertices.size());
+        meshlet.mTriangleOffset = static_cast<uint32_t> (meshletData.mTriangles.size() / 3);
+    }
+
+    // Largest scale of a matrix that scales first, and then rotates and translates:
+    // the length of its longest axis.
+    float computeMaxScale(DirectX::CXMMATRIX world)
+    {
+        const float scaleX = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[0]));
+        const float scaleY = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[1]));
+        const float scaleZ = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[2]));
+
+        return sqrtf((std::max)(scaleX, (std::max)(scaleY, scaleZ)));
+    }
+
+    // Sphere center and radius in world space.
+    bool isSphereOutsideFrustum(DirectX::FXMVECTOR center,
+                                const float radius,
+                                const Camera& camera)
+    {
+        // Sphere center in view space.
+        const DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(center, DirectX::XMLoadFloat3(&camera.mPosition));
+        const float x = DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&camera.mRight)));
+        const float y = DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&camera.mUp)));
+        const float z = DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&camera.mLook)));
+
+        if(z + radius < camera.mNearZ || z - radius > camera.mFarZ) {
+            return true;
+        }
+
+        // Distances to the side planes, that go through the view position.
+        const float halfFieldOfViewY = 0.5f * camera.mFieldOfViewY;
+        const float halfFieldOfViewX = atanf(tanf(halfFieldOfViewY) * camera.mAspectRatio);
+        const float cosY = cosf(halfFieldOfViewY);
+        const float sinY = sinf(halfFieldOfViewY);
+        const float cosX = cosf(halfFieldOfViewX);
+        const float sinX = sinf(halfFieldOfViewX);
+
+        return y * cosY - z * sinY > radius ||
+               -y * cosY - z * sinY > radius ||
+               x * cosX - z * sinX > radius ||
+               -x * cosX - z * sinX > radius;
+    }
+
+    bool isMeshletOutsideFrustum(const Meshlet& meshlet,
+                                 DirectX::FXMMATRIX world,
+                                 const float maxScale,
+                                 const Camera& camera)
+    {
+        const DirectX::XMVECTOR center = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&meshlet.mBoundingSphere.mCenter), world);
+        return isSphereOutsideFrustum(center, meshlet.mBoundingSphere.mRadius * maxScale, camera);
+    }
+}
+
+namespace MeshletUtils
+{
+    void buildMeshlets(const MeshData& meshData,
+                       MeshletData& meshletData,
+                       const uint32_t maxVertices,
+                       const uint32_t maxTriangles)
+    {
+        assert(maxVertices >= 3 && maxVertices <= 256);
+        assert(maxTriangles > 0);
+
+        meshletData.mMeshlets.clear();
+        meshletData.mVertices.clear();
+        meshletData.mTriangles.clear();
+
+        const size_t numTriangles = meshData.mIndices.size() / 3;
+        meshletData.mTriangles.reserve(numTriangles * 3);
+
+        // Local index of every mesh vertex in the current meshlet.
+        std::vector<uint32_t> localIndices(meshData.mVertices.size(), sUnassigned);
+
+        Meshlet meshlet;
+        for(size_t triangleIndex = 0; triangleIndex < numTriangles; ++triangleIndex) {
+            const uint32_t* triangle = &meshData.mIndices[triangleIndex * 3];
+
+            uint32_t newVertices = 0;
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                // Repeated indices in a degenerate triangle are counted once.
+                const bool repeated = (corner > 0 && triangle[corner] == triangle[0]) ||
+                                      (corner > 1 && triangle[corner] == triangle[1]);
+                if(localIndices[triangle[corner]] == sUnassigned && !repeated) {
+                    ++newVertices;
+                }
+            }
+
+            if(meshlet.mVertexCount + newVertices > maxVertices || meshlet.mTriangleCount == maxTriangles) {
+                finishMeshlet(meshData, meshletData, meshlet, localIndices);
+            }
+
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                const uint32_t vertexIndex = triangle[corner];
+                if(localIndices[vertexIndex] == sUnassigned) {
+                    localIndices[vertexIndex] = meshlet.mVertexCount++;
+                    meshletData.mVertices.push_back(vertexIndex);
+                }
+
+                meshletData.mTriangles.push_back(static_cast<uint8_t> (localIndices[vertexIndex]));
+            }
+
+            ++meshlet.mTriangleCount;
+        }
+
+        finishMeshlet(meshData, meshletData, meshlet, localIndices);
+    }
+
+    bool isOutsideFrustum(const Meshlet& meshlet,
+                          const DirectX::XMFLOAT4X4& world,
+                          const Camera& camera)
+    {
+        const DirectX::XMMATRIX worldMatrix = DirectX::XMLoadFloat4x4(&world);
+        return isMeshletOutsideFrustum(meshlet, worldMatrix, computeMaxScale(worldMatrix), camera);
+    }
+
+    bool isBackFacing(const Meshlet& meshlet,
+                      const DirectX::XMFLOAT3& objectViewPosition)
+    {
+        // The cone test is done in object space: the view position is in the back
+        // half space of a triangle in world space if, and only if, it is in object
+        // space, for every world matrix that does not mirror.
+        const DirectX::XMVECTOR viewDirection =
+            DirectX::XMVector3Normalize(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&meshlet.mConeApex),
+                                                                  DirectX::XMLoadFloat3(&objectViewPosition)));
+        const float dot = DirectX::XMVectorGetX(DirectX::XMVector3Dot(viewDirection, DirectX::XMLoadFloat3(&meshlet.mConeAxis)));
+
+        return dot >= meshlet.mConeCutoff;
+    }
+
+    uint32_t cullMeshlets(const MeshletData& meshletData,
+                          const DirectX::XMFLOAT4X4& world,
+                          const Camera& camera,
+                          std::vector<uint32_t>& visibleMeshlets)
+    {
+        visibleMeshlets.clear();
+
+        const DirectX::XMMATRIX worldMatrix = DirectX::XMLoadFloat4x4(&world);
+        const float maxScale = computeMaxScale(worldMatrix);
+
+        // Camera position in object space, for backface culling.
+        DirectX::XMVECTOR determinant;
+        const DirectX::XMMATRIX inverseWorld = DirectX::XMMatrixInverse(&determinant, worldMatrix);
+        const bool backfaceCulling = DirectX::XMVectorGetX(determinant) > 0.0f;
+        DirectX::XMFLOAT3 objectViewPosition;
+        DirectX::XMStoreFloat3(&objectViewPosition, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&camera.mPosition), inverseWorld));
+
+        uint32_t rejectedTriangles = 0;
+        for(uint32_t meshletIndex = 0; meshletIndex < meshletData.mMeshlets.size(); ++meshletIndex) {
+            const Meshlet& meshlet = meshletData.mMeshlets[meshletIndex];
+            if(isMeshletOutsideFrustum(meshlet, worldMatrix, maxScale, camera) ||
+               (backfaceCulling && isBackFacing(meshlet, objectViewPosition))) {
+                rejectedTriangles += meshlet.mTriangleCount;
+            } else {
+                visibleMeshlets.push_back(meshletIndex);
+            }
+        }
+
+        return rejectedTriangles;
+    }
+
+    void appendIndices(const MeshletData& meshletData,
+                       const std::vector<uint32_t>& meshlets,
+                       std::vector<uint32_t>& indices)
+    {
+        for(size_t i = 0; i < meshlets.size(); ++i) {
+            const Meshlet& meshlet = meshletData.mMeshlets[meshlets[i]];
+            const uint32_t* vertices = &meshletData.mVertices[meshlet.mVertexOffset];
+            const uint8_t* triangles = &meshletData.mTriangles[meshlet.mTriangleOffset * 3];
+            for(uint32_t j = 0; j < meshlet.mTriangleCount * 3; ++j) {
+                indices.push_back(vertices[triangles[j]]);
+            }
+        }
+    }
+}
@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Splits a MeshData into meshlets: small clusters of triangles with
+// a bounded number of vertices and triangles.
+//
+// Every meshlet stores a bounding sphere and a normal cone, so whole
+// clusters can be rejected on the CPU (frustum and backface culling)
+// before the index ranges to draw are built.
+//
+// Meshlets are built greedily in index buffer order, so running
+// MeshOptimizer::optimizeVertexCache first produces tighter clusters.
+//
+// Meshlet bounds are in the object space of the MeshData. Culling takes
+// the world matrix of the object, so the camera stays in world space.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <vector>
+
+#include <GeometryGenerator.h>
+
+struct Camera;
+
+struct Meshlet
+{
+    Meshlet()
+        : mVertexOffset(0)
+        , mTriangleOffset(0)
+        , mVertexCount(0)
+        , mTriangleCount(0)
+        , mConeApex(0.0f, 0.0f, 0.0f)
+        , mConeAxis(0.0f, 0.0f, 0.0f)
+        , mConeCutoff(1.0f)
+    {
+
+    }
+
+    // Offset in MeshletData::mVertices
+    uint32_t mVertexOffset;
+
+    // Offset (in triangles) in MeshletData::mTriangles
+    uint32_t mTriangleOffset;
+
+    uint32_t mVertexCount;
+    uint32_t mTriangleCount;
+
+    BoundingSphere mBoundingSphere;
+
+    // The meshlet is back facing for every view position p that
+    // satisfies dot(normalize(mConeApex - p), mConeAxis) >= mConeCutoff.
+    // Meshlets whose triangles face too many directions have
+    // a zero axis, so they are never rejected.
+    DirectX::XMFLOAT3 mConeApex;
+    DirectX::XMFLOAT3 mConeAxis;
+    float mConeCutoff;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> mMeshlets;
+
+    // Indices of MeshData::mVertices used by each meshlet.
+    std::vector<uint32_t> mVertices;
+
+    // 3 meshlet local vertex indices (relative to
+    // Meshlet::mVertexOffset) per triangle.
+    std::vector<uint8_t> mTriangles;
+};
+
+namespace MeshletUtils
+{
+    // maxVertices must be in [3, 256], so local indices fit in 8 bits.
+    void buildMeshlets(const MeshData& meshData,
+                       MeshletData& meshletData,
+                       const uint32_t maxVertices = 64,
+                       const uint32_t maxTriangles = 124);
+
+    // world transforms the meshlet to the world space of the camera. It must
+    // scale first, and then rotate and translate, so the bounding sphere radius
+    // is scaled by its largest scale.
+    bool isOutsideFrustum(const Meshlet& meshlet,
+                          const DirectX::XMFLOAT4X4& world,
+                          const Camera& camera);
+
+    // objectViewPosition is the view position in the object space of the
+    // meshlet, that is, the camera position transformed by the inverse world.
+    bool isBackFacing(const Meshlet& meshlet,
+                      const DirectX::XMFLOAT3& objectViewPosition);
+
+    // Fills visibleMeshlets with the indices of the meshlets that pass
+    // frustum and backface culling and returns the number of triangles
+    // of the rejected ones. world is the world matrix of the object, as in
+    // isOutsideFrustum. If it mirrors, backface culling is skipped.
+    uint32_t cullMeshlets(const MeshletData& meshletData,
+                          const DirectX::XMFLOAT4X4& world,
+                          const Camera& camera,
+                          std::vector<uint32_t>& visibleMeshlets);
+
+    // Appends the triangles of the given meshlets to indices,
+    // as indices of the original MeshData::mVertices.
+    void appendIndices(const MeshletData& meshletData,
+                       const std::vector<uint32_t>& meshlets,
+                       std::vector<uint32_t>& indices);
+}
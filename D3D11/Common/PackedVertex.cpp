@@ -0,0 +1,206 @@
+#include "PackedVertex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#include <GeometryGenerator.h>
+
+namespace
+{
+    // 1 for positive or zero components and -1 for negative ones.
+    DirectX::XMVECTOR signNotZero(DirectX::FXMVECTOR vector)
+    {
+        const DirectX::XMVECTOR one = DirectX::XMVectorSplatOne();
+        return DirectX::XMVectorSelect(one,
+                                       DirectX::XMVectorNegate(one),
+                                       DirectX::XMVectorLess(vector, DirectX::XMVectorZero()));
+    }
+
+    // Angle between a vector and a unit vector, or 0 if the first one
+    // is not a valid direction (zero length, not finite).
+    float computeAngle(DirectX::FXMVECTOR vector,
+                       DirectX::FXMVECTOR unitVector)
+    {
+        const float length = DirectX::XMVectorGetX(DirectX::XMVector3Length(vector));
+        if(!(length > 0.0f) || length > FLT_MAX) {
+            return 0.0f;
+        }
+
+        // More precise than acos for small angles.
+        const float sine = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(vector, unitVector)));
+        const float cosine = DirectX::XMVectorGetX(DirectX::XMVector3Dot(vector, unitVector));
+
+        return atan2f(sine, cosine);
+    }
+}
+
+namespace PackedVertexUtils
+{
+    DirectX::XMVECTOR encodeOctahedral(DirectX::FXMVECTOR unitVector)
+    {
+        const DirectX::XMVECTOR zero = DirectX::XMVectorZero();
+        const DirectX::XMVECTOR one = DirectX::XMVectorSplatOne();
+
+        // Project on the octahedron |x| + |y| + |z| = 1
+        const DirectX::XMVECTOR l1Norm = DirectX::XMVector3Dot(DirectX::XMVectorAbs(unitVector), one);
+        DirectX::XMVECTOR projected = DirectX::XMVectorDivide(unitVector, l1Norm);
+
+        // Lower hemisphere is folded over the diagonals:
+        // xy = (1 - |yx|) * sign(xy)
+        const DirectX::XMVECTOR swapped = DirectX::XMVectorSwizzle<1, 0, 2, 3>(projected);
+        const DirectX::XMVECTOR folded = DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(one, DirectX::XMVectorAbs(swapped)),
+                                                                   signNotZero(projected));
+        const DirectX::XMVECTOR lowerHemisphere = DirectX::XMVectorLess(DirectX::XMVectorSplatZ(projected), zero);
+        projected = DirectX::XMVectorSelect(projected, folded, lowerHemisphere);
+
+        // Comparisons with NaN are false, so invalid vectors are zeroed too.
+        const DirectX::XMVECTOR validVector = DirectX::XMVectorGreater(l1Norm, zero);
+
+        return DirectX::XMVectorSelect(zero, projected, validVector);
+    }
+
+    DirectX::XMVECTOR decodeOctahedral(DirectX::FXMVECTOR encodedVector)
+    {
+        const DirectX::XMVECTOR zero = DirectX::XMVectorZero();
+        const DirectX::XMVECTOR one = DirectX::XMVectorSplatOne();
+
+        // z = 1 - |x| - |y|
+        const DirectX::XMVECTOR absVector = DirectX::XMVectorAbs(encodedVector);
+        const DirectX::XMVECTOR z = DirectX::XMVectorSubtract(one,
+                                                              DirectX::XMVectorAdd(DirectX::XMVectorSplatX(absVector),
+                                                                                   DirectX::XMVectorSplatY(absVector)));
+
+        // Unfold the lower hemisphere: xy -= sign(xy) * max(-z, 0)
+        const DirectX::XMVECTOR t = DirectX::XMVectorMax(DirectX::XMVectorNegate(z), zero);
+        const DirectX::XMVECTOR xy = DirectX::XMVectorNegativeMultiplySubtract(signNotZero(encodedVector), t, encodedVector);
+
+        const DirectX::XMVECTOR vector = DirectX::XMVectorSelect(z, xy, DirectX::XMVectorSelectControl(1, 1, 0, 0));
+
+        return DirectX::XMVector3Normalize(vector);
+    }
+
+    void encode(const MeshData& meshData,
+                PackedMeshData& packedMeshData)
+    {
+        const size_t numVertices = meshData.mVertices.size();
+        packedMeshData.mVertices.resize(numVertices);
+        packedMeshData.mIndices = meshData.mIndices;
+        if(numVertices == 0) {
+            return;
+        }
+
+        // Bounding box
+        DirectX::XMVECTOR minPosition = DirectX::XMVectorReplicate(FLT_MAX);
+        DirectX::XMVECTOR maxPosition = DirectX::XMVectorReplicate(-FLT_MAX);
+        for(size_t i = 0; i < numVertices; ++i) {
+            const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&meshData.mVertices[i].mPosition);
+            minPosition = DirectX::XMVectorMin(minPosition, position);
+            maxPosition = DirectX::XMVectorMax(maxPosition, position);
+        }
+
+        const DirectX::XMVECTOR extent = DirectX::XMVectorSubtract(maxPosition, minPosition);
+        DirectX::XMStoreFloat3(&packedMeshData.mPositionOffset, minPosition);
+        DirectX::XMStoreFloat3(&packedMeshData.mPositionScale, extent);
+
+        // Flat dimensions (for example, the y of a grid) are encoded as 0.
+        const DirectX::XMVECTOR inverseExtent = DirectX::XMVectorSelect(DirectX::XMVectorReciprocal(extent),
+                                                                        DirectX::XMVectorZero(),
+                                                                        DirectX::XMVectorEqual(extent, DirectX::XMVectorZero()));
+
+        for(size_t i = 0; i < numVertices; ++i) {
+            const VertexData& vertex = meshData.mVertices[i];
+            PackedVertexData& packedVertex = packedMeshData.mVertices[i];
+
+            const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&vertex.mPosition);
+            const DirectX::XMVECTOR normalizedPosition = DirectX::XMVectorMultiply(DirectX::XMVectorSubtract(position, minPosition),
+                                                                                   inverseExtent);
+            DirectX::PackedVector::XMStoreUShortN4(&packedVertex.mPosition, normalizedPosition);
+
+            DirectX::PackedVector::XMStoreShortN2(&packedVertex.mNormal, encodeOctahedral(DirectX::XMLoadFloat3(&vertex.mNormal)));
+            DirectX::PackedVector::XMStoreShortN2(&packedVertex.mTangentU, encodeOctahedral(DirectX::XMLoadFloat3(&vertex.mTangentU)));
+        }
+
+        // Texture coordinates are converted as two strided streams.
+        DirectX::PackedVector::XMConvertFloatToHalfStream(&packedMeshData.mVertices[0].mTexCoord.x,
+                                                          sizeof(PackedVertexData),
+                                                          &meshData.mVertices[0].mTexCoord.x,
+                                                          sizeof(VertexData),
+                                                          numVertices);
+        DirectX::PackedVector::XMConvertFloatToHalfStream(&packedMeshData.mVertices[0].mTexCoord.y,
+                                                          sizeof(PackedVertexData),
+                                                          &meshData.mVertices[0].mTexCoord.y,
+                                                          sizeof(VertexData),
+                                                          numVertices);
+    }
+
+    void decode(const PackedMeshData& packedMeshData,
+                MeshData& meshData)
+    {
+        const size_t numVertices = packedMeshData.mVertices.size();
+        meshData.mVertices.resize(numVertices);
+        meshData.mIndices = packedMeshData.mIndices;
+        if(numVertices == 0) {
+            return;
+        }
+
+        const DirectX::XMVECTOR positionOffset = DirectX::XMLoadFloat3(&packedMeshData.mPositionOffset);
+        const DirectX::XMVECTOR positionScale = DirectX::XMLoadFloat3(&packedMeshData.mPositionScale);
+
+        for(size_t i = 0; i < numVertices; ++i) {
+            const PackedVertexData& packedVertex = packedMeshData.mVertices[i];
+            VertexData& vertex = meshData.mVertices[i];
+
+            const DirectX::XMVECTOR normalizedPosition = DirectX::PackedVector::XMLoadUShortN4(&packedVertex.mPosition);
+            DirectX::XMStoreFloat3(&vertex.mPosition, DirectX::XMVectorMultiplyAdd(normalizedPosition, positionScale, positionOffset));
+
+            DirectX::XMStoreFloat3(&vertex.mNormal, decodeOctahedral(DirectX::PackedVector::XMLoadShortN2(&packedVertex.mNormal)));
+            DirectX::XMStoreFloat3(&vertex.mTangentU, decodeOctahedral(DirectX::PackedVector::XMLoadShortN2(&packedVertex.mTangentU)));
+        }
+
+        DirectX::PackedVector::XMConvertHalfToFloatStream(&meshData.mVertices[0].mTexCoord.x,
+                                                          sizeof(VertexData),
+                                                          &packedMeshData.mVertices[0].mTexCoord.x,
+                                                          sizeof(PackedVertexData),
+                                                          numVertices);
+        DirectX::PackedVector::XMConvertHalfToFloatStream(&meshData.mVertices[0].mTexCoord.y,
+                                                          sizeof(VertexData),
+                                                          &packedMeshData.mVertices[0].mTexCoord.y,
+                                                          sizeof(PackedVertexData),
+                                                          numVertices);
+    }
+
+    PackedVertexErrors computeErrors(const MeshData& meshData,
+                                     const PackedMeshData& packedMeshData)
+    {
+        assert(meshData.mVertices.size() == packedMeshData.mVertices.size());
+
+        MeshData decodedMeshData;
+        decode(packedMeshData, decodedMeshData);
+
+        PackedVertexErrors errors;
+        for(size_t i = 0; i < meshData.mVertices.size(); ++i) {
+            const VertexData& vertex = meshData.mVertices[i];
+            const VertexData& decodedVertex = decodedMeshData.mVertices[i];
+
+            const DirectX::XMVECTOR positionDifference = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&vertex.mPosition),
+                                                                                   DirectX::XMLoadFloat3(&decodedVertex.mPosition));
+            errors.mPositionError = std::max(errors.mPositionError,
+                                             DirectX::XMVectorGetX(DirectX::XMVector3Length(positionDifference)));
+
+            errors.mNormalAngleError = std::max(errors.mNormalAngleError,
+                                                computeAngle(DirectX::XMLoadFloat3(&vertex.mNormal),
+                                                             DirectX::XMLoadFloat3(&decodedVertex.mNormal)));
+            errors.mTangentAngleError = std::max(errors.mTangentAngleError,
+                                                 computeAngle(DirectX::XMLoadFloat3(&vertex.mTangentU),
+                                                              DirectX::XMLoadFloat3(&decodedVertex.mTangentU)));
+
+            // NaN differences are ignored by std::max
+            errors.mTexCoordError = std::max(errors.mTexCoordError, fabsf(vertex.mTexCoord.x - decodedVertex.mTexCoord.x));
+            errors.mTexCoordError = std::max(errors.mTexCoordError, fabsf(vertex.mTexCoord.y - decodedVertex.mTexCoord.y));
+        }
+
+        return errors;
+    }
+}
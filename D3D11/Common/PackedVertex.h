@@ -0,0 +1,96 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Compact vertex format for MeshData.
+//
+// VertexData stores 11 floats (44 bytes). PackedVertexData stores
+// the same attributes in 20 bytes:
+// - Position: 16 bit unsigned normalized integers, relative to the
+//   mesh bounding box (DXGI_FORMAT_R16G16B16A16_UNORM, w is unused).
+// - Normal and tangent: octahedral encoding in 16 bit signed normalized
+//   integers (DXGI_FORMAT_R16G16_SNORM).
+// - Texture coordinates: half floats (DXGI_FORMAT_R16G16_FLOAT).
+//
+// Positions are decoded with PackedMeshData::mPositionOffset and
+// mPositionScale (usually folded into the world matrix). Normals
+// and tangents are decoded with the same octahedral decoding used by
+// decodeOctahedral, that is cheap to implement in a vertex shader.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <vector>
+
+struct MeshData;
+
+struct PackedVertexData
+{
+    DirectX::PackedVector::XMUSHORTN4 mPosition;
+    DirectX::PackedVector::XMSHORTN2 mNormal;
+    DirectX::PackedVector::XMSHORTN2 mTangentU;
+    DirectX::PackedVector::XMHALF2 mTexCoord;
+};
+
+struct PackedMeshData
+{
+    PackedMeshData()
+        : mPositionOffset(0.0f, 0.0f, 0.0f)
+        , mPositionScale(0.0f, 0.0f, 0.0f)
+    {
+
+    }
+
+    std::vector<PackedVertexData> mVertices;
+    std::vector<uint32_t> mIndices;
+
+    // position = mPositionOffset + decoded position * mPositionScale
+    DirectX::XMFLOAT3 mPositionOffset;
+    DirectX::XMFLOAT3 mPositionScale;
+};
+
+// Maximum error introduced by the encoding, per attribute.
+struct PackedVertexErrors
+{
+    PackedVertexErrors()
+        : mPositionError(0.0f)
+        , mNormalAngleError(0.0f)
+        , mTangentAngleError(0.0f)
+        , mTexCoordError(0.0f)
+    {
+
+    }
+
+    // Distance in object space units
+    float mPositionError;
+
+    // Angles in radians
+    float mNormalAngleError;
+    float mTangentAngleError;
+
+    // Absolute difference in texture space
+    float mTexCoordError;
+};
+
+namespace PackedVertexUtils
+{
+    // Maps a unit vector to a point in [-1, 1]^2 (x and y of the result).
+    // Zero or invalid vectors are mapped to (0, 0), that decodes to +z.
+    DirectX::XMVECTOR encodeOctahedral(DirectX::FXMVECTOR unitVector);
+
+    // Inverse of encodeOctahedral. The result has unit length.
+    DirectX::XMVECTOR decodeOctahedral(DirectX::FXMVECTOR encodedVector);
+
+    void encode(const MeshData& meshData,
+                PackedMeshData& packedMeshData);
+
+    void decode(const PackedMeshData& packedMeshData,
+                MeshData& meshData);
+
+    // Decodes packedMeshData and compares it against the
+    // mesh it was encoded from.
+    PackedVertexErrors computeErrors(const MeshData& meshData,
+                                     const PackedMeshData& packedMeshData);
+}
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Helpers to split loops across threads.
+//
+// Work is split in contiguous ranges, one per thread, so every
+// thread writes its own part of preallocated outputs and no
+// synchronization is needed besides waiting for the ranges. Ranges
+// run on the shared ThreadPool, so no threads are created per call.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+#include <ThreadPool.h>
+
+namespace ParallelUtils
+{
+    // Number of threads to use when 0 is requested.
+    inline uint32_t defaultThreadCount()
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return hardwareThreads > 0 ? hardwareThreads : 1;
+    }
+
+    // Calls function(rangeBegin, rangeEnd) for numThreads contiguous ranges
+    // covering [begin, end), on the threads of the shared thread pool (the
+    // calling thread included). numThreads = 0 uses defaultThreadCount().
+    // If the shared pool is in use (by another thread, or because this is
+    // called from a range), the calling thread processes the whole range.
+    template<typename Function>
+    void parallelFor(const uint32_t begin,
+                     const uint32_t end,
+                     const uint32_t numThreads,
+                     const Function& function)
+    {
+        if(begin >= end) {
+            return;
+        }
+
+        const uint32_t count = end - begin;
+        const uint32_t requestedThreads = numThreads == 0 ? defaultThreadCount() : numThreads;
+        // Parenthesized, as windows.h defines min and max macros.
+        const uint32_t threadCount = (std::min)(requestedThreads, count);
+        if(threadCount <= 1) {
+            function(begin, end);
+            return;
+        }
+
+        ThreadPool* threadPool = ThreadPoolUtils::acquireSharedThreadPool();
+        if(threadPool == nullptr) {
+            function(begin, end);
+            return;
+        }
+
+        // The first (count % threadCount) ranges get one more element.
+        const uint32_t rangeSize = count / threadCount;
+        const uint32_t remainder = count % threadCount;
+        ThreadPoolUtils::run(*threadPool, threadCount, [&function, begin, rangeSize, remainder](const uint32_t rangeIndex) {
+            const uint32_t rangeBegin = begin + rangeIndex * rangeSize + (std::min)(rangeIndex, remainder);
+            const uint32_t rangeEnd = rangeBegin + rangeSize + (rangeIndex < remainder ? 1 : 0);
+            function(rangeBegin, rangeEnd);
+        });
+
+        ThreadPoolUtils::releaseSharedThreadPool();
+    }
+}
@@ -0,0 +1,667 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Ring and row builders shared by the GeometryGenerator shapes
+// (MeshData, MeshStreams, parallel and MeshSink versions).
+//
+// Builders compute a vertex at a time and hand it to
+// vertexWriter(vertexIndex, vertex), so the same builders generate
+// into every destination, and writers that are inlined into them
+// store only what they need. Builders only compute the attributes in
+// their streamMask (MeshStream flags), the rest are left as they are
+// in the vertex. Every ring or row only writes its own vertices and
+// indices, so they can be computed in any order.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <DirectXMath.h>
+
+#include <GeometryGenerator.h>
+
+namespace ShapeBuilders
+{
+    // Corner (in half extents), normal, tangent and texture coordinates
+    // of the 4 vertices of every box face.
+    struct BoxVertex
+    {
+        float mCorner[3];
+        float mNormal[3];
+        float mTangentU[3];
+        float mTexCoord[2];
+    };
+
+    const BoxVertex sBoxVertices[] = {
+        // Front face
+        { { -1.0f, -1.0f, -1.0f }, {  0.0f,  0.0f, -1.0f }, {  1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+        { { -1.0f,  1.0f, -1.0f }, {  0.0f,  0.0f, -1.0f }, {  1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { {  1.0f,  1.0f, -1.0f }, {  0.0f,  0.0f, -1.0f }, {  1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+        { {  1.0f, -1.0f, -1.0f }, {  0.0f,  0.0f, -1.0f }, {  1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+
+        // Back face
+        { { -1.0f, -1.0f,  1.0f }, {  0.0f,  0.0f,  1.0f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+        { {  1.0f, -1.0f,  1.0f }, {  0.0f,  0.0f,  1.0f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+        { {  1.0f,  1.0f,  1.0f }, {  0.0f,  0.0f,  1.0f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { { -1.0f,  1.0f,  1.0f }, {  0.0f,  0.0f,  1.0f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+
+        // Top face
+        { { -1.0f,  1.0f, -1.0f }, {  0.0f,  1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+        { { -1.0f,  1.0f,  1.0f }, {  0.0f,  1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { {  1.0f,  1.0f,  1.0f }, {  0.0f,  1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+        { {  1.0f,  1.0f, -1.0f }, {  0.0f,  1.0f,  0.0f }, {  1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+
+        // Bottom face
+        { { -1.0f, -1.0f, -1.0f }, {  0.0f, -1.0f,  0.0f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 1.0f } },
+        { {  1.0f, -1.0f, -1.0f }, {  0.0f, -1.0f,  0.0f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 1.0f } },
+        { {  1.0f, -1.0f,  1.0f }, {  0.0f, -1.0f,  0.0f }, { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f } },
+        { { -1.0f, -1.0f,  1.0f }, {  0.0f, -1.0f,  0.0f }, { -1.0f,  0.0f,  0.0f }, { 1.0f, 0.0f } },
+
+        // Left face
+        { { -1.0f, -1.0f,  1.0f }, { -1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f, -1.0f }, { 0.0f, 1.0f } },
+        { { -1.0f,  1.0f,  1.0f }, { -1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f, -1.0f }, { 0.0f, 0.0f } },
+        { { -1.0f,  1.0f, -1.0f }, { -1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f, -1.0f }, { 1.0f, 0.0f } },
+        { { -1.0f, -1.0f, -1.0f }, { -1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f, -1.0f }, { 1.0f, 1.0f } },
+
+        // Right face
+        { {  1.0f, -1.0f, -1.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }, { 0.0f, 1.0f } },
+        { {  1.0f,  1.0f, -1.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }, { 0.0f, 0.0f } },
+        { {  1.0f,  1.0f,  1.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }, { 1.0f, 0.0f } },
+        { {  1.0f, -1.0f,  1.0f }, {  1.0f,  0.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }, { 1.0f, 1.0f } }
+    };
+
+    template<typename VertexWriter>
+    void buildBoxVertices(const float width,
+                          const float height, 
+                          const float depth,
+                          const uint32_t streamMask,
+                          const VertexWriter& vertexWriter)
+    {
+        const float halfWidth = 0.5f * width;
+        const float halfHeight = 0.5f * height;
+        const float halfDepth = 0.5f * depth;
+
+        VertexData vertex;
+        for(size_t vertexIndex = 0; vertexIndex < sizeof(sBoxVertices) / sizeof(sBoxVertices[0]); ++vertexIndex) {
+            const BoxVertex& boxVertex = sBoxVertices[vertexIndex];
+            vertex.mPosition = DirectX::XMFLOAT3(boxVertex.mCorner[0] * halfWidth,
+                                                 boxVertex.mCorner[1] * halfHeight,
+                                                 boxVertex.mCorner[2] * halfDepth);
+
+            if(streamMask & MeshStream::NORMAL) {
+                vertex.mNormal = DirectX::XMFLOAT3(boxVertex.mNormal[0], boxVertex.mNormal[1], boxVertex.mNormal[2]);
+            }
+
+            if(streamMask & MeshStream::TANGENT_U) {
+                vertex.mTangentU = DirectX::XMFLOAT3(boxVertex.mTangentU[0], boxVertex.mTangentU[1], boxVertex.mTangentU[2]);
+            }
+
+            if(streamMask & MeshStream::TEXCOORD) {
+                vertex.mTexCoord = DirectX::XMFLOAT2(boxVertex.mTexCoord[0], boxVertex.mTexCoord[1]);
+            }
+
+            vertexWriter(vertexIndex, vertex);
+        }
+    }
+
+    inline void buildBoxIndices(uint32_t* indices)
+    {
+        // Fill in the front face index data
+        indices[0] = 0; indices[1] = 1; indices[2] = 2;
+        indices[3] = 0; indices[4] = 2; indices[5] = 3;
+
+        // Fill in the back face index data
+        indices[6] = 4; indices[7]  = 5; indices[8]  = 6;
+        indices[9] = 4; indices[10] = 6; indices[11] = 7;
+
+        // Fill in the top face index data
+        indices[12] = 8; indices[13] =  9; indices[14] = 10;
+        indices[15] = 8; indices[16] = 10; indices[17] = 11;
+
+        // Fill in the bottom face index data
+        indices[18] = 12; indices[19] = 13; indices[20] = 14;
+        indices[21] = 12; indices[22] = 14; indices[23] = 15;
+
+        // Fill in the left face index data
+        indices[24] = 16; indices[25] = 17; indices[26] = 18;
+        indices[27] = 16; indices[28] = 18; indices[29] = 19;
+
+        // Fill in the right face index data
+        indices[30] = 20; indices[31] = 21; indices[32] = 22;
+        indices[33] = 20; indices[34] = 22; indices[35] = 23;
+    }
+
+    inline uint32_t sphereVertexCount(const uint32_t sliceCount, 
+                                      const uint32_t stackCount)
+    {
+        // Poles plus a ring per inner stack boundary.
+        // Rings duplicate their first vertex.
+        return 2 + (stackCount - 1) * (sliceCount + 1);
+    }
+
+    inline uint32_t sphereIndexCount(const uint32_t sliceCount, 
+                                     const uint32_t stackCount)
+    {
+        // Pole stacks have a triangle per slice and inner stacks two.
+        return 2 * 3 * sliceCount + (stackCount - 2) * 6 * sliceCount;
+    }
+
+    // Vertices of the ring at the bottom of stack stackIndex, 
+    // in [1, stackCount - 1], from vertex firstVertex.
+    template<typename VertexWriter>
+    void buildSphereRing(const float radius, 
+                         const uint32_t sliceCount, 
+                         const float phiStep,
+                         const float thetaStep,
+                         const size_t stackIndex,
+                         const uint32_t streamMask,
+                         const size_t firstVertex,
+                         const VertexWriter& vertexWriter)
+    {
+        const float phi = stackIndex * phiStep;
+
+        VertexData vertex;
+        DirectX::XMVECTOR tangentU;
+        DirectX::XMVECTOR position;
+        for(size_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
+            const float theta = sliceIndex * thetaStep;
+
+            // spherical to cartesian
+            vertex.mPosition.x = radius * sinf(phi) * cosf(theta);
+            vertex.mPosition.y = radius * cosf(phi);
+            vertex.mPosition.z = radius * sinf(phi) * sinf(theta);
+
+            if(streamMask & MeshStream::TANGENT_U) {
+                // Partial derivative of P with respect to theta
+                vertex.mTangentU.x = -radius * sinf(phi) * sinf(theta);
+                vertex.mTangentU.y = 0.0f;
+                vertex.mTangentU.z = +radius * sinf(phi) * cosf(theta);
+
+                tangentU = DirectX::XMLoadFloat3(&vertex.mTangentU);
+                DirectX::XMStoreFloat3(&vertex.mTangentU, DirectX::XMVector3Normalize(tangentU));
+            }
+
+            if(streamMask & MeshStream::NORMAL) {
+                position = DirectX::XMLoadFloat3(&vertex.mPosition);
+                DirectX::XMStoreFloat3(&vertex.mNormal, DirectX::XMVector3Normalize(position));
+            }
+
+            if(streamMask & MeshStream::TEXCOORD) {
+                vertex.mTexCoord.x = theta / DirectX::XM_2PI;
+                vertex.mTexCoord.y = phi / DirectX::XM_PI;
+            }
+
+            vertexWriter(firstVertex + sliceIndex, vertex);
+        }
+    }
+
+    // Indices of inner stack stackIndex (not connected to poles), 
+    // in [0, stackCount - 3].
+    inline void buildSphereStackIndices(const uint32_t sliceCount, 
+                                        const uint32_t stackIndex,
+                                        uint32_t* indices)
+    {
+        // Offset the indices to the index of the first vertex in the first ring.
+        // This is just skipping the top pole vertex.
+        const uint32_t baseIndex = 1;
+        const uint32_t ringVertexCount = sliceCount + 1;
+        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
+            indices[0] = baseIndex + stackIndex * ringVertexCount + sliceIndex;
+            indices[1] = baseIndex + stackIndex * ringVertexCount + sliceIndex + 1;
+            indices[2] = baseIndex + (stackIndex + 1) * ringVertexCount + sliceIndex;
+
+            indices[3] = baseIndex + (stackIndex + 1) * ringVertexCount + sliceIndex;
+            indices[4] = baseIndex + stackIndex * ringVertexCount + sliceIndex + 1;
+            indices[5] = baseIndex + (stackIndex + 1) * ringVertexCount + sliceIndex + 1;
+
+            indices += 6;
+        }
+    }
+
+    // Pole vertices, that are the first and the last ones
+    // of the vertexCount vertices.
+    template<typename VertexWriter>
+    void buildSpherePoleVertices(const float radius, 
+                                 const uint32_t vertexCount,
+                                 const VertexWriter& vertexWriter)
+    {
+        // Poles: note that there will be texture coordinate distortion as there is
+        // not a unique point on the texture map to assign to the pole when mapping
+        // a rectangular texture onto a sphere.
+        vertexWriter(0, VertexData(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+        vertexWriter(vertexCount - 1, VertexData(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    }
+
+    // Indices of the pole stacks, that are the first and the last ones 
+    // of the indexCount indices.
+    inline void buildSpherePoleIndices(const uint32_t sliceCount, 
+                                       const uint32_t vertexCount,
+                                       const uint32_t indexCount,
+                                       uint32_t* indices)
+    {
+        // Compute indices for top stack.  The top stack was written first to the vertex buffer
+        // and connects the top pole to the first ring.
+        uint32_t* stackIndices = indices;
+        for(uint32_t sliceIndex = 1; sliceIndex <= sliceCount; ++sliceIndex) {
+            stackIndices[0] = 0;
+            stackIndices[1] = sliceIndex + 1;
+            stackIndices[2] = sliceIndex;
+
+            stackIndices += 3;
+        }
+
+        // Compute indices for bottom stack. The bottom stack was written last to the vertex buffer
+        // and connects the bottom pole to the bottom ring.
+        // South pole vertex was added last.
+        const uint32_t southPoleIndex = vertexCount - 1;
+
+        // Offset the indices to the index of the first vertex in the last ring.
+        const uint32_t baseIndex = southPoleIndex - (sliceCount + 1);
+
+        stackIndices = indices + indexCount - 3 * sliceCount;
+        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
+            stackIndices[0] = southPoleIndex;
+            stackIndices[1] = baseIndex + sliceIndex;
+            stackIndices[2] = baseIndex + sliceIndex + 1;
+
+            stackIndices += 3;
+        }
+    }
+
+    // Vertices and indices (if indices is not nullptr) of generateSphere.
+    template<typename VertexWriter>
+    void buildSphere(const float radius,
+                     const uint32_t sliceCount,
+                     const uint32_t stackCount,
+                     const uint32_t streamMask,
+                     const VertexWriter& vertexWriter,
+                     uint32_t* indices)
+    {
+        const float phiStep = DirectX::XM_PI / stackCount;
+        const float thetaStep = 2.0f * DirectX::XM_PI / sliceCount;
+
+        // Compute the vertices starting at the top pole and moving down the stacks.
+        // Compute vertices for each stack ring (do not count the poles as rings).
+        const uint32_t ringVertexCount = sliceCount + 1;
+        for(uint32_t stackIndex = 1; stackIndex <= stackCount - 1; ++stackIndex) {
+            buildSphereRing(radius, 
+                            sliceCount, 
+                            phiStep, 
+                            thetaStep, 
+                            stackIndex, 
+                            streamMask,
+                            1 + (stackIndex - 1) * ringVertexCount,
+                            vertexWriter);
+        }
+
+        const uint32_t vertexCount = sphereVertexCount(sliceCount, stackCount);
+        buildSpherePoleVertices(radius, vertexCount, vertexWriter);
+
+        if(indices == nullptr) {
+            return;
+        }
+
+        // Compute indices for inner stacks (not connected to poles).
+        // They are after the top stack indices.
+        for(uint32_t stackIndex = 0; stackIndex < stackCount - 2; ++stackIndex) {
+            buildSphereStackIndices(sliceCount, 
+                                    stackIndex, 
+                                    indices + 3 * sliceCount + stackIndex * 6 * sliceCount);
+        }
+
+        buildSpherePoleIndices(sliceCount, vertexCount, sphereIndexCount(sliceCount, stackCount), indices);
+    }
+
+    inline uint32_t cylinderVertexCount(const uint32_t sliceCount,
+                                        const uint32_t stackCount)
+    {
+        // Rings of the stacks plus a ring and a center vertex per cap.
+        const uint32_t ringVertexCount = sliceCount + 1;
+        return (stackCount + 1) * ringVertexCount + 2 * (ringVertexCount + 1);
+    }
+
+    inline uint32_t cylinderIndexCount(const uint32_t sliceCount,
+                                       const uint32_t stackCount)
+    {
+        // Two triangles per stack slice and one per cap slice.
+        return 6 * stackCount * sliceCount + 2 * 3 * sliceCount;
+    }
+
+    // Vertices of cylinder ring ringIndex, in [0, stackCount], 
+    // starting at the bottom and moving up, from vertex firstVertex.
+    template<typename VertexWriter>
+    void buildCylinderRing(const float bottomRadius, 
+                           const float topRadius, 
+                           const float height, 
+                           const uint32_t sliceCount, 
+                           const uint32_t stackCount,
+                           const size_t ringIndex,
+                           const uint32_t streamMask,
+                           const size_t firstVertex,
+                           const VertexWriter& vertexWriter)
+    {
+        const float stackHeight = height / stackCount;
+
+        // Amount to increment radius as we move up each stack level from bottom to top.
+        const float radiusStep = (topRadius - bottomRadius) / stackCount;
+
+        const float y = -0.5f * height + ringIndex * stackHeight;
+        const float r = bottomRadius + ringIndex * radiusStep;
+
+        VertexData vertex;
+        DirectX::XMVECTOR tangentU;
+        DirectX::XMVECTOR biTangentU;
+        DirectX::XMVECTOR normal;
+        DirectX::XMFLOAT3 bitangent;
+        const float dTheta = 2.0f * DirectX::XM_PI / sliceCount;		
+        for(size_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
+            const float c = cosf(sliceIndex * dTheta);
+            const float s = sinf(sliceIndex * dTheta);
+
+            vertex.mPosition = DirectX::XMFLOAT3(r * c, y, r * s);
+
+            if(streamMask & MeshStream::TEXCOORD) {
+                vertex.mTexCoord.x = static_cast<float> (sliceIndex) / sliceCount;
+                vertex.mTexCoord.y = 1.0f - static_cast<float> (ringIndex) / stackCount;
+            }
+
+            // Cylinder can be parameterized as follows, where we introduce v
+            // parameter that goes in the same direction as the v tex-coord
+            // so that the bitangent goes in the same direction as the v tex-coord.
+            //   Let r0 be the bottom radius and let r1 be the top radius.
+            //   y(v) = h - hv for v in [0,1].
+            //   r(v) = r1 + (r0-r1)v
+            // 
+            //   x(t, v) = r(v)*cos(t)
+            //   y(t, v) = h - hv
+            //   z(t, v) = r(v)*sin(t)
+            // 
+            //  dx/dt = -r(v)*sin(t)
+            //  dy/dt = 0
+            //  dz/dt = +r(v)*cos(t)
+            // 
+            //  dx/dv = (r0-r1)*cos(t)
+            //  dy/dv = -h
+            //  dz/dv = (r0-r1)*sin(t)
+
+            // This is unit length.
+            vertex.mTangentU = DirectX::XMFLOAT3(-s, 0.0f, c);
+
+            if(streamMask & MeshStream::NORMAL) {
+                const float dr = bottomRadius - topRadius;
+                bitangent = DirectX::XMFLOAT3(dr * c, -height, dr * s);
+
+                tangentU = DirectX::XMLoadFloat3(&vertex.mTangentU);
+                biTangentU = DirectX::XMLoadFloat3(&bitangent);
+                normal = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(tangentU, biTangentU));
+                DirectX::XMStoreFloat3(&vertex.mNormal, normal);
+            }
+
+            vertexWriter(firstVertex + sliceIndex, vertex);
+        }
+    }
+
+    // Indices of cylinder stack stackIndex, in [0, stackCount - 1].
+    inline void buildCylinderStackIndices(const uint32_t sliceCount, 
+                                          const uint32_t stackIndex,
+                                          uint32_t* indices)
+    {
+        // Add one because we duplicate the first and last vertex per ring
+        // since the texture coordinates are different.
+        const uint32_t ringVertexCount = sliceCount + 1;
+        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
+            indices[0] = stackIndex * ringVertexCount + sliceIndex;
+            indices[1] = (stackIndex + 1) * ringVertexCount + sliceIndex;
+            indices[2] = (stackIndex + 1) * ringVertexCount + sliceIndex + 1;
+
+            indices[3] = stackIndex * ringVertexCount + sliceIndex;
+            indices[4] = (stackIndex + 1) * ringVertexCount + sliceIndex + 1;
+            indices[5] = stackIndex * ringVertexCount + sliceIndex + 1;
+
+            indices += 6;
+        }
+    }
+
+    // Cap ring plus its center vertex, from vertex firstVertex, and its
+    // indices (if indices is not nullptr). normalY is +1 for the top cap
+    // and -1 for the bottom one, that is wound the other way.
+    template<typename VertexWriter>
+    void buildCylinderCap(const float radius,
+                          const float y,
+                          const float normalY,
+                          const float height, 
+                          const uint32_t sliceCount, 
+                          const uint32_t firstVertex,
+                          const VertexWriter& vertexWriter,
+                          uint32_t* indices)
+    {
+        const float dTheta = 2.0f * DirectX::XM_PI / sliceCount;		
+
+        // Duplicate cap ring vertices because the texture coordinates and normals differ.
+        for(uint32_t sliceIndex = 0; sliceIndex <= sliceCount; ++sliceIndex) {
+            const float x = radius * cosf(sliceIndex * dTheta);
+            const float z = radius * sinf(sliceIndex * dTheta);
+
+            // Scale down by the height to try and make top cap texture coord area
+            // proportional to base.
+            const float u = x / height + 0.5f;
+            const float v = z / height + 0.5f;
+
+            vertexWriter(firstVertex + sliceIndex, VertexData(x, y, z, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+        }
+
+        // Cap center vertex.
+        const uint32_t centerIndex = firstVertex + sliceCount + 1;
+        vertexWriter(centerIndex, VertexData(0.0f, y, 0.0f, 0.0f, normalY, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+        if(indices == nullptr) {
+            return;
+        }
+
+        for(uint32_t sliceIndex = 0; sliceIndex < sliceCount; ++sliceIndex) {
+            indices[0] = centerIndex;
+            if(normalY > 0.0f) {
+                indices[1] = firstVertex + sliceIndex + 1;
+                indices[2] = firstVertex + sliceIndex;
+            } else {
+                indices[1] = firstVertex + sliceIndex;
+                indices[2] = firstVertex + sliceIndex + 1;
+            }
+
+            indices += 3;
+        }
+    }
+
+    // Both caps, that are after the stack rings and the stack indices.
+    template<typename VertexWriter>
+    void buildCylinderCaps(const float bottomRadius,
+                           const float topRadius, 
+                           const float height, 
+                           const uint32_t sliceCount, 
+                           const uint32_t stackCount,
+                           const VertexWriter& vertexWriter,
+                           uint32_t* indices)
+    {
+        const uint32_t ringVertexCount = sliceCount + 1;
+        const uint32_t topCapFirstVertex = (stackCount + 1) * ringVertexCount;
+        const uint32_t bottomCapFirstVertex = topCapFirstVertex + ringVertexCount + 1;
+        uint32_t* const topCapIndices = indices != nullptr ? indices + 6 * stackCount * sliceCount : nullptr;
+        uint32_t* const bottomCapIndices = indices != nullptr ? topCapIndices + 3 * sliceCount : nullptr;
+
+        buildCylinderCap(topRadius,
+                         0.5f * height,
+                         1.0f,
+                         height,
+                         sliceCount,
+                         topCapFirstVertex,
+                         vertexWriter,
+                         topCapIndices);
+
+        buildCylinderCap(bottomRadius,
+                         -0.5f * height,
+                         -1.0f,
+                         height,
+                         sliceCount,
+                         bottomCapFirstVertex,
+                         vertexWriter,
+                         bottomCapIndices);
+    }
+
+    // Vertices and indices (if indices is not nullptr) of generateCylinder.
+    template<typename VertexWriter>
+    void buildCylinder(const float bottomRadius,
+                       const float topRadius,
+                       const float height,
+                       const uint32_t sliceCount,
+                       const uint32_t stackCount,
+                       const uint32_t streamMask,
+                       const VertexWriter& vertexWriter,
+                       uint32_t* indices)
+    {
+        // Compute vertices for each stack ring starting at the bottom and moving up.
+        const uint32_t ringCount = stackCount + 1;
+        const uint32_t ringVertexCount = sliceCount + 1;
+        for(uint32_t ringIndex = 0; ringIndex < ringCount; ++ringIndex) {
+            buildCylinderRing(bottomRadius, 
+                              topRadius, 
+                              height, 
+                              sliceCount, 
+                              stackCount, 
+                              ringIndex, 
+                              streamMask,
+                              ringIndex * ringVertexCount,
+                              vertexWriter);
+        }
+
+        // Compute indices for each stack.
+        if(indices != nullptr) {
+            for(uint32_t stackIndex = 0; stackIndex < stackCount; ++stackIndex) {
+                buildCylinderStackIndices(sliceCount, 
+                                          stackIndex, 
+                                          indices + stackIndex * 6 * sliceCount);
+            }
+        }
+
+        buildCylinderCaps(bottomRadius,
+                          topRadius,
+                          height,
+                          sliceCount,
+                          stackCount,
+                          vertexWriter,
+                          indices);
+    }
+
+    // Vertices of grid row vertexPerRowIndex, in [0, numRows],
+    // from vertex firstVertex.
+    template<typename VertexWriter>
+    void buildGridRow(const float width, 
+                      const float depth, 
+                      const uint32_t numRows, 
+                      const uint32_t numColumns, 
+                      const size_t vertexPerRowIndex,
+                      const uint32_t streamMask,
+                      const size_t firstVertex,
+                      const VertexWriter& vertexWriter)
+    {
+        const uint32_t vexterPerColumn = numColumns + 1;
+        const uint32_t vexterPerRow = numRows + 1;
+
+        const float halfWidth = 0.5f * width;
+        const float halfDepth = 0.5f * depth;
+
+        const float dx = width / (vexterPerColumn);
+        const float dz = depth / (vexterPerRow);
+
+        const float du = 1.0f / (vexterPerColumn);
+        const float dv = 1.0f / (vexterPerRow);
+
+        // Every grid attribute but positions and texture coordinates is constant.
+        VertexData vertex;
+        if(streamMask & MeshStream::NORMAL) {
+            vertex.mNormal = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
+        }
+
+        if(streamMask & MeshStream::TANGENT_U) {
+            vertex.mTangentU = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+        }
+
+        const float z = halfDepth - vertexPerRowIndex * dz;
+        for(size_t vertexPerColumnIndex = 0; 
+                   vertexPerColumnIndex < vexterPerColumn; 
+                   ++vertexPerColumnIndex) {
+            const float x = -halfWidth + vertexPerColumnIndex * dx;
+            vertex.mPosition = DirectX::XMFLOAT3(x, 0.0f, z);
+
+            // Stretch texture over grid.
+            if(streamMask & MeshStream::TEXCOORD) {
+                vertex.mTexCoord.x = vertexPerColumnIndex * du;
+                vertex.mTexCoord.y = vertexPerRowIndex * dv;
+            }
+
+            vertexWriter(firstVertex + vertexPerColumnIndex, vertex);
+        }
+    }
+
+    // Indices of the quads between grid rows vertexPerRowIndex 
+    // and vertexPerRowIndex + 1, in [0, numRows - 1].
+    inline void buildGridRowIndices(const uint32_t numColumns, 
+                                    const uint32_t vertexPerRowIndex,
+                                    uint32_t* indices)
+    {
+        const uint32_t vexterPerColumn = numColumns + 1;
+        for(uint32_t vertexPerColumnIndex = 0; 
+                     vertexPerColumnIndex < vexterPerColumn - 1; 
+                     ++vertexPerColumnIndex) {
+            indices[0] = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex;
+            indices[1] = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex + 1;
+            indices[2] = (vertexPerRowIndex + 1) * vexterPerColumn + vertexPerColumnIndex;
+
+            indices[3] = (vertexPerRowIndex + 1) * vexterPerColumn + vertexPerColumnIndex;
+            indices[4] = vertexPerRowIndex * vexterPerColumn + vertexPerColumnIndex + 1;
+            indices[5] = (vertexPerRowIndex + 1) * vexterPerColumn + vertexPerColumnIndex + 1;
+
+            indices += 6; // next quad
+        }
+    }
+
+    // Vertices and indices (if indices is not nullptr) of generateGrid.
+    template<typename VertexWriter>
+    void buildGrid(const float width,
+                   const float depth,
+                   const uint32_t numRows,
+                   const uint32_t numColumns,
+                   const uint32_t streamMask,
+                   const VertexWriter& vertexWriter,
+                   uint32_t* indices)
+    {
+        // Create the vertices.
+        const uint32_t vexterPerColumn = numColumns + 1;
+        for(uint32_t vertexPerRowIndex = 0; 
+                     vertexPerRowIndex <= numRows; 
+                     ++vertexPerRowIndex) {
+            buildGridRow(width, 
+                         depth, 
+                         numRows, 
+                         numColumns, 
+                         vertexPerRowIndex, 
+                         streamMask,
+                         vertexPerRowIndex * vexterPerColumn,
+                         vertexWriter);
+        }
+
+        if(indices == nullptr) {
+            return;
+        }
+
+        // Create the indices. Each row of quads has 6 indices per quad.
+        for(uint32_t vertexPerRowIndex = 0; 
+                     vertexPerRowIndex < numRows; 
+                     ++vertexPerRowIndex) {
+            buildGridRowIndices(numColumns, 
+                                vertexPerRowIndex, 
+                                indices + vertexPerRowIndex * 6 * numColumns);
+        }
+    }
+}
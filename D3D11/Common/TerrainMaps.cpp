@@ -0,0 +1,431 @@
+#include "TerrainMaps.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <d3d11.h>
+#include <fstream>
+#include <windows.h>
+
+#include <DxErrorChecker.h>
+#include <HalfConversion.h>
+#include <HeightMap.h>
+#include <ParallelUtils.h>
+
+namespace
+{
+    // "TMAP"
+    const uint32_t sMagic = 0x50414D54;
+
+    // Increment it every time the file layout or the encoding changes.
+    const uint32_t sVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        uint64_t mKey;
+
+        uint32_t mDimension;
+        float mCellSpacing;
+        uint32_t mGradientOperator;
+        uint32_t mReserved;
+    };
+
+    // Texels baked at a time
+    const uint32_t sBlockSize = 4;
+
+    // Largest value of a SNORM16 channel
+    const float sSnorm16Scale = 32767.0f;
+
+    uint64_t hashWord(const uint64_t hash,
+                      const uint32_t word)
+    {
+        // 64 bits FNV-1a, a 32 bits word at a time
+        const uint64_t prime = 1099511628211ULL;
+        return (hash ^ word) * prime;
+    }
+
+    // Copies a height map row with its first and last texels repeated
+    // once before and after it, and padding so the last block of columns
+    // can be loaded as a whole.
+    void copyPaddedRow(const HeightMap& heightMap,
+                       const uint32_t row,
+                       std::vector<float>& paddedRow)
+    {
+        const uint32_t dimension = heightMap.mDimension;
+        const float* heights = &heightMap.mData[row * dimension];
+        paddedRow[0] = heights[0];
+        std::copy(heights, heights + dimension, paddedRow.begin() + 1);
+        std::fill(paddedRow.begin() + dimension + 1, paddedRow.end(), heights[dimension - 1]);
+    }
+
+    DirectX::XMVECTOR loadFloat4(const float* values)
+    {
+        return DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (values));
+    }
+
+    // Stores (a0, b0, a1, b1, a2, b2, a3, b3)
+    void storeInterleaved(DirectX::FXMVECTOR a,
+                          DirectX::FXMVECTOR b,
+                          float* values)
+    {
+        DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (values), DirectX::XMVectorMergeXY(a, b));
+        DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (values + 4), DirectX::XMVectorMergeZW(a, b));
+    }
+
+    void bakeRows(const HeightMap& heightMap,
+                  const uint32_t fromRow,
+                  const uint32_t toRow,
+                  TerrainMaps& terrainMaps)
+    {
+        const uint32_t dimension = heightMap.mDimension;
+
+        // Rows above, at and below the baked one
+        std::vector<float> previousRow(dimension + sBlockSize + 1);
+        std::vector<float> currentRow(previousRow.size());
+        std::vector<float> nextRow(previousRow.size());
+
+        // Interleaved channels of the baked row, with room for its last block
+        std::vector<float> normals(2 * (dimension + sBlockSize));
+        std::vector<float> slopeCurvature(normals.size());
+
+        // Sobel sums 4 central differences with weights 1, 2, 1.
+        const bool sobel = terrainMaps.mGradientOperator == GradientOperator::SOBEL;
+        const float inverseCellSpacing = 1.0f / terrainMaps.mCellSpacing;
+        const float gradientScale = (sobel ? 0.125f : 0.5f) * inverseCellSpacing;
+        const float curvatureScale = inverseCellSpacing * inverseCellSpacing;
+
+        const DirectX::XMVECTOR two = DirectX::XMVectorReplicate(2.0f);
+        const DirectX::XMVECTOR four = DirectX::XMVectorReplicate(4.0f);
+
+        for(uint32_t row = fromRow; row < toRow; ++row) {
+            copyPaddedRow(heightMap, row == 0 ? 0 : row - 1, previousRow);
+            copyPaddedRow(heightMap, row, currentRow);
+            copyPaddedRow(heightMap, (std::min)(row + 1, dimension - 1), nextRow);
+
+            for(uint32_t column = 0; column < dimension; column += sBlockSize) {
+                // Padded rows are shifted one texel to the right.
+                const DirectX::XMVECTOR left = loadFloat4(&currentRow[column]);
+                const DirectX::XMVECTOR center = loadFloat4(&currentRow[column + 1]);
+                const DirectX::XMVECTOR right = loadFloat4(&currentRow[column + 2]);
+                const DirectX::XMVECTOR top = loadFloat4(&previousRow[column + 1]);
+                const DirectX::XMVECTOR bottom = loadFloat4(&nextRow[column + 1]);
+
+                DirectX::XMVECTOR heightDu;
+                DirectX::XMVECTOR heightDv;
+                if(sobel) {
+                    const DirectX::XMVECTOR topLeft = loadFloat4(&previousRow[column]);
+                    const DirectX::XMVECTOR topRight = loadFloat4(&previousRow[column + 2]);
+                    const DirectX::XMVECTOR bottomLeft = loadFloat4(&nextRow[column]);
+                    const DirectX::XMVECTOR bottomRight = loadFloat4(&nextRow[column + 2]);
+
+                    heightDu = DirectX::XMVectorSubtract(DirectX::XMVectorMultiplyAdd(two, right, DirectX::XMVectorAdd(topRight, bottomRight)),
+                                                         DirectX::XMVectorMultiplyAdd(two, left, DirectX::XMVectorAdd(topLeft, bottomLeft)));
+                    heightDv = DirectX::XMVectorSubtract(DirectX::XMVectorMultiplyAdd(two, bottom, DirectX::XMVectorAdd(bottomLeft, bottomRight)),
+                                                         DirectX::XMVectorMultiplyAdd(two, top, DirectX::XMVectorAdd(topLeft, topRight)));
+                } else {
+                    heightDu = DirectX::XMVectorSubtract(right, left);
+                    heightDv = DirectX::XMVectorSubtract(bottom, top);
+                }
+
+                // Height change per world unit along x and z
+                const DirectX::XMVECTOR gradientX = DirectX::XMVectorScale(heightDu, gradientScale);
+                const DirectX::XMVECTOR gradientZ = DirectX::XMVectorScale(heightDv, gradientScale);
+
+                const DirectX::XMVECTOR slope = DirectX::XMVectorSqrt(DirectX::XMVectorMultiplyAdd(gradientX,
+                                                                                                   gradientX,
+                                                                                                   DirectX::XMVectorMultiply(gradientZ, gradientZ)));
+                const DirectX::XMVECTOR neighborsSum = DirectX::XMVectorAdd(DirectX::XMVectorAdd(left, right),
+                                                                            DirectX::XMVectorAdd(top, bottom));
+                const DirectX::XMVECTOR curvature = DirectX::XMVectorScale(DirectX::XMVectorNegativeMultiplySubtract(four, center, neighborsSum),
+                                                                           curvatureScale);
+                storeInterleaved(slope, curvature, &slopeCurvature[2 * column]);
+
+                // The normal (-gradientX, 1, -gradientZ) is always in the upper
+                // hemisphere, so its octahedral encoding is just its x and z
+                // divided by |x| + |y| + |z|, with no folding.
+                const DirectX::XMVECTOR manhattanLength = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMVectorAbs(gradientX),
+                                                                                                    DirectX::XMVectorAbs(gradientZ)),
+                                                                               DirectX::XMVectorSplatOne());
+                const DirectX::XMVECTOR encodingScale = DirectX::XMVectorDivide(DirectX::XMVectorReplicate(-sSnorm16Scale), manhattanLength);
+                storeInterleaved(DirectX::XMVectorRound(DirectX::XMVectorMultiply(gradientX, encodingScale)),
+                                 DirectX::XMVectorRound(DirectX::XMVectorMultiply(gradientZ, encodingScale)),
+                                 &normals[2 * column]);
+            }
+
+            const uint32_t rowChannels = 2 * dimension;
+            int16_t* rowNormals = &terrainMaps.mNormals[row * rowChannels];
+            for(uint32_t i = 0; i < rowChannels; ++i) {
+                rowNormals[i] = static_cast<int16_t> (normals[i]);
+            }
+
+            HalfConversionUtils::convertFloatToHalf(&slopeCurvature[0],
+                                                    rowChannels,
+                                                    &terrainMaps.mSlopeCurvature[row * rowChannels],
+                                                    1);
+        }
+    }
+
+    ID3D11ShaderResourceView* buildTexture2DSRV(ID3D11Device& device,
+                                                const uint32_t dimension,
+                                                const DXGI_FORMAT format,
+                                                const void* data,
+                                                const uint32_t texelSize)
+    {
+        D3D11_TEXTURE2D_DESC texture2DDesc;
+        texture2DDesc.Width = dimension;
+        texture2DDesc.Height = dimension;
+        texture2DDesc.MipLevels = 1;
+        texture2DDesc.ArraySize = 1;
+        texture2DDesc.Format = format;
+        texture2DDesc.SampleDesc.Count = 1;
+        texture2DDesc.SampleDesc.Quality = 0;
+        texture2DDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        texture2DDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        texture2DDesc.CPUAccessFlags = 0;
+        texture2DDesc.MiscFlags = 0;
+
+        D3D11_SUBRESOURCE_DATA subResourceData;
+        subResourceData.pSysMem = data;
+        subResourceData.SysMemPitch = dimension * texelSize;
+        subResourceData.SysMemSlicePitch = 0;
+
+        ID3D11Texture2D* texture;
+        HRESULT result = device.CreateTexture2D(&texture2DDesc,
+                                                &subResourceData,
+                                                &texture);
+        DxErrorChecker(result);
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        srvDesc.Format = format;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MostDetailedMip = 0;
+        srvDesc.Texture2D.MipLevels = 1;
+        ID3D11ShaderResourceView* srv;
+        result = device.CreateShaderResourceView(texture,
+                                                 &srvDesc,
+                                                 &srv);
+        DxErrorChecker(result);
+
+        // SRV saves reference.
+        texture->Release();
+
+        return srv;
+    }
+}
+
+namespace TerrainMapsUtils
+{
+    uint64_t computeKey(const HeightMap& heightMap,
+                        const float cellSpacing,
+                        const GradientOperator gradientOperator)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        hash = hashWord(hash, heightMap.mDimension);
+        for(size_t i = 0; i < heightMap.mData.size(); ++i) {
+            uint32_t heightBits;
+            memcpy(&heightBits, &heightMap.mData[i], sizeof(heightBits));
+            hash = hashWord(hash, heightBits);
+        }
+
+        uint32_t cellSpacingBits;
+        memcpy(&cellSpacingBits, &cellSpacing, sizeof(cellSpacingBits));
+        hash = hashWord(hash, cellSpacingBits);
+        hash = hashWord(hash, static_cast<uint32_t> (gradientOperator));
+
+        return hash;
+    }
+
+    void bake(const HeightMap& heightMap,
+              const float cellSpacing,
+              const GradientOperator gradientOperator,
+              TerrainMaps& terrainMaps,
+              const uint32_t numThreads)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+        assert(heightMap.mDimension > 0);
+        assert(cellSpacing > 0.0f);
+
+        const uint32_t dimension = heightMap.mDimension;
+        terrainMaps.mDimension = dimension;
+        terrainMaps.mCellSpacing = cellSpacing;
+        terrainMaps.mGradientOperator = gradientOperator;
+        terrainMaps.mKey = computeKey(heightMap, cellSpacing, gradientOperator);
+        terrainMaps.mNormals.resize(2 * dimension * dimension);
+        terrainMaps.mSlopeCurvature.resize(2 * dimension * dimension);
+
+        ParallelUtils::parallelFor(0, dimension, numThreads, [&heightMap, &terrainMaps](const uint32_t fromRow, const uint32_t toRow) {
+            bakeRows(heightMap, fromRow, toRow, terrainMaps);
+        });
+    }
+
+    DirectX::XMFLOAT3 decodeNormal(const int16_t x,
+                                   const int16_t z)
+    {
+        // -32768 is also -1.
+        float normalX = (std::max)(x / sSnorm16Scale, -1.0f);
+        float normalZ = (std::max)(z / sSnorm16Scale, -1.0f);
+        const float normalY = 1.0f - fabsf(normalX) - fabsf(normalZ);
+
+        // Lower hemisphere normals are folded over the diagonals.
+        if(normalY < 0.0f) {
+            const float foldedX = (1.0f - fabsf(normalZ)) * (normalX >= 0.0f ? 1.0f : -1.0f);
+            normalZ = (1.0f - fabsf(normalX)) * (normalZ >= 0.0f ? 1.0f : -1.0f);
+            normalX = foldedX;
+        }
+
+        DirectX::XMFLOAT3 normal;
+        DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(DirectX::XMVectorSet(normalX, normalY, normalZ, 0.0f)));
+
+        return normal;
+    }
+
+    bool saveToFile(const std::string& filePath,
+                    const TerrainMaps& terrainMaps,
+                    std::string* errorMessage)
+    {
+        const size_t channelCount = 2 * terrainMaps.mDimension * terrainMaps.mDimension;
+        assert(terrainMaps.mNormals.size() == channelCount);
+        assert(terrainMaps.mSlopeCurvature.size() == channelCount);
+
+        FileHeader header;
+        header.mMagic = sMagic;
+        header.mVersion = sVersion;
+        header.mKey = terrainMaps.mKey;
+        header.mDimension = terrainMaps.mDimension;
+        header.mCellSpacing = terrainMaps.mCellSpacing;
+        header.mGradientOperator = static_cast<uint32_t> (terrainMaps.mGradientOperator);
+        header.mReserved = 0;
+
+        // Write to a temporary file and rename it, so other runs never
+        // see a partially written file.
+        const std::string temporaryFilePath = filePath + ".tmp";
+        {
+            std::ofstream file(temporaryFilePath.c_str(), std::ios::binary | std::ios::trunc);
+            if(file) {
+                file.write(reinterpret_cast<const char*> (&header), sizeof(header));
+                if(channelCount > 0) {
+                    file.write(reinterpret_cast<const char*> (&terrainMaps.mNormals[0]), channelCount * sizeof(int16_t));
+                    file.write(reinterpret_cast<const char*> (&terrainMaps.mSlopeCurvature[0]), channelCount * sizeof(uint16_t));
+                }
+            }
+
+            if(!file) {
+                if(errorMessage != nullptr) {
+                    *errorMessage = "Unable to write " + temporaryFilePath;
+                }
+
+                return false;
+            }
+        }
+
+        if(!MoveFileExA(temporaryFilePath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileA(temporaryFilePath.c_str());
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to replace " + filePath;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    bool loadFromFile(const std::string& filePath,
+                      TerrainMaps& terrainMaps,
+                      std::string* errorMessage)
+    {
+        std::ifstream file(filePath.c_str(), std::ios::binary);
+        if(!file) {
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to open " + filePath;
+            }
+
+            return false;
+        }
+
+        FileHeader header;
+        file.read(reinterpret_cast<char*> (&header), sizeof(header));
+        const bool validHeader = file &&
+                                 header.mMagic == sMagic &&
+                                 header.mVersion == sVersion &&
+                                 header.mCellSpacing > 0.0f &&
+                                 header.mGradientOperator <= static_cast<uint32_t> (GradientOperator::SOBEL);
+        if(!validHeader) {
+            if(errorMessage != nullptr) {
+                *errorMessage = filePath + " is not a terrain maps file of the current version";
+            }
+
+            return false;
+        }
+
+        const size_t channelCount = 2 * header.mDimension * header.mDimension;
+        terrainMaps.mNormals.resize(channelCount);
+        terrainMaps.mSlopeCurvature.resize(channelCount);
+        if(channelCount > 0) {
+            file.read(reinterpret_cast<char*> (&terrainMaps.mNormals[0]), channelCount * sizeof(int16_t));
+            file.read(reinterpret_cast<char*> (&terrainMaps.mSlopeCurvature[0]), channelCount * sizeof(uint16_t));
+        }
+
+        if(!file) {
+            if(errorMessage != nullptr) {
+                *errorMessage = filePath + " is truncated";
+            }
+
+            return false;
+        }
+
+        terrainMaps.mDimension = header.mDimension;
+        terrainMaps.mCellSpacing = header.mCellSpacing;
+        terrainMaps.mGradientOperator = static_cast<GradientOperator> (header.mGradientOperator);
+        terrainMaps.mKey = header.mKey;
+
+        return true;
+    }
+
+    bool loadOrBake(const std::string& cacheFilePath,
+                    const HeightMap& heightMap,
+                    const float cellSpacing,
+                    const GradientOperator gradientOperator,
+                    TerrainMaps& terrainMaps,
+                    const uint32_t numThreads,
+                    std::string* errorMessage)
+    {
+        const uint64_t key = computeKey(heightMap, cellSpacing, gradientOperator);
+        if(loadFromFile(cacheFilePath, terrainMaps) &&
+           terrainMaps.mKey == key &&
+           terrainMaps.mDimension == heightMap.mDimension) {
+            return true;
+        }
+
+        bake(heightMap, cellSpacing, gradientOperator, terrainMaps, numThreads);
+
+        return saveToFile(cacheFilePath, terrainMaps, errorMessage);
+    }
+
+    ID3D11ShaderResourceView* buildNormalMapSRV(ID3D11Device& device,
+                                                const TerrainMaps& terrainMaps)
+    {
+        assert(terrainMaps.mNormals.size() == 2 * terrainMaps.mDimension * terrainMaps.mDimension);
+
+        return buildTexture2DSRV(device,
+                                 terrainMaps.mDimension,
+                                 DXGI_FORMAT_R16G16_SNORM,
+                                 &terrainMaps.mNormals[0],
+                                 2 * sizeof(int16_t));
+    }
+
+    ID3D11ShaderResourceView* buildSlopeCurvatureMapSRV(ID3D11Device& device,
+                                                        const TerrainMaps& terrainMaps)
+    {
+        assert(terrainMaps.mSlopeCurvature.size() == 2 * terrainMaps.mDimension * terrainMaps.mDimension);
+
+        return buildTexture2DSRV(device,
+                                 terrainMaps.mDimension,
+                                 DXGI_FORMAT_R16G16_FLOAT,
+                                 &terrainMaps.mSlopeCurvature[0],
+                                 2 * sizeof(uint16_t));
+    }
+}
@@ -0,0 +1,111 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Normal and slope maps baked from a HeightMap.
+//
+// Baking computes the height gradient of every texel (central
+// differences or Sobel, with texels out of the map clamped to its
+// border, as a clamp sampler does) and stores:
+// - The unit normal, octahedral encoded in 2 signed 16-bit channels.
+// - The slope and curvature, as 2 half channels.
+// Both maps can be saved to a versioned binary file keyed by the height
+// map contents and the bake parameters, so later runs only load them,
+// and turned into textures for shaders to sample.
+//
+// Maps are in height map space: x is the column, z is the row and
+// y is up.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+struct HeightMap;
+struct ID3D11Device;
+struct ID3D11ShaderResourceView;
+
+enum struct GradientOperator
+{
+    CENTRAL_DIFFERENCES,
+    SOBEL
+};
+
+struct TerrainMaps
+{
+    TerrainMaps()
+        : mDimension(0)
+        , mCellSpacing(1.0f)
+        , mGradientOperator(GradientOperator::CENTRAL_DIFFERENCES)
+        , mKey(0)
+    {
+
+    }
+
+    // Octahedral encoded normal (x, z) of every texel, in
+    // [-32767, 32767] (DXGI_FORMAT_R16G16_SNORM).
+    std::vector<int16_t> mNormals;
+
+    // Slope (height change per world unit, that is, the tangent of the
+    // angle with the horizontal plane) and curvature (Laplacian of the
+    // height) of every texel, as halves (DXGI_FORMAT_R16G16_FLOAT).
+    std::vector<uint16_t> mSlopeCurvature;
+
+    uint32_t mDimension;
+
+    // Bake parameters
+    float mCellSpacing;
+    GradientOperator mGradientOperator;
+
+    // Hash of the height map and the bake parameters
+    uint64_t mKey;
+};
+
+namespace TerrainMapsUtils
+{
+    uint64_t computeKey(const HeightMap& heightMap,
+                        const float cellSpacing,
+                        const GradientOperator gradientOperator);
+
+    // cellSpacing is the world distance between adjacent texels.
+    // Rows are split across numThreads threads (0 uses all hardware threads).
+    void bake(const HeightMap& heightMap,
+              const float cellSpacing,
+              const GradientOperator gradientOperator,
+              TerrainMaps& terrainMaps,
+              const uint32_t numThreads = 0);
+
+    DirectX::XMFLOAT3 decodeNormal(const int16_t x,
+                                   const int16_t z);
+
+    // Return false (and fill errorMessage if it is not nullptr) if the
+    // file can not be written or read, or it is not a valid file for the
+    // current version.
+    bool saveToFile(const std::string& filePath,
+                    const TerrainMaps& terrainMaps,
+                    std::string* errorMessage = nullptr);
+
+    bool loadFromFile(const std::string& filePath,
+                      TerrainMaps& terrainMaps,
+                      std::string* errorMessage = nullptr);
+
+    // Loads the maps from cacheFilePath if they were baked from the same
+    // height map and parameters. Otherwise, it bakes them and saves them
+    // to cacheFilePath. terrainMaps is always valid on return. It returns
+    // false (and fills errorMessage) only if the cache could not be written.
+    bool loadOrBake(const std::string& cacheFilePath,
+                    const HeightMap& heightMap,
+                    const float cellSpacing,
+                    const GradientOperator gradientOperator,
+                    TerrainMaps& terrainMaps,
+                    const uint32_t numThreads = 0,
+                    std::string* errorMessage = nullptr);
+
+    ID3D11ShaderResourceView* buildNormalMapSRV(ID3D11Device& device,
+                                                const TerrainMaps& terrainMaps);
+
+    ID3D11ShaderResourceView* buildSlopeCurvatureMapSRV(ID3D11Device& device,
+                                                        const TerrainMaps& terrainMaps);
+}
@@ -0,0 +1,198 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cassert>
+
+#include <ParallelUtils.h>
+
+namespace
+{
+    ThreadPool sSharedThreadPool;
+    bool sSharedThreadPoolStarted = false;
+
+    // Set while a caller holds the shared pool
+    std::atomic_flag sSharedThreadPoolHeld = ATOMIC_FLAG_INIT;
+
+    bool takeTask(ThreadPoolTaskRange& taskRange, uint32_t& taskIndex)
+    {
+        std::lock_guard<std::mutex> lock(taskRange.mMutex);
+        if(taskRange.mBegin == taskRange.mEnd) {
+            return false;
+        }
+
+        taskIndex = taskRange.mBegin++;
+
+        return true;
+    }
+
+    // Takes the last task of the first thread after threadIndex
+    // that still has tasks.
+    bool stealTask(ThreadPool& threadPool, const uint32_t threadIndex, uint32_t& taskIndex)
+    {
+        for(uint32_t i = 1; i < threadPool.mThreadCount; ++i) {
+            ThreadPoolTaskRange& taskRange = threadPool.mTaskRanges[(threadIndex + i) % threadPool.mThreadCount];
+            std::lock_guard<std::mutex> lock(taskRange.mMutex);
+            if(taskRange.mBegin < taskRange.mEnd) {
+                taskIndex = --taskRange.mEnd;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // Runs tasks until no thread has tasks left. Tasks are never
+    // added during a run, so there is nothing to wait for then.
+    void processTasks(ThreadPool& threadPool, const uint32_t threadIndex)
+    {
+        const ThreadPoolTask& task = *threadPool.mTask;
+        ThreadPoolTaskRange& taskRange = threadPool.mTaskRanges[threadIndex];
+        uint32_t taskIndex;
+        while(takeTask(taskRange, taskIndex) || stealTask(threadPool, threadIndex, taskIndex)) {
+            task(taskIndex);
+        }
+    }
+
+    // runs is the number of runs when the worker was started, so a run
+    // requested before the worker gets to wait is not missed.
+    void runWorker(ThreadPool& threadPool, const uint32_t threadIndex, uint64_t runs)
+    {
+        std::unique_lock<std::mutex> lock(threadPool.mMutex);
+        for(;;) {
+            threadPool.mRunRequested.wait(lock, [&threadPool, runs]() {
+                return threadPool.mStopWorkers || threadPool.mRuns != runs;
+            });
+
+            if(threadPool.mStopWorkers) {
+                return;
+            }
+
+            runs = threadPool.mRuns;
+            lock.unlock();
+
+            processTasks(threadPool, threadIndex);
+
+            lock.lock();
+            if(--threadPool.mBusyWorkers == 0) {
+                threadPool.mRunFinished.notify_one();
+            }
+        }
+    }
+}
+
+ThreadPool::ThreadPool()
+    : mThreadCount(1)
+    , mTask(nullptr)
+    , mRuns(0)
+    , mBusyWorkers(0)
+    , mStopWorkers(false)
+{
+
+}
+
+ThreadPool::~ThreadPool()
+{
+    ThreadPoolUtils::stop(*this);
+}
+
+namespace ThreadPoolUtils
+{
+    void start(ThreadPool& threadPool, const uint32_t numThreads)
+    {
+        stop(threadPool);
+
+        const uint32_t threadCount = numThreads == 0 ? ParallelUtils::defaultThreadCount() : numThreads;
+        threadPool.mThreadCount = threadCount;
+        threadPool.mTaskRanges.reset(new ThreadPoolTaskRange[threadCount]);
+        threadPool.mStopWorkers = false;
+
+        threadPool.mWorkers.reserve(threadCount - 1);
+        for(uint32_t threadIndex = 0; threadIndex + 1 < threadCount; ++threadIndex) {
+            threadPool.mWorkers.push_back(std::thread(runWorker, std::ref(threadPool), threadIndex, threadPool.mRuns));
+        }
+    }
+
+    void stop(ThreadPool& threadPool)
+    {
+        {
+            std::lock_guard<std::mutex> lock(threadPool.mMutex);
+            threadPool.mStopWorkers = true;
+        }
+
+        threadPool.mRunRequested.notify_all();
+        for(size_t i = 0; i < threadPool.mWorkers.size(); ++i) {
+            threadPool.mWorkers[i].join();
+        }
+
+        threadPool.mWorkers.clear();
+        threadPool.mTaskRanges.reset();
+        threadPool.mThreadCount = 1;
+    }
+
+    void run(ThreadPool& threadPool,
+             const uint32_t taskCount,
+             const ThreadPoolTask& task)
+    {
+        if(threadPool.mWorkers.empty() || taskCount <= 1) {
+            for(uint32_t taskIndex = 0; taskIndex < taskCount; ++taskIndex) {
+                task(taskIndex);
+            }
+
+            return;
+        }
+
+        // Same split as ParallelUtils::parallelFor: the first
+        // (taskCount % mThreadCount) ranges get one more task.
+        // Workers are waiting, so ranges are set without locking them.
+        const uint32_t threadCount = threadPool.mThreadCount;
+        const uint32_t rangeSize = taskCount / threadCount;
+        const uint32_t remainder = taskCount % threadCount;
+        uint32_t rangeBegin = 0;
+        for(uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+            ThreadPoolTaskRange& taskRange = threadPool.mTaskRanges[threadIndex];
+            taskRange.mBegin = rangeBegin;
+            taskRange.mEnd = rangeBegin + rangeSize + (threadIndex < remainder ? 1 : 0);
+            rangeBegin = taskRange.mEnd;
+        }
+
+        assert(rangeBegin == taskCount);
+
+        {
+            std::lock_guard<std::mutex> lock(threadPool.mMutex);
+            threadPool.mTask = &task;
+            threadPool.mBusyWorkers = static_cast<uint32_t> (threadPool.mWorkers.size());
+            ++threadPool.mRuns;
+        }
+
+        threadPool.mRunRequested.notify_all();
+
+        processTasks(threadPool, threadCount - 1);
+
+        std::unique_lock<std::mutex> lock(threadPool.mMutex);
+        threadPool.mRunFinished.wait(lock, [&threadPool]() {
+            return threadPool.mBusyWorkers == 0;
+        });
+
+        threadPool.mTask = nullptr;
+    }
+
+    ThreadPool* acquireSharedThreadPool()
+    {
+        if(sSharedThreadPoolHeld.test_and_set(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        // Only the holder gets here, so it is started once.
+        if(!sSharedThreadPoolStarted) {
+            start(sSharedThreadPool);
+            sSharedThreadPoolStarted = true;
+        }
+
+        return &sSharedThreadPool;
+    }
+
+    void releaseSharedThreadPool()
+    {
+        sSharedThreadPoolHeld.clear(std::memory_order_release);
+    }
+}
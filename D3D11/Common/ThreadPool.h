@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Persistent worker threads for work split in small tasks.
+//
+// Every run gives each thread a contiguous range of task indices.
+// A thread takes tasks from the front of its own range and, once it
+// is empty, steals tasks from the back of the other threads' ranges,
+// so threads that finish early help the slow ones. run returns when
+// every task is done, so each run is a single barrier, and no threads
+// are created or joined per run.
+//
+// A pool of all the hardware threads is shared by the whole process
+// (ParallelUtils::parallelFor runs on it). It is started on first use
+// and stopped at exit.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void(const uint32_t taskIndex)> ThreadPoolTask;
+
+// Task indices [mBegin, mEnd) of a thread that were not taken yet.
+// The thread takes mBegin and the other ones steal mEnd - 1.
+struct ThreadPoolTaskRange
+{
+    ThreadPoolTaskRange()
+        : mBegin(0)
+        , mEnd(0)
+    {
+
+    }
+
+    std::mutex mMutex;
+    uint32_t mBegin;
+    uint32_t mEnd;
+};
+
+struct ThreadPool
+{
+    ThreadPool();
+    ~ThreadPool();
+
+    // The thread that calls run is the last thread, after the workers.
+    std::vector<std::thread> mWorkers;
+    std::unique_ptr<ThreadPoolTaskRange[]> mTaskRanges;
+    uint32_t mThreadCount;
+
+    // Task of the current run, and the number of runs so far,
+    // so workers know when there is a new run.
+    const ThreadPoolTask* mTask;
+    uint64_t mRuns;
+
+    // Workers that did not finish the current run.
+    uint32_t mBusyWorkers;
+
+    // Guards everything but the task ranges.
+    std::mutex mMutex;
+    std::condition_variable mRunRequested;
+    std::condition_variable mRunFinished;
+
+    bool mStopWorkers;
+
+private:
+    ThreadPool(const ThreadPool&);
+    const ThreadPool& operator=(const ThreadPool&);
+};
+
+namespace ThreadPoolUtils
+{
+    // Starts numThreads - 1 workers (numThreads = 0 uses all hardware
+    // threads), as the thread that calls run works too. A pool that was
+    // started is stopped first.
+    void start(ThreadPool& threadPool, const uint32_t numThreads = 0);
+
+    // Joins the workers. run still works, on the calling thread only.
+    void stop(ThreadPool& threadPool);
+
+    // Calls task(taskIndex) for every index in [0, taskCount) and returns
+    // when all of them are done. It must not be called from several threads
+    // at the same time, nor from a task.
+    void run(ThreadPool& threadPool,
+             const uint32_t taskCount,
+             const ThreadPoolTask& task);
+
+    // Returns the shared pool, starting it the first time, or nullptr if
+    // another caller holds it (another thread, or a task of its run). It
+    // never waits, so callers that get nullptr do their work themselves.
+    // Every pool returned must be released.
+    ThreadPool* acquireSharedThreadPool();
+    void releaseSharedThreadPool();
+}
@@ -0,0 +1,642 @@
+#include "TiledHeightMap.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <windows.h>
+
+#include <Camera.h>
+
+namespace
+{
+    // "HTIL"
+    const uint32_t sMagic = 0x4C495448;
+
+    // Increment it every time the file layout changes.
+    const uint32_t sVersion = 1;
+
+    struct FileHeader
+    {
+        uint32_t mMagic;
+        uint32_t mVersion;
+        uint32_t mDimension;
+        uint32_t mTileDimension;
+    };
+
+    // Reads rows [fromRow, toRow) of the height map into heights.
+    typedef std::function<bool(const uint32_t fromRow, const uint32_t toRow, float* heights)> RowsReader;
+
+    double currentTime()
+    {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        return static_cast<double> (counter.QuadPart) / frequency.QuadPart;
+    }
+
+    uint64_t computeTileOffset(const uint32_t tileIndex,
+                               const uint32_t tileDimension)
+    {
+        return sizeof(FileHeader) + static_cast<uint64_t> (tileIndex) * tileDimension * tileDimension * sizeof(float);
+    }
+
+    bool writeTileFile(const std::string& tileFilePath,
+                       const uint32_t dimension,
+                       const uint32_t tileDimension,
+                       const RowsReader& readRows,
+                       std::string* errorMessage)
+    {
+        assert(dimension > 0);
+        assert(tileDimension > 0);
+
+        FileHeader header;
+        header.mMagic = sMagic;
+        header.mVersion = sVersion;
+        header.mDimension = dimension;
+        header.mTileDimension = tileDimension;
+
+        // Write to a temporary file and rename it, so readers never
+        // see a partially written tile file.
+        const std::string temporaryFilePath = tileFilePath + ".tmp";
+        {
+            std::ofstream file(temporaryFilePath.c_str(), std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*> (&header), sizeof(header));
+
+            // A row of tiles of the height map and a tile
+            std::vector<float> band(tileDimension * dimension);
+            std::vector<float> tile(tileDimension * tileDimension);
+
+            const uint32_t tilesPerSide = (dimension + tileDimension - 1) / tileDimension;
+            for(uint32_t tileRow = 0; file && tileRow < tilesPerSide; ++tileRow) {
+                const uint32_t fromRow = tileRow * tileDimension;
+                const uint32_t numRows = (std::min)(tileDimension, dimension - fromRow);
+                if(!readRows(fromRow, fromRow + numRows, &band[0])) {
+                    file.close();
+                    DeleteFileA(temporaryFilePath.c_str());
+                    return false;
+                }
+
+                for(uint32_t tileColumn = 0; tileColumn < tilesPerSide; ++tileColumn) {
+                    const uint32_t fromColumn = tileColumn * tileDimension;
+                    for(uint32_t row = 0; row < tileDimension; ++row) {
+                        const float* bandRow = &band[(std::min)(row, numRows - 1) * dimension];
+                        float* tileRowHeights = &tile[row * tileDimension];
+                        for(uint32_t column = 0; column < tileDimension; ++column) {
+                            tileRowHeights[column] = bandRow[(std::min)(fromColumn + column, dimension - 1)];
+                        }
+                    }
+
+                    file.write(reinterpret_cast<const char*> (&tile[0]), tile.size() * sizeof(float));
+                }
+            }
+
+            if(!file) {
+                if(errorMessage != nullptr) {
+                    *errorMessage = "Unable to write " + temporaryFilePath;
+                }
+
+                return false;
+            }
+        }
+
+        if(!MoveFileExA(temporaryFilePath.c_str(), tileFilePath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            DeleteFileA(temporaryFilePath.c_str());
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to replace " + tileFilePath;
+            }
+
+            return false;
+        }
+
+        return true;
+    }
+
+    // open() checked the file size, but the file can still be truncated
+    // or fail to read later. The stream is cleared first, so a failed
+    // read does not fail the next ones.
+    bool readTile(std::ifstream& file,
+                  const uint32_t tileIndex,
+                  const uint32_t tileDimension,
+                  std::vector<float>& heights)
+    {
+        heights.resize(tileDimension * tileDimension);
+        file.clear();
+        file.seekg(computeTileOffset(tileIndex, tileDimension));
+        file.read(reinterpret_cast<char*> (&heights[0]), heights.size() * sizeof(float));
+
+        return !file.fail();
+    }
+
+    //
+    // Cache helpers. They must be called with the mutex locked.
+    //
+
+    CachedHeightMapTile& insertLoadingTile(TiledHeightMap& tiledHeightMap,
+                                           const uint32_t tileIndex)
+    {
+        tiledHeightMap.mLeastRecentlyUsed.push_front(tileIndex);
+        CachedHeightMapTile& tile = tiledHeightMap.mTiles[tileIndex];
+        tile.mUsePosition = tiledHeightMap.mLeastRecentlyUsed.begin();
+
+        return tile;
+    }
+
+    void markAsUsed(TiledHeightMap& tiledHeightMap,
+                    CachedHeightMapTile& tile)
+    {
+        std::list<uint32_t>& leastRecentlyUsed = tiledHeightMap.mLeastRecentlyUsed;
+        leastRecentlyUsed.splice(leastRecentlyUsed.begin(), leastRecentlyUsed, tile.mUsePosition);
+    }
+
+    // Evicts the least recently used tiles over the budget.
+    // Tiles being read are never evicted.
+    void evictTiles(TiledHeightMap& tiledHeightMap)
+    {
+        std::list<uint32_t>& leastRecentlyUsed = tiledHeightMap.mLeastRecentlyUsed;
+        std::list<uint32_t>::iterator candidate = leastRecentlyUsed.end();
+        while(tiledHeightMap.mTiles.size() > tiledHeightMap.mMaxResidentTiles && candidate != leastRecentlyUsed.begin()) {
+            --candidate;
+            std::unordered_map<uint32_t, CachedHeightMapTile>::iterator tile = tiledHeightMap.mTiles.find(*candidate);
+            assert(tile != tiledHeightMap.mTiles.end());
+            if(tile->second.mLoading) {
+                continue;
+            }
+
+            tiledHeightMap.mTiles.erase(tile);
+            candidate = leastRecentlyUsed.erase(candidate);
+            ++tiledHeightMap.mStatistics.mEvictedTiles;
+        }
+    }
+
+    void finishLoading(TiledHeightMap& tiledHeightMap,
+                       const uint32_t tileIndex,
+                       const std::shared_ptr<std::vector<float>>& heights)
+    {
+        CachedHeightMapTile& tile = tiledHeightMap.mTiles[tileIndex];
+        tile.mHeights = heights;
+        tile.mLoading = false;
+        evictTiles(tiledHeightMap);
+        tiledHeightMap.mTileLoaded.notify_all();
+    }
+
+    // Removes a tile that could not be read, so it is read again
+    // the next time it is requested.
+    void failLoading(TiledHeightMap& tiledHeightMap,
+                     const uint32_t tileIndex)
+    {
+        std::unordered_map<uint32_t, CachedHeightMapTile>::iterator tile = tiledHeightMap.mTiles.find(tileIndex);
+        assert(tile != tiledHeightMap.mTiles.end());
+        tiledHeightMap.mLeastRecentlyUsed.erase(tile->second.mUsePosition);
+        tiledHeightMap.mTiles.erase(tile);
+        ++tiledHeightMap.mStatistics.mFailedReads;
+        tiledHeightMap.mTileLoaded.notify_all();
+    }
+
+    // Prefetcher thread. It reads the queued tiles, nearest first,
+    // from its own stream until it is stopped.
+    void prefetchTiles(TiledHeightMap& tiledHeightMap)
+    {
+        std::unique_lock<std::mutex> lock(tiledHeightMap.mMutex);
+        for(;;) {
+            tiledHeightMap.mPrefetchRequested.wait(lock, [&tiledHeightMap]() {
+                return tiledHeightMap.mStopPrefetcher || !tiledHeightMap.mPrefetchQueue.empty();
+            });
+
+            if(tiledHeightMap.mStopPrefetcher) {
+                return;
+            }
+
+            const uint32_t tileIndex = tiledHeightMap.mPrefetchQueue.back();
+            tiledHeightMap.mPrefetchQueue.pop_back();
+            if(tiledHeightMap.mTiles.find(tileIndex) != tiledHeightMap.mTiles.end()) {
+                continue;
+            }
+
+            insertLoadingTile(tiledHeightMap, tileIndex);
+            lock.unlock();
+
+            std::shared_ptr<std::vector<float>> heights = std::make_shared<std::vector<float>>();
+            const bool read = readTile(tiledHeightMap.mPrefetchFile, tileIndex, tiledHeightMap.mTileDimension, *heights);
+
+            lock.lock();
+            if(read) {
+                ++tiledHeightMap.mStatistics.mPrefetchedTiles;
+                finishLoading(tiledHeightMap, tileIndex, heights);
+            } else {
+                failLoading(tiledHeightMap, tileIndex);
+            }
+        }
+    }
+
+    // Squared distance from (x, y) to the segment from (fromX, fromY) to (toX, toY)
+    float computeSquaredDistanceToSegment(const float x,
+                                          const float y,
+                                          const float fromX,
+                                          const float fromY,
+                                          const float toX,
+                                          const float toY)
+    {
+        const float segmentX = toX - fromX;
+        const float segmentY = toY - fromY;
+        const float squaredLength = segmentX * segmentX + segmentY * segmentY;
+        float t = 0.0f;
+        if(squaredLength > 0.0f) {
+            t = ((x - fromX) * segmentX + (y - fromY) * segmentY) / squaredLength;
+            t = (std::min)((std::max)(t, 0.0f), 1.0f);
+        }
+
+        const float distanceX = x - (fromX + t * segmentX);
+        const float distanceY = y - (fromY + t * segmentY);
+
+        return distanceX * distanceX + distanceY * distanceY;
+    }
+}
+
+TiledHeightMap::TiledHeightMap()
+    : mDimension(0)
+    , mTileDimension(0)
+    , mTilesPerSide(0)
+    , mMaxResidentTiles(0)
+    , mStopPrefetcher(false)
+{
+
+}
+
+TiledHeightMap::~TiledHeightMap()
+{
+    TiledHeightMapUtils::close(*this);
+}
+
+namespace TiledHeightMapUtils
+{
+    bool buildTileFile(const HeightMap& heightMap,
+                       const uint32_t tileDimension,
+                       const std::string& tileFilePath,
+                       std::string* errorMessage)
+    {
+        assert(heightMap.mData.size() == heightMap.mDimension * heightMap.mDimension);
+
+        const uint32_t dimension = heightMap.mDimension;
+        return writeTileFile(tileFilePath,
+                             dimension,
+                             tileDimension,
+                             [&heightMap, dimension](const uint32_t fromRow, const uint32_t toRow, float* heights) {
+            std::copy(heightMap.mData.begin() + fromRow * dimension,
+                      heightMap.mData.begin() + toRow * dimension,
+                      heights);
+            return true;
+        },
+                             errorMessage);
+    }
+
+    bool buildTileFileFromRAW(const std::string& rawFilePath,
+                              const uint32_t dimension,
+                              const float scaleFactor,
+                              const RAWFormat format,
+                              const uint32_t tileDimension,
+                              const std::string& tileFilePath,
+                              std::string* errorMessage)
+    {
+        std::ifstream rawFile(rawFilePath.c_str(), std::ios::binary | std::ios::ate);
+        if(!rawFile) {
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to open " + rawFilePath;
+            }
+
+            return false;
+        }
+
+        const uint32_t bytesPerSample = format == RAWFormat::UINT8 ? 1 : 2;
+        const uint64_t rawFileSize = static_cast<uint64_t> (rawFile.tellg());
+        if(rawFileSize < static_cast<uint64_t> (dimension) * dimension * bytesPerSample) {
+            if(errorMessage != nullptr) {
+                *errorMessage = rawFilePath + " is too small for the height map dimension";
+            }
+
+            return false;
+        }
+
+        rawFile.seekg(0);
+
+        // Rows are read in order, a row of tiles at a time.
+        std::vector<uint8_t> samples;
+        return writeTileFile(tileFilePath,
+                             dimension,
+                             tileDimension,
+                             [&](const uint32_t fromRow, const uint32_t toRow, float* heights) {
+            const uint32_t numSamples = (toRow - fromRow) * dimension;
+            samples.resize(numSamples * bytesPerSample);
+            rawFile.read(reinterpret_cast<char*> (&samples[0]), samples.size());
+            if(!rawFile) {
+                if(errorMessage != nullptr) {
+                    *errorMessage = "Unable to read " + rawFilePath;
+                }
+
+                return false;
+            }
+
+            HeightMapUtils::convertRAWSamples(&samples[0], format, scaleFactor, 0, numSamples, heights);
+            return true;
+        },
+                             errorMessage);
+    }
+
+    bool open(const std::string& tileFilePath,
+              const uint64_t cacheBudget,
+              TiledHeightMap& tiledHeightMap,
+              std::string* errorMessage)
+    {
+        close(tiledHeightMap);
+
+        std::ifstream& file = tiledHeightMap.mFile;
+        file.clear();
+        file.open(tileFilePath.c_str(), std::ios::binary | std::ios::ate);
+        if(!file) {
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to open " + tileFilePath;
+            }
+
+            return false;
+        }
+
+        const uint64_t fileSize = static_cast<uint64_t> (file.tellg());
+        file.seekg(0);
+
+        FileHeader header;
+        file.read(reinterpret_cast<char*> (&header), sizeof(header));
+        const bool validHeader = file &&
+                                 header.mMagic == sMagic &&
+                                 header.mVersion == sVersion &&
+                                 header.mDimension > 0 &&
+                                 header.mTileDimension > 0;
+        const uint32_t tilesPerSide = validHeader ? (header.mDimension + header.mTileDimension - 1) / header.mTileDimension : 0;
+        if(!validHeader || fileSize != computeTileOffset(tilesPerSide * tilesPerSide, header.mTileDimension)) {
+            file.close();
+            if(errorMessage != nullptr) {
+                *errorMessage = tileFilePath + " is not a tile file of the current version";
+            }
+
+            return false;
+        }
+
+        tiledHeightMap.mPrefetchFile.clear();
+        tiledHeightMap.mPrefetchFile.open(tileFilePath.c_str(), std::ios::binary);
+        if(!tiledHeightMap.mPrefetchFile) {
+            file.close();
+            if(errorMessage != nullptr) {
+                *errorMessage = "Unable to open " + tileFilePath + " for the prefetcher";
+            }
+
+            return false;
+        }
+
+        const uint64_t tileSize = static_cast<uint64_t> (header.mTileDimension) * header.mTileDimension * sizeof(float);
+        tiledHeightMap.mFilePath = tileFilePath;
+        tiledHeightMap.mDimension = header.mDimension;
+        tiledHeightMap.mTileDimension = header.mTileDimension;
+        tiledHeightMap.mTilesPerSide = tilesPerSide;
+        tiledHeightMap.mMaxResidentTiles = static_cast<uint32_t> ((std::max)(cacheBudget / tileSize, static_cast<uint64_t> (1)));
+        tiledHeightMap.mStatistics = TileCacheStatistics();
+        tiledHeightMap.mStopPrefetcher = false;
+        tiledHeightMap.mPrefetcher = std::thread(prefetchTiles, std::ref(tiledHeightMap));
+
+        return true;
+    }
+
+    void close(TiledHeightMap& tiledHeightMap)
+    {
+        {
+            std::lock_guard<std::mutex> lock(tiledHeightMap.mMutex);
+            tiledHeightMap.mStopPrefetcher = true;
+        }
+
+        tiledHeightMap.mPrefetchRequested.notify_all();
+        if(tiledHeightMap.mPrefetcher.joinable()) {
+            tiledHeightMap.mPrefetcher.join();
+        }
+
+        tiledHeightMap.mTiles.clear();
+        tiledHeightMap.mLeastRecentlyUsed.clear();
+        tiledHeightMap.mPrefetchQueue.clear();
+        if(tiledHeightMap.mFile.is_open()) {
+            tiledHeightMap.mFile.close();
+        }
+
+        if(tiledHeightMap.mPrefetchFile.is_open()) {
+            tiledHeightMap.mPrefetchFile.close();
+        }
+    }
+
+    HeightMapTile acquireTile(TiledHeightMap& tiledHeightMap,
+                              const uint32_t tileRow,
+                              const uint32_t tileColumn)
+    {
+        assert(tileRow < tiledHeightMap.mTilesPerSide);
+        assert(tileColumn < tiledHeightMap.mTilesPerSide);
+
+        const uint32_t tileIndex = tileRow * tiledHeightMap.mTilesPerSide + tileColumn;
+
+        std::unique_lock<std::mutex> lock(tiledHeightMap.mMutex);
+        bool missed = false;
+        double stallStartTime = 0.0;
+        for(;;) {
+            std::unordered_map<uint32_t, CachedHeightMapTile>::iterator cachedTile = tiledHeightMap.mTiles.find(tileIndex);
+            if(cachedTile != tiledHeightMap.mTiles.end() && !cachedTile->second.mLoading) {
+                if(missed) {
+                    tiledHeightMap.mStatistics.mStallTime += currentTime() - stallStartTime;
+                } else {
+                    ++tiledHeightMap.mStatistics.mHits;
+                }
+
+                markAsUsed(tiledHeightMap, cachedTile->second);
+                return cachedTile->second.mHeights;
+            }
+
+            if(!missed) {
+                missed = true;
+                ++tiledHeightMap.mStatistics.mMisses;
+                stallStartTime = currentTime();
+            }
+
+            if(cachedTile == tiledHeightMap.mTiles.end()) {
+                // Read it in this thread.
+                insertLoadingTile(tiledHeightMap, tileIndex);
+                lock.unlock();
+
+                std::shared_ptr<std::vector<float>> heights = std::make_shared<std::vector<float>>();
+                bool read;
+                {
+                    std::lock_guard<std::mutex> fileLock(tiledHeightMap.mFileMutex);
+                    read = readTile(tiledHeightMap.mFile, tileIndex, tiledHeightMap.mTileDimension, *heights);
+                }
+
+                lock.lock();
+                tiledHeightMap.mStatistics.mStallTime += currentTime() - stallStartTime;
+                if(!read) {
+                    failLoading(tiledHeightMap, tileIndex);
+                    return nullptr;
+                }
+
+                finishLoading(tiledHeightMap, tileIndex, heights);
+
+                return heights;
+            }
+
+            // Another thread (probably the prefetcher) is reading it. If
+            // it is evicted, or it can not be read, before this thread
+            // wakes up, this thread reads it again.
+            tiledHeightMap.mTileLoaded.wait(lock, [&tiledHeightMap, tileIndex]() {
+                std::unordered_map<uint32_t, CachedHeightMapTile>::const_iterator tile = tiledHeightMap.mTiles.find(tileIndex);
+                return tile == tiledHeightMap.mTiles.end() || !tile->second.mLoading;
+            });
+        }
+    }
+
+    float fetchHeight(TiledHeightMap& tiledHeightMap,
+                      const uint32_t row,
+                      const uint32_t column)
+    {
+        const uint32_t lastIndex = tiledHeightMap.mDimension - 1;
+        const uint32_t clampedRow = (std::min)(row, lastIndex);
+        const uint32_t clampedColumn = (std::min)(column, lastIndex);
+        const uint32_t tileDimension = tiledHeightMap.mTileDimension;
+        const HeightMapTile tile = acquireTile(tiledHeightMap,
+                                               clampedRow / tileDimension,
+                                               clampedColumn / tileDimension);
+        if(tile == nullptr) {
+            return 0.0f;
+        }
+
+        return (*tile)[(clampedRow % tileDimension) * tileDimension + clampedColumn % tileDimension];
+    }
+
+    float sampleHeight(TiledHeightMap& tiledHeightMap,
+                       const HeightMapMapping& mapping,
+                       const float x,
+                       const float z)
+    {
+        const uint32_t dimension = tiledHeightMap.mDimension;
+        if(dimension == 1) {
+            return fetchHeight(tiledHeightMap, 0, 0);
+        }
+
+        const float maxCoordinate = static_cast<float> (dimension - 1);
+        const float u = (std::min)((std::max)((x - mapping.mOriginX) / mapping.mTexelSizeX, 0.0f), maxCoordinate);
+        const float v = (std::min)((std::max)((z - mapping.mOriginZ) / mapping.mTexelSizeZ, 0.0f), maxCoordinate);
+        const uint32_t column = (std::min)(static_cast<uint32_t> (u), dimension - 2);
+        const uint32_t row = (std::min)(static_cast<uint32_t> (v), dimension - 2);
+        const float fractionU = u - column;
+        const float fractionV = v - row;
+
+        float h00;
+        float h01;
+        float h10;
+        float h11;
+        const uint32_t tileDimension = tiledHeightMap.mTileDimension;
+        const uint32_t tileRow = row / tileDimension;
+        const uint32_t tileColumn = column / tileDimension;
+        if(tileRow == (row + 1) / tileDimension && tileColumn == (column + 1) / tileDimension) {
+            // All the corners are in the same tile.
+            const HeightMapTile tile = acquireTile(tiledHeightMap, tileRow, tileColumn);
+            if(tile == nullptr) {
+                return 0.0f;
+            }
+
+            const float* heights = &(*tile)[(row % tileDimension) * tileDimension + column % tileDimension];
+            h00 = heights[0];
+            h01 = heights[1];
+            h10 = heights[tileDimension];
+            h11 = heights[tileDimension + 1];
+        } else {
+            h00 = fetchHeight(tiledHeightMap, row, column);
+            h01 = fetchHeight(tiledHeightMap, row, column + 1);
+            h10 = fetchHeight(tiledHeightMap, row + 1, column);
+            h11 = fetchHeight(tiledHeightMap, row + 1, column + 1);
+        }
+
+        const float top = h00 + (h01 - h00) * fractionU;
+        const float bottom = h10 + (h11 - h10) * fractionU;
+
+        return top + (bottom - top) * fractionV;
+    }
+
+    void prefetch(TiledHeightMap& tiledHeightMap,
+                  const HeightMapMapping& mapping,
+                  const Camera& camera,
+                  const float radius,
+                  const float lookAhead)
+    {
+        // Segment from the camera to the predicted position, in texels.
+        const float lookLength = sqrtf(camera.mLook.x * camera.mLook.x + camera.mLook.z * camera.mLook.z);
+        const float aheadScale = lookLength > 0.0f ? lookAhead / lookLength : 0.0f;
+        const float fromU = (camera.mPosition.x - mapping.mOriginX) / mapping.mTexelSizeX;
+        const float fromV = (camera.mPosition.z - mapping.mOriginZ) / mapping.mTexelSizeZ;
+        const float toU = (camera.mPosition.x + camera.mLook.x * aheadScale - mapping.mOriginX) / mapping.mTexelSizeX;
+        const float toV = (camera.mPosition.z + camera.mLook.z * aheadScale - mapping.mOriginZ) / mapping.mTexelSizeZ;
+
+        // A tile is needed if its bounding circle is within radius of the segment.
+        const float tileDimension = static_cast<float> (tiledHeightMap.mTileDimension);
+        const float radiusInTexels = radius / (std::min)(fabsf(mapping.mTexelSizeX), fabsf(mapping.mTexelSizeZ));
+        const float maxDistance = radiusInTexels + 0.7072f * tileDimension;
+
+        const float lastTile = static_cast<float> (tiledHeightMap.mTilesPerSide - 1);
+        const uint32_t fromTileColumn = static_cast<uint32_t> ((std::min)((std::max)(floorf(((std::min)(fromU, toU) - maxDistance) / tileDimension), 0.0f), lastTile));
+        const uint32_t toTileColumn = static_cast<uint32_t> ((std::min)((std::max)(floorf(((std::max)(fromU, toU) + maxDistance) / tileDimension), 0.0f), lastTile));
+        const uint32_t fromTileRow = static_cast<uint32_t> ((std::min)((std::max)(floorf(((std::min)(fromV, toV) - maxDistance) / tileDimension), 0.0f), lastTile));
+        const uint32_t toTileRow = static_cast<uint32_t> ((std::min)((std::max)(floorf(((std::max)(fromV, toV) + maxDistance) / tileDimension), 0.0f), lastTile));
+
+        // (squared distance to the camera, tile index)
+        std::vector<std::pair<float, uint32_t>> neededTiles;
+        for(uint32_t tileRow = fromTileRow; tileRow <= toTileRow; ++tileRow) {
+            const float centerV = (tileRow + 0.5f) * tileDimension;
+            for(uint32_t tileColumn = fromTileColumn; tileColumn <= toTileColumn; ++tileColumn) {
+                const float centerU = (tileColumn + 0.5f) * tileDimension;
+                if(computeSquaredDistanceToSegment(centerU, centerV, fromU, fromV, toU, toV) <= maxDistance * maxDistance) {
+                    const float cameraDistanceU = centerU - fromU;
+                    const float cameraDistanceV = centerV - fromV;
+                    neededTiles.push_back(std::make_pair(cameraDistanceU * cameraDistanceU + cameraDistanceV * cameraDistanceV,
+                                                         tileRow * tiledHeightMap.mTilesPerSide + tileColumn));
+                }
+            }
+        }
+
+        // Keep the nearest tiles that fit in the cache.
+        std::sort(neededTiles.begin(), neededTiles.end());
+        neededTiles.resize((std::min)(neededTiles.size(), static_cast<size_t> (tiledHeightMap.mMaxResidentTiles)));
+
+        {
+            std::lock_guard<std::mutex> lock(tiledHeightMap.mMutex);
+
+            // Farthest tiles first, so the nearest ones end up as the most
+            // recently used and at the back of the queue, read first.
+            tiledHeightMap.mPrefetchQueue.clear();
+            for(size_t i = neededTiles.size(); i > 0; --i) {
+                const uint32_t tileIndex = neededTiles[i - 1].second;
+                std::unordered_map<uint32_t, CachedHeightMapTile>::iterator cachedTile = tiledHeightMap.mTiles.find(tileIndex);
+                if(cachedTile != tiledHeightMap.mTiles.end()) {
+                    markAsUsed(tiledHeightMap, cachedTile->second);
+                } else {
+                    tiledHeightMap.mPrefetchQueue.push_back(tileIndex);
+                }
+            }
+        }
+
+        tiledHeightMap.mPrefetchRequested.notify_one();
+    }
+
+    TileCacheStatistics getStatistics(TiledHeightMap& tiledHeightMap)
+    {
+        std::lock_guard<std::mutex> lock(tiledHeightMap.mMutex);
+        return tiledHeightMap.mStatistics;
+    }
+
+    void resetStatistics(TiledHeightMap& tiledHeightMap)
+    {
+        std::lock_guard<std::mutex> lock(tiledHeightMap.mMutex);
+        tiledHeightMap.mStatistics = TileCacheStatistics();
+    }
+}
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Out-of-core height map split in square tiles.
+//
+// A tile file stores the heights tile by tile, so a tile is read with
+// a single seek. Tiles are read on demand into a least recently used
+// cache with a memory budget, and a background prefetcher reads the
+// tiles the camera is predicted to need before they are requested.
+// Height maps much larger than the memory budget (32k x 32k and more)
+// can be used this way.
+//
+// Tiles past the height map border are padded with its last row and
+// column.
+//
+// A tile that can not be read (the file was truncated or its device
+// failed after open) is not cached, so the next request reads it again,
+// and it is counted in TileCacheStatistics::mFailedReads.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <HeightMap.h>
+#include <HeightMapSampler.h>
+
+struct Camera;
+
+// Row major heights of a tile. It stays valid while it is
+// referenced, even if the cache evicts the tile.
+typedef std::shared_ptr<const std::vector<float>> HeightMapTile;
+
+struct TileCacheStatistics
+{
+    TileCacheStatistics()
+        : mHits(0)
+        , mMisses(0)
+        , mPrefetchedTiles(0)
+        , mEvictedTiles(0)
+        , mFailedReads(0)
+        , mStallTime(0.0)
+    {
+
+    }
+
+    // Tile requests of resident tiles
+    uint64_t mHits;
+
+    // Tile requests that waited for the tile to be read,
+    // by the calling thread or by the prefetcher
+    uint64_t mMisses;
+
+    uint64_t mPrefetchedTiles;
+    uint64_t mEvictedTiles;
+
+    // Tile reads that failed, by the calling threads or by the prefetcher
+    uint64_t mFailedReads;
+
+    // Seconds the calling threads waited for tiles
+    double mStallTime;
+};
+
+struct CachedHeightMapTile
+{
+    CachedHeightMapTile()
+        : mLoading(true)
+    {
+
+    }
+
+    // nullptr while the tile is being read
+    std::shared_ptr<std::vector<float>> mHeights;
+
+    // Position in TiledHeightMap::mLeastRecentlyUsed
+    std::list<uint32_t>::iterator mUsePosition;
+
+    bool mLoading;
+};
+
+struct TiledHeightMap
+{
+    TiledHeightMap();
+    ~TiledHeightMap();
+
+    std::string mFilePath;
+    uint32_t mDimension;
+    uint32_t mTileDimension;
+    uint32_t mTilesPerSide;
+    uint32_t mMaxResidentTiles;
+
+    // Resident (or being read) tiles by tile index (tileRow * mTilesPerSide + tileColumn),
+    // and tile indices from the most to the least recently used.
+    std::unordered_map<uint32_t, CachedHeightMapTile> mTiles;
+    std::list<uint32_t> mLeastRecentlyUsed;
+
+    // Tiles the prefetcher has to read, the first one to read last.
+    std::vector<uint32_t> mPrefetchQueue;
+
+    TileCacheStatistics mStatistics;
+
+    // Guards everything but the file calling threads read from.
+    std::mutex mMutex;
+    std::condition_variable mTileLoaded;
+    std::condition_variable mPrefetchRequested;
+
+    std::ifstream mFile;
+    std::mutex mFileMutex;
+
+    // Only the prefetcher reads from its own stream.
+    std::ifstream mPrefetchFile;
+    std::thread mPrefetcher;
+    bool mStopPrefetcher;
+
+private:
+    TiledHeightMap(const TiledHeightMap&);
+    const TiledHeightMap& operator=(const TiledHeightMap&);
+};
+
+namespace TiledHeightMapUtils
+{
+    // Write the tile file of a height map. The RAW one converts the file
+    // a row of tiles at a time, so the whole height map is never in memory.
+    // Return false (and fill errorMessage if it is not nullptr) if a file
+    // can not be read or written.
+    bool buildTileFile(const HeightMap& heightMap,
+                       const uint32_t tileDimension,
+                       const std::string& tileFilePath,
+                       std::string* errorMessage = nullptr);
+
+    bool buildTileFileFromRAW(const std::string& rawFilePath,
+                              const uint32_t dimension,
+                              const float scaleFactor,
+                              const RAWFormat format,
+                              const uint32_t tileDimension,
+                              const std::string& tileFilePath,
+                              std::string* errorMessage = nullptr);
+
+    // Opens the tile file, for the calling threads and for the
+    // prefetcher, and starts the prefetcher. At most
+    // cacheBudget bytes of tiles (and at least 1 tile) are kept resident.
+    bool open(const std::string& tileFilePath,
+              const uint64_t cacheBudget,
+              TiledHeightMap& tiledHeightMap,
+              std::string* errorMessage = nullptr);
+
+    // Stops the prefetcher and releases the cached tiles.
+    void close(TiledHeightMap& tiledHeightMap);
+
+    // Returns the tile, reading it if it is not resident, or nullptr if
+    // it can not be read. It can be called from several threads.
+    HeightMapTile acquireTile(TiledHeightMap& tiledHeightMap,
+                              const uint32_t tileRow,
+                              const uint32_t tileColumn);
+
+    // Height of a texel, clamped to the height map. Texels of tiles
+    // that can not be read are 0.
+    float fetchHeight(TiledHeightMap& tiledHeightMap,
+                      const uint32_t row,
+                      const uint32_t column);
+
+    // Bilinear height at world (x, z), clamped to the height map,
+    // or 0 if a tile can not be read.
+    float sampleHeight(TiledHeightMap& tiledHeightMap,
+                       const HeightMapMapping& mapping,
+                       const float x,
+                       const float z);
+
+    // Replaces the prefetcher queue with the tiles within radius of
+    // the segment from the camera position to lookAhead units along its
+    // horizontal look direction, nearest to the camera first. Resident
+    // tiles among them are marked as used, so they are not evicted first.
+    void prefetch(TiledHeightMap& tiledHeightMap,
+                  const HeightMapMapping& mapping,
+                  const Camera& camera,
+                  const float radius,
+                  const float lookAhead);
+
+    TileCacheStatistics getStatistics(TiledHeightMap& tiledHeightMap);
+
+    void resetStatistics(TiledHeightMap& tiledHeightMap);
+}
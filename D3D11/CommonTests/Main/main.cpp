@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <cstring>
+
+#include <Tests/TestUtils.h>
+#include <Tests/Tests.h>
+
+namespace
+{
+    typedef void (*TestFunction)(TestResults&);
+    typedef void (*BenchmarkFunction)();
+
+    struct TestCase
+    {
+        const char* mName;
+        TestFunction mFunction;
+    };
+
+    struct BenchmarkCase
+    {
+        const char* mName;
+        BenchmarkFunction mFunction;
+    };
+
+    const TestCase sTestCases[] = {
+        { "CompressedHeightMap", &Tests::testCompressedHeightMap },
+        { "GeometryGenerator", &Tests::testGeometryGenerator },
+        { "HalfConversion", &Tests::testHalfConversion },
+        { "HeightMap", &Tests::testHeightMap },
+        { "HeightMapPyramid", &Tests::testHeightMapPyramid },
+        { "HeightMapSampler", &Tests::testHeightMapSampler },
+        { "MeshCache", &Tests::testMeshCache },
+        { "MeshletBuilder", &Tests::testMeshletBuilder },
+        { "MeshOptimizer", &Tests::testMeshOptimizer },
+        { "MeshSimplifier", &Tests::testMeshSimplifier },
+        { "MeshSink", &Tests::testMeshSink },
+        { "PackedVertex", &Tests::testPackedVertex },
+        { "TerrainMaps", &Tests::testTerrainMaps },
+        { "TiledHeightMap", &Tests::testTiledHeightMap },
+    };
+
+    const BenchmarkCase sBenchmarkCases[] = {
+        { "GeometryGenerator", &Tests::benchmarkGeometryGenerator },
+        { "HalfConversion", &Tests::benchmarkHalfConversion },
+        { "HeightMap", &Tests::benchmarkHeightMap },
+        { "HeightMapPyramid", &Tests::benchmarkHeightMapPyramid },
+        { "MeshCache", &Tests::benchmarkMeshCache },
+        { "MeshOptimizer", &Tests::benchmarkMeshOptimizer },
+        { "MeshSink", &Tests::benchmarkMeshSink },
+    };
+}
+
+// Benchmarks take much longer than the tests, so they are only run,
+// after the tests, with the --benchmarks argument. Build them in Release.
+int main(int argc, char* argv[])
+{
+    uint32_t failedTests = 0;
+    for(size_t i = 0; i < sizeof(sTestCases) / sizeof(sTestCases[0]); ++i) {
+        printf("%s\n", sTestCases[i].mName);
+
+        TestResults results;
+        sTestCases[i].mFunction(results);
+        printf("    %u checks, %u failed\n", results.mChecks, results.mFailures);
+
+        if(results.mFailures > 0) {
+            ++failedTests;
+        }
+    }
+
+    if(argc > 1 && strcmp(argv[1], "--benchmarks") == 0) {
+        for(size_t i = 0; i < sizeof(sBenchmarkCases) / sizeof(sBenchmarkCases[0]); ++i) {
+            printf("%s benchmark\n", sBenchmarkCases[i].mName);
+            sBenchmarkCases[i].mFunction();
+        }
+    }
+
+    return failedTests == 0 ? 0 : 1;
+}
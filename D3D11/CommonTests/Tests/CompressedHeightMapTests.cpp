@@ -0,0 +1,190 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CompressedHeightMap.h>
+#include <HeightMap.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    const char* sFilePath = "CompressedHeightMapTests.hmc";
+    const char* sCorruptFilePath = "CompressedHeightMapTests.corrupt.hmc";
+    const char* sRAWFilePath = "CompressedHeightMapTests.raw";
+
+    // Random samples, smooth terrain and samples that alternate between
+    // their extremes, so every predictor and Rice parameter is used.
+    void buildHeightMap(const uint32_t kind,
+                        std::mt19937& generator,
+                        QuantizedHeightMap& heightMap)
+    {
+        std::uniform_int_distribution<uint32_t> sampleDistribution(0, 0xFFFF);
+        const uint32_t dimension = heightMap.mDimension;
+        for(uint32_t row = 0; row < dimension; ++row) {
+            for(uint32_t column = 0; column < dimension; ++column) {
+                uint16_t& sample = heightMap.mData[row * dimension + column];
+                if(kind == 0) {
+                    sample = static_cast<uint16_t> (sampleDistribution(generator));
+                } else if(kind == 1) {
+                    sample = static_cast<uint16_t> (30000.0f + 20000.0f * sinf(row * 0.05f) * cosf(column * 0.03f));
+                } else {
+                    sample = (row + column) % 2 == 0 ? 0 : 0xFFFF;
+                }
+            }
+        }
+
+        heightMap.mScale = 0.5f;
+        heightMap.mOffset = -3.0f;
+    }
+
+    // Number of samples of heightMap that are not the dequantized samples of quantizedHeightMap
+    uint32_t countWrongHeights(const HeightMap& heightMap,
+                               const QuantizedHeightMap& quantizedHeightMap)
+    {
+        uint32_t wrongHeights = 0;
+        for(size_t i = 0; i < quantizedHeightMap.mData.size(); ++i) {
+            if(heightMap.mData[i] != quantizedHeightMap.mOffset + quantizedHeightMap.mScale * quantizedHeightMap.mData[i]) {
+                ++wrongHeights;
+            }
+        }
+
+        return wrongHeights;
+    }
+}
+
+namespace Tests
+{
+    void testCompressedHeightMap(TestResults& results)
+    {
+        std::mt19937 generator(1);
+        std::string errorMessage;
+
+        // Tiles of a single sample, tiles that do not divide the dimension and
+        // a single tile, decoded by a different number of threads than encoded.
+        const uint32_t dimensions[] = { 1, 17, 300 };
+        const uint32_t tileDimensions[] = { 1, 16, 128 };
+        uint32_t wrongHeightMaps = 0;
+        for(size_t i = 0; i < sizeof(dimensions) / sizeof(dimensions[0]); ++i) {
+            for(size_t j = 0; j < sizeof(tileDimensions) / sizeof(tileDimensions[0]); ++j) {
+                for(uint32_t kind = 0; kind < 3; ++kind) {
+                    QuantizedHeightMap heightMap(dimensions[i]);
+                    buildHeightMap(kind, generator, heightMap);
+                    if(!CompressedHeightMapUtils::saveToFile(sFilePath, heightMap, tileDimensions[j], 3, &errorMessage)) {
+                        ++wrongHeightMaps;
+                        continue;
+                    }
+
+                    QuantizedHeightMap loadedQuantizedHeightMap(0);
+                    HeightMap loadedHeightMap(0);
+                    if(!CompressedHeightMapUtils::loadFromFile(sFilePath, loadedQuantizedHeightMap, 2, &errorMessage) ||
+                       !CompressedHeightMapUtils::loadFromFile(sFilePath, loadedHeightMap, 4, &errorMessage) ||
+                       loadedQuantizedHeightMap.mDimension != heightMap.mDimension ||
+                       loadedQuantizedHeightMap.mData != heightMap.mData ||
+                       loadedQuantizedHeightMap.mScale != heightMap.mScale ||
+                       loadedQuantizedHeightMap.mOffset != heightMap.mOffset ||
+                       loadedHeightMap.mDimension != heightMap.mDimension ||
+                       countWrongHeights(loadedHeightMap, heightMap) != 0) {
+                        ++wrongHeightMaps;
+                    }
+                }
+            }
+        }
+
+        TEST_CHECK(results, wrongHeightMaps == 0);
+
+        // RAW files are loaded with the same heights as HeightMapUtils::loadFromRAWFile,
+        // and 8-bit samples compress to much less than the RAW file.
+        const uint32_t rawDimension = 257;
+        QuantizedHeightMap smoothHeightMap(rawDimension);
+        buildHeightMap(1, generator, smoothHeightMap);
+        std::vector<uint8_t> rawSamples(rawDimension * rawDimension);
+        for(size_t i = 0; i < rawSamples.size(); ++i) {
+            rawSamples[i] = static_cast<uint8_t> (smoothHeightMap.mData[i] >> 8);
+        }
+
+        std::ofstream rawFile(sRAWFilePath, std::ios_base::binary);
+        rawFile.write(reinterpret_cast<const char*> (&rawSamples[0]), rawSamples.size());
+        rawFile.close();
+
+        HeightMap rawHeightMap(rawDimension);
+        HeightMap loadedHeightMap(0);
+        TEST_CHECK(results, HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, rawHeightMap, RAWFormat::UINT8, &errorMessage));
+        TEST_CHECK(results, CompressedHeightMapUtils::compressRAWFile(sRAWFilePath,
+                                                                      rawDimension,
+                                                                      150.0f,
+                                                                      RAWFormat::UINT8,
+                                                                      sFilePath,
+                                                                      64,
+                                                                      &errorMessage));
+        TEST_CHECK(results, CompressedHeightMapUtils::loadFromFile(sFilePath, loadedHeightMap, 0, &errorMessage));
+        TEST_CHECK(results, loadedHeightMap.mDimension == rawDimension);
+
+        float maxError = 0.0f;
+        for(size_t i = 0; i < rawHeightMap.mData.size() && loadedHeightMap.mDimension == rawDimension; ++i) {
+            maxError = std::max(maxError, fabsf(loadedHeightMap.mData[i] - rawHeightMap.mData[i]));
+        }
+
+        std::vector<char> bytes;
+        {
+            std::ifstream file(sFilePath, std::ios_base::binary);
+            bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        printf("    %u x %u 8-bit RAW: %u bytes compressed to %u, error %.2e\n",
+               rawDimension,
+               rawDimension,
+               static_cast<uint32_t> (rawSamples.size()),
+               static_cast<uint32_t> (bytes.size()),
+               maxError);
+        TEST_CHECK(results, maxError <= 1.0e-4f);
+        TEST_CHECK(results, !bytes.empty() && bytes.size() < rawSamples.size() / 2);
+
+        // Too small RAW files, missing files, truncated files and files with
+        // corrupt headers are rejected.
+        TEST_CHECK(results, !CompressedHeightMapUtils::compressRAWFile(sRAWFilePath,
+                                                                       rawDimension + 1,
+                                                                       150.0f,
+                                                                       RAWFormat::UINT8,
+                                                                       sCorruptFilePath,
+                                                                       64,
+                                                                       &errorMessage));
+        TEST_CHECK(results, !CompressedHeightMapUtils::loadFromFile(sRAWFilePath, loadedHeightMap, 0, &errorMessage));
+        TEST_CHECK(results, !CompressedHeightMapUtils::loadFromFile("CompressedHeightMapTests.missing.hmc", loadedHeightMap, 0, &errorMessage));
+
+        std::uniform_int_distribution<size_t> byteDistribution(0, bytes.size() - 1);
+        uint32_t acceptedCorruptFiles = 0;
+        for(uint32_t i = 0; i < 100; ++i) {
+            std::vector<char> corruptBytes(bytes);
+            if(i % 2 == 0) {
+                corruptBytes.resize(byteDistribution(generator));
+            } else {
+                corruptBytes[byteDistribution(generator) % 16] ^= 0x10;
+            }
+
+            std::ofstream corruptFile(sCorruptFilePath, std::ios_base::binary);
+            if(!corruptBytes.empty()) {
+                corruptFile.write(&corruptBytes[0], corruptBytes.size());
+            }
+            corruptFile.close();
+
+            QuantizedHeightMap corruptHeightMap(0);
+            if(CompressedHeightMapUtils::loadFromFile(sCorruptFilePath, corruptHeightMap, 1)) {
+                ++acceptedCorruptFiles;
+            }
+        }
+
+        TEST_CHECK(results, acceptedCorruptFiles == 0);
+
+        remove(sFilePath);
+        remove(sCorruptFilePath);
+        remove(sRAWFilePath);
+    }
+}
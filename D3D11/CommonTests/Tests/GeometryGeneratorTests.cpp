@@ -0,0 +1,566 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <HeightMap.h>
+#include <ParallelUtils.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    // Single texel maps, maps smaller than a chunk, maps whose dimension - 1
+    // is not a multiple of the chunk size and maps of many chunks
+    const uint32_t sTerrainDimensions[] = { 1, 2, 5, 17, 64, 129 };
+    const uint32_t sChunkSizes[] = { 1, 2, 8, 32 };
+    const uint32_t sThreadCounts[] = { 1, 3 };
+
+    const float sCellSpacing = 2.0f;
+    const float sSkirtDepth = 3.0f;
+
+    // Grids of a single patch, a single row or column, 2 and 3 columns (no
+    // or a single inner patch) and grids of many inner patches
+    const uint32_t sInterlockingTilesSizes[][2] = {
+        { 1, 1 }, { 1, 2 }, { 2, 1 }, { 2, 2 }, { 3, 3 }, { 3, 5 }, { 7, 4 }, { 64, 64 }
+    };
+    const uint32_t sInterlockingTilesControlPoints = 12;
+
+    const uint32_t sMaxBenchmarkSubdivisions = 8;
+
+    // Tessellations in the thousands, as tooling uses
+    const uint32_t sParallelBenchmarkSlices = 1024;
+    const uint32_t sParallelBenchmarkRows = 2048;
+
+    const uint32_t sInterlockingTilesBenchmarkSizes[] = { 1024, 2048 };
+
+    struct TerrainErrors
+    {
+        TerrainErrors()
+            : mWrongLayouts(0)
+            , mWrongGridVertices(0)
+            , mWrongSkirtVertices(0)
+            , mWrongLodIndexCounts(0)
+            , mWrongWindings(0)
+            , mWrongBounds(0)
+        {
+
+        }
+
+        uint32_t mWrongLayouts;
+        uint32_t mWrongGridVertices;
+        uint32_t mWrongSkirtVertices;
+        uint32_t mWrongLodIndexCounts;
+        uint32_t mWrongWindings;
+        uint32_t mWrongBounds;
+    };
+
+    void buildHeightMap(std::mt19937& generator,
+                        HeightMap& heightMap)
+    {
+        std::uniform_real_distribution<float> bumpDistribution(0.0f, 0.1f);
+        const uint32_t dimension = heightMap.mDimension;
+        for(uint32_t row = 0; row < dimension; ++row) {
+            for(uint32_t column = 0; column < dimension; ++column) {
+                heightMap.mData[row * dimension + column] = 10.0f * sinf(row * 0.2f) +
+                                                            5.0f * cosf(column * 0.3f) +
+                                                            bumpDistribution(generator);
+            }
+        }
+    }
+
+    float fetchHeight(const HeightMap& heightMap,
+                      const uint32_t row,
+                      const uint32_t column)
+    {
+        return heightMap.mData[row * heightMap.mDimension + column];
+    }
+
+    // Vertex of the texel (row, column), with central differences
+    // (one sided on the border) for the normal, a texel at a time.
+    VertexData computeReferenceVertex(const HeightMap& heightMap,
+                                      const uint32_t row,
+                                      const uint32_t column)
+    {
+        const uint32_t lastIndex = heightMap.mDimension - 1;
+        const uint32_t leftColumn = column > 0 ? column - 1 : 0;
+        const uint32_t rightColumn = (std::min)(column + 1, lastIndex);
+        const uint32_t topRow = row > 0 ? row - 1 : 0;
+        const uint32_t bottomRow = (std::min)(row + 1, lastIndex);
+        const float heightDx = rightColumn > leftColumn ?
+            (fetchHeight(heightMap, row, rightColumn) - fetchHeight(heightMap, row, leftColumn)) / ((rightColumn - leftColumn) * sCellSpacing) :
+            0.0f;
+        const float heightDz = bottomRow > topRow ?
+            (fetchHeight(heightMap, topRow, column) - fetchHeight(heightMap, bottomRow, column)) / ((bottomRow - topRow) * sCellSpacing) :
+            0.0f;
+        const float normalLength = sqrtf(heightDx * heightDx + 1.0f + heightDz * heightDz);
+
+        // Centered at the origin, with row 0 on the +z border
+        const float halfSize = 0.5f * lastIndex * sCellSpacing;
+        VertexData vertex;
+        vertex.mPosition = DirectX::XMFLOAT3(-halfSize + column * sCellSpacing, fetchHeight(heightMap, row, column), halfSize - row * sCellSpacing);
+        vertex.mNormal = DirectX::XMFLOAT3(-heightDx / normalLength, 1.0f / normalLength, -heightDz / normalLength);
+
+        return vertex;
+    }
+
+    bool isVertex(const VertexData& vertex,
+                  const VertexData& referenceVertex,
+                  const float heightOffset)
+    {
+        return fabsf(vertex.mPosition.x - referenceVertex.mPosition.x) <= 1.0e-4f &&
+               vertex.mPosition.y == referenceVertex.mPosition.y + heightOffset &&
+               fabsf(vertex.mPosition.z - referenceVertex.mPosition.z) <= 1.0e-4f &&
+               fabsf(vertex.mNormal.x - referenceVertex.mNormal.x) <= 1.0e-5f &&
+               fabsf(vertex.mNormal.y - referenceVertex.mNormal.y) <= 1.0e-5f &&
+               fabsf(vertex.mNormal.z - referenceVertex.mNormal.z) <= 1.0e-5f;
+    }
+
+    DirectX::XMFLOAT3 computeTriangleNormal(const DirectX::XMFLOAT3& position0,
+                                            const DirectX::XMFLOAT3& position1,
+                                            const DirectX::XMFLOAT3& position2)
+    {
+        const DirectX::XMFLOAT3 edge1(position1.x - position0.x, position1.y - position0.y, position1.z - position0.z);
+        const DirectX::XMFLOAT3 edge2(position2.x - position0.x, position2.y - position0.y, position2.z - position0.z);
+
+        return DirectX::XMFLOAT3(edge1.y * edge2.z - edge1.z * edge2.y,
+                                 edge1.z * edge2.x - edge1.x * edge2.z,
+                                 edge1.x * edge2.y - edge1.y * edge2.x);
+    }
+
+    // Grid triangles face up and skirt triangles face out of the chunk,
+    // for every level of detail.
+    uint32_t countWrongWindings(const TerrainMeshData& terrainMeshData,
+                                const TerrainChunk& chunk)
+    {
+        const uint32_t gridVertexCount = (terrainMeshData.mChunkSize + 1) * (terrainMeshData.mChunkSize + 1);
+        const VertexData* vertices = &terrainMeshData.mVertices[chunk.mBaseVertex];
+        const float centerX = 0.5f * (chunk.mMinPosition.x + chunk.mMaxPosition.x);
+        const float centerZ = 0.5f * (chunk.mMinPosition.z + chunk.mMaxPosition.z);
+        uint32_t wrongWindings = 0;
+        for(size_t i = 0; i < terrainMeshData.mIndices.size(); i += 3) {
+            const uint32_t* triangle = &terrainMeshData.mIndices[i];
+            const DirectX::XMFLOAT3& position0 = vertices[triangle[0]].mPosition;
+            const DirectX::XMFLOAT3& position1 = vertices[triangle[1]].mPosition;
+            const DirectX::XMFLOAT3& position2 = vertices[triangle[2]].mPosition;
+            const DirectX::XMFLOAT3 normal = computeTriangleNormal(position0, position1, position2);
+
+            // Chunks past the height map border have degenerate triangles.
+            if(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z < 1.0e-8f) {
+                continue;
+            }
+
+            const bool skirt = triangle[0] >= gridVertexCount || triangle[1] >= gridVertexCount || triangle[2] >= gridVertexCount;
+            if(skirt) {
+                const float outX = (position0.x + position1.x + position2.x) / 3.0f - centerX;
+                const float outZ = (position0.z + position1.z + position2.z) / 3.0f - centerZ;
+                if(normal.x * outX + normal.z * outZ <= 0.0f) {
+                    ++wrongWindings;
+                }
+            } else if(normal.y <= 0.0f) {
+                ++wrongWindings;
+            }
+        }
+
+        return wrongWindings;
+    }
+
+    void checkTerrainChunks(const HeightMap& heightMap,
+                            const TerrainMeshData& terrainMeshData,
+                            TerrainErrors& errors)
+    {
+        const uint32_t dimension = heightMap.mDimension;
+        const uint32_t chunkSize = terrainMeshData.mChunkSize;
+        const uint32_t verticesPerSide = chunkSize + 1;
+        const uint32_t chunksPerSide = ((std::max)(dimension - 1, 1U) + chunkSize - 1) / chunkSize;
+        uint32_t lodCount = 0;
+        while((1U << lodCount) <= chunkSize) {
+            ++lodCount;
+        }
+
+        const uint32_t verticesPerChunk = verticesPerSide * verticesPerSide + 4 * verticesPerSide;
+        if(terrainMeshData.mChunksPerSide != chunksPerSide ||
+           terrainMeshData.mChunks.size() != chunksPerSide * chunksPerSide ||
+           terrainMeshData.mVerticesPerChunk != verticesPerChunk ||
+           terrainMeshData.mVertices.size() != terrainMeshData.mChunks.size() * verticesPerChunk ||
+           terrainMeshData.mLods.size() != lodCount) {
+            ++errors.mWrongLayouts;
+            return;
+        }
+
+        // Every LOD has 2 triangles per quad of step x step texels
+        // and 2 per skirt quad, and indices only the chunk vertices.
+        uint32_t lodIndexCount = 0;
+        for(uint32_t lod = 0; lod < lodCount; ++lod) {
+            const uint32_t quadsPerSide = chunkSize >> lod;
+            const TerrainLod& terrainLod = terrainMeshData.mLods[lod];
+            if(terrainLod.mStartIndex != lodIndexCount ||
+               terrainLod.mIndexCount != 6 * quadsPerSide * quadsPerSide + 4 * 6 * quadsPerSide) {
+                ++errors.mWrongLodIndexCounts;
+            }
+
+            lodIndexCount += terrainLod.mIndexCount;
+        }
+
+        if(terrainMeshData.mIndices.size() != lodIndexCount ||
+           *std::max_element(terrainMeshData.mIndices.begin(), terrainMeshData.mIndices.end()) >= verticesPerChunk) {
+            ++errors.mWrongLodIndexCounts;
+            return;
+        }
+
+        const float halfSize = 0.5f * (dimension - 1) * sCellSpacing;
+        for(uint32_t chunkIndex = 0; chunkIndex < terrainMeshData.mChunks.size(); ++chunkIndex) {
+            const TerrainChunk& chunk = terrainMeshData.mChunks[chunkIndex];
+            const uint32_t firstRow = (chunkIndex / chunksPerSide) * chunkSize;
+            const uint32_t firstColumn = (chunkIndex % chunksPerSide) * chunkSize;
+            const VertexData* vertices = &terrainMeshData.mVertices[chunk.mBaseVertex];
+            if(chunk.mBaseVertex != chunkIndex * verticesPerChunk) {
+                ++errors.mWrongLayouts;
+                continue;
+            }
+
+            // Grid vertices are the texels, clamped to the height map.
+            for(uint32_t row = 0; row < verticesPerSide; ++row) {
+                for(uint32_t column = 0; column < verticesPerSide; ++column) {
+                    const VertexData referenceVertex = computeReferenceVertex(heightMap,
+                                                                              (std::min)(firstRow + row, dimension - 1),
+                                                                              (std::min)(firstColumn + column, dimension - 1));
+                    if(!isVertex(vertices[row * verticesPerSide + column], referenceVertex, 0.0f)) {
+                        ++errors.mWrongGridVertices;
+                    }
+                }
+            }
+
+            // Skirt vertices are on the chunk border (clamped to the height
+            // map, as its grid vertices are), skirtDepth below its texels.
+            const uint32_t lastRow = (std::min)(firstRow + chunkSize, dimension - 1) - firstRow;
+            const uint32_t lastColumn = (std::min)(firstColumn + chunkSize, dimension - 1) - firstColumn;
+            for(uint32_t i = verticesPerSide * verticesPerSide; i < verticesPerChunk; ++i) {
+                const VertexData& vertex = vertices[i];
+                const float column = (vertex.mPosition.x + halfSize) / sCellSpacing - firstColumn;
+                const float row = (halfSize - vertex.mPosition.z) / sCellSpacing - firstRow;
+                const uint32_t nearestColumn = static_cast<uint32_t> (floorf(column + 0.5f));
+                const uint32_t nearestRow = static_cast<uint32_t> (floorf(row + 0.5f));
+                const bool onBorder = nearestRow == 0 || nearestRow == lastRow || nearestColumn == 0 || nearestColumn == lastColumn;
+                if(column < -0.5f || row < -0.5f || nearestColumn > lastColumn || nearestRow > lastRow || !onBorder) {
+                    ++errors.mWrongSkirtVertices;
+                    continue;
+                }
+
+                const VertexData referenceVertex = computeReferenceVertex(heightMap, firstRow + nearestRow, firstColumn + nearestColumn);
+                if(!isVertex(vertex, referenceVertex, -sSkirtDepth)) {
+                    ++errors.mWrongSkirtVertices;
+                }
+            }
+
+            errors.mWrongWindings += countWrongWindings(terrainMeshData, chunk);
+
+            // Bounds contain the chunk vertices. They are exact but for their
+            // bottom, that is skirtDepth below the lowest grid vertex.
+            DirectX::XMFLOAT3 minPosition = vertices[0].mPosition;
+            DirectX::XMFLOAT3 maxPosition = vertices[0].mPosition;
+            for(uint32_t i = 1; i < verticesPerChunk; ++i) {
+                const DirectX::XMFLOAT3& position = vertices[i].mPosition;
+                minPosition = DirectX::XMFLOAT3((std::min)(minPosition.x, position.x), (std::min)(minPosition.y, position.y), (std::min)(minPosition.z, position.z));
+                maxPosition = DirectX::XMFLOAT3((std::max)(maxPosition.x, position.x), (std::max)(maxPosition.y, position.y), (std::max)(maxPosition.z, position.z));
+            }
+
+            if(chunk.mMinPosition.x != minPosition.x ||
+               chunk.mMinPosition.y > minPosition.y ||
+               chunk.mMinPosition.z != minPosition.z ||
+               memcmp(&maxPosition, &chunk.mMaxPosition, sizeof(maxPosition)) != 0) {
+                ++errors.mWrongBounds;
+            }
+        }
+    }
+
+    uint32_t clampToGrid(const int32_t index,
+                         const uint32_t lastIndex)
+    {
+        return static_cast<uint32_t> ((std::min)((std::max)(index, 0), static_cast<int32_t> (lastIndex)));
+    }
+
+    // Control points of patch (row, column), computed one by one.
+    void buildControlPoints(const uint32_t numRows,
+                            const uint32_t numColumns,
+                            const uint32_t row,
+                            const uint32_t column,
+                            uint32_t* controlPoints)
+    {
+        const int32_t rows[] = { 0, 0, 1, 1, 2, 2, 0, 1, -1, -1, 0, 1 };
+        const int32_t columns[] = { 0, 1, 0, 1, 0, 1, 2, 2, 0, 1, -1, -1 };
+        for(uint32_t i = 0; i < sInterlockingTilesControlPoints; ++i) {
+            const uint32_t controlPointRow = clampToGrid(static_cast<int32_t> (row) + rows[i], numRows);
+            const uint32_t controlPointColumn = clampToGrid(static_cast<int32_t> (column) + columns[i], numColumns);
+            controlPoints[i] = controlPointRow * (numColumns + 1) + controlPointColumn;
+        }
+    }
+
+    // Number of patches whose 12 control points, whose compact base index or whose
+    // control points reconstructed from it are wrong, and whether the grids have
+    // the vertices of generateGrid.
+    uint32_t countWrongInterlockingTilesPatches(const uint32_t numRows,
+                                                const uint32_t numColumns,
+                                                bool& wrongVertices)
+    {
+        MeshData gridMeshData;
+        MeshData meshData;
+        MeshData compactMeshData;
+        GeometryGenerator::generateGrid(40.0f, 30.0f, numRows, numColumns, gridMeshData);
+        GeometryGenerator::generateGridForInterlockingTiles(40.0f, 30.0f, numRows, numColumns, meshData);
+        GeometryGenerator::generateGridForInterlockingTilesCompact(40.0f, 30.0f, numRows, numColumns, compactMeshData);
+
+        const size_t vertexBytes = gridMeshData.mVertices.size() * sizeof(VertexData);
+        wrongVertices = meshData.mVertices.size() != gridMeshData.mVertices.size() ||
+                        compactMeshData.mVertices.size() != gridMeshData.mVertices.size() ||
+                        memcmp(&meshData.mVertices[0], &gridMeshData.mVertices[0], vertexBytes) != 0 ||
+                        memcmp(&compactMeshData.mVertices[0], &gridMeshData.mVertices[0], vertexBytes) != 0;
+
+        const uint32_t patchCount = numRows * numColumns;
+        if(meshData.mIndices.size() != patchCount * sInterlockingTilesControlPoints ||
+           compactMeshData.mIndices.size() != patchCount) {
+            return patchCount;
+        }
+
+        uint32_t wrongPatches = 0;
+        for(uint32_t patchId = 0; patchId < patchCount; ++patchId) {
+            uint32_t controlPoints[sInterlockingTilesControlPoints];
+            uint32_t reconstructedControlPoints[sInterlockingTilesControlPoints];
+            buildControlPoints(numRows, numColumns, patchId / numColumns, patchId % numColumns, controlPoints);
+            const uint32_t baseIndex = compactMeshData.mIndices[patchId];
+            GeometryGenerator::computeInterlockingTilesControlPoints(numRows, numColumns, baseIndex, reconstructedControlPoints);
+            if(memcmp(&meshData.mIndices[patchId * sInterlockingTilesControlPoints], controlPoints, sizeof(controlPoints)) != 0 ||
+               baseIndex != patchId + patchId / numColumns ||
+               memcmp(reconstructedControlPoints, controlPoints, sizeof(controlPoints)) != 0) {
+                ++wrongPatches;
+            }
+        }
+
+        return wrongPatches;
+    }
+
+    // Time of the interlocking tiles grids, with the 12 control points built by the
+    // row builder, that writes inner patches 4 control points at a time, and built
+    // patch by patch from the compact grid, and of the compact grid alone.
+    void benchmarkInterlockingTiles()
+    {
+        for(size_t i = 0; i < sizeof(sInterlockingTilesBenchmarkSizes) / sizeof(sInterlockingTilesBenchmarkSizes[0]); ++i) {
+            const uint32_t size = sInterlockingTilesBenchmarkSizes[i];
+            MeshData meshData;
+            MeshData compactMeshData;
+            std::vector<uint32_t> indices(size * size * sInterlockingTilesControlPoints);
+            const double vectorTime = TestUtils::measureMilliseconds(3, [&]() {
+                GeometryGenerator::generateGridForInterlockingTiles(1000.0f, 1000.0f, size, size, meshData);
+            });
+            const double scalarTime = TestUtils::measureMilliseconds(3, [&]() {
+                GeometryGenerator::generateGridForInterlockingTilesCompact(1000.0f, 1000.0f, size, size, compactMeshData);
+                for(size_t patchId = 0; patchId < compactMeshData.mIndices.size(); ++patchId) {
+                    GeometryGenerator::computeInterlockingTilesControlPoints(size,
+                                                                             size,
+                                                                             compactMeshData.mIndices[patchId],
+                                                                             &indices[patchId * sInterlockingTilesControlPoints]);
+                }
+            });
+            const double compactTime = TestUtils::measureMilliseconds(3, [&]() {
+                GeometryGenerator::generateGridForInterlockingTilesCompact(1000.0f, 1000.0f, size, size, compactMeshData);
+            });
+
+            printf("    interlocking tiles %4u x %4u: row builder %7.2f ms, per patch %7.2f ms, %6.2f MB indices; compact %7.2f ms, %5.2f MB indices\n",
+                   size,
+                   size,
+                   vectorTime,
+                   scalarTime,
+                   meshData.mIndices.size() * sizeof(uint32_t) / (1024.0 * 1024.0),
+                   compactTime,
+                   compactMeshData.mIndices.size() * sizeof(uint32_t) / (1024.0 * 1024.0));
+        }
+    }
+
+    uint64_t computeMeshBytes(const MeshData& meshData)
+    {
+        return meshData.mVertices.size() * sizeof(VertexData) + meshData.mIndices.size() * sizeof(uint32_t);
+    }
+
+    // Vertex count, memory and time of every geosphere subdivision level,
+    // with split and welded subdivision.
+    void benchmarkGeosphereSubdivision()
+    {
+        for(uint32_t numSubdivisions = 0; numSubdivisions <= sMaxBenchmarkSubdivisions; ++numSubdivisions) {
+            const uint32_t repetitions = numSubdivisions < 6 ? 10 : 2;
+            MeshData splitMeshData;
+            MeshData weldedMeshData;
+            const double splitTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                GeometryGenerator::generateGeosphere(1.0f, numSubdivisions, splitMeshData, GeometryGenerator::SubdivisionMode::SPLIT);
+            });
+            const double weldedTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                GeometryGenerator::generateGeosphere(1.0f, numSubdivisions, weldedMeshData, GeometryGenerator::SubdivisionMode::WELDED);
+            });
+
+            printf("    geosphere %u subdivisions: split %8u vertices %7.2f MB %8.2f ms, welded %8u vertices %7.2f MB %8.2f ms\n",
+                   numSubdivisions,
+                   static_cast<uint32_t> (splitMeshData.mVertices.size()),
+                   computeMeshBytes(splitMeshData) / (1024.0 * 1024.0),
+                   splitTime,
+                   static_cast<uint32_t> (weldedMeshData.mVertices.size()),
+                   computeMeshBytes(weldedMeshData) / (1024.0 * 1024.0),
+                   weldedTime);
+        }
+    }
+
+    // Time of the serial generator and of the parallel one, from 1 thread
+    // up to all the hardware threads, doubling them.
+    void benchmarkParallelGenerator(const char* name,
+                                    const std::function<void(MeshData&)>& generateSerial,
+                                    const std::function<void(const uint32_t numThreads, MeshData&)>& generateParallel)
+    {
+        MeshData meshData;
+        const double serialTime = TestUtils::measureMilliseconds(3, [&]() {
+            generateSerial(meshData);
+        });
+
+        printf("    %-28s %8u vertices: serial %8.2f ms\n",
+               name,
+               static_cast<uint32_t> (meshData.mVertices.size()),
+               serialTime);
+
+        std::vector<uint32_t> threadCounts;
+        const uint32_t maxThreadCount = ParallelUtils::defaultThreadCount();
+        for(uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2) {
+            threadCounts.push_back(threadCount);
+        }
+
+        threadCounts.push_back(maxThreadCount);
+        for(size_t i = 0; i < threadCounts.size(); ++i) {
+            const uint32_t threadCount = threadCounts[i];
+            const double parallelTime = TestUtils::measureMilliseconds(3, [&]() {
+                generateParallel(threadCount, meshData);
+            });
+
+            printf("    %-28s %2u threads: %8.2f ms (%.2fx serial)\n",
+                   name,
+                   threadCount,
+                   parallelTime,
+                   serialTime / parallelTime);
+        }
+    }
+
+    bool haveSameVertices(const TerrainMeshData& terrainMeshData,
+                          const TerrainMeshData& otherTerrainMeshData)
+    {
+        return terrainMeshData.mVertices.size() == otherTerrainMeshData.mVertices.size() &&
+               memcmp(&terrainMeshData.mVertices[0],
+                      &otherTerrainMeshData.mVertices[0],
+                      terrainMeshData.mVertices.size() * sizeof(VertexData)) == 0 &&
+               terrainMeshData.mIndices == otherTerrainMeshData.mIndices;
+    }
+}
+
+namespace Tests
+{
+    void testGeometryGenerator(TestResults& results)
+    {
+        // Terrain chunks of every size, over maps of every dimension,
+        // built by every number of threads
+        std::mt19937 generator(1);
+        TerrainErrors errors;
+        uint32_t wrongThreadedChunks = 0;
+        uint32_t numTerrains = 0;
+        for(size_t i = 0; i < sizeof(sTerrainDimensions) / sizeof(sTerrainDimensions[0]); ++i) {
+            HeightMap heightMap(sTerrainDimensions[i]);
+            buildHeightMap(generator, heightMap);
+            for(size_t j = 0; j < sizeof(sChunkSizes) / sizeof(sChunkSizes[0]); ++j) {
+                TerrainMeshData singleThreadMeshData;
+                for(size_t k = 0; k < sizeof(sThreadCounts) / sizeof(sThreadCounts[0]); ++k) {
+                    TerrainMeshData terrainMeshData;
+                    GeometryGenerator::generateTerrainChunks(heightMap,
+                                                             sChunkSizes[j],
+                                                             sCellSpacing,
+                                                             sSkirtDepth,
+                                                             sThreadCounts[k],
+                                                             terrainMeshData);
+                    checkTerrainChunks(heightMap, terrainMeshData, errors);
+                    ++numTerrains;
+                    if(k == 0) {
+                        singleThreadMeshData = terrainMeshData;
+                    } else if(!haveSameVertices(terrainMeshData, singleThreadMeshData)) {
+                        ++wrongThreadedChunks;
+                    }
+                }
+            }
+        }
+
+        printf("    %u terrains: %u wrong layouts, %u wrong grid vertices, %u wrong skirt vertices, %u wrong LOD index counts\n",
+               numTerrains,
+               errors.mWrongLayouts,
+               errors.mWrongGridVertices,
+               errors.mWrongSkirtVertices,
+               errors.mWrongLodIndexCounts);
+        printf("    %u wrong windings, %u wrong bounds, %u wrong threaded terrains\n",
+               errors.mWrongWindings,
+               errors.mWrongBounds,
+               wrongThreadedChunks);
+        TEST_CHECK(results, errors.mWrongLayouts == 0);
+        TEST_CHECK(results, errors.mWrongGridVertices == 0);
+        TEST_CHECK(results, errors.mWrongSkirtVertices == 0);
+        TEST_CHECK(results, errors.mWrongLodIndexCounts == 0);
+        TEST_CHECK(results, errors.mWrongWindings == 0);
+        TEST_CHECK(results, errors.mWrongBounds == 0);
+        TEST_CHECK(results, wrongThreadedChunks == 0);
+
+        // Interlocking tiles grids have the generateGrid vertices, and the
+        // 12 control points and the compact base index of every patch.
+        uint32_t wrongInterlockingTilesPatches = 0;
+        uint32_t wrongInterlockingTilesGrids = 0;
+        for(size_t i = 0; i < sizeof(sInterlockingTilesSizes) / sizeof(sInterlockingTilesSizes[0]); ++i) {
+            bool wrongVertices = false;
+            wrongInterlockingTilesPatches += countWrongInterlockingTilesPatches(sInterlockingTilesSizes[i][0],
+                                                                                sInterlockingTilesSizes[i][1],
+                                                                                wrongVertices);
+            if(wrongVertices) {
+                ++wrongInterlockingTilesGrids;
+            }
+        }
+
+        printf("    interlocking tiles: %u wrong patches, %u wrong grid vertices\n",
+               wrongInterlockingTilesPatches,
+               wrongInterlockingTilesGrids);
+        TEST_CHECK(results, wrongInterlockingTilesPatches == 0);
+        TEST_CHECK(results, wrongInterlockingTilesGrids == 0);
+    }
+
+    void benchmarkGeometryGenerator()
+    {
+        benchmarkGeosphereSubdivision();
+        benchmarkInterlockingTiles();
+
+        const uint32_t slices = sParallelBenchmarkSlices;
+        const uint32_t rows = sParallelBenchmarkRows;
+        benchmarkParallelGenerator("sphere 1024 x 1024",
+                                   [slices](MeshData& meshData) {
+            GeometryGenerator::generateSphere(1.0f, slices, slices, meshData);
+        },
+                                   [slices](const uint32_t numThreads, MeshData& meshData) {
+            GeometryGenerator::generateSphereParallel(1.0f, slices, slices, numThreads, meshData);
+        });
+        benchmarkParallelGenerator("cylinder 1024 x 1024",
+                                   [slices](MeshData& meshData) {
+            GeometryGenerator::generateCylinder(0.5f, 0.3f, 3.0f, slices, slices, meshData);
+        },
+                                   [slices](const uint32_t numThreads, MeshData& meshData) {
+            GeometryGenerator::generateCylinderParallel(0.5f, 0.3f, 3.0f, slices, slices, numThreads, meshData);
+        });
+        benchmarkParallelGenerator("grid 2048 x 2048",
+                                   [rows](MeshData& meshData) {
+            GeometryGenerator::generateGrid(1000.0f, 1000.0f, rows, rows, meshData);
+        },
+                                   [rows](const uint32_t numThreads, MeshData& meshData) {
+            GeometryGenerator::generateGridParallel(1000.0f, 1000.0f, rows, rows, numThreads, meshData);
+        });
+    }
+}
@@ -0,0 +1,216 @@
+#include "Tests.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <HalfConversion.h>
+#include <ParallelUtils.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    // Large enough to be split across threads
+    const uint32_t sBulkCount = 1000003;
+    const uint32_t sBenchmarkCount = 16 * 1024 * 1024;
+
+    bool isNaNHalf(const uint16_t value)
+    {
+        return (value & 0x7C00) == 0x7C00 && (value & 0x3FF) != 0;
+    }
+
+    // Value of a finite half, computed from its fields.
+    float computeHalfValue(const uint16_t value)
+    {
+        const int exponent = (value >> 10) & 0x1F;
+        const int mantissa = value & 0x3FF;
+        const float magnitude = exponent == 0 ? ldexpf(static_cast<float> (mantissa), -24)
+                                              : ldexpf(static_cast<float> (1024 + mantissa), exponent - 25);
+        return (value & 0x8000) != 0 ? -magnitude : magnitude;
+    }
+
+    uint32_t toBits(const float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float fromBits(const uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Random floats around the half range, with denormals, infinities and NaNs.
+    void buildFloats(std::vector<float>& values)
+    {
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> exponentDistribution(-30.0f, 17.0f);
+        std::uniform_real_distribution<float> mantissaDistribution(-2.0f, 2.0f);
+        for(size_t i = 0; i < values.size(); ++i) {
+            values[i] = mantissaDistribution(generator) * exp2f(exponentDistribution(generator));
+        }
+
+        for(size_t i = 0; i < values.size(); i += 997) {
+            values[i] = i % 3 == 0 ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN();
+        }
+    }
+}
+
+namespace Tests
+{
+    void testHalfConversion(TestResults& results)
+    {
+        // Every half converts to its exact float value and back to itself.
+        // NaNs stay NaNs with their payload, made quiet.
+        std::vector<uint16_t> halves(65536);
+        for(uint32_t i = 0; i < 65536; ++i) {
+            halves[i] = static_cast<uint16_t> (i);
+        }
+
+        std::vector<float> floats(65536);
+        std::vector<uint16_t> roundTripHalves(65536);
+        HalfConversionUtils::convertHalfToFloat(&halves[0], 65536, &floats[0]);
+        HalfConversionUtils::convertFloatToHalf(&floats[0], 65536, &roundTripHalves[0]);
+        uint32_t wrongFloats = 0;
+        uint32_t wrongRoundTrips = 0;
+        for(uint32_t i = 0; i < 65536; ++i) {
+            const uint16_t half = halves[i];
+            if(floats[i] != HalfConversionUtils::convertHalfToFloat(half) && !isNaNHalf(half)) {
+                ++wrongFloats;
+            }
+
+            if(isNaNHalf(half)) {
+                if(floats[i] == floats[i] || roundTripHalves[i] != (half | 0x200)) {
+                    ++wrongRoundTrips;
+                }
+            } else if((half & 0x7FFF) == 0x7C00) {
+                if(!std::isinf(floats[i]) || roundTripHalves[i] != half) {
+                    ++wrongRoundTrips;
+                }
+            } else if(toBits(floats[i]) != toBits(computeHalfValue(half)) || roundTripHalves[i] != half) {
+                ++wrongRoundTrips;
+            }
+        }
+
+        printf("    65536 halves: %u wrong floats, %u wrong round trips\n", wrongFloats, wrongRoundTrips);
+        TEST_CHECK(results, wrongFloats == 0);
+        TEST_CHECK(results, wrongRoundTrips == 0);
+
+        // Floats between consecutive finite halves round to the nearest one,
+        // and the ones halfway to the even one, of both signs.
+        uint32_t wrongRoundings = 0;
+        for(uint32_t half = 0; half < 0x7BFF; ++half) {
+            const float low = computeHalfValue(static_cast<uint16_t> (half));
+            const float high = computeHalfValue(static_cast<uint16_t> (half + 1));
+            const float halfway = 0.5f * (low + high);
+            const uint16_t even = static_cast<uint16_t> ((half & 1) == 0 ? half : half + 1);
+            for(uint32_t negative = 0; negative < 2; ++negative) {
+                const uint32_t sign = negative == 0 ? 0 : 0x8000;
+                const float direction = negative == 0 ? 1.0f : -1.0f;
+                if(HalfConversionUtils::convertFloatToHalf(direction * low) != (sign | half) ||
+                   HalfConversionUtils::convertFloatToHalf(direction * nextafterf(halfway, 0.0f)) != (sign | half) ||
+                   HalfConversionUtils::convertFloatToHalf(direction * nextafterf(halfway, high)) != (sign | (half + 1)) ||
+                   HalfConversionUtils::convertFloatToHalf(direction * halfway) != (sign | even)) {
+                    ++wrongRoundings;
+                }
+            }
+        }
+
+        printf("    %u wrong roundings between finite halves\n", wrongRoundings);
+        TEST_CHECK(results, wrongRoundings == 0);
+
+        // Ties, denormals, the largest half and the overflow threshold
+        const float infinity = std::numeric_limits<float>::infinity();
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(1.0f + ldexpf(1.0f, -11)) == 0x3C00);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(1.0f + 3.0f * ldexpf(1.0f, -11)) == 0x3C02);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(ldexpf(1.0f, -24)) == 0x0001);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(ldexpf(1.0f, -25)) == 0x0000);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(nextafterf(ldexpf(1.0f, -25), 1.0f)) == 0x0001);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(1.5f * ldexpf(1.0f, -24)) == 0x0002);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(-1023.0f * ldexpf(1.0f, -24)) == 0x83FF);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(ldexpf(1.0f, -14)) == 0x0400);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(fromBits(1)) == 0x0000);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(-0.0f) == 0x8000);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(65504.0f) == 0x7BFF);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(nextafterf(65520.0f, 0.0f)) == 0x7BFF);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(65520.0f) == 0x7C00);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(-65520.0f) == 0xFC00);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(3.0e38f) == 0x7C00);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(infinity) == 0x7C00);
+        TEST_CHECK(results, HalfConversionUtils::convertFloatToHalf(-infinity) == 0xFC00);
+        TEST_CHECK(results, isNaNHalf(HalfConversionUtils::convertFloatToHalf(std::numeric_limits<float>::quiet_NaN())));
+        TEST_CHECK(results, isNaNHalf(HalfConversionUtils::convertFloatToHalf(fromBits(0xFF800001))));
+        TEST_CHECK(results, HalfConversionUtils::convertHalfToFloat(0x7C00) == infinity);
+        TEST_CHECK(results, HalfConversionUtils::convertHalfToFloat(0xFC00) == -infinity);
+
+        // Threaded conversions match the single thread ones, which match the
+        // scalar ones (so the F16C path, when it is built, matches too).
+        std::vector<float> bulkFloats(sBulkCount);
+        buildFloats(bulkFloats);
+        std::vector<uint16_t> singleThreadHalves(sBulkCount);
+        std::vector<float> singleThreadFloats(sBulkCount);
+        HalfConversionUtils::convertFloatToHalf(&bulkFloats[0], sBulkCount, &singleThreadHalves[0], 1);
+        HalfConversionUtils::convertHalfToFloat(&singleThreadHalves[0], sBulkCount, &singleThreadFloats[0], 1);
+
+        uint32_t wrongSingleThreadHalves = 0;
+        for(uint32_t i = 0; i < sBulkCount; ++i) {
+            if(singleThreadHalves[i] != HalfConversionUtils::convertFloatToHalf(bulkFloats[i])) {
+                ++wrongSingleThreadHalves;
+            }
+        }
+
+        TEST_CHECK(results, wrongSingleThreadHalves == 0);
+
+        const uint32_t threadCounts[] = { 2, 3, 7, 0 };
+        uint32_t wrongThreadedConversions = 0;
+        for(size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); ++i) {
+            std::vector<uint16_t> threadedHalves(sBulkCount);
+            std::vector<float> threadedFloats(sBulkCount);
+            HalfConversionUtils::convertFloatToHalf(&bulkFloats[0], sBulkCount, &threadedHalves[0], threadCounts[i]);
+            HalfConversionUtils::convertHalfToFloat(&threadedHalves[0], sBulkCount, &threadedFloats[0], threadCounts[i]);
+            if(threadedHalves != singleThreadHalves ||
+               memcmp(&threadedFloats[0], &singleThreadFloats[0], sBulkCount * sizeof(float)) != 0) {
+                ++wrongThreadedConversions;
+            }
+        }
+
+        TEST_CHECK(results, wrongThreadedConversions == 0);
+    }
+
+    void benchmarkHalfConversion()
+    {
+        std::vector<float> floats(sBenchmarkCount);
+        buildFloats(floats);
+        std::vector<uint16_t> halves(sBenchmarkCount);
+
+        const uint32_t threadCounts[] = { 1, ParallelUtils::defaultThreadCount() };
+        for(size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); ++i) {
+            const uint32_t threadCount = threadCounts[i];
+            if(i > 0 && threadCount == threadCounts[0]) {
+                continue;
+            }
+
+            const double floatToHalfTime = TestUtils::measureMilliseconds(5, [&]() {
+                HalfConversionUtils::convertFloatToHalf(&floats[0], sBenchmarkCount, &halves[0], threadCount);
+            });
+            const double halfToFloatTime = TestUtils::measureMilliseconds(5, [&]() {
+                HalfConversionUtils::convertHalfToFloat(&halves[0], sBenchmarkCount, &floats[0], threadCount);
+            });
+
+            printf("    %u values, %2u threads: float to half %7.2f ms (%6.0f M/s), half to float %7.2f ms (%6.0f M/s)\n",
+                   sBenchmarkCount,
+                   threadCount,
+                   floatToHalfTime,
+                   sBenchmarkCount / (1000.0 * floatToHalfTime),
+                   halfToFloatTime,
+                   sBenchmarkCount / (1000.0 * halfToFloatTime));
+        }
+    }
+}
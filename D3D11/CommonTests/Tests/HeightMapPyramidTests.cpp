@@ -0,0 +1,382 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <DirectXMath.h>
+#include <random>
+#include <vector>
+
+#include <HeightMap.h>
+#include <HeightMapPyramid.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    // Brute force rays test every cell, so they are only timed on the smallest map.
+    const uint32_t sBenchmarkDimensions[] = { 1025, 4097 };
+    const uint32_t sBenchmarkRectangleCount = 200;
+    const uint32_t sBenchmarkRayCount = 20;
+
+    struct Rectangle
+    {
+        uint32_t mFromRow;
+        uint32_t mFromColumn;
+        uint32_t mToRow;
+        uint32_t mToColumn;
+    };
+
+    // Smooth hills with noise, so neighbor samples differ and
+    // ranges of different rectangles are different.
+    void buildHeightMap(std::mt19937& generator,
+                        HeightMap& heightMap)
+    {
+        std::uniform_real_distribution<float> noise(0.0f, 5.0f);
+        const uint32_t dimension = heightMap.mDimension;
+        for(uint32_t row = 0; row < dimension; ++row) {
+            for(uint32_t column = 0; column < dimension; ++column) {
+                heightMap.mData[row * dimension + column] = 20.0f * sinf(row * 0.1f) * cosf(column * 0.07f) + noise(generator);
+            }
+        }
+    }
+
+    HeightRange computeBruteForceRange(const HeightMap& heightMap,
+                                       const uint32_t fromRow,
+                                       const uint32_t fromColumn,
+                                       const uint32_t toRow,
+                                       const uint32_t toColumn)
+    {
+        HeightRange range;
+        for(uint32_t row = fromRow; row <= toRow; ++row) {
+            for(uint32_t column = fromColumn; column <= toColumn; ++column) {
+                const float height = heightMap.mData[row * heightMap.mDimension + column];
+                range.mMin = std::min(range.mMin, height);
+                range.mMax = std::max(range.mMax, height);
+            }
+        }
+
+        return range;
+    }
+
+    DirectX::XMVECTOR loadSample(const HeightMap& heightMap,
+                                 const uint32_t row,
+                                 const uint32_t column)
+    {
+        return DirectX::XMVectorSet(static_cast<float> (column),
+                                    heightMap.mData[row * heightMap.mDimension + column],
+                                    static_cast<float> (row),
+                                    0.0f);
+    }
+
+    // Moller-Trumbore ray triangle intersection. Returns a negative
+    // distance if the ray does not hit the triangle.
+    float intersectTriangle(DirectX::FXMVECTOR origin,
+                            DirectX::FXMVECTOR direction,
+                            DirectX::FXMVECTOR vertex0,
+                            DirectX::GXMVECTOR vertex1,
+                            DirectX::HXMVECTOR vertex2)
+    {
+        const DirectX::XMVECTOR edge1 = DirectX::XMVectorSubtract(vertex1, vertex0);
+        const DirectX::XMVECTOR edge2 = DirectX::XMVectorSubtract(vertex2, vertex0);
+        const DirectX::XMVECTOR p = DirectX::XMVector3Cross(direction, edge2);
+        const float determinant = DirectX::XMVectorGetX(DirectX::XMVector3Dot(edge1, p));
+        if(fabsf(determinant) < 1.0e-12f) {
+            return -1.0f;
+        }
+
+        const DirectX::XMVECTOR s = DirectX::XMVectorSubtract(origin, vertex0);
+        const float u = DirectX::XMVectorGetX(DirectX::XMVector3Dot(s, p)) / determinant;
+        if(u < 0.0f || u > 1.0f) {
+            return -1.0f;
+        }
+
+        const DirectX::XMVECTOR q = DirectX::XMVector3Cross(s, edge1);
+        const float v = DirectX::XMVectorGetX(DirectX::XMVector3Dot(direction, q)) / determinant;
+        if(v < 0.0f || u + v > 1.0f) {
+            return -1.0f;
+        }
+
+        return DirectX::XMVectorGetX(DirectX::XMVector3Dot(edge2, q)) / determinant;
+    }
+
+    // Nearest hit of every cell triangle (split as in GeometryGenerator::generateGrid),
+    // or a negative distance if the ray misses the terrain.
+    float intersectBruteForce(const HeightMap& heightMap,
+                              const DirectX::XMFLOAT3& origin,
+                              const DirectX::XMFLOAT3& direction)
+    {
+        const DirectX::XMVECTOR rayOrigin = DirectX::XMLoadFloat3(&origin);
+        const DirectX::XMVECTOR rayDirection = DirectX::XMLoadFloat3(&direction);
+
+        float nearestDistance = -1.0f;
+        for(uint32_t row = 0; row + 1 < heightMap.mDimension; ++row) {
+            for(uint32_t column = 0; column + 1 < heightMap.mDimension; ++column) {
+                const DirectX::XMVECTOR sample00 = loadSample(heightMap, row, column);
+                const DirectX::XMVECTOR sample01 = loadSample(heightMap, row, column + 1);
+                const DirectX::XMVECTOR sample10 = loadSample(heightMap, row + 1, column);
+                const DirectX::XMVECTOR sample11 = loadSample(heightMap, row + 1, column + 1);
+
+                const float distances[] = {
+                    intersectTriangle(rayOrigin, rayDirection, sample00, sample01, sample10),
+                    intersectTriangle(rayOrigin, rayDirection, sample10, sample01, sample11),
+                };
+
+                for(size_t i = 0; i < 2; ++i) {
+                    if(distances[i] >= 0.0f && (nearestDistance < 0.0f || distances[i] < nearestDistance)) {
+                        nearestDistance = distances[i];
+                    }
+                }
+            }
+        }
+
+        return nearestDistance;
+    }
+
+    // Random rectangles of at least 2x2 samples
+    Rectangle buildRectangle(const uint32_t dimension,
+                             std::mt19937& generator)
+    {
+        std::uniform_int_distribution<uint32_t> sampleDistribution(0, dimension - 1);
+        Rectangle rectangle;
+        do {
+            rectangle.mFromRow = sampleDistribution(generator);
+            rectangle.mToRow = sampleDistribution(generator);
+            rectangle.mFromColumn = sampleDistribution(generator);
+            rectangle.mToColumn = sampleDistribution(generator);
+        } while(rectangle.mFromRow == rectangle.mToRow || rectangle.mFromColumn == rectangle.mToColumn);
+
+        if(rectangle.mFromRow > rectangle.mToRow) {
+            std::swap(rectangle.mFromRow, rectangle.mToRow);
+        }
+
+        if(rectangle.mFromColumn > rectangle.mToColumn) {
+            std::swap(rectangle.mFromColumn, rectangle.mToColumn);
+        }
+
+        return rectangle;
+    }
+
+    // Random rays from above the terrain, aimed at random points of its base plane,
+    // so most of them hit it (from above or through its sides) and some graze it.
+    void buildRay(const uint32_t dimension,
+                  std::mt19937& generator,
+                  DirectX::XMFLOAT3& origin,
+                  DirectX::XMFLOAT3& direction)
+    {
+        std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+        const float cellDimension = static_cast<float> (dimension - 1);
+        origin = DirectX::XMFLOAT3(unitDistribution(generator) * cellDimension,
+                                   40.0f + unitDistribution(generator) * 20.0f,
+                                   unitDistribution(generator) * cellDimension);
+        direction = DirectX::XMFLOAT3(unitDistribution(generator) * cellDimension - origin.x,
+                                      -origin.y,
+                                      unitDistribution(generator) * cellDimension - origin.z);
+    }
+
+    void testPyramid(const uint32_t dimension,
+                     std::mt19937& generator,
+                     TestResults& results)
+    {
+        HeightMap heightMap(dimension);
+        buildHeightMap(generator, heightMap);
+
+        HeightMapPyramid pyramid;
+        HeightMapPyramidUtils::build(heightMap, pyramid, 3);
+        TEST_CHECK(results, pyramid.mCellDimension == dimension - 1);
+        TEST_CHECK(results, pyramid.mLevelDimensions.back() == 1);
+
+        uint32_t wrongRanges = 0;
+        uint32_t wrongConservativeRanges = 0;
+        for(uint32_t i = 0; i < 1000; ++i) {
+            const Rectangle rectangle = buildRectangle(dimension, generator);
+            const uint32_t fromRow = rectangle.mFromRow;
+            const uint32_t fromColumn = rectangle.mFromColumn;
+            const uint32_t toRow = rectangle.mToRow;
+            const uint32_t toColumn = rectangle.mToColumn;
+
+            const HeightRange expectedRange = computeBruteForceRange(heightMap, fromRow, fromColumn, toRow, toColumn);
+            const HeightRange range = HeightMapPyramidUtils::computeRange(pyramid, fromRow, fromColumn, toRow, toColumn);
+            if(range.mMin != expectedRange.mMin || range.mMax != expectedRange.mMax) {
+                ++wrongRanges;
+            }
+
+            const HeightRange conservativeRange = HeightMapPyramidUtils::computeConservativeRange(pyramid, fromRow, fromColumn, toRow, toColumn);
+            if(conservativeRange.mMin > expectedRange.mMin || conservativeRange.mMax < expectedRange.mMax) {
+                ++wrongConservativeRanges;
+            }
+        }
+
+        TEST_CHECK(results, wrongRanges == 0);
+        TEST_CHECK(results, wrongConservativeRanges == 0);
+
+        uint32_t hits = 0;
+        uint32_t wrongRays = 0;
+        for(uint32_t i = 0; i < 300; ++i) {
+            DirectX::XMFLOAT3 origin;
+            DirectX::XMFLOAT3 direction;
+            buildRay(dimension, generator, origin, direction);
+
+            const float expectedDistance = intersectBruteForce(heightMap, origin, direction);
+            float distance;
+            const bool hit = HeightMapPyramidUtils::intersectRay(heightMap, pyramid, origin, direction, FLT_MAX, distance);
+            if(hit) {
+                ++hits;
+            }
+
+            if(hit != (expectedDistance >= 0.0f) ||
+               (hit && fabsf(distance - expectedDistance) > 1.0e-3f * std::max(1.0f, expectedDistance))) {
+                ++wrongRays;
+            }
+        }
+
+        printf("    %4u x %-4u %u levels, %u wrong ranges, %u wrong conservative ranges, %u of 300 rays hit, %u wrong\n",
+               dimension,
+               dimension,
+               static_cast<uint32_t> (pyramid.mLevels.size()),
+               wrongRanges,
+               wrongConservativeRanges,
+               hits,
+               wrongRays);
+        TEST_CHECK(results, wrongRays == 0);
+    }
+
+    // Time of the pyramid build and of its range and ray queries,
+    // against the brute force ones, that read every sample or cell.
+    void benchmarkPyramid(const uint32_t dimension,
+                          const bool timeRays,
+                          std::mt19937& generator)
+    {
+        HeightMap heightMap(dimension);
+        buildHeightMap(generator, heightMap);
+
+        HeightMapPyramid pyramid;
+        const double buildTime = TestUtils::measureMilliseconds(3, [&]() {
+            HeightMapPyramidUtils::build(heightMap, pyramid);
+        });
+
+        std::vector<Rectangle> rectangles(sBenchmarkRectangleCount);
+        for(size_t i = 0; i < rectangles.size(); ++i) {
+            rectangles[i] = buildRectangle(dimension, generator);
+        }
+
+        std::vector<HeightRange> ranges(rectangles.size());
+        std::vector<HeightRange> conservativeRanges(rectangles.size());
+        std::vector<HeightRange> expectedRanges(rectangles.size());
+        const double rangeTime = TestUtils::measureMilliseconds(5, [&]() {
+            for(size_t i = 0; i < rectangles.size(); ++i) {
+                const Rectangle& rectangle = rectangles[i];
+                ranges[i] = HeightMapPyramidUtils::computeRange(pyramid, rectangle.mFromRow, rectangle.mFromColumn, rectangle.mToRow, rectangle.mToColumn);
+            }
+        });
+        const double conservativeRangeTime = TestUtils::measureMilliseconds(5, [&]() {
+            for(size_t i = 0; i < rectangles.size(); ++i) {
+                const Rectangle& rectangle = rectangles[i];
+                conservativeRanges[i] = HeightMapPyramidUtils::computeConservativeRange(pyramid, rectangle.mFromRow, rectangle.mFromColumn, rectangle.mToRow, rectangle.mToColumn);
+            }
+        });
+        const double bruteForceRangeTime = TestUtils::measureMilliseconds(1, [&]() {
+            for(size_t i = 0; i < rectangles.size(); ++i) {
+                const Rectangle& rectangle = rectangles[i];
+                expectedRanges[i] = computeBruteForceRange(heightMap, rectangle.mFromRow, rectangle.mFromColumn, rectangle.mToRow, rectangle.mToColumn);
+            }
+        });
+
+        uint32_t wrongRanges = 0;
+        for(size_t i = 0; i < rectangles.size(); ++i) {
+            if(ranges[i].mMin != expectedRanges[i].mMin || ranges[i].mMax != expectedRanges[i].mMax ||
+               conservativeRanges[i].mMin > expectedRanges[i].mMin || conservativeRanges[i].mMax < expectedRanges[i].mMax) {
+                ++wrongRanges;
+            }
+        }
+
+        const double microsecondsPerRectangle = 1000.0 / rectangles.size();
+        printf("    %4u x %-4u build %7.2f ms; per range query: exact %7.2f us, conservative %5.2f us, brute force %9.2f us (%u wrong)\n",
+               dimension,
+               dimension,
+               buildTime,
+               rangeTime * microsecondsPerRectangle,
+               conservativeRangeTime * microsecondsPerRectangle,
+               bruteForceRangeTime * microsecondsPerRectangle,
+               wrongRanges);
+
+        if(!timeRays) {
+            return;
+        }
+
+        std::vector<DirectX::XMFLOAT3> origins(sBenchmarkRayCount);
+        std::vector<DirectX::XMFLOAT3> directions(sBenchmarkRayCount);
+        for(size_t i = 0; i < origins.size(); ++i) {
+            buildRay(dimension, generator, origins[i], directions[i]);
+        }
+
+        std::vector<float> distances(origins.size());
+        std::vector<float> expectedDistances(origins.size());
+        const double rayTime = TestUtils::measureMilliseconds(5, [&]() {
+            for(size_t i = 0; i < origins.size(); ++i) {
+                if(!HeightMapPyramidUtils::intersectRay(heightMap, pyramid, origins[i], directions[i], FLT_MAX, distances[i])) {
+                    distances[i] = -1.0f;
+                }
+            }
+        });
+        const double bruteForceRayTime = TestUtils::measureMilliseconds(1, [&]() {
+            for(size_t i = 0; i < origins.size(); ++i) {
+                expectedDistances[i] = intersectBruteForce(heightMap, origins[i], directions[i]);
+            }
+        });
+
+        uint32_t wrongRays = 0;
+        for(size_t i = 0; i < origins.size(); ++i) {
+            if((distances[i] >= 0.0f) != (expectedDistances[i] >= 0.0f) ||
+               fabsf(distances[i] - expectedDistances[i]) > 1.0e-3f * std::max(1.0f, expectedDistances[i])) {
+                ++wrongRays;
+            }
+        }
+
+        const double microsecondsPerRay = 1000.0 / origins.size();
+        printf("    %4u x %-4u per ray: pyramid %7.2f us, brute force %9.2f us (%u wrong)\n",
+               dimension,
+               dimension,
+               rayTime * microsecondsPerRay,
+               bruteForceRayTime * microsecondsPerRay,
+               wrongRays);
+    }
+}
+
+namespace Tests
+{
+    void testHeightMapPyramid(TestResults& results)
+    {
+        std::mt19937 generator(1);
+
+        // Smallest map (a single cell), odd cell counts and a power of two plus one
+        const uint32_t dimensions[] = { 2, 3, 18, 65 };
+        for(size_t i = 0; i < sizeof(dimensions) / sizeof(dimensions[0]); ++i) {
+            testPyramid(dimensions[i], generator, results);
+        }
+
+        // Single row and single column rectangles return the range
+        // of the cells on both sides of them.
+        HeightMap heightMap(17);
+        buildHeightMap(generator, heightMap);
+        HeightMapPyramid pyramid;
+        HeightMapPyramidUtils::build(heightMap, pyramid, 1);
+
+        const HeightRange rowRange = HeightMapPyramidUtils::computeRange(pyramid, 5, 2, 5, 9);
+        const HeightRange expectedRowRange = computeBruteForceRange(heightMap, 4, 2, 6, 9);
+        TEST_CHECK(results, rowRange.mMin == expectedRowRange.mMin && rowRange.mMax == expectedRowRange.mMax);
+
+        const HeightRange columnRange = HeightMapPyramidUtils::computeRange(pyramid, 0, 16, 12, 16);
+        const HeightRange expectedColumnRange = computeBruteForceRange(heightMap, 0, 15, 12, 16);
+        TEST_CHECK(results, columnRange.mMin == expectedColumnRange.mMin && columnRange.mMax == expectedColumnRange.mMax);
+    }
+
+    void benchmarkHeightMapPyramid()
+    {
+        std::mt19937 generator(1);
+        for(size_t i = 0; i < sizeof(sBenchmarkDimensions) / sizeof(sBenchmarkDimensions[0]); ++i) {
+            benchmarkPyramid(sBenchmarkDimensions[i], i == 0, generator);
+        }
+    }
+}
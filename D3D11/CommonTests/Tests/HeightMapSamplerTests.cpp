@@ -0,0 +1,176 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <DirectXMath.h>
+#include <random>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <HeightMap.h>
+#include <HeightMapSampler.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    const uint32_t sDimension = 65;
+    const float sTerrainSize = 128.0f;
+
+    float computeHeight(const uint32_t row,
+                        const uint32_t column)
+    {
+        return 10.0f * sinf(row * 0.2f) + 5.0f * cosf(column * 0.15f) + 0.1f * row;
+    }
+
+    // Scalar bilinear filtering, in texel coordinates.
+    float sampleBilinear(const HeightMap& heightMap,
+                         const float u,
+                         const float v)
+    {
+        const uint32_t dimension = heightMap.mDimension;
+        const float clampedU = std::min(std::max(u, 0.0f), static_cast<float> (dimension - 1));
+        const float clampedV = std::min(std::max(v, 0.0f), static_cast<float> (dimension - 1));
+        const uint32_t column = std::min(static_cast<uint32_t> (clampedU), dimension - 2);
+        const uint32_t row = std::min(static_cast<uint32_t> (clampedV), dimension - 2);
+        const float fractionU = clampedU - column;
+        const float fractionV = clampedV - row;
+
+        const float* samples = &heightMap.mData[row * dimension + column];
+        const float top = samples[0] + (samples[1] - samples[0]) * fractionU;
+        const float bottom = samples[dimension] + (samples[dimension + 1] - samples[dimension]) * fractionU;
+        return top + (bottom - top) * fractionV;
+    }
+}
+
+namespace Tests
+{
+    void testHeightMapSampler(TestResults& results)
+    {
+        HeightMap heightMap(sDimension);
+        QuantizedHeightMap quantizedHeightMap(sDimension);
+        quantizedHeightMap.mOffset = -20.0f;
+        quantizedHeightMap.mScale = 50.0f / 65535.0f;
+        for(uint32_t row = 0; row < sDimension; ++row) {
+            for(uint32_t column = 0; column < sDimension; ++column) {
+                const uint32_t index = row * sDimension + column;
+                heightMap.mData[index] = computeHeight(row, column);
+                quantizedHeightMap.mData[index] =
+                    static_cast<uint16_t> ((heightMap.mData[index] - quantizedHeightMap.mOffset) / quantizedHeightMap.mScale + 0.5f);
+            }
+        }
+
+        const HeightMapMapping mapping = HeightMapSamplerUtils::computeGridMapping(sTerrainSize, sTerrainSize, sDimension);
+
+        // Both filters interpolate the samples, so vertices of the matching grid get their sample.
+        MeshData grid;
+        GeometryGenerator::generateGrid(sTerrainSize, sTerrainSize, sDimension - 1, sDimension - 1, grid);
+        const uint32_t vertexCount = static_cast<uint32_t> (grid.mVertices.size());
+        std::vector<float> x(vertexCount);
+        std::vector<float> z(vertexCount);
+        for(uint32_t i = 0; i < vertexCount; ++i) {
+            x[i] = grid.mVertices[i].mPosition.x;
+            z[i] = grid.mVertices[i].mPosition.z;
+        }
+
+        std::vector<float> heights(vertexCount);
+        float maxVertexError[2] = { 0.0f, 0.0f };
+        const HeightFilter filters[] = { HeightFilter::BILINEAR, HeightFilter::BICUBIC };
+        for(size_t i = 0; i < 2; ++i) {
+            HeightMapSamplerUtils::sampleHeights(heightMap, mapping, filters[i], &x[0], &z[0], vertexCount, &heights[0]);
+            for(uint32_t j = 0; j < vertexCount; ++j) {
+                maxVertexError[i] = std::max(maxVertexError[i], fabsf(heights[j] - heightMap.mData[j]));
+            }
+        }
+
+        printf("    grid vertices: bilinear error %.2e, bicubic error %.2e\n", maxVertexError[0], maxVertexError[1]);
+        TEST_CHECK(results, maxVertexError[0] <= 1.0e-4f);
+        TEST_CHECK(results, maxVertexError[1] <= 1.0e-4f);
+
+        // Random positions, some of them out of the map. A count that is not
+        // a multiple of the block size also samples the last partial block.
+        const uint32_t count = 1001;
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> distribution(-0.6f * sTerrainSize, 0.6f * sTerrainSize);
+        x.resize(count);
+        z.resize(count);
+        for(uint32_t i = 0; i < count; ++i) {
+            x[i] = distribution(generator);
+            z[i] = distribution(generator);
+        }
+
+        heights.resize(count);
+        std::vector<DirectX::XMFLOAT3> normals(count);
+        HeightMapSamplerUtils::sampleHeights(heightMap, mapping, HeightFilter::BILINEAR, &x[0], &z[0], count, &heights[0], &normals[0]);
+        float maxBilinearError = 0.0f;
+        float maxNormalLengthError = 0.0f;
+        for(uint32_t i = 0; i < count; ++i) {
+            const float u = (x[i] - mapping.mOriginX) / mapping.mTexelSizeX;
+            const float v = (z[i] - mapping.mOriginZ) / mapping.mTexelSizeZ;
+            maxBilinearError = std::max(maxBilinearError, fabsf(heights[i] - sampleBilinear(heightMap, u, v)));
+            maxNormalLengthError = std::max(maxNormalLengthError, fabsf(DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&normals[i]))) - 1.0f));
+        }
+
+        printf("    random positions: bilinear error %.2e\n", maxBilinearError);
+        TEST_CHECK(results, maxBilinearError <= 1.0e-4f);
+        TEST_CHECK(results, maxNormalLengthError <= 1.0e-4f);
+
+        // Bicubic filtering is continuously differentiable, so its normals match
+        // central differences of its heights (inside the map, where they are not clamped).
+        HeightMapSamplerUtils::sampleHeights(heightMap, mapping, HeightFilter::BICUBIC, &x[0], &z[0], count, &heights[0], &normals[0]);
+        const float delta = 1.0e-2f;
+        float maxNormalError = 0.0f;
+        for(uint32_t i = 0; i < count; ++i) {
+            if(fabsf(x[i]) > 0.45f * sTerrainSize || fabsf(z[i]) > 0.45f * sTerrainSize) {
+                continue;
+            }
+
+            const float neighborX[] = { x[i] + delta, x[i] - delta, x[i], x[i] };
+            const float neighborZ[] = { z[i], z[i], z[i] + delta, z[i] - delta };
+            float neighborHeights[4];
+            HeightMapSamplerUtils::sampleHeights(heightMap, mapping, HeightFilter::BICUBIC, neighborX, neighborZ, 4, neighborHeights);
+
+            const DirectX::XMVECTOR expectedNormal =
+                DirectX::XMVector3Normalize(DirectX::XMVectorSet(-(neighborHeights[0] - neighborHeights[1]) / (2.0f * delta),
+                                                                 1.0f,
+                                                                 -(neighborHeights[2] - neighborHeights[3]) / (2.0f * delta),
+                                                                 0.0f));
+            const DirectX::XMVECTOR normalError = DirectX::XMVectorSubtract(expectedNormal, DirectX::XMLoadFloat3(&normals[i]));
+            maxNormalError = std::max(maxNormalError, DirectX::XMVectorGetX(DirectX::XMVector3Length(normalError)));
+        }
+
+        printf("    random positions: bicubic normal error %.2e\n", maxNormalError);
+        TEST_CHECK(results, maxNormalError <= 1.0e-2f);
+
+        // Positions out of the map get the heights of its border.
+        const float outsideX[] = { -sTerrainSize, sTerrainSize, -sTerrainSize, sTerrainSize };
+        const float outsideZ[] = { sTerrainSize, sTerrainSize, -sTerrainSize, -sTerrainSize };
+        float outsideHeights[4];
+        HeightMapSamplerUtils::sampleHeights(heightMap, mapping, HeightFilter::BICUBIC, outsideX, outsideZ, 4, outsideHeights);
+        const uint32_t last = sDimension - 1;
+        TEST_CHECK(results, fabsf(outsideHeights[0] - heightMap.mData[0]) <= 1.0e-4f);
+        TEST_CHECK(results, fabsf(outsideHeights[1] - heightMap.mData[last]) <= 1.0e-4f);
+        TEST_CHECK(results, fabsf(outsideHeights[2] - heightMap.mData[last * sDimension]) <= 1.0e-4f);
+        TEST_CHECK(results, fabsf(outsideHeights[3] - heightMap.mData[last * sDimension + last]) <= 1.0e-4f);
+
+        // Quantized heights match the dequantized height map.
+        HeightMap dequantizedHeightMap(sDimension);
+        for(uint32_t i = 0; i < sDimension * sDimension; ++i) {
+            dequantizedHeightMap.mData[i] = quantizedHeightMap.mOffset + quantizedHeightMap.mScale * quantizedHeightMap.mData[i];
+        }
+
+        std::vector<float> quantizedHeights(count);
+        float maxQuantizedError = 0.0f;
+        for(size_t i = 0; i < 2; ++i) {
+            HeightMapSamplerUtils::sampleHeights(dequantizedHeightMap, mapping, filters[i], &x[0], &z[0], count, &heights[0]);
+            HeightMapSamplerUtils::sampleHeights(quantizedHeightMap, mapping, filters[i], &x[0], &z[0], count, &quantizedHeights[0]);
+            for(uint32_t j = 0; j < count; ++j) {
+                maxQuantizedError = std::max(maxQuantizedError, fabsf(quantizedHeights[j] - heights[j]));
+            }
+        }
+
+        printf("    quantized heights: error %.2e\n", maxQuantizedError);
+        TEST_CHECK(results, maxQuantizedError <= 1.0e-4f);
+    }
+}
@@ -0,0 +1,612 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <HeightMap.h>
+#include <ParallelUtils.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    const uint32_t sFilterDimensions[] = { 1, 2, 3, 4, 5, 6, 7, 9, 13, 31, 67 };
+    const uint32_t sMipDimensions[] = { 1, 2, 3, 5, 7, 8, 13, 31, 64, 67, 100, 129, 257 };
+    const uint32_t sBenchmarkDimensions[] = { 512, 1024, 2048, 4096, 8192 };
+    const uint32_t sRAWDimensions[] = { 1, 5, 67 };
+    const uint32_t sRAWBenchmarkDimensions[] = { 4096, 16384 };
+
+    const char* sRAWFilePath = "HeightMapTests.raw";
+
+    // Writes samples in format, with extraBytes bytes after them
+    // (or that many bytes less if it is negative).
+    void writeRAWFile(const std::vector<uint16_t>& samples,
+                      const RAWFormat format,
+                      const int extraBytes = 0)
+    {
+        std::vector<char> bytes;
+        for(size_t i = 0; i < samples.size(); ++i) {
+            const char low = static_cast<char> (samples[i] & 0xFF);
+            const char high = static_cast<char> (samples[i] >> 8);
+            if(format == RAWFormat::UINT8) {
+                bytes.push_back(low);
+            } else if(format == RAWFormat::UINT16_LITTLE_ENDIAN) {
+                bytes.push_back(low);
+                bytes.push_back(high);
+            } else {
+                bytes.push_back(high);
+                bytes.push_back(low);
+            }
+        }
+
+        bytes.resize(bytes.size() + extraBytes, 0);
+        std::ofstream file(sRAWFilePath, std::ios_base::binary);
+        if(!bytes.empty()) {
+            file.write(&bytes[0], bytes.size());
+        }
+    }
+
+    // Loads as HeightMapUtils::loadFromRAWFile did before it mapped the file:
+    // reads the file in a buffer and converts its 8-bit samples one by one.
+    void loadReferenceRAWFile(const float scaleFactor,
+                              HeightMap& heightMap)
+    {
+        std::vector<uint8_t> fileData(heightMap.mData.size());
+        std::ifstream file(sRAWFilePath, std::ios_base::binary);
+        file.read(reinterpret_cast<char*> (&fileData[0]), static_cast<std::streamsize> (fileData.size()));
+        for(size_t i = 0; i < fileData.size(); ++i) {
+            heightMap.mData[i] = (fileData[i] / 255.0f) * scaleFactor;
+        }
+    }
+
+    void buildHeightMap(std::mt19937& generator,
+                        HeightMap& heightMap)
+    {
+        std::uniform_real_distribution<float> heightDistribution(0.0f, 150.0f);
+        for(size_t i = 0; i < heightMap.mData.size(); ++i) {
+            heightMap.mData[i] = heightDistribution(generator);
+        }
+    }
+
+    // The filter before it was separable: every pixel averages
+    // itself with its neighbors in the height map, one at a time.
+    float computeAverageHeight(const HeightMap& heightMap,
+                               const uint32_t rowIndex,
+                               const uint32_t columnIndex)
+    {
+        float average = 0.0f;
+        float numNeighbors = 0.0f;
+        const int dimension = static_cast<int> (heightMap.mDimension);
+        for(int row = static_cast<int> (rowIndex) - 1; row <= static_cast<int> (rowIndex) + 1; ++row) {
+            for(int column = static_cast<int> (columnIndex) - 1; column <= static_cast<int> (columnIndex) + 1; ++column) {
+                if(row >= 0 && row < dimension && column >= 0 && column < dimension) {
+                    average += heightMap.mData[row * dimension + column];
+                    numNeighbors += 1.0f;
+                }
+            }
+        }
+
+        return average / numNeighbors;
+    }
+
+    void applyReferenceFilter(HeightMap& heightMap)
+    {
+        const uint32_t dimension = heightMap.mDimension;
+        HeightMap filteredHeightMap(dimension);
+        for(uint32_t row = 0; row < dimension; ++row) {
+            for(uint32_t column = 0; column < dimension; ++column) {
+                filteredHeightMap.mData[row * dimension + column] = computeAverageHeight(heightMap, row, column);
+            }
+        }
+
+        heightMap = filteredHeightMap;
+    }
+
+    void buildQuantizedHeightMap(std::mt19937& generator,
+                                 QuantizedHeightMap& heightMap)
+    {
+        std::uniform_int_distribution<uint32_t> sampleDistribution(0, 0xFFFF);
+        for(size_t i = 0; i < heightMap.mData.size(); ++i) {
+            heightMap.mData[i] = static_cast<uint16_t> (sampleDistribution(generator));
+        }
+    }
+
+    // Number of samples of the filtered height map that are not the nearest ones to the
+    // exact average of the original samples (the even one if it is halfway). Averages of
+    // 6 and 9 samples are multiplied by a rounded inverse, so they can round either way
+    // when they are almost halfway.
+    uint32_t countWrongFilteredSamples(const QuantizedHeightMap& heightMap,
+                                       const QuantizedHeightMap& filteredHeightMap)
+    {
+        uint32_t wrongSamples = 0;
+        const int dimension = static_cast<int> (heightMap.mDimension);
+        for(int rowIndex = 0; rowIndex < dimension; ++rowIndex) {
+            for(int columnIndex = 0; columnIndex < dimension; ++columnIndex) {
+                uint32_t sum = 0;
+                uint32_t count = 0;
+                for(int row = rowIndex - 1; row <= rowIndex + 1; ++row) {
+                    for(int column = columnIndex - 1; column <= columnIndex + 1; ++column) {
+                        if(row >= 0 && row < dimension && column >= 0 && column < dimension) {
+                            sum += heightMap.mData[row * dimension + column];
+                            ++count;
+                        }
+                    }
+                }
+
+                const double average = static_cast<double> (sum) / count;
+                const double fraction = average - floor(average);
+                const bool almostHalfway = (count == 6 || count == 9) && fabs(fraction - 0.5) < 1.0e-3;
+                const uint16_t sample = filteredHeightMap.mData[rowIndex * dimension + columnIndex];
+                if(sample != static_cast<uint16_t> (nearbyint(average)) && !almostHalfway) {
+                    ++wrongSamples;
+                }
+            }
+        }
+
+        return wrongSamples;
+    }
+
+    // Texels [from, to) of the previous level a mip texel covers: 2, or 3 for
+    // the last texel if the previous level is odd.
+    void computeCoveredTexels(const uint32_t mipIndex,
+                              const uint32_t mipDimension,
+                              const uint32_t previousDimension,
+                              uint32_t& from,
+                              uint32_t& to)
+    {
+        from = 2 * mipIndex;
+        to = mipIndex + 1 == mipDimension ? previousDimension : from + 2;
+    }
+
+    // Reduces every level from the previous one, a texel at a time.
+    void buildReferenceMipChain(const HeightMap& heightMap,
+                                const MipReducer reducer,
+                                std::vector<HeightMap>& mipLevels)
+    {
+        mipLevels.clear();
+        const HeightMap* previousLevel = &heightMap;
+        for(uint32_t mipDimension = heightMap.mDimension / 2; mipDimension > 0; mipDimension /= 2) {
+            HeightMap mipLevel(mipDimension);
+            const uint32_t previousDimension = previousLevel->mDimension;
+            for(uint32_t mipRow = 0; mipRow < mipDimension; ++mipRow) {
+                for(uint32_t mipColumn = 0; mipColumn < mipDimension; ++mipColumn) {
+                    uint32_t fromRow;
+                    uint32_t toRow;
+                    uint32_t fromColumn;
+                    uint32_t toColumn;
+                    computeCoveredTexels(mipRow, mipDimension, previousDimension, fromRow, toRow);
+                    computeCoveredTexels(mipColumn, mipDimension, previousDimension, fromColumn, toColumn);
+
+                    double sum = 0.0;
+                    float minHeight = previousLevel->mData[fromRow * previousDimension + fromColumn];
+                    float maxHeight = minHeight;
+                    for(uint32_t row = fromRow; row < toRow; ++row) {
+                        for(uint32_t column = fromColumn; column < toColumn; ++column) {
+                            const float height = previousLevel->mData[row * previousDimension + column];
+                            sum += height;
+                            minHeight = std::min(minHeight, height);
+                            maxHeight = std::max(maxHeight, height);
+                        }
+                    }
+
+                    float& mipHeight = mipLevel.mData[mipRow * mipDimension + mipColumn];
+                    if(reducer == MipReducer::MIN) {
+                        mipHeight = minHeight;
+                    } else if(reducer == MipReducer::MAX) {
+                        mipHeight = maxHeight;
+                    } else {
+                        mipHeight = static_cast<float> (sum / ((toRow - fromRow) * (toColumn - fromColumn)));
+                    }
+                }
+            }
+
+            mipLevels.push_back(mipLevel);
+            previousLevel = &mipLevels.back();
+        }
+    }
+
+    // Number of levels with other dimensions or heights than the reference
+    // ones. Averages can differ by float errors.
+    uint32_t countWrongMipLevels(const std::vector<HeightMap>& mipLevels,
+                                 const std::vector<HeightMap>& referenceMipLevels,
+                                 const MipReducer reducer)
+    {
+        if(mipLevels.size() != referenceMipLevels.size()) {
+            return static_cast<uint32_t> (std::max(mipLevels.size(), referenceMipLevels.size()));
+        }
+
+        uint32_t wrongMipLevels = 0;
+        for(size_t level = 0; level < mipLevels.size(); ++level) {
+            const HeightMap& mipLevel = mipLevels[level];
+            const HeightMap& referenceMipLevel = referenceMipLevels[level];
+            bool sameHeights = mipLevel.mDimension == referenceMipLevel.mDimension;
+            for(size_t i = 0; i < mipLevel.mData.size() && sameHeights; ++i) {
+                const float error = fabsf(mipLevel.mData[i] - referenceMipLevel.mData[i]);
+                const float tolerance = reducer == MipReducer::AVERAGE ? 1.0e-5f * std::max(1.0f, fabsf(referenceMipLevel.mData[i])) : 0.0f;
+                sameHeights = error <= tolerance;
+            }
+
+            if(!sameHeights) {
+                ++wrongMipLevels;
+            }
+        }
+
+        return wrongMipLevels;
+    }
+
+    // Largest difference relative to the reference heights, that are at least 1
+    float computeMaxError(const HeightMap& heightMap,
+                          const HeightMap& referenceHeightMap)
+    {
+        float maxError = 0.0f;
+        for(size_t i = 0; i < heightMap.mData.size(); ++i) {
+            const float error = fabsf(heightMap.mData[i] - referenceHeightMap.mData[i]);
+            maxError = std::max(maxError, error / std::max(1.0f, fabsf(referenceHeightMap.mData[i])));
+        }
+
+        return maxError;
+    }
+}
+
+namespace Tests
+{
+    void testHeightMap(TestResults& results)
+    {
+        std::mt19937 generator(1);
+
+        // The separable filter sums in another order than the reference one,
+        // so heights differ by a few ulps, and any thread count gives the
+        // same heights, including more threads than rows.
+        float maxFilterError = 0.0f;
+        uint32_t wrongThreadedFilters = 0;
+        for(size_t i = 0; i < sizeof(sFilterDimensions) / sizeof(sFilterDimensions[0]); ++i) {
+            const uint32_t dimension = sFilterDimensions[i];
+            HeightMap heightMap(dimension);
+            buildHeightMap(generator, heightMap);
+
+            HeightMap referenceHeightMap(heightMap);
+            applyReferenceFilter(referenceHeightMap);
+
+            HeightMap singleThreadHeightMap(heightMap);
+            HeightMapUtils::applyNeighborsFilter(singleThreadHeightMap, 1);
+            maxFilterError = std::max(maxFilterError, computeMaxError(singleThreadHeightMap, referenceHeightMap));
+
+            for(uint32_t numThreads = 2; numThreads <= 8; ++numThreads) {
+                HeightMap threadedHeightMap(heightMap);
+                HeightMapUtils::applyNeighborsFilter(threadedHeightMap, numThreads);
+                if(threadedHeightMap.mData != singleThreadHeightMap.mData) {
+                    ++wrongThreadedFilters;
+                }
+            }
+        }
+
+        printf("    filter: error %.2e, %u wrong threaded filters\n", maxFilterError, wrongThreadedFilters);
+        TEST_CHECK(results, maxFilterError <= 1.0e-6f);
+        TEST_CHECK(results, wrongThreadedFilters == 0);
+
+        // quantize maps the height range to the whole sample range, rounding to the
+        // nearest sample (the even one if it is halfway) in any column, so on any
+        // dimension and thread count. dequantize gives offset + scale * sample.
+        uint32_t wrongQuantizations = 0;
+        uint32_t wrongDequantizations = 0;
+        float maxRoundTripError = 0.0f;
+        for(size_t i = 0; i < sizeof(sFilterDimensions) / sizeof(sFilterDimensions[0]); ++i) {
+            const uint32_t dimension = sFilterDimensions[i];
+            HeightMap heightMap(dimension);
+            buildHeightMap(generator, heightMap);
+            if(dimension > 1) {
+                heightMap.mData[0] = -20.0f;
+                heightMap.mData[1] = 200.0f;
+            }
+
+            for(uint32_t numThreads = 1; numThreads <= 4; ++numThreads) {
+                QuantizedHeightMap quantizedHeightMap(0);
+                HeightMapUtils::quantize(heightMap, quantizedHeightMap, numThreads);
+                const float inverseScale = dimension > 1 ? 65535.0f / 220.0f : 0.0f;
+                bool sameSamples = quantizedHeightMap.mDimension == dimension &&
+                                   quantizedHeightMap.mOffset == (dimension > 1 ? -20.0f : heightMap.mData[0]);
+                for(size_t j = 0; j < heightMap.mData.size() && sameSamples; ++j) {
+                    const float value = (heightMap.mData[j] - quantizedHeightMap.mOffset) * inverseScale;
+                    sameSamples = quantizedHeightMap.mData[j] == static_cast<uint16_t> (nearbyintf(value));
+                }
+
+                if(!sameSamples) {
+                    ++wrongQuantizations;
+                }
+
+                HeightMap dequantizedHeightMap(0);
+                HeightMapUtils::dequantize(quantizedHeightMap, dequantizedHeightMap, numThreads);
+                bool sameHeights = dequantizedHeightMap.mDimension == dimension;
+                for(size_t j = 0; j < heightMap.mData.size() && sameHeights; ++j) {
+                    sameHeights = dequantizedHeightMap.mData[j] == quantizedHeightMap.mOffset + quantizedHeightMap.mScale * quantizedHeightMap.mData[j];
+                    maxRoundTripError = std::max(maxRoundTripError, fabsf(dequantizedHeightMap.mData[j] - heightMap.mData[j]));
+                }
+
+                if(!sameHeights) {
+                    ++wrongDequantizations;
+                }
+            }
+        }
+
+        printf("    quantize: %u wrong, dequantize: %u wrong, round trip error %.2e\n",
+               wrongQuantizations,
+               wrongDequantizations,
+               maxRoundTripError);
+        TEST_CHECK(results, wrongQuantizations == 0);
+        TEST_CHECK(results, wrongDequantizations == 0);
+
+        // Heights are at most half a sample (of a 220 height range) away, with float errors.
+        TEST_CHECK(results, maxRoundTripError <= 0.5f * 220.0f / 65535.0f + 1.0e-4f);
+
+        // Halfway values round to the even sample in the 4-wide columns and in the
+        // last ones. A flat height map has every sample 0.
+        HeightMap halfwayHeightMap(3);
+        const float halfwayHeights[] = { 0.0f, 2.5f, 3.5f, 5.5f, 65535.0f, 6.5f, 7.5f, 8.5f, 10.5f };
+        halfwayHeightMap.mData.assign(halfwayHeights, halfwayHeights + 9);
+        QuantizedHeightMap halfwayQuantizedHeightMap(0);
+        HeightMapUtils::quantize(halfwayHeightMap, halfwayQuantizedHeightMap, 1);
+        const uint16_t evenSamples[] = { 0, 2, 4, 6, 65535, 6, 8, 8, 10 };
+        TEST_CHECK(results, halfwayQuantizedHeightMap.mData == std::vector<uint16_t>(evenSamples, evenSamples + 9));
+
+        HeightMap flatHeightMap(5);
+        flatHeightMap.mData.assign(25, 7.0f);
+        QuantizedHeightMap flatQuantizedHeightMap(0);
+        HeightMapUtils::quantize(flatHeightMap, flatQuantizedHeightMap);
+        TEST_CHECK(results, flatQuantizedHeightMap.mData == std::vector<uint16_t>(25, 0));
+        TEST_CHECK(results, flatQuantizedHeightMap.mOffset == 7.0f);
+
+        // Quantized filters round the exact averages, and any thread count
+        // gives the same samples. The last corner of a 5 x 5 map is in the
+        // last columns and averages to halfway.
+        uint32_t wrongQuantizedFilters = 0;
+        uint32_t wrongThreadedQuantizedFilters = 0;
+        for(size_t i = 0; i < sizeof(sFilterDimensions) / sizeof(sFilterDimensions[0]); ++i) {
+            const uint32_t dimension = sFilterDimensions[i];
+            QuantizedHeightMap heightMap(dimension);
+            buildQuantizedHeightMap(generator, heightMap);
+
+            QuantizedHeightMap filteredHeightMap(heightMap);
+            HeightMapUtils::applyNeighborsFilter(filteredHeightMap, 1);
+            wrongQuantizedFilters += countWrongFilteredSamples(heightMap, filteredHeightMap);
+
+            for(uint32_t numThreads = 2; numThreads <= 8; ++numThreads) {
+                QuantizedHeightMap threadedHeightMap(heightMap);
+                HeightMapUtils::applyNeighborsFilter(threadedHeightMap, numThreads);
+                if(threadedHeightMap.mData != filteredHeightMap.mData) {
+                    ++wrongThreadedQuantizedFilters;
+                }
+            }
+        }
+
+        QuantizedHeightMap halfwayCornerHeightMap(5);
+        halfwayCornerHeightMap.mData[23] = 1;
+        halfwayCornerHeightMap.mData[24] = 1;
+        HeightMapUtils::applyNeighborsFilter(halfwayCornerHeightMap, 1);
+
+        printf("    quantized filter: %u wrong samples, %u wrong threaded filters\n", wrongQuantizedFilters, wrongThreadedQuantizedFilters);
+        TEST_CHECK(results, wrongQuantizedFilters == 0);
+        TEST_CHECK(results, wrongThreadedQuantizedFilters == 0);
+        TEST_CHECK(results, halfwayCornerHeightMap.mData[24] == 0);
+
+        // Mip chains of float and quantized height maps, odd and even, reduce
+        // every level as the reference does, on any number of threads. Odd
+        // levels reduce 3 texels in their last row and column.
+        const MipReducer reducers[] = { MipReducer::MIN, MipReducer::MAX, MipReducer::AVERAGE };
+        uint32_t wrongMipChains = 0;
+        uint32_t wrongQuantizedMipChains = 0;
+        for(size_t i = 0; i < sizeof(sMipDimensions) / sizeof(sMipDimensions[0]); ++i) {
+            const uint32_t dimension = sMipDimensions[i];
+            HeightMap heightMap(dimension);
+            buildHeightMap(generator, heightMap);
+            QuantizedHeightMap quantizedHeightMap(dimension);
+            buildQuantizedHeightMap(generator, quantizedHeightMap);
+            quantizedHeightMap.mScale = 0.01f;
+            quantizedHeightMap.mOffset = -100.0f;
+            HeightMap dequantizedHeightMap(0);
+            HeightMapUtils::dequantize(quantizedHeightMap, dequantizedHeightMap);
+
+            for(size_t j = 0; j < sizeof(reducers) / sizeof(reducers[0]); ++j) {
+                std::vector<HeightMap> referenceMipLevels;
+                std::vector<HeightMap> referenceQuantizedMipLevels;
+                buildReferenceMipChain(heightMap, reducers[j], referenceMipLevels);
+                buildReferenceMipChain(dequantizedHeightMap, reducers[j], referenceQuantizedMipLevels);
+
+                for(uint32_t numThreads = 1; numThreads <= 7; ++numThreads) {
+                    std::vector<HeightMap> mipLevels;
+                    HeightMapUtils::buildMipChain(heightMap, reducers[j], mipLevels, numThreads);
+                    wrongMipChains += countWrongMipLevels(mipLevels, referenceMipLevels, reducers[j]) > 0 ? 1 : 0;
+
+                    std::vector<HeightMap> quantizedMipLevels;
+                    HeightMapUtils::buildMipChain(quantizedHeightMap, reducers[j], quantizedMipLevels, numThreads);
+                    wrongQuantizedMipChains += countWrongMipLevels(quantizedMipLevels, referenceQuantizedMipLevels, reducers[j]) > 0 ? 1 : 0;
+                }
+            }
+        }
+
+        printf("    mip chains: %u wrong, %u wrong quantized\n", wrongMipChains, wrongQuantizedMipChains);
+        TEST_CHECK(results, wrongMipChains == 0);
+        TEST_CHECK(results, wrongQuantizedMipChains == 0);
+
+        // RAW files of every format load to (sample / maxSample) * scaleFactor, and
+        // to the 16-bit samples (8-bit ones expanded by 257). Files can be larger.
+        const RAWFormat formats[] = { RAWFormat::UINT8, RAWFormat::UINT16_LITTLE_ENDIAN, RAWFormat::UINT16_BIG_ENDIAN };
+        std::string errorMessage;
+        uint32_t wrongRAWLoads = 0;
+        for(size_t i = 0; i < sizeof(sRAWDimensions) / sizeof(sRAWDimensions[0]); ++i) {
+            const uint32_t dimension = sRAWDimensions[i];
+            for(size_t j = 0; j < sizeof(formats) / sizeof(formats[0]); ++j) {
+                const RAWFormat format = formats[j];
+                const bool is8Bit = format == RAWFormat::UINT8;
+                QuantizedHeightMap sampleHeightMap(dimension);
+                buildQuantizedHeightMap(generator, sampleHeightMap);
+                std::vector<uint16_t>& samples = sampleHeightMap.mData;
+                for(size_t k = 0; k < samples.size() && is8Bit; ++k) {
+                    samples[k] &= 0xFF;
+                }
+
+                writeRAWFile(samples, format, static_cast<int> (i));
+
+                HeightMap heightMap(dimension);
+                QuantizedHeightMap quantizedHeightMap(dimension);
+                if(!HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, heightMap, format, &errorMessage) ||
+                   !HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, quantizedHeightMap, format, &errorMessage) ||
+                   quantizedHeightMap.mScale != 150.0f / 65535.0f ||
+                   quantizedHeightMap.mOffset != 0.0f) {
+                    ++wrongRAWLoads;
+                    continue;
+                }
+
+                const float maxSample = is8Bit ? 255.0f : 65535.0f;
+                bool sameHeights = true;
+                for(size_t k = 0; k < samples.size(); ++k) {
+                    sameHeights &= heightMap.mData[k] == (samples[k] / maxSample) * 150.0f;
+                    sameHeights &= quantizedHeightMap.mData[k] == (is8Bit ? samples[k] * 257 : samples[k]);
+                }
+
+                if(!sameHeights) {
+                    ++wrongRAWLoads;
+                }
+            }
+        }
+
+        printf("    RAW files: %u wrong loads\n", wrongRAWLoads);
+        TEST_CHECK(results, wrongRAWLoads == 0);
+
+        // Missing, empty and too small files are rejected with a message.
+        HeightMap rawHeightMap(5);
+        QuantizedHeightMap rawQuantizedHeightMap(5);
+        errorMessage.clear();
+        TEST_CHECK(results, !HeightMapUtils::loadFromRAWFile("HeightMapTests.missing.raw", 1.0f, rawHeightMap, RAWFormat::UINT8, &errorMessage));
+        TEST_CHECK(results, !errorMessage.empty());
+
+        writeRAWFile(std::vector<uint16_t>(), RAWFormat::UINT8);
+        errorMessage.clear();
+        TEST_CHECK(results, !HeightMapUtils::loadFromRAWFile(sRAWFilePath, 1.0f, rawHeightMap, RAWFormat::UINT8, &errorMessage));
+        TEST_CHECK(results, !errorMessage.empty());
+
+        writeRAWFile(std::vector<uint16_t>(25, 1), RAWFormat::UINT8, -1);
+        errorMessage.clear();
+        TEST_CHECK(results, !HeightMapUtils::loadFromRAWFile(sRAWFilePath, 1.0f, rawHeightMap, RAWFormat::UINT8, &errorMessage));
+        TEST_CHECK(results, !errorMessage.empty());
+        TEST_CHECK(results, !HeightMapUtils::loadFromRAWFile(sRAWFilePath, 1.0f, rawQuantizedHeightMap, RAWFormat::UINT8));
+
+        // 8-bit files are half as large as the 16-bit ones.
+        writeRAWFile(std::vector<uint16_t>(25, 1), RAWFormat::UINT8);
+        TEST_CHECK(results, HeightMapUtils::loadFromRAWFile(sRAWFilePath, 1.0f, rawHeightMap, RAWFormat::UINT8));
+        TEST_CHECK(results, !HeightMapUtils::loadFromRAWFile(sRAWFilePath, 1.0f, rawHeightMap, RAWFormat::UINT16_LITTLE_ENDIAN));
+        TEST_CHECK(results, !HeightMapUtils::loadFromRAWFile(sRAWFilePath, 1.0f, rawQuantizedHeightMap, RAWFormat::UINT16_BIG_ENDIAN));
+
+        remove(sRAWFilePath);
+    }
+
+    void benchmarkHeightMap()
+    {
+        std::mt19937 generator(1);
+        const uint32_t threadCounts[] = { 1, ParallelUtils::defaultThreadCount() };
+        for(size_t i = 0; i < sizeof(sBenchmarkDimensions) / sizeof(sBenchmarkDimensions[0]); ++i) {
+            const uint32_t dimension = sBenchmarkDimensions[i];
+            const uint32_t repetitions = dimension <= 2048 ? 5 : 1;
+            const double pixels = static_cast<double> (dimension) * dimension;
+            HeightMap heightMap(dimension);
+            buildHeightMap(generator, heightMap);
+
+            // Filters in place, so every repetition filters the last result.
+            const double referenceTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                applyReferenceFilter(heightMap);
+            });
+            printf("    %4u x %4u filter: per pixel %9.2f ms (%6.1f M pixels/s)",
+                   dimension,
+                   dimension,
+                   referenceTime,
+                   pixels / (1000.0 * referenceTime));
+
+            for(size_t j = 0; j < sizeof(threadCounts) / sizeof(threadCounts[0]); ++j) {
+                const uint32_t threadCount = threadCounts[j];
+                if(j > 0 && threadCount == threadCounts[0]) {
+                    continue;
+                }
+
+                const double time = TestUtils::measureMilliseconds(repetitions, [&]() {
+                    HeightMapUtils::applyNeighborsFilter(heightMap, threadCount);
+                });
+                printf(", %2u threads %8.2f ms (%6.1f M pixels/s)", threadCount, time, pixels / (1000.0 * time));
+            }
+
+            printf("\n");
+
+            // The quantized height map takes half the memory, and its filter,
+            // quantize and dequantize run with every hardware thread.
+            QuantizedHeightMap quantizedHeightMap(0);
+            const double quantizeTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::quantize(heightMap, quantizedHeightMap);
+            });
+            const double dequantizeTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::dequantize(quantizedHeightMap, heightMap);
+            });
+            const double floatFilterTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::applyNeighborsFilter(heightMap);
+            });
+            const double quantizedFilterTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::applyNeighborsFilter(quantizedHeightMap);
+            });
+
+            printf("    %4u x %4u quantized: %6.1f MB (float %6.1f MB), filter %6.1f M pixels/s (float %6.1f), quantize %6.1f, dequantize %6.1f M pixels/s\n",
+                   dimension,
+                   dimension,
+                   quantizedHeightMap.mData.size() * sizeof(uint16_t) / 1.0e6,
+                   heightMap.mData.size() * sizeof(float) / 1.0e6,
+                   pixels / (1000.0 * quantizedFilterTime),
+                   pixels / (1000.0 * floatFilterTime),
+                   pixels / (1000.0 * quantizeTime),
+                   pixels / (1000.0 * dequantizeTime));
+        }
+
+        // RAW files are in the file cache after they are written, so loads
+        // measure the conversion and not the disk.
+        for(size_t i = 0; i < sizeof(sRAWBenchmarkDimensions) / sizeof(sRAWBenchmarkDimensions[0]); ++i) {
+            const uint32_t dimension = sRAWBenchmarkDimensions[i];
+            const uint32_t repetitions = dimension <= 4096 ? 5 : 2;
+            const double pixels = static_cast<double> (dimension) * dimension;
+            QuantizedHeightMap sampleHeightMap(dimension);
+            buildQuantizedHeightMap(generator, sampleHeightMap);
+            HeightMap heightMap(dimension);
+            QuantizedHeightMap quantizedHeightMap(dimension);
+
+            writeRAWFile(sampleHeightMap.mData, RAWFormat::UINT8);
+            const double referenceTime = TestUtils::measureMilliseconds(repetitions, [&]() {
+                loadReferenceRAWFile(150.0f, heightMap);
+            });
+            const double time8Bit = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, heightMap, RAWFormat::UINT8);
+            });
+            const double quantizedTime8Bit = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, quantizedHeightMap, RAWFormat::UINT8);
+            });
+
+            writeRAWFile(sampleHeightMap.mData, RAWFormat::UINT16_BIG_ENDIAN);
+            const double time16Bit = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, heightMap, RAWFormat::UINT16_BIG_ENDIAN);
+            });
+            const double quantizedTime16Bit = TestUtils::measureMilliseconds(repetitions, [&]() {
+                HeightMapUtils::loadFromRAWFile(sRAWFilePath, 150.0f, quantizedHeightMap, RAWFormat::UINT16_BIG_ENDIAN);
+            });
+
+            // Milliseconds and millions of pixels per second
+            const double times[] = { referenceTime, time8Bit, quantizedTime8Bit, time16Bit, quantizedTime16Bit };
+            const char* names[] = { "8-bit read", "mapped", "quantized", "16-bit big endian mapped", "quantized" };
+            printf("    %5u x %5u RAW load:", dimension, dimension);
+            for(size_t j = 0; j < sizeof(times) / sizeof(times[0]); ++j) {
+                printf("%s %s %.1f ms (%.0f M pixels/s)", j == 0 ? "" : ",", names[j], times[j], pixels / (1000.0 * times[j]));
+            }
+
+            printf("\n");
+        }
+
+        remove(sRAWFilePath);
+    }
+}
@@ -0,0 +1,175 @@
+#include "Tests.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <MeshCache.h>
+#include <MeshOptimizer.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    const char* sCacheDirectory = "MeshCacheTests";
+
+    // Optimized sphere in the VertexData layout, as the applications cache it.
+    bool generateSphere(const uint32_t dimension,
+                        CachedMeshData& cachedMeshData)
+    {
+        MeshData meshData;
+        GeometryGenerator::generateSphere(1.0f, dimension, dimension, meshData);
+        MeshOptimizer::optimize(meshData);
+        MeshCacheUtils::fromMeshData(meshData, cachedMeshData);
+        return true;
+    }
+
+    bool isSameMesh(const MappedMeshData& mappedMeshData,
+                    const CachedMeshData& cachedMeshData)
+    {
+        const uint32_t vertexCount = static_cast<uint32_t> (cachedMeshData.mVertices.size() / cachedMeshData.mVertexStride);
+        return mappedMeshData.mVertexStride == cachedMeshData.mVertexStride &&
+               mappedMeshData.mVertexCount == vertexCount &&
+               mappedMeshData.mIndexCount == cachedMeshData.mIndices.size() &&
+               memcmp(mappedMeshData.mVertices, &cachedMeshData.mVertices[0], cachedMeshData.mVertices.size()) == 0 &&
+               memcmp(mappedMeshData.mIndices, &cachedMeshData.mIndices[0], cachedMeshData.mIndices.size() * sizeof(uint32_t)) == 0;
+    }
+
+    void removeCacheFile(const std::string& generatorName,
+                         const std::vector<float>& parameters,
+                         const CachedVertexLayout& vertexLayout)
+    {
+        const uint64_t key = MeshCacheUtils::computeKey(generatorName, parameters, vertexLayout);
+        remove(MeshCacheUtils::computeFilePath(sCacheDirectory, generatorName, key).c_str());
+    }
+}
+
+namespace Tests
+{
+    void testMeshCache(TestResults& results)
+    {
+        // Every part of the layout is in the key, besides the name and the parameters.
+        const CachedVertexLayout vertexLayout = MeshCacheUtils::computeVertexDataLayout();
+        const std::vector<float> parameters = { 16.0f };
+        const uint64_t key = MeshCacheUtils::computeKey("Sphere", parameters, vertexLayout);
+        TEST_CHECK(results, key == MeshCacheUtils::computeKey("Sphere", parameters, MeshCacheUtils::computeVertexDataLayout()));
+        TEST_CHECK(results, key != MeshCacheUtils::computeKey("Sphere", { 17.0f }, vertexLayout));
+        TEST_CHECK(results, key != MeshCacheUtils::computeKey("Spheres", parameters, vertexLayout));
+        TEST_CHECK(results, key != MeshCacheUtils::computeKey("Sphere", parameters, CachedVertexLayout("Vertex", vertexLayout.mVertexStride)));
+        TEST_CHECK(results, key != MeshCacheUtils::computeKey("Sphere", parameters, CachedVertexLayout("VertexData", 12)));
+        TEST_CHECK(results, key != MeshCacheUtils::computeKey("Sphere", parameters, CachedVertexLayout("VertexData", vertexLayout.mVertexStride, { 0.0f })));
+        TEST_CHECK(results, MeshCacheUtils::computeKey("Sphere", {}, CachedVertexLayout("VertexData", 12, { 1.0f })) !=
+                            MeshCacheUtils::computeKey("Sphere", { 1.0f }, CachedVertexLayout("VertexData", 12)));
+
+        // The first load generates and writes the mesh, the next ones map
+        // the same mesh from the file.
+        CachedMeshData sphere;
+        generateSphere(16, sphere);
+        removeCacheFile("Sphere", parameters, vertexLayout);
+
+        uint32_t generatorCalls = 0;
+        const std::function<bool(CachedMeshData&)> generator = [&](CachedMeshData& cachedMeshData) {
+            ++generatorCalls;
+            return generateSphere(16, cachedMeshData);
+        };
+
+        MeshCacheStatistics coldStatistics;
+        MeshCacheStatistics warmStatistics;
+        {
+            MappedMeshData coldMesh;
+            MeshCacheUtils::mapOrGenerate(sCacheDirectory, "Sphere", parameters, vertexLayout, generator, coldMesh, &coldStatistics);
+            TEST_CHECK(results, isSameMesh(coldMesh, sphere));
+            TEST_CHECK(results, coldMesh.mView != nullptr);
+        }
+
+        MappedMeshData warmMesh;
+        MeshCacheUtils::mapOrGenerate(sCacheDirectory, "Sphere", parameters, vertexLayout, generator, warmMesh, &warmStatistics);
+        TEST_CHECK(results, !coldStatistics.mCacheHit);
+        TEST_CHECK(results, warmStatistics.mCacheHit);
+        TEST_CHECK(results, generatorCalls == 1);
+        TEST_CHECK(results, isSameMesh(warmMesh, sphere));
+        TEST_CHECK(results, warmMesh.mMinPosition.y == -1.0f && warmMesh.mMaxPosition.y == 1.0f);
+
+        // Files are not mapped with another key or vertex stride.
+        MappedMeshData wrongMesh;
+        const std::string filePath = MeshCacheUtils::computeFilePath(sCacheDirectory, "Sphere", key);
+        TEST_CHECK(results, !MeshCacheUtils::mapFile(filePath, key + 1, vertexLayout.mVertexStride, wrongMesh));
+        TEST_CHECK(results, !MeshCacheUtils::mapFile(filePath, key, vertexLayout.mVertexStride + 4, wrongMesh));
+        MeshCacheUtils::unmapFile(warmMesh);
+        removeCacheFile("Sphere", parameters, vertexLayout);
+
+        // Failed generations leave the mesh empty and are not cached.
+        const std::function<bool(CachedMeshData&)> failingGenerator = [&](CachedMeshData& cachedMeshData) {
+            ++generatorCalls;
+            generateSphere(16, cachedMeshData);
+            return false;
+        };
+
+        for(uint32_t i = 0; i < 2; ++i) {
+            MappedMeshData failedMesh;
+            MeshCacheStatistics failedStatistics;
+            MeshCacheUtils::mapOrGenerate(sCacheDirectory, "FailedSphere", parameters, vertexLayout, failingGenerator, failedMesh, &failedStatistics);
+            TEST_CHECK(results, !failedStatistics.mCacheHit);
+            TEST_CHECK(results, failedMesh.mVertexCount == 0 && failedMesh.mIndexCount == 0);
+        }
+
+        TEST_CHECK(results, generatorCalls == 3);
+    }
+
+    void benchmarkMeshCache()
+    {
+        // Cold loads generate, optimize and write the mesh, warm loads map it.
+        const CachedVertexLayout vertexLayout = MeshCacheUtils::computeVertexDataLayout();
+        const uint32_t dimensions[] = { 20, 100, 500 };
+        for(size_t i = 0; i < sizeof(dimensions) / sizeof(dimensions[0]); ++i) {
+            const uint32_t dimension = dimensions[i];
+            const std::vector<float> parameters = { static_cast<float> (dimension) };
+            const std::function<bool(CachedMeshData&)> generator = [dimension](CachedMeshData& cachedMeshData) {
+                return generateSphere(dimension, cachedMeshData);
+            };
+
+            double coldTime = 0.0;
+            double warmTime = 0.0;
+            uint32_t vertexCount = 0;
+            uint32_t wrongHits = 0;
+            for(uint32_t repetition = 0; repetition < 3; ++repetition) {
+                removeCacheFile("BenchmarkSphere", parameters, vertexLayout);
+
+                MeshCacheStatistics coldStatistics;
+                {
+                    MappedMeshData mesh;
+                    MeshCacheUtils::mapOrGenerate(sCacheDirectory, "BenchmarkSphere", parameters, vertexLayout, generator, mesh, &coldStatistics);
+                    vertexCount = mesh.mVertexCount;
+                }
+
+                MeshCacheStatistics warmStatistics;
+                {
+                    MappedMeshData mesh;
+                    MeshCacheUtils::mapOrGenerate(sCacheDirectory, "BenchmarkSphere", parameters, vertexLayout, generator, mesh, &warmStatistics);
+                }
+
+                if(coldStatistics.mCacheHit || !warmStatistics.mCacheHit) {
+                    ++wrongHits;
+                }
+
+                const double coldMilliseconds = 1000.0 * coldStatistics.mLoadTime;
+                const double warmMilliseconds = 1000.0 * warmStatistics.mLoadTime;
+                coldTime = repetition == 0 || coldMilliseconds < coldTime ? coldMilliseconds : coldTime;
+                warmTime = repetition == 0 || warmMilliseconds < warmTime ? warmMilliseconds : warmTime;
+            }
+
+            removeCacheFile("BenchmarkSphere", parameters, vertexLayout);
+
+            printf("    %3u x %3u sphere, %6u vertices: cold %9.3f ms, warm %7.3f ms (%6.1fx)%s\n",
+                   dimension,
+                   dimension,
+                   vertexCount,
+                   coldTime,
+                   warmTime,
+                   coldTime / warmTime,
+                   wrongHits == 0 ? "" : ", WRONG CACHE HITS");
+        }
+    }
+}
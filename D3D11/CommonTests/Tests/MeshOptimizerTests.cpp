@@ -0,0 +1,134 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <MeshOptimizer.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    struct NamedMesh
+    {
+        const char* mName;
+        std::function<void(MeshData&)> mGenerate;
+    };
+
+    // Row-major generators, at the tessellations of the apps and
+    // at the dense ones of tooling.
+    std::vector<NamedMesh> buildMeshes(const bool dense)
+    {
+        const uint32_t scale = dense ? 8 : 1;
+        std::vector<NamedMesh> meshes;
+        meshes.push_back({ "sphere", [scale](MeshData& meshData) {
+            GeometryGenerator::generateSphere(1.0f, 20 * scale, 20 * scale, meshData);
+        } });
+        meshes.push_back({ "geosphere", [dense](MeshData& meshData) {
+            GeometryGenerator::generateGeosphere(1.0f, dense ? 6 : 3, meshData, GeometryGenerator::SubdivisionMode::WELDED);
+        } });
+        meshes.push_back({ "cylinder", [scale](MeshData& meshData) {
+            GeometryGenerator::generateCylinder(0.5f, 0.3f, 3.0f, 20 * scale, 20 * scale, meshData);
+        } });
+        meshes.push_back({ "grid", [scale](MeshData& meshData) {
+            GeometryGenerator::generateGrid(160.0f, 160.0f, 50 * scale, 50 * scale, meshData);
+        } });
+
+        return meshes;
+    }
+
+    // Triangles as sorted position triples, so they can be compared
+    // after vertices and triangles are reordered.
+    typedef std::array<float, 9> TrianglePositions;
+
+    std::vector<TrianglePositions> computeSortedTriangles(const MeshData& meshData)
+    {
+        std::vector<TrianglePositions> triangles(meshData.mIndices.size() / 3);
+        for(size_t i = 0; i < triangles.size(); ++i) {
+            std::array<std::array<float, 3>, 3> corners;
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                const DirectX::XMFLOAT3& position = meshData.mVertices[meshData.mIndices[3 * i + corner]].mPosition;
+                corners[corner] = { { position.x, position.y, position.z } };
+            }
+
+            // Rotate the smallest corner first, keeping the winding.
+            const size_t first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+            for(uint32_t corner = 0; corner < 3; ++corner) {
+                std::copy(corners[(first + corner) % 3].begin(), corners[(first + corner) % 3].end(), triangles[i].begin() + 3 * corner);
+            }
+        }
+
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+}
+
+namespace Tests
+{
+    void testMeshOptimizer(TestResults& results)
+    {
+        // Optimized meshes have the same triangles, with the same winding,
+        // the vertices in first use order and no worse vertex cache use.
+        const std::vector<NamedMesh> meshes = buildMeshes(false);
+        for(size_t i = 0; i < meshes.size(); ++i) {
+            MeshData meshData;
+            meshes[i].mGenerate(meshData);
+            const std::vector<TrianglePositions> triangles = computeSortedTriangles(meshData);
+
+            VertexCacheStatistics statisticsBefore;
+            VertexCacheStatistics statisticsAfter;
+            MeshOptimizer::optimize(meshData, statisticsBefore, statisticsAfter);
+            TEST_CHECK(results, computeSortedTriangles(meshData) == triangles);
+            TEST_CHECK(results, statisticsAfter.mACMR <= statisticsBefore.mACMR);
+
+            uint32_t nextVertex = 0;
+            bool firstUseOrder = true;
+            for(size_t j = 0; j < meshData.mIndices.size(); ++j) {
+                firstUseOrder = firstUseOrder && meshData.mIndices[j] <= nextVertex;
+                nextVertex = (std::max)(nextVertex, meshData.mIndices[j] + 1);
+            }
+
+            TEST_CHECK(results, firstUseOrder);
+        }
+    }
+
+    void benchmarkMeshOptimizer()
+    {
+        // ACMR and ATVR of a 16 entry FIFO and LRU cache, before and after
+        // the optimizations, and the time the optimizations take.
+        for(uint32_t dense = 0; dense < 2; ++dense) {
+            const std::vector<NamedMesh> meshes = buildMeshes(dense != 0);
+            for(size_t i = 0; i < meshes.size(); ++i) {
+                MeshData meshData;
+                meshes[i].mGenerate(meshData);
+                const VertexCacheStatistics fifoBefore = MeshOptimizer::computeVertexCacheStatistics(meshData, 16, MeshOptimizer::CacheModel::FIFO);
+                const VertexCacheStatistics lruBefore = MeshOptimizer::computeVertexCacheStatistics(meshData, 16, MeshOptimizer::CacheModel::LRU);
+
+                MeshData optimizedMeshData;
+                const double optimizeTime = TestUtils::measureMilliseconds(3, [&]() {
+                    optimizedMeshData = meshData;
+                    MeshOptimizer::optimize(optimizedMeshData);
+                });
+                const VertexCacheStatistics fifoAfter = MeshOptimizer::computeVertexCacheStatistics(optimizedMeshData, 16, MeshOptimizer::CacheModel::FIFO);
+                const VertexCacheStatistics lruAfter = MeshOptimizer::computeVertexCacheStatistics(optimizedMeshData, 16, MeshOptimizer::CacheModel::LRU);
+
+                printf("    %-9s %7u triangles: FIFO ACMR %.3f -> %.3f ATVR %.3f -> %.3f, LRU ACMR %.3f -> %.3f ATVR %.3f -> %.3f, %8.2f ms\n",
+                       meshes[i].mName,
+                       static_cast<uint32_t> (meshData.mIndices.size() / 3),
+                       fifoBefore.mACMR,
+                       fifoAfter.mACMR,
+                       fifoBefore.mATVR,
+                       fifoAfter.mATVR,
+                       lruBefore.mACMR,
+                       lruAfter.mACMR,
+                       lruBefore.mATVR,
+                       lruAfter.mATVR,
+                       optimizeTime);
+            }
+        }
+    }
+}
@@ -0,0 +1,187 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <DirectXMath.h>
+#include <vector>
+
+#include <Camera.h>
+#include <GeometryGenerator.h>
+#include <MeshSimplifier.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    uint32_t triangleCount(const MeshData& meshData)
+    {
+        return static_cast<uint32_t> (meshData.mIndices.size() / 3);
+    }
+
+    // Triangles whose face normal points against the sum of their vertex
+    // normals. Triangles that are perpendicular to them (within a small
+    // tolerance) are not counted.
+    uint32_t countInvertedTriangles(const MeshData& meshData)
+    {
+        uint32_t invertedTriangles = 0;
+        for(size_t i = 0; i < meshData.mIndices.size(); i += 3) {
+            const VertexData& v0 = meshData.mVertices[meshData.mIndices[i]];
+            const VertexData& v1 = meshData.mVertices[meshData.mIndices[i + 1]];
+            const VertexData& v2 = meshData.mVertices[meshData.mIndices[i + 2]];
+
+            const DirectX::XMVECTOR p0 = DirectX::XMLoadFloat3(&v0.mPosition);
+            const DirectX::XMVECTOR faceNormal =
+                DirectX::XMVector3Normalize(DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&v1.mPosition), p0),
+                                                                    DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&v2.mPosition), p0)));
+            const DirectX::XMVECTOR vertexNormal =
+                DirectX::XMVector3Normalize(DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&v0.mNormal),
+                                                                                      DirectX::XMLoadFloat3(&v1.mNormal)),
+                                                                 DirectX::XMLoadFloat3(&v2.mNormal)));
+
+            if(DirectX::XMVectorGetX(DirectX::XMVector3Dot(faceNormal, vertexNormal)) < -1.0e-3f) {
+                ++invertedTriangles;
+            }
+        }
+
+        return invertedTriangles;
+    }
+
+    // Maximum distance between the centroid of a triangle and a unit sphere.
+    float computeRadialDeviation(const MeshData& meshData)
+    {
+        float deviation = 0.0f;
+        for(size_t i = 0; i < meshData.mIndices.size(); i += 3) {
+            const DirectX::XMVECTOR centroid =
+                DirectX::XMVectorScale(DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&meshData.mVertices[meshData.mIndices[i]].mPosition),
+                                                                                 DirectX::XMLoadFloat3(&meshData.mVertices[meshData.mIndices[i + 1]].mPosition)),
+                                                            DirectX::XMLoadFloat3(&meshData.mVertices[meshData.mIndices[i + 2]].mPosition)),
+                                       1.0f / 3.0f);
+            deviation = std::max(deviation, fabsf(1.0f - DirectX::XMVectorGetX(DirectX::XMVector3Length(centroid))));
+        }
+
+        return deviation;
+    }
+
+    struct BoundingBox
+    {
+        DirectX::XMFLOAT3 mMin;
+        DirectX::XMFLOAT3 mMax;
+    };
+
+    void computeBoundingBox(const MeshData& meshData,
+                            BoundingBox& boundingBox)
+    {
+        DirectX::XMVECTOR minPosition = DirectX::XMVectorReplicate(FLT_MAX);
+        DirectX::XMVECTOR maxPosition = DirectX::XMVectorReplicate(-FLT_MAX);
+        for(size_t i = 0; i < meshData.mVertices.size(); ++i) {
+            const DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&meshData.mVertices[i].mPosition);
+            minPosition = DirectX::XMVectorMin(minPosition, position);
+            maxPosition = DirectX::XMVectorMax(maxPosition, position);
+        }
+
+        DirectX::XMStoreFloat3(&boundingBox.mMin, minPosition);
+        DirectX::XMStoreFloat3(&boundingBox.mMax, maxPosition);
+    }
+
+    void testUnitSphereChain(const char* name,
+                             const MeshData& meshData,
+                             TestResults& results)
+    {
+        std::vector<float> triangleRatios;
+        triangleRatios.push_back(1.0f);
+        triangleRatios.push_back(0.5f);
+        triangleRatios.push_back(0.25f);
+        triangleRatios.push_back(0.125f);
+
+        std::vector<LodLevel> lods;
+        MeshSimplifier::generateLodChain(meshData, triangleRatios, lods);
+        TEST_CHECK(results, lods.size() == triangleRatios.size());
+        if(lods.size() != triangleRatios.size()) {
+            return;
+        }
+
+        TEST_CHECK(results, triangleCount(lods[0].mMeshData) == triangleCount(meshData));
+
+        const float originalDeviation = computeRadialDeviation(lods[0].mMeshData);
+        for(size_t i = 0; i < lods.size(); ++i) {
+            const MeshData& lodMeshData = lods[i].mMeshData;
+            const float deviation = computeRadialDeviation(lodMeshData);
+            printf("    %-10s %5u triangles, error %.5f, radial deviation %.5f\n",
+                   name,
+                   triangleCount(lodMeshData),
+                   lods[i].mError,
+                   deviation);
+
+            TEST_CHECK(results, triangleCount(lodMeshData) <= static_cast<uint32_t> (triangleRatios[i] * triangleCount(meshData)));
+            TEST_CHECK(results, i == 0 || lods[i].mError >= lods[i - 1].mError);
+            TEST_CHECK(results, deviation <= originalDeviation + lods[i].mError);
+            TEST_CHECK(results, countInvertedTriangles(lodMeshData) == 0);
+        }
+    }
+}
+
+namespace Tests
+{
+    void testMeshSimplifier(TestResults& results)
+    {
+        MeshData sphere;
+        GeometryGenerator::generateSphere(1.0f, 64, 64, sphere);
+        testUnitSphereChain("sphere", sphere, results);
+
+        MeshData geosphere;
+        GeometryGenerator::generateGeosphere(1.0f, 5, geosphere, GeometryGenerator::SubdivisionMode::WELDED);
+        testUnitSphereChain("geosphere", geosphere, results);
+
+        // A flat grid simplifies with (almost) no error and keeps its border.
+        MeshData grid;
+        GeometryGenerator::generateGrid(100.0f, 100.0f, 64, 64, grid);
+        MeshData simplifiedGrid;
+        const float gridError = MeshSimplifier::simplify(grid, triangleCount(grid) / 8, simplifiedGrid);
+        printf("    grid       %5u triangles, error %.7f\n", triangleCount(simplifiedGrid), gridError);
+        TEST_CHECK(results, gridError < 1.0e-4f);
+        TEST_CHECK(results, triangleCount(simplifiedGrid) <= triangleCount(grid) / 8);
+
+        BoundingBox gridBox;
+        BoundingBox simplifiedGridBox;
+        computeBoundingBox(grid, gridBox);
+        computeBoundingBox(simplifiedGrid, simplifiedGridBox);
+        TEST_CHECK(results, simplifiedGridBox.mMin.x == gridBox.mMin.x && simplifiedGridBox.mMax.x == gridBox.mMax.x);
+        TEST_CHECK(results, simplifiedGridBox.mMin.z == gridBox.mMin.z && simplifiedGridBox.mMax.z == gridBox.mMax.z);
+        TEST_CHECK(results, simplifiedGridBox.mMin.y == 0.0f && simplifiedGridBox.mMax.y == 0.0f);
+
+        // Coarser levels of detail as the camera moves away.
+        std::vector<float> triangleRatios;
+        triangleRatios.push_back(1.0f);
+        triangleRatios.push_back(0.5f);
+        triangleRatios.push_back(0.25f);
+        triangleRatios.push_back(0.125f);
+
+        std::vector<LodLevel> lods;
+        MeshSimplifier::generateLodChain(sphere, triangleRatios, lods);
+
+        Camera camera;
+        CameraUtils::setFrustrum(0.25f * DirectX::XM_PI, 1.5f, 1.0f, 1000.0f, camera);
+
+        BoundingSphere boundingSphere;
+        boundingSphere.mRadius = 1.0f;
+
+        uint32_t previousLod = 0;
+        const float distances[] = { 2.0f, 5.0f, 10.0f, 20.0f, 50.0f, 200.0f };
+        for(size_t i = 0; i < sizeof(distances) / sizeof(distances[0]); ++i) {
+            CameraUtils::setCoordinateSystem(DirectX::XMFLOAT3(0.0f, 0.0f, -distances[i]),
+                                             DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f),
+                                             DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f),
+                                             camera);
+
+            const uint32_t lod = MeshSimplifier::selectLod(lods, boundingSphere, camera, 800.0f);
+            printf("    distance %5.1f selects level of detail %u\n", distances[i], lod);
+
+            TEST_CHECK(results, lod >= previousLod);
+            previousLod = lod;
+        }
+
+        TEST_CHECK(results, previousLod == lods.size() - 1);
+    }
+}
@@ -0,0 +1,320 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <DirectXMath.h>
+#include <vector>
+
+#include <GeometryGenerator.h>
+#include <MeshOptimizer.h>
+#include <MeshSink.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    // Application-like vertex layout, smaller than VertexData.
+    struct TestVertex
+    {
+        DirectX::XMFLOAT3 mPosition;
+        DirectX::XMFLOAT2 mTexCoord;
+    };
+
+    // Counts its calls, to check every vertex is written once.
+    struct TestVertexProjection
+    {
+        explicit TestVertexProjection(uint32_t& numCalls)
+            : mNumCalls(&numCalls)
+        {
+
+        }
+
+        void operator()(const VertexData& vertex, TestVertex& testVertex) const
+        {
+            testVertex.mPosition = vertex.mPosition;
+            testVertex.mTexCoord = vertex.mTexCoord;
+            ++*mNumCalls;
+        }
+
+        uint32_t* mNumCalls;
+    };
+
+    // Copies every attribute, to check which ones the builders computed.
+    struct VertexDataProjection
+    {
+        void operator()(const VertexData& vertex, VertexData& destination) const
+        {
+            destination = vertex;
+        }
+    };
+
+    typedef MeshSink<VertexData, VertexDataProjection> VertexDataMeshSink;
+
+    struct BenchmarkVertexProjection
+    {
+        void operator()(const VertexData& vertex, TestVertex& testVertex) const
+        {
+            testVertex.mPosition = vertex.mPosition;
+            testVertex.mTexCoord = vertex.mTexCoord;
+        }
+    };
+
+    bool isProjection(const VertexData& vertex,
+                      const TestVertex& testVertex)
+    {
+        return vertex.mPosition.x == testVertex.mPosition.x &&
+               vertex.mPosition.y == testVertex.mPosition.y &&
+               vertex.mPosition.z == testVertex.mPosition.z &&
+               vertex.mTexCoord.x == testVertex.mTexCoord.x &&
+               vertex.mTexCoord.y == testVertex.mTexCoord.y;
+    }
+
+    bool isProjection(const MeshData& meshData,
+                      const TestVertex* testVertices,
+                      const uint32_t* indices)
+    {
+        for(size_t i = 0; i < meshData.mVertices.size(); ++i) {
+            if(!isProjection(meshData.mVertices[i], testVertices[i])) {
+                return false;
+            }
+        }
+
+        return indices == nullptr ||
+               meshData.mIndices.empty() ||
+               memcmp(indices, &meshData.mIndices[0], meshData.mIndices.size() * sizeof(uint32_t)) == 0;
+    }
+
+    template<typename Attribute>
+    bool isSameAttribute(const Attribute& attribute,
+                         const Attribute& otherAttribute)
+    {
+        return memcmp(&attribute, &otherAttribute, sizeof(Attribute)) == 0;
+    }
+
+    // Generates the mesh into sinks with every stream mask. Positions and the
+    // attributes in the mask must be the ones of generateMeshData, and the
+    // rest must be left as default constructed.
+    template<typename MeshDataGenerator, typename SinkGenerator>
+    uint32_t countWrongMaskedVertices(const MeshSize& meshSize,
+                                      const MeshDataGenerator& generateMeshData,
+                                      const SinkGenerator& generateSink)
+    {
+        MeshData meshData;
+        generateMeshData(meshData);
+
+        const uint32_t streamMasks[] = {
+            MeshStream::POSITION, MeshStream::NORMAL, MeshStream::TANGENT_U, MeshStream::TEXCOORD, MeshStream::ALL
+        };
+        const VertexData defaultVertex;
+        uint32_t wrongVertices = 0;
+        for(size_t i = 0; i < sizeof(streamMasks) / sizeof(streamMasks[0]); ++i) {
+            const uint32_t streamMask = streamMasks[i];
+            std::vector<VertexData> vertices(meshSize.mVertexCount);
+            std::vector<uint32_t> indices(meshSize.mIndexCount);
+            generateSink(GeometryGenerator::makeMeshSink(vertices, indices, VertexDataProjection(), streamMask));
+
+            for(size_t j = 0; j < vertices.size(); ++j) {
+                const VertexData& vertex = vertices[j];
+                const VertexData& expectedVertex = meshData.mVertices[j];
+                const VertexData& normalVertex = (streamMask & MeshStream::NORMAL) ? expectedVertex : defaultVertex;
+                const VertexData& tangentVertex = (streamMask & MeshStream::TANGENT_U) ? expectedVertex : defaultVertex;
+                const VertexData& texCoordVertex = (streamMask & MeshStream::TEXCOORD) ? expectedVertex : defaultVertex;
+                if(!isSameAttribute(vertex.mPosition, expectedVertex.mPosition) ||
+                   !isSameAttribute(vertex.mNormal, normalVertex.mNormal) ||
+                   !isSameAttribute(vertex.mTangentU, tangentVertex.mTangentU) ||
+                   !isSameAttribute(vertex.mTexCoord, texCoordVertex.mTexCoord)) {
+                    ++wrongVertices;
+                }
+            }
+        }
+
+        return wrongVertices;
+    }
+
+    // Generates the same mesh through generateMeshData and through generateSink
+    // into plain buffers, and compares them and the bytes each path writes.
+    template<typename MeshDataGenerator, typename SinkGenerator>
+    void testMesh(const char* name,
+                  const MeshSize& meshSize,
+                  const MeshDataGenerator& generateMeshData,
+                  const SinkGenerator& generateSink,
+                  TestResults& results)
+    {
+        MeshData meshData;
+        generateMeshData(meshData);
+        TEST_CHECK(results, meshData.mVertices.size() == meshSize.mVertexCount);
+        TEST_CHECK(results, meshData.mIndices.size() == meshSize.mIndexCount);
+
+        // One extra vertex and index after the mesh, that must not be written.
+        const uint32_t vertexCount = meshSize.mVertexCount;
+        const uint32_t indexCount = meshSize.mIndexCount;
+        TestVertex* vertices = new TestVertex[vertexCount + 1];
+        uint32_t* indices = new uint32_t[indexCount + 1];
+        TestVertex sentinelVertex;
+        sentinelVertex.mPosition = DirectX::XMFLOAT3(-1.0f, -1.0f, -1.0f);
+        sentinelVertex.mTexCoord = DirectX::XMFLOAT2(-1.0f, -1.0f);
+        const uint32_t sentinelIndex = ~0U;
+        std::fill(vertices, vertices + vertexCount + 1, sentinelVertex);
+        std::fill(indices, indices + indexCount + 1, sentinelIndex);
+
+        uint32_t numProjections = 0;
+        TestVertexProjection projection(numProjections);
+        TEST_CHECK(results, generateSink(GeometryGenerator::makeMeshSink(vertices, vertexCount, indices, indexCount, projection)));
+        TEST_CHECK(results, isProjection(meshData, vertices, indices));
+        TEST_CHECK(results, numProjections == vertexCount);
+        TEST_CHECK(results, memcmp(&vertices[vertexCount], &sentinelVertex, sizeof(TestVertex)) == 0);
+        TEST_CHECK(results, indices[indexCount] == sentinelIndex);
+
+        // Vertices only.
+        std::fill(vertices, vertices + vertexCount, sentinelVertex);
+        TEST_CHECK(results, generateSink(GeometryGenerator::makeMeshSink(vertices, vertexCount, static_cast<uint32_t*> (nullptr), 0, projection)));
+        TEST_CHECK(results, isProjection(meshData, vertices, nullptr));
+
+        // Too small sinks are rejected before writing anything.
+        numProjections = 0;
+        TEST_CHECK(results, !generateSink(GeometryGenerator::makeMeshSink(vertices, vertexCount - 1, indices, indexCount, projection)));
+        TEST_CHECK(results, !generateSink(GeometryGenerator::makeMeshSink(vertices, vertexCount, indices, indexCount - 1, projection)));
+        TEST_CHECK(results, numProjections == 0);
+
+        // Optimizing the projected vertices gives the projection of the optimized MeshData.
+        MeshOptimizer::optimize(meshData);
+        MeshOptimizer::optimize(vertices, sizeof(TestVertex), vertexCount, indices, indexCount);
+        TEST_CHECK(results, isProjection(meshData, vertices, indices));
+
+        // The MeshData path writes a VertexData per vertex and the indices, and then
+        // copies them to the application layout and to the index buffer data.
+        // The sink path writes every vertex and index once, in its final layout.
+        const uint32_t indexBytes = indexCount * sizeof(uint32_t);
+        const uint32_t meshDataBytes = vertexCount * sizeof(VertexData) + indexBytes + vertexCount * sizeof(TestVertex) + indexBytes;
+        const uint32_t sinkBytes = vertexCount * sizeof(TestVertex) + indexBytes;
+        printf("    %-9s %6u vertices, %6u indices: MeshData path %8u bytes written, sink %8u (%.0f%%)\n",
+               name,
+               vertexCount,
+               indexCount,
+               meshDataBytes,
+               sinkBytes,
+               100.0f * sinkBytes / meshDataBytes);
+        TEST_CHECK(results, sinkBytes < meshDataBytes);
+
+        delete[] vertices;
+        delete[] indices;
+    }
+
+    // Times the MeshData path, that generates a MeshData and then copies its vertices
+    // to the application layout and its indices to the index buffer data, as the apps
+    // did, against the sink path, that generates straight into those buffers.
+    template<typename MeshDataGenerator, typename SinkGenerator>
+    void benchmarkMesh(const char* name,
+                       const MeshSize& meshSize,
+                       const MeshDataGenerator& generateMeshData,
+                       const SinkGenerator& generateSink)
+    {
+        const uint32_t vertexCount = meshSize.mVertexCount;
+        const uint32_t indexCount = meshSize.mIndexCount;
+        std::vector<TestVertex> vertices(vertexCount);
+        std::vector<uint32_t> indices(indexCount);
+        const BenchmarkVertexProjection projection;
+
+        MeshData meshData;
+        const double meshDataTime = TestUtils::measureMilliseconds(5, [&]() {
+            generateMeshData(meshData);
+            for(uint32_t i = 0; i < vertexCount; ++i) {
+                projection(meshData.mVertices[i], vertices[i]);
+            }
+
+            memcpy(&indices[0], &meshData.mIndices[0], indexCount * sizeof(uint32_t));
+        });
+
+        const double sinkTime = TestUtils::measureMilliseconds(5, [&]() {
+            generateSink(GeometryGenerator::makeMeshSink(&vertices[0], vertexCount, &indices[0], indexCount, projection));
+        });
+
+        // Only the MeshData path copies, every vertex and index once.
+        const uint32_t copiedBytes = vertexCount * sizeof(TestVertex) + indexCount * sizeof(uint32_t);
+        printf("    %-9s %8u vertices, %8u indices: MeshData path %7.2f ms, %9u bytes copied, sink %7.2f ms, 0 bytes copied\n",
+               name,
+               vertexCount,
+               indexCount,
+               meshDataTime,
+               copiedBytes,
+               sinkTime);
+    }
+}
+
+namespace Tests
+{
+    void testMeshSink(TestResults& results)
+    {
+        testMesh("box",
+                 GeometryGenerator::computeBoxSize(),
+                 [](MeshData& meshData) { GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshData); },
+                 [](const MeshSink<TestVertex, TestVertexProjection>& meshSink) {
+                     return GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshSink);
+                 },
+                 results);
+
+        testMesh("sphere",
+                 GeometryGenerator::computeSphereSize(30, 30),
+                 [](MeshData& meshData) { GeometryGenerator::generateSphere(20.0f, 30, 30, meshData); },
+                 [](const MeshSink<TestVertex, TestVertexProjection>& meshSink) {
+                     return GeometryGenerator::generateSphere(20.0f, 30, 30, meshSink);
+                 },
+                 results);
+
+        testMesh("cylinder",
+                 GeometryGenerator::computeCylinderSize(40, 10),
+                 [](MeshData& meshData) { GeometryGenerator::generateCylinder(1.0f, 0.5f, 3.0f, 40, 10, meshData); },
+                 [](const MeshSink<TestVertex, TestVertexProjection>& meshSink) {
+                     return GeometryGenerator::generateCylinder(1.0f, 0.5f, 3.0f, 40, 10, meshSink);
+                 },
+                 results);
+
+        testMesh("grid",
+                 GeometryGenerator::computeGridSize(50, 50),
+                 [](MeshData& meshData) { GeometryGenerator::generateGrid(160.0f, 160.0f, 50, 50, meshData); },
+                 [](const MeshSink<TestVertex, TestVertexProjection>& meshSink) {
+                     return GeometryGenerator::generateGrid(160.0f, 160.0f, 50, 50, meshSink);
+                 },
+                 results);
+
+        // Box and grid attributes are constant or cheap, but they are still only
+        // computed when their stream is requested.
+        const uint32_t wrongBoxVertices =
+            countWrongMaskedVertices(GeometryGenerator::computeBoxSize(),
+                                     [](MeshData& meshData) { GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshData); },
+                                     [](const VertexDataMeshSink& meshSink) { GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshSink); });
+        const uint32_t wrongGridVertices =
+            countWrongMaskedVertices(GeometryGenerator::computeGridSize(7, 5),
+                                     [](MeshData& meshData) { GeometryGenerator::generateGrid(16.0f, 10.0f, 7, 5, meshData); },
+                                     [](const VertexDataMeshSink& meshSink) { GeometryGenerator::generateGrid(16.0f, 10.0f, 7, 5, meshSink); });
+        printf("    stream masks: %u wrong box vertices, %u wrong grid vertices\n", wrongBoxVertices, wrongGridVertices);
+        TEST_CHECK(results, wrongBoxVertices == 0);
+        TEST_CHECK(results, wrongGridVertices == 0);
+    }
+
+    void benchmarkMeshSink()
+    {
+        typedef MeshSink<TestVertex, BenchmarkVertexProjection> BenchmarkMeshSink;
+
+        benchmarkMesh("box",
+                      GeometryGenerator::computeBoxSize(),
+                      [](MeshData& meshData) { GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshData); },
+                      [](const BenchmarkMeshSink& meshSink) { GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshSink); });
+
+        benchmarkMesh("sphere",
+                      GeometryGenerator::computeSphereSize(500, 500),
+                      [](MeshData& meshData) { GeometryGenerator::generateSphere(20.0f, 500, 500, meshData); },
+                      [](const BenchmarkMeshSink& meshSink) { GeometryGenerator::generateSphere(20.0f, 500, 500, meshSink); });
+
+        benchmarkMesh("cylinder",
+                      GeometryGenerator::computeCylinderSize(500, 500),
+                      [](MeshData& meshData) { GeometryGenerator::generateCylinder(1.0f, 0.5f, 3.0f, 500, 500, meshData); },
+                      [](const BenchmarkMeshSink& meshSink) { GeometryGenerator::generateCylinder(1.0f, 0.5f, 3.0f, 500, 500, meshSink); });
+
+        benchmarkMesh("grid",
+                      GeometryGenerator::computeGridSize(1000, 1000),
+                      [](MeshData& meshData) { GeometryGenerator::generateGrid(160.0f, 160.0f, 1000, 1000, meshData); },
+                      [](const BenchmarkMeshSink& meshSink) { GeometryGenerator::generateGrid(160.0f, 160.0f, 1000, 1000, meshSink); });
+    }
+}
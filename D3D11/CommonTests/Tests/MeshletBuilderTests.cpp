@@ -0,0 +1,283 @@
+#include "Tests.h"
+
+#include <cstdio>
+#include <DirectXMath.h>
+#include <vector>
+
+#include <Camera.h>
+#include <GeometryGenerator.h>
+#include <MeshletBuilder.h>
+#include <MeshOptimizer.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    struct CameraPose
+    {
+        const char* mName;
+        DirectX::XMFLOAT3 mPosition;
+        DirectX::XMFLOAT3 mTarget;
+        DirectX::XMFLOAT3 mUp;
+    };
+
+    // Poses that look at the sphere from outside, so about half of it is back facing.
+    const CameraPose sOutsidePoses[] = {
+        { "front", DirectX::XMFLOAT3(0.0f, 0.0f, -20.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+        { "back", DirectX::XMFLOAT3(0.0f, 0.0f, 20.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+        { "right", DirectX::XMFLOAT3(20.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+        { "top", DirectX::XMFLOAT3(0.0f, 20.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 1.0f) },
+        { "diagonal", DirectX::XMFLOAT3(-12.0f, 9.0f, -12.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+        { "close", DirectX::XMFLOAT3(0.0f, 0.0f, -6.0f), DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+        { "grazing", DirectX::XMFLOAT3(0.0f, 0.0f, -20.0f), DirectX::XMFLOAT3(7.0f, 0.0f, 0.0f), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f) },
+    };
+
+    struct TriangleCounts
+    {
+        TriangleCounts()
+            : mRejected(0)
+            , mBruteForceRejectable(0)
+            , mWronglyRejected(0)
+        {
+
+        }
+
+        // Triangles of the meshlets rejected by MeshletUtils::cullMeshlets
+        uint32_t mRejected;
+
+        // Triangles that are back facing or outside the frustum
+        uint32_t mBruteForceRejectable;
+
+        // Rejected triangles that are neither, so they could be visible.
+        uint32_t mWronglyRejected;
+    };
+
+    DirectX::XMFLOAT3 toViewSpace(const DirectX::XMFLOAT3& position,
+                                  const Camera& camera)
+    {
+        const DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&position),
+                                                                   DirectX::XMLoadFloat3(&camera.mPosition));
+        return DirectX::XMFLOAT3(DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&camera.mRight))),
+                                 DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&camera.mUp))),
+                                 DirectX::XMVectorGetX(DirectX::XMVector3Dot(offset, DirectX::XMLoadFloat3(&camera.mLook))));
+    }
+
+    // Signed distances of a view space point to the 6 frustum planes,
+    // positive outside.
+    void computePlaneDistances(const DirectX::XMFLOAT3& viewPosition,
+                               const Camera& camera,
+                               float distances[6])
+    {
+        const float halfFieldOfViewY = 0.5f * camera.mFieldOfViewY;
+        const float halfFieldOfViewX = atanf(tanf(halfFieldOfViewY) * camera.mAspectRatio);
+        const float x = viewPosition.x;
+        const float y = viewPosition.y;
+        const float z = viewPosition.z;
+
+        distances[0] = camera.mNearZ - z;
+        distances[1] = z - camera.mFarZ;
+        distances[2] = y * cosf(halfFieldOfViewY) - z * sinf(halfFieldOfViewY);
+        distances[3] = -y * cosf(halfFieldOfViewY) - z * sinf(halfFieldOfViewY);
+        distances[4] = x * cosf(halfFieldOfViewX) - z * sinf(halfFieldOfViewX);
+        distances[5] = -x * cosf(halfFieldOfViewX) - z * sinf(halfFieldOfViewX);
+    }
+
+    bool isTriangleOutsideFrustum(const DirectX::XMFLOAT3 positions[3],
+                                  const Camera& camera)
+    {
+        float distances[3][6];
+        for(uint32_t corner = 0; corner < 3; ++corner) {
+            computePlaneDistances(toViewSpace(positions[corner], camera), camera, distances[corner]);
+        }
+
+        for(uint32_t plane = 0; plane < 6; ++plane) {
+            if(distances[0][plane] > 0.0f && distances[1][plane] > 0.0f && distances[2][plane] > 0.0f) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool isTriangleBackFacing(const DirectX::XMFLOAT3 positions[3],
+                              const Camera& camera)
+    {
+        // Same winding as MeshletBuilder: outward facing normals.
+        const DirectX::XMVECTOR p0 = DirectX::XMLoadFloat3(&positions[0]);
+        const DirectX::XMVECTOR p1 = DirectX::XMLoadFloat3(&positions[1]);
+        const DirectX::XMVECTOR p2 = DirectX::XMLoadFloat3(&positions[2]);
+        const DirectX::XMVECTOR normal =
+            DirectX::XMVector3Cross(DirectX::XMVectorSubtract(p1, p0), DirectX::XMVectorSubtract(p2, p0));
+        const DirectX::XMVECTOR viewDirection = DirectX::XMVectorSubtract(p0, DirectX::XMLoadFloat3(&camera.mPosition));
+
+        return DirectX::XMVectorGetX(DirectX::XMVector3Dot(viewDirection, normal)) >= 0.0f;
+    }
+
+    // worldMeshData has the vertices of the meshlets transformed by world.
+    TriangleCounts countTriangles(const MeshData& worldMeshData,
+                                  const MeshletData& meshletData,
+                                  const DirectX::XMFLOAT4X4& world,
+                                  const Camera& camera)
+    {
+        TriangleCounts counts;
+
+        std::vector<uint32_t> visibleMeshlets;
+        counts.mRejected = MeshletUtils::cullMeshlets(meshletData, world, camera, visibleMeshlets);
+
+        std::vector<bool> visible(meshletData.mMeshlets.size(), false);
+        for(size_t i = 0; i < visibleMeshlets.size(); ++i) {
+            visible[visibleMeshlets[i]] = true;
+        }
+
+        for(size_t meshletIndex = 0; meshletIndex < meshletData.mMeshlets.size(); ++meshletIndex) {
+            const Meshlet& meshlet = meshletData.mMeshlets[meshletIndex];
+            const uint32_t* vertices = &meshletData.mVertices[meshlet.mVertexOffset];
+            const uint8_t* triangles = &meshletData.mTriangles[meshlet.mTriangleOffset * 3];
+            for(uint32_t triangleIndex = 0; triangleIndex < meshlet.mTriangleCount; ++triangleIndex) {
+                DirectX::XMFLOAT3 positions[3];
+                for(uint32_t corner = 0; corner < 3; ++corner) {
+                    positions[corner] = worldMeshData.mVertices[vertices[triangles[triangleIndex * 3 + corner]]].mPosition;
+                }
+
+                const bool rejectable = isTriangleBackFacing(positions, camera) || isTriangleOutsideFrustum(positions, camera);
+                if(rejectable) {
+                    ++counts.mBruteForceRejectable;
+                } else if(!visible[meshletIndex]) {
+                    ++counts.mWronglyRejected;
+                }
+            }
+        }
+
+        return counts;
+    }
+
+    void transformMeshData(const MeshData& meshData,
+                           const DirectX::XMFLOAT4X4& world,
+                           MeshData& worldMeshData)
+    {
+        const DirectX::XMMATRIX worldMatrix = DirectX::XMLoadFloat4x4(&world);
+        worldMeshData = meshData;
+        for(size_t i = 0; i < worldMeshData.mVertices.size(); ++i) {
+            DirectX::XMFLOAT3& position = worldMeshData.mVertices[i].mPosition;
+            DirectX::XMStoreFloat3(&position, DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&position), worldMatrix));
+        }
+    }
+
+    // The outside poses around the sphere transformed by world, at twice the distance.
+    // Without backface culling (mirrored worlds) nothing in front of them is rejected.
+    void testWorldPoses(const char* worldName,
+                        const MeshData& meshData,
+                        const MeshletData& meshletData,
+                        const DirectX::XMFLOAT4X4& world,
+                        const bool backfaceCulling,
+                        Camera& camera,
+                        TestResults& results)
+    {
+        MeshData worldMeshData;
+        transformMeshData(meshData, world, worldMeshData);
+
+        const uint32_t numTriangles = static_cast<uint32_t> (meshData.mIndices.size() / 3);
+        const DirectX::XMVECTOR center = DirectX::XMVectorSet(world.m[3][0], world.m[3][1], world.m[3][2], 0.0f);
+        for(size_t i = 0; i < sizeof(sOutsidePoses) / sizeof(sOutsidePoses[0]); ++i) {
+            const CameraPose& pose = sOutsidePoses[i];
+            DirectX::XMFLOAT3 position;
+            DirectX::XMFLOAT3 target;
+            DirectX::XMStoreFloat3(&position, DirectX::XMVectorAdd(center, DirectX::XMVectorScale(DirectX::XMLoadFloat3(&pose.mPosition), 2.0f)));
+            DirectX::XMStoreFloat3(&target, DirectX::XMVectorAdd(center, DirectX::XMVectorScale(DirectX::XMLoadFloat3(&pose.mTarget), 2.0f)));
+            CameraUtils::setCoordinateSystem(position, target, pose.mUp, camera);
+
+            const TriangleCounts counts = countTriangles(worldMeshData, meshletData, world, camera);
+            printf("    %-8s %-10s rejected %5u of %5u triangles (brute force %5u)\n",
+                   worldName,
+                   pose.mName,
+                   counts.mRejected,
+                   numTriangles,
+                   counts.mBruteForceRejectable);
+
+            TEST_CHECK(results, counts.mWronglyRejected == 0);
+            TEST_CHECK(results, counts.mRejected <= counts.mBruteForceRejectable);
+            TEST_CHECK(results, backfaceCulling ? counts.mRejected >= numTriangles / 4 : counts.mRejected == 0);
+        }
+    }
+}
+
+namespace Tests
+{
+    void testMeshletBuilder(TestResults& results)
+    {
+        MeshData meshData;
+        GeometryGenerator::generateSphere(5.0f, 64, 64, meshData);
+        MeshOptimizer::optimizeVertexCache(meshData);
+
+        MeshletData meshletData;
+        MeshletUtils::buildMeshlets(meshData, meshletData);
+
+        const uint32_t numTriangles = static_cast<uint32_t> (meshData.mIndices.size() / 3);
+        TEST_CHECK(results, meshletData.mTriangles.size() == meshData.mIndices.size());
+
+        std::vector<uint32_t> allMeshlets(meshletData.mMeshlets.size());
+        for(uint32_t i = 0; i < allMeshlets.size(); ++i) {
+            allMeshlets[i] = i;
+        }
+
+        std::vector<uint32_t> indices;
+        MeshletUtils::appendIndices(meshletData, allMeshlets, indices);
+        TEST_CHECK(results, indices == meshData.mIndices);
+
+        Camera camera;
+        CameraUtils::setFrustrum(0.25f * DirectX::XM_PI, 4.0f / 3.0f, 1.0f, 1000.0f, camera);
+
+        const DirectX::XMFLOAT3 yAxis(0.0f, 1.0f, 0.0f);
+        const DirectX::XMFLOAT3 zAxis(0.0f, 0.0f, 1.0f);
+        DirectX::XMFLOAT4X4 identity;
+        DirectX::XMStoreFloat4x4(&identity, DirectX::XMMatrixIdentity());
+
+        for(size_t i = 0; i < sizeof(sOutsidePoses) / sizeof(sOutsidePoses[0]); ++i) {
+            const CameraPose& pose = sOutsidePoses[i];
+            CameraUtils::setCoordinateSystem(pose.mPosition, pose.mTarget, pose.mUp, camera);
+
+            const TriangleCounts counts = countTriangles(meshData, meshletData, identity, camera);
+            printf("    %-10s rejected %5u of %5u triangles (brute force %5u)\n",
+                   pose.mName,
+                   counts.mRejected,
+                   numTriangles,
+                   counts.mBruteForceRejectable);
+
+            TEST_CHECK(results, counts.mWronglyRejected == 0);
+            TEST_CHECK(results, counts.mRejected <= counts.mBruteForceRejectable);
+
+            // Meshlets are coarser than triangles, but should still
+            // reject most of the back facing half.
+            TEST_CHECK(results, counts.mRejected >= numTriangles / 4);
+        }
+
+        // Looking away from the sphere rejects everything.
+        CameraUtils::setCoordinateSystem(DirectX::XMFLOAT3(0.0f, 0.0f, -20.0f),
+                                         DirectX::XMFLOAT3(0.0f, 0.0f, -40.0f),
+                                         yAxis,
+                                         camera);
+        TriangleCounts counts = countTriangles(meshData, meshletData, identity, camera);
+        printf("    %-10s rejected %5u of %5u triangles\n", "away", counts.mRejected, numTriangles);
+        TEST_CHECK(results, counts.mRejected == numTriangles);
+
+        // From inside, culling must stay conservative.
+        CameraUtils::setCoordinateSystem(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), zAxis, yAxis, camera);
+        counts = countTriangles(meshData, meshletData, identity, camera);
+        printf("    %-10s rejected %5u of %5u triangles\n", "inside", counts.mRejected, numTriangles);
+        TEST_CHECK(results, counts.mWronglyRejected == 0);
+
+        // Meshlets stay in object space: a scaled, rotated and translated sphere is
+        // culled with its world matrix, against its triangles in world space.
+        // A mirrored one is only frustum culled.
+        DirectX::XMFLOAT4X4 world;
+        DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixScaling(1.5f, 0.75f, 2.0f) *
+                                         DirectX::XMMatrixRotationRollPitchYaw(0.3f, 0.8f, -0.4f) *
+                                         DirectX::XMMatrixTranslation(30.0f, -10.0f, 50.0f));
+        testWorldPoses("world", meshData, meshletData, world, true, camera, results);
+
+        DirectX::XMFLOAT4X4 mirroredWorld;
+        DirectX::XMStoreFloat4x4(&mirroredWorld, DirectX::XMMatrixScaling(-1.0f, 1.0f, 1.0f) *
+                                                 DirectX::XMMatrixTranslation(-40.0f, 5.0f, 20.0f));
+        testWorldPoses("mirrored", meshData, meshletData, mirroredWorld, false, camera, results);
+    }
+}
@@ -0,0 +1,106 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <random>
+
+#include <GeometryGenerator.h>
+#include <PackedVertex.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    // Largest angle (in radians) between two unit vectors.
+    float computeAngle(DirectX::FXMVECTOR unitVector0,
+                       DirectX::FXMVECTOR unitVector1)
+    {
+        const float cosAngle = DirectX::XMVectorGetX(DirectX::XMVector3Dot(unitVector0, unitVector1));
+        const float sinAngle = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(unitVector0, unitVector1)));
+        return atan2f(sinAngle, cosAngle);
+    }
+
+    void testMesh(const char* name,
+                  const MeshData& meshData,
+                  TestResults& results)
+    {
+        PackedMeshData packedMeshData;
+        PackedVertexUtils::encode(meshData, packedMeshData);
+        TEST_CHECK(results, packedMeshData.mVertices.size() == meshData.mVertices.size());
+        TEST_CHECK(results, packedMeshData.mIndices == meshData.mIndices);
+
+        const PackedVertexErrors errors = PackedVertexUtils::computeErrors(meshData, packedMeshData);
+        printf("    %-8s %7u -> %7u bytes, position %.2e, normal %.4f deg, tangent %.4f deg, texcoord %.2e\n",
+               name,
+               static_cast<uint32_t> (meshData.mVertices.size() * sizeof(VertexData)),
+               static_cast<uint32_t> (packedMeshData.mVertices.size() * sizeof(PackedVertexData)),
+               errors.mPositionError,
+               DirectX::XMConvertToDegrees(errors.mNormalAngleError),
+               DirectX::XMConvertToDegrees(errors.mTangentAngleError),
+               errors.mTexCoordError);
+
+        // Half a quantization step per axis, with some room for float rounding.
+        const float maxPositionError =
+            1.01f * 0.5f * DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMLoadFloat3(&packedMeshData.mPositionScale))) / 65535.0f;
+        TEST_CHECK(results, errors.mPositionError <= maxPositionError);
+
+        TEST_CHECK(results, errors.mNormalAngleError <= DirectX::XMConvertToRadians(0.01f));
+        TEST_CHECK(results, errors.mTangentAngleError <= DirectX::XMConvertToRadians(0.01f));
+
+        // Texture coordinates are in [0, 1], where half floats have 11 bits of precision.
+        TEST_CHECK(results, errors.mTexCoordError <= 1.0f / 4096.0f);
+    }
+}
+
+namespace Tests
+{
+    void testPackedVertex(TestResults& results)
+    {
+        TEST_CHECK(results, sizeof(PackedVertexData) == 20);
+
+        MeshData meshData;
+        GeometryGenerator::generateBox(1.0f, 2.0f, 3.0f, meshData);
+        testMesh("box", meshData, results);
+
+        GeometryGenerator::generateSphere(1.0f, 64, 64, meshData);
+        testMesh("sphere", meshData, results);
+
+        GeometryGenerator::generateGeosphere(3.0f, 5, meshData);
+        testMesh("geosphere", meshData, results);
+
+        GeometryGenerator::generateCylinder(0.5f, 0.3f, 3.0f, 20, 20, meshData);
+        testMesh("cylinder", meshData, results);
+
+        GeometryGenerator::generateGrid(160.0f, 160.0f, 50, 50, meshData);
+        testMesh("grid", meshData, results);
+
+        // Octahedral round trip through 16 bit signed normalized integers.
+        std::mt19937 generator(1);
+        std::normal_distribution<float> distribution;
+        float maxAngle = 0.0f;
+        for(uint32_t i = 0; i < 100000; ++i) {
+            const DirectX::XMVECTOR direction =
+                DirectX::XMVector3Normalize(DirectX::XMVectorSet(distribution(generator), distribution(generator), distribution(generator), 0.0f));
+
+            DirectX::PackedVector::XMSHORTN2 encodedDirection;
+            DirectX::PackedVector::XMStoreShortN2(&encodedDirection, PackedVertexUtils::encodeOctahedral(direction));
+            const DirectX::XMVECTOR decodedDirection = PackedVertexUtils::decodeOctahedral(DirectX::PackedVector::XMLoadShortN2(&encodedDirection));
+
+            maxAngle = std::max(maxAngle, computeAngle(direction, decodedDirection));
+        }
+
+        printf("    random directions: %.4f deg\n", DirectX::XMConvertToDegrees(maxAngle));
+        TEST_CHECK(results, maxAngle <= DirectX::XMConvertToRadians(0.01f));
+
+        // Zero vectors decode to +z, and -z (encoded in the folded corners) survives the round trip.
+        const DirectX::XMVECTOR zAxis = DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+        const DirectX::XMVECTOR decodedZero = PackedVertexUtils::decodeOctahedral(PackedVertexUtils::encodeOctahedral(DirectX::XMVectorZero()));
+        TEST_CHECK(results, DirectX::XMVector3NearEqual(decodedZero, zAxis, DirectX::XMVectorReplicate(1.0e-6f)));
+
+        const DirectX::XMVECTOR decodedNegativeZ = PackedVertexUtils::decodeOctahedral(PackedVertexUtils::encodeOctahedral(DirectX::XMVectorNegate(zAxis)));
+        TEST_CHECK(results, DirectX::XMVector3NearEqual(decodedNegativeZ, DirectX::XMVectorNegate(zAxis), DirectX::XMVectorReplicate(1.0e-6f)));
+    }
+}
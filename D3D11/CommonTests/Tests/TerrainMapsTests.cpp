@@ -0,0 +1,244 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <HalfConversion.h>
+#include <HeightMap.h>
+#include <TerrainMaps.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    const char* sCacheFilePath = "TerrainMapsTests.maps";
+
+    // Maps of a single texel, smaller than a block, not a multiple of
+    // a block and split unevenly across threads
+    const uint32_t sDimensions[] = { 1, 2, 5, 7, 130 };
+    const float sCellSpacings[] = { 0.5f, 2.0f };
+
+    // Smooth terrain with random bumps, so gradients and curvatures of
+    // both signs are baked.
+    void buildHeightMap(std::mt19937& generator,
+                        HeightMap& heightMap)
+    {
+        std::uniform_real_distribution<float> bumpDistribution(-2.0f, 2.0f);
+        const uint32_t dimension = heightMap.mDimension;
+        for(uint32_t row = 0; row < dimension; ++row) {
+            for(uint32_t column = 0; column < dimension; ++column) {
+                heightMap.mData[row * dimension + column] = 20.0f * sinf(row * 0.05f) +
+                                                            15.0f * cosf(column * 0.07f) +
+                                                            0.3f * row +
+                                                            bumpDistribution(generator);
+            }
+        }
+    }
+
+    // Texels out of the map are clamped to its border.
+    float sampleHeight(const HeightMap& heightMap,
+                       const int32_t row,
+                       const int32_t column)
+    {
+        const int32_t last = static_cast<int32_t> (heightMap.mDimension) - 1;
+        const int32_t clampedRow = (std::min)((std::max)(row, 0), last);
+        const int32_t clampedColumn = (std::min)((std::max)(column, 0), last);
+        return heightMap.mData[clampedRow * heightMap.mDimension + clampedColumn];
+    }
+
+    // Height change per world unit along x (columns) and z (rows),
+    // one texel at a time.
+    void computeReferenceGradient(const HeightMap& heightMap,
+                                  const int32_t row,
+                                  const int32_t column,
+                                  const float cellSpacing,
+                                  const GradientOperator gradientOperator,
+                                  float& gradientX,
+                                  float& gradientZ)
+    {
+        float heightDu;
+        float heightDv;
+        if(gradientOperator == GradientOperator::SOBEL) {
+            heightDu = (sampleHeight(heightMap, row - 1, column + 1) + 2.0f * sampleHeight(heightMap, row, column + 1) + sampleHeight(heightMap, row + 1, column + 1)) -
+                       (sampleHeight(heightMap, row - 1, column - 1) + 2.0f * sampleHeight(heightMap, row, column - 1) + sampleHeight(heightMap, row + 1, column - 1));
+            heightDv = (sampleHeight(heightMap, row + 1, column - 1) + 2.0f * sampleHeight(heightMap, row + 1, column) + sampleHeight(heightMap, row + 1, column + 1)) -
+                       (sampleHeight(heightMap, row - 1, column - 1) + 2.0f * sampleHeight(heightMap, row - 1, column) + sampleHeight(heightMap, row - 1, column + 1));
+            heightDu /= 8.0f;
+            heightDv /= 8.0f;
+        } else {
+            heightDu = 0.5f * (sampleHeight(heightMap, row, column + 1) - sampleHeight(heightMap, row, column - 1));
+            heightDv = 0.5f * (sampleHeight(heightMap, row + 1, column) - sampleHeight(heightMap, row - 1, column));
+        }
+
+        gradientX = heightDu / cellSpacing;
+        gradientZ = heightDv / cellSpacing;
+    }
+
+    // Number of texels of terrainMaps whose normal, slope or curvature is
+    // not the one of the scalar reference, up to encoding precision.
+    uint32_t countWrongTexels(const HeightMap& heightMap,
+                              const float cellSpacing,
+                              const GradientOperator gradientOperator,
+                              const TerrainMaps& terrainMaps)
+    {
+        const int32_t dimension = static_cast<int32_t> (heightMap.mDimension);
+        uint32_t wrongTexels = 0;
+        for(int32_t row = 0; row < dimension; ++row) {
+            for(int32_t column = 0; column < dimension; ++column) {
+                float gradientX;
+                float gradientZ;
+                computeReferenceGradient(heightMap, row, column, cellSpacing, gradientOperator, gradientX, gradientZ);
+
+                const float length = sqrtf(gradientX * gradientX + gradientZ * gradientZ + 1.0f);
+                const float slope = sqrtf(gradientX * gradientX + gradientZ * gradientZ);
+                const float curvature = (sampleHeight(heightMap, row, column - 1) +
+                                         sampleHeight(heightMap, row, column + 1) +
+                                         sampleHeight(heightMap, row - 1, column) +
+                                         sampleHeight(heightMap, row + 1, column) -
+                                         4.0f * sampleHeight(heightMap, row, column)) / (cellSpacing * cellSpacing);
+
+                const size_t texel = 2 * (row * dimension + column);
+                const DirectX::XMFLOAT3 normal = TerrainMapsUtils::decodeNormal(terrainMaps.mNormals[texel], terrainMaps.mNormals[texel + 1]);
+                const float bakedSlope = HalfConversionUtils::convertHalfToFloat(terrainMaps.mSlopeCurvature[texel]);
+                const float bakedCurvature = HalfConversionUtils::convertHalfToFloat(terrainMaps.mSlopeCurvature[texel + 1]);
+
+                // SNORM16 channels are exact to 1.0e-4, and halves to 1.0e-3 relative.
+                const float normalError = fabsf(normal.x + gradientX / length) +
+                                          fabsf(normal.y - 1.0f / length) +
+                                          fabsf(normal.z + gradientZ / length);
+                if(normalError > 1.0e-3f ||
+                   fabsf(bakedSlope - slope) > 1.0e-3f * (std::max)(slope, 1.0f) ||
+                   fabsf(bakedCurvature - curvature) > 1.0e-3f * (std::max)(fabsf(curvature), 1.0f)) {
+                    ++wrongTexels;
+                }
+            }
+        }
+
+        return wrongTexels;
+    }
+
+    bool haveSameMaps(const TerrainMaps& terrainMaps,
+                      const TerrainMaps& otherTerrainMaps)
+    {
+        return terrainMaps.mDimension == otherTerrainMaps.mDimension &&
+               terrainMaps.mCellSpacing == otherTerrainMaps.mCellSpacing &&
+               terrainMaps.mGradientOperator == otherTerrainMaps.mGradientOperator &&
+               terrainMaps.mKey == otherTerrainMaps.mKey &&
+               terrainMaps.mNormals == otherTerrainMaps.mNormals &&
+               terrainMaps.mSlopeCurvature == otherTerrainMaps.mSlopeCurvature;
+    }
+}
+
+namespace Tests
+{
+    void testTerrainMaps(TestResults& results)
+    {
+        std::mt19937 generator(1);
+        std::string errorMessage;
+
+        // Both operators match the scalar reference, for every dimension
+        // and cell spacing, and threaded bakes match single thread ones.
+        const GradientOperator gradientOperators[] = { GradientOperator::CENTRAL_DIFFERENCES, GradientOperator::SOBEL };
+        uint32_t wrongTexels = 0;
+        uint32_t wrongThreadedBakes = 0;
+        for(size_t i = 0; i < sizeof(sDimensions) / sizeof(sDimensions[0]); ++i) {
+            HeightMap heightMap(sDimensions[i]);
+            buildHeightMap(generator, heightMap);
+            for(size_t j = 0; j < sizeof(sCellSpacings) / sizeof(sCellSpacings[0]); ++j) {
+                for(size_t k = 0; k < sizeof(gradientOperators) / sizeof(gradientOperators[0]); ++k) {
+                    TerrainMaps terrainMaps;
+                    TerrainMapsUtils::bake(heightMap, sCellSpacings[j], gradientOperators[k], terrainMaps, 1);
+                    wrongTexels += countWrongTexels(heightMap, sCellSpacings[j], gradientOperators[k], terrainMaps);
+
+                    TerrainMaps threadedTerrainMaps;
+                    TerrainMapsUtils::bake(heightMap, sCellSpacings[j], gradientOperators[k], threadedTerrainMaps, 3);
+                    if(!haveSameMaps(terrainMaps, threadedTerrainMaps)) {
+                        ++wrongThreadedBakes;
+                    }
+                }
+            }
+        }
+
+        printf("    %u wrong texels, %u wrong threaded bakes\n", wrongTexels, wrongThreadedBakes);
+        TEST_CHECK(results, wrongTexels == 0);
+        TEST_CHECK(results, wrongThreadedBakes == 0);
+
+        // Flat maps have up normals and no slope or curvature.
+        HeightMap flatHeightMap(9);
+        std::fill(flatHeightMap.mData.begin(), flatHeightMap.mData.end(), 7.0f);
+        TerrainMaps flatTerrainMaps;
+        TerrainMapsUtils::bake(flatHeightMap, 1.0f, GradientOperator::SOBEL, flatTerrainMaps, 1);
+        TEST_CHECK(results, std::count(flatTerrainMaps.mNormals.begin(), flatTerrainMaps.mNormals.end(), 0) == 2 * 9 * 9);
+        TEST_CHECK(results, std::count(flatTerrainMaps.mSlopeCurvature.begin(), flatTerrainMaps.mSlopeCurvature.end(), 0) == 2 * 9 * 9);
+
+        // The key changes with the heights, the cell spacing and the operator.
+        HeightMap heightMap(64);
+        buildHeightMap(generator, heightMap);
+        const uint64_t key = TerrainMapsUtils::computeKey(heightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES);
+        HeightMap changedHeightMap(heightMap);
+        changedHeightMap.mData[1000] += 0.001f;
+        TEST_CHECK(results, key == TerrainMapsUtils::computeKey(heightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES));
+        TEST_CHECK(results, key != TerrainMapsUtils::computeKey(changedHeightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES));
+        TEST_CHECK(results, key != TerrainMapsUtils::computeKey(heightMap, 2.0f, GradientOperator::CENTRAL_DIFFERENCES));
+        TEST_CHECK(results, key != TerrainMapsUtils::computeKey(heightMap, 1.0f, GradientOperator::SOBEL));
+
+        // The first loadOrBake bakes and writes the cache, which loads
+        // back as the baked maps.
+        remove(sCacheFilePath);
+        TerrainMaps bakedTerrainMaps;
+        TerrainMapsUtils::bake(heightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES, bakedTerrainMaps, 1);
+        TerrainMaps terrainMaps;
+        TerrainMaps loadedTerrainMaps;
+        TEST_CHECK(results, TerrainMapsUtils::loadOrBake(sCacheFilePath, heightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES, terrainMaps, 1, &errorMessage));
+        TEST_CHECK(results, haveSameMaps(terrainMaps, bakedTerrainMaps));
+        TEST_CHECK(results, TerrainMapsUtils::loadFromFile(sCacheFilePath, loadedTerrainMaps, &errorMessage));
+        TEST_CHECK(results, haveSameMaps(loadedTerrainMaps, bakedTerrainMaps));
+
+        // Later runs with the same key load the cache instead of baking: a
+        // cache with marked normals comes back marked.
+        TerrainMaps markedTerrainMaps(bakedTerrainMaps);
+        markedTerrainMaps.mNormals[0] ^= 1;
+        TEST_CHECK(results, TerrainMapsUtils::saveToFile(sCacheFilePath, markedTerrainMaps, &errorMessage));
+        TEST_CHECK(results, TerrainMapsUtils::loadOrBake(sCacheFilePath, heightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES, terrainMaps, 1, &errorMessage));
+        TEST_CHECK(results, haveSameMaps(terrainMaps, markedTerrainMaps));
+
+        // A different height map, cell spacing or operator rebakes the maps
+        // and replaces the cache with them.
+        uint32_t wrongRebakes = 0;
+        for(uint32_t change = 0; change < 3; ++change) {
+            TEST_CHECK(results, TerrainMapsUtils::saveToFile(sCacheFilePath, markedTerrainMaps, &errorMessage));
+
+            const HeightMap& rebakedHeightMap = change == 0 ? changedHeightMap : heightMap;
+            const float cellSpacing = change == 1 ? 2.0f : 1.0f;
+            const GradientOperator gradientOperator = change == 2 ? GradientOperator::SOBEL : GradientOperator::CENTRAL_DIFFERENCES;
+            TerrainMaps expectedTerrainMaps;
+            TerrainMapsUtils::bake(rebakedHeightMap, cellSpacing, gradientOperator, expectedTerrainMaps, 1);
+            if(!TerrainMapsUtils::loadOrBake(sCacheFilePath, rebakedHeightMap, cellSpacing, gradientOperator, terrainMaps, 1, &errorMessage) ||
+               !haveSameMaps(terrainMaps, expectedTerrainMaps) ||
+               !TerrainMapsUtils::loadFromFile(sCacheFilePath, loadedTerrainMaps, &errorMessage) ||
+               !haveSameMaps(loadedTerrainMaps, expectedTerrainMaps)) {
+                ++wrongRebakes;
+            }
+        }
+
+        TEST_CHECK(results, wrongRebakes == 0);
+
+        // Truncated caches are rebaked.
+        TEST_CHECK(results, TerrainMapsUtils::saveToFile(sCacheFilePath, markedTerrainMaps, &errorMessage));
+        {
+            std::ofstream file(sCacheFilePath, std::ios::binary | std::ios::trunc);
+            file.write("TMAP", 4);
+        }
+
+        TEST_CHECK(results, !TerrainMapsUtils::loadFromFile(sCacheFilePath, loadedTerrainMaps));
+        TEST_CHECK(results, TerrainMapsUtils::loadOrBake(sCacheFilePath, heightMap, 1.0f, GradientOperator::CENTRAL_DIFFERENCES, terrainMaps, 1, &errorMessage));
+        TEST_CHECK(results, haveSameMaps(terrainMaps, bakedTerrainMaps));
+
+        remove(sCacheFilePath);
+    }
+}
@@ -0,0 +1,38 @@
+#include "TestUtils.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace TestUtils
+{
+    void check(const bool condition,
+               const char* expression,
+               const char* file,
+               const int line,
+               TestResults& results)
+    {
+        ++results.mChecks;
+        if(!condition) {
+            ++results.mFailures;
+            printf("    FAILED: %s (%s:%d)\n", expression, file, line);
+        }
+    }
+
+    double measureMilliseconds(const uint32_t repetitions,
+                               const std::function<void()>& function)
+    {
+        double fastestTime = 0.0;
+        for(uint32_t i = 0; i < repetitions; ++i) {
+            const std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+            function();
+            const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+            const double time = std::chrono::duration<double, std::milli>(end - begin).count();
+            if(i == 0 || time < fastestTime) {
+                fastestTime = time;
+            }
+        }
+
+        return fastestTime;
+    }
+}
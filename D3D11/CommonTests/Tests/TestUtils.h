@@ -0,0 +1,42 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Minimal checks for the headless Common tests.
+//
+// Every failed check prints its expression and location, and is
+// counted in TestResults, so main can return a nonzero exit code.
+// Benchmarks time their runs with measureMilliseconds.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+struct TestResults
+{
+    TestResults()
+        : mChecks(0)
+        , mFailures(0)
+    {
+
+    }
+
+    uint32_t mChecks;
+    uint32_t mFailures;
+};
+
+namespace TestUtils
+{
+    void check(const bool condition,
+               const char* expression,
+               const char* file,
+               const int line,
+               TestResults& results);
+
+    // Calls function repetitions times and returns the time of the fastest call.
+    double measureMilliseconds(const uint32_t repetitions,
+                               const std::function<void()>& function);
+}
+
+#define TEST_CHECK(results, condition) TestUtils::check((condition), #condition, __FILE__, __LINE__, (results))
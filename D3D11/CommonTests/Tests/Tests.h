@@ -0,0 +1,36 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// Headless tests of the Common code that do not need a device, and
+// benchmarks of it, that only print their timings.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+struct TestResults;
+
+namespace Tests
+{
+    void testCompressedHeightMap(TestResults& results);
+    void testGeometryGenerator(TestResults& results);
+    void testHalfConversion(TestResults& results);
+    void testHeightMap(TestResults& results);
+    void testHeightMapPyramid(TestResults& results);
+    void testHeightMapSampler(TestResults& results);
+    void testMeshCache(TestResults& results);
+    void testMeshletBuilder(TestResults& results);
+    void testMeshOptimizer(TestResults& results);
+    void testMeshSimplifier(TestResults& results);
+    void testMeshSink(TestResults& results);
+    void testPackedVertex(TestResults& results);
+    void testTerrainMaps(TestResults& results);
+    void testTiledHeightMap(TestResults& results);
+
+    void benchmarkGeometryGenerator();
+    void benchmarkHalfConversion();
+    void benchmarkHeightMap();
+    void benchmarkHeightMapPyramid();
+    void benchmarkMeshCache();
+    void benchmarkMeshOptimizer();
+    void benchmarkMeshSink();
+}
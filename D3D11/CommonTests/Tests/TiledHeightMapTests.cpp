@@ -0,0 +1,274 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Camera.h>
+#include <HeightMap.h>
+#include <HeightMapSampler.h>
+#include <TiledHeightMap.h>
+
+#include "TestUtils.h"
+
+namespace
+{
+    // Not a multiple of the tile dimension, so the last row
+    // and column of tiles are padded.
+    const uint32_t sDimension = 300;
+    const uint32_t sTileDimension = 64;
+    const uint32_t sTileBytes = sTileDimension * sTileDimension * sizeof(float);
+
+    const char* sTileFilePath = "TiledHeightMapTests.tiles";
+    const char* sRAWFilePath = "TiledHeightMapTests.raw";
+    const char* sRAWTileFilePath = "TiledHeightMapTests.raw.tiles";
+    const char* sTruncatedTileFilePath = "TiledHeightMapTests.truncated.tiles";
+
+    void writeFile(const char* filePath,
+                   const std::vector<char>& bytes,
+                   const size_t size)
+    {
+        std::ofstream file(filePath, std::ios_base::binary | std::ios_base::trunc);
+        file.write(&bytes[0], size);
+    }
+
+    // Number of texels of tiledHeightMap that differ from heightMap
+    uint32_t countWrongHeights(TiledHeightMap& tiledHeightMap,
+                               const HeightMap& heightMap)
+    {
+        uint32_t wrongHeights = 0;
+        for(uint32_t row = 0; row < heightMap.mDimension; ++row) {
+            for(uint32_t column = 0; column < heightMap.mDimension; ++column) {
+                if(TiledHeightMapUtils::fetchHeight(tiledHeightMap, row, column) != heightMap.mData[row * heightMap.mDimension + column]) {
+                    ++wrongHeights;
+                }
+            }
+        }
+
+        return wrongHeights;
+    }
+
+    // Waits (up to a second) for the prefetcher to read its queue.
+    bool waitForPrefetcher(TiledHeightMap& tiledHeightMap)
+    {
+        for(uint32_t i = 0; i < 1000; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(tiledHeightMap.mMutex);
+                bool loading = false;
+                for(std::unordered_map<uint32_t, CachedHeightMapTile>::const_iterator tile = tiledHeightMap.mTiles.begin();
+                    tile != tiledHeightMap.mTiles.end();
+                    ++tile) {
+                    loading = loading || tile->second.mLoading;
+                }
+
+                if(tiledHeightMap.mPrefetchQueue.empty() && !loading) {
+                    return true;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return false;
+    }
+}
+
+namespace Tests
+{
+    void testTiledHeightMap(TestResults& results)
+    {
+        HeightMap heightMap(sDimension);
+        for(uint32_t row = 0; row < sDimension; ++row) {
+            for(uint32_t column = 0; column < sDimension; ++column) {
+                heightMap.mData[row * sDimension + column] = 50.0f * sinf(row * 0.03f) + 30.0f * cosf(column * 0.05f);
+            }
+        }
+
+        std::string errorMessage;
+        TEST_CHECK(results, TiledHeightMapUtils::buildTileFile(heightMap, sTileDimension, sTileFilePath, &errorMessage));
+
+        // Every texel, through a cache much smaller than the height map
+        {
+            TiledHeightMap tiledHeightMap;
+            TEST_CHECK(results, TiledHeightMapUtils::open(sTileFilePath, 4 * sTileBytes, tiledHeightMap, &errorMessage));
+            TEST_CHECK(results, tiledHeightMap.mTilesPerSide == 5);
+            TEST_CHECK(results, tiledHeightMap.mMaxResidentTiles == 4);
+            TEST_CHECK(results, countWrongHeights(tiledHeightMap, heightMap) == 0);
+            TEST_CHECK(results, tiledHeightMap.mTiles.size() <= tiledHeightMap.mMaxResidentTiles);
+
+            const TileCacheStatistics statistics = TiledHeightMapUtils::getStatistics(tiledHeightMap);
+            printf("    %u x %u in %u x %u tiles, 4 resident: %llu hits, %llu misses, %llu evicted\n",
+                   sDimension,
+                   sDimension,
+                   sTileDimension,
+                   sTileDimension,
+                   static_cast<unsigned long long> (statistics.mHits),
+                   static_cast<unsigned long long> (statistics.mMisses),
+                   static_cast<unsigned long long> (statistics.mEvictedTiles));
+            TEST_CHECK(results, statistics.mEvictedTiles > 0);
+
+            // Bilinear heights match HeightMapSampler.
+            const HeightMapMapping mapping = HeightMapSamplerUtils::computeGridMapping(600.0f, 600.0f, sDimension);
+            std::mt19937 generator(1);
+            std::uniform_real_distribution<float> distribution(-320.0f, 320.0f);
+            float maxError = 0.0f;
+            for(uint32_t i = 0; i < 10000; ++i) {
+                const float x = distribution(generator);
+                const float z = distribution(generator);
+                float expectedHeight;
+                HeightMapSamplerUtils::sampleHeights(heightMap, mapping, HeightFilter::BILINEAR, &x, &z, 1, &expectedHeight);
+                maxError = std::max(maxError, fabsf(TiledHeightMapUtils::sampleHeight(tiledHeightMap, mapping, x, z) - expectedHeight));
+            }
+
+            printf("    bilinear heights: error %.2e\n", maxError);
+            TEST_CHECK(results, maxError <= 1.0e-3f);
+
+            // Prefetched tiles around the camera are resident when they are requested.
+            Camera camera;
+            camera.mPosition = DirectX::XMFLOAT3(0.0f, 100.0f, 0.0f);
+            camera.mLook = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+            TiledHeightMapUtils::prefetch(tiledHeightMap, mapping, camera, 10.0f, 50.0f);
+            TEST_CHECK(results, waitForPrefetcher(tiledHeightMap));
+
+            TiledHeightMapUtils::resetStatistics(tiledHeightMap);
+            TiledHeightMapUtils::sampleHeight(tiledHeightMap, mapping, camera.mPosition.x, camera.mPosition.z);
+            TiledHeightMapUtils::sampleHeight(tiledHeightMap, mapping, camera.mPosition.x + 50.0f, camera.mPosition.z);
+            const TileCacheStatistics prefetchStatistics = TiledHeightMapUtils::getStatistics(tiledHeightMap);
+            TEST_CHECK(results, prefetchStatistics.mMisses == 0);
+            TEST_CHECK(results, prefetchStatistics.mHits > 0);
+
+            TiledHeightMapUtils::close(tiledHeightMap);
+        }
+
+        // Several threads reading through a 3 tile cache
+        {
+            TiledHeightMap tiledHeightMap;
+            TEST_CHECK(results, TiledHeightMapUtils::open(sTileFilePath, 3 * sTileBytes, tiledHeightMap, &errorMessage));
+
+            const uint32_t numThreads = 4;
+            uint32_t wrongHeights[numThreads] = { 0 };
+            std::vector<std::thread> threads;
+            for(uint32_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+                threads.push_back(std::thread([&, threadIndex]() {
+                    std::mt19937 threadGenerator(threadIndex);
+                    std::uniform_int_distribution<uint32_t> texelDistribution(0, sDimension - 1);
+                    for(uint32_t i = 0; i < 20000; ++i) {
+                        const uint32_t row = texelDistribution(threadGenerator);
+                        const uint32_t column = texelDistribution(threadGenerator);
+                        if(TiledHeightMapUtils::fetchHeight(tiledHeightMap, row, column) != heightMap.mData[row * sDimension + column]) {
+                            ++wrongHeights[threadIndex];
+                        }
+                    }
+                }));
+            }
+
+            for(uint32_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+                threads[threadIndex].join();
+                TEST_CHECK(results, wrongHeights[threadIndex] == 0);
+            }
+
+            TEST_CHECK(results, tiledHeightMap.mTiles.size() <= tiledHeightMap.mMaxResidentTiles);
+            TiledHeightMapUtils::close(tiledHeightMap);
+        }
+
+        // RAW files are converted without loading them whole, to the same heights.
+        {
+            std::vector<uint16_t> samples(sDimension * sDimension);
+            for(uint32_t i = 0; i < sDimension * sDimension; ++i) {
+                samples[i] = static_cast<uint16_t> (i * 7919U);
+            }
+
+            std::ofstream rawFile(sRAWFilePath, std::ios_base::binary);
+            rawFile.write(reinterpret_cast<const char*> (&samples[0]), samples.size() * sizeof(uint16_t));
+            rawFile.close();
+
+            HeightMap rawHeightMap(sDimension);
+            TEST_CHECK(results, HeightMapUtils::loadFromRAWFile(sRAWFilePath, 100.0f, rawHeightMap, RAWFormat::UINT16_LITTLE_ENDIAN, &errorMessage));
+            TEST_CHECK(results, TiledHeightMapUtils::buildTileFileFromRAW(sRAWFilePath,
+                                                                          sDimension,
+                                                                          100.0f,
+                                                                          RAWFormat::UINT16_LITTLE_ENDIAN,
+                                                                          sTileDimension,
+                                                                          sRAWTileFilePath,
+                                                                          &errorMessage));
+
+            TiledHeightMap tiledHeightMap;
+            TEST_CHECK(results, TiledHeightMapUtils::open(sRAWTileFilePath, 2 * sTileBytes, tiledHeightMap, &errorMessage));
+            TEST_CHECK(results, countWrongHeights(tiledHeightMap, rawHeightMap) == 0);
+            TiledHeightMapUtils::close(tiledHeightMap);
+
+            // Too small RAW files and files that are not tile files are rejected.
+            TEST_CHECK(results, !TiledHeightMapUtils::buildTileFileFromRAW(sRAWFilePath,
+                                                                           sDimension + 1,
+                                                                           100.0f,
+                                                                           RAWFormat::UINT16_LITTLE_ENDIAN,
+                                                                           sTileDimension,
+                                                                           sRAWTileFilePath,
+                                                                           &errorMessage));
+            TiledHeightMap invalidTiledHeightMap;
+            TEST_CHECK(results, !TiledHeightMapUtils::open(sRAWFilePath, sTileBytes, invalidTiledHeightMap, &errorMessage));
+        }
+
+        // Tiles that can not be read, because the file was truncated after
+        // it was opened, are not cached and are counted as failed reads, by
+        // the calling threads and by the prefetcher. They are read once the
+        // file is whole again.
+        {
+            std::vector<char> bytes;
+            {
+                std::ifstream file(sTileFilePath, std::ios_base::binary);
+                bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+
+            writeFile(sTruncatedTileFilePath, bytes, bytes.size());
+            TiledHeightMap tiledHeightMap;
+            TEST_CHECK(results, TiledHeightMapUtils::open(sTruncatedTileFilePath, 4 * sTileBytes, tiledHeightMap, &errorMessage));
+
+            // Keep the header and the first tile only.
+            writeFile(sTruncatedTileFilePath, bytes, bytes.size() - 24 * sTileBytes);
+            const uint32_t centerTileIndex = 2 * tiledHeightMap.mTilesPerSide + 2;
+            TEST_CHECK(results, TiledHeightMapUtils::acquireTile(tiledHeightMap, 0, 0) != nullptr);
+            TEST_CHECK(results, TiledHeightMapUtils::acquireTile(tiledHeightMap, 2, 2) == nullptr);
+            TEST_CHECK(results, TiledHeightMapUtils::fetchHeight(tiledHeightMap, 2 * sTileDimension, 2 * sTileDimension) == 0.0f);
+            TEST_CHECK(results, tiledHeightMap.mTiles.count(centerTileIndex) == 0);
+            TEST_CHECK(results, tiledHeightMap.mTiles.size() == tiledHeightMap.mLeastRecentlyUsed.size());
+            TEST_CHECK(results, TiledHeightMapUtils::getStatistics(tiledHeightMap).mFailedReads == 2);
+
+            const HeightMapMapping mapping = HeightMapSamplerUtils::computeGridMapping(600.0f, 600.0f, sDimension);
+            Camera camera;
+            camera.mPosition = DirectX::XMFLOAT3(0.0f, 100.0f, 0.0f);
+            camera.mLook = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
+            TiledHeightMapUtils::resetStatistics(tiledHeightMap);
+            TiledHeightMapUtils::prefetch(tiledHeightMap, mapping, camera, 10.0f, 50.0f);
+            TEST_CHECK(results, waitForPrefetcher(tiledHeightMap));
+
+            const TileCacheStatistics failedPrefetchStatistics = TiledHeightMapUtils::getStatistics(tiledHeightMap);
+            printf("    truncated file: %llu failed prefetches, %u resident tiles\n",
+                   static_cast<unsigned long long> (failedPrefetchStatistics.mFailedReads),
+                   static_cast<uint32_t> (tiledHeightMap.mTiles.size()));
+            TEST_CHECK(results, failedPrefetchStatistics.mFailedReads > 0);
+            TEST_CHECK(results, failedPrefetchStatistics.mPrefetchedTiles == 0);
+            TEST_CHECK(results, tiledHeightMap.mTiles.size() == 1);
+
+            writeFile(sTruncatedTileFilePath, bytes, bytes.size());
+            TiledHeightMapUtils::resetStatistics(tiledHeightMap);
+            TEST_CHECK(results, TiledHeightMapUtils::acquireTile(tiledHeightMap, 2, 2) != nullptr);
+            TEST_CHECK(results, countWrongHeights(tiledHeightMap, heightMap) == 0);
+            TEST_CHECK(results, TiledHeightMapUtils::getStatistics(tiledHeightMap).mFailedReads == 0);
+            TiledHeightMapUtils::close(tiledHeightMap);
+        }
+
+        remove(sTileFilePath);
+        remove(sRAWFilePath);
+        remove(sRAWTileFilePath);
+        remove(sTruncatedTileFilePath);
+    }
+}
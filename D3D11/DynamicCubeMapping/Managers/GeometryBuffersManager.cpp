@@ -7,6 +7,7 @@
 #include <GeometryGenerator.h>
 #include <DxErrorChecker.h>
 #include <MathHelper.h>
+#include <MeshSink.h>
 
 namespace 
 {
@@ -28,6 +29,15 @@ namespace
     {
         return 0.3f * (0.3f * z * sinf(0.1f * x) + 0.5f * x * cosf(0.1f * z));
     }
+
+    // Sky vertices only need the sphere positions.
+    struct SkyVertexProjection
+    {
+        void operator()(const VertexData& vertex, Geometry::SkyVertex& skyVertex) const
+        {
+            skyVertex.mPosition = vertex.mPosition;
+        }
+    };
 }
 
 namespace Managers
@@ -143,14 +153,16 @@ namespace Managers
         mSkyBufferInfo->mBaseVertexLocation = 0;
         
         // Fill vertices to insert in the vertex buffer
+        // Only positions are needed, so the sphere is generated
+        // straight into the sky vertex layout.
         const float skySphereRadius = 20.0f;
-        MeshData sphere;
-        GeometryGenerator::generateSphere(skySphereRadius, 30, 30, sphere);
-
-        std::vector<Geometry::SkyVertex> vertices(sphere.mVertices.size());
-
-        for(size_t i = 0; i < sphere.mVertices.size(); ++i)
-            vertices[i].mPosition = sphere.mVertices[i].mPosition;
+        const MeshSize sphereSize = GeometryGenerator::computeSphereSize(30, 30);
+        std::vector<Geometry::SkyVertex> vertices(sphereSize.mVertexCount);
+        std::vector<uint32_t> indices(sphereSize.mIndexCount);
+        GeometryGenerator::generateSphere(skySphereRadius, 
+                                          30, 
+                                          30, 
+                                          GeometryGenerator::makeMeshSink(vertices, indices, SkyVertexProjection(), MeshStream::POSITION));
 
         // Create vertex buffer
         D3D11_BUFFER_DESC vertexBufferDesc;
@@ -168,7 +180,7 @@ namespace Managers
         DxErrorChecker(result);
 
         // Set index count
-        mSkyBufferInfo->mIndexCount = static_cast<uint32_t> (sphere.mIndices.size());
+        mSkyBufferInfo->mIndexCount = static_cast<uint32_t> (indices.size());
 
         // Create and fill index buffer
         D3D11_BUFFER_DESC ibd;
@@ -179,9 +191,6 @@ namespace Managers
         ibd.StructureByteStride = 0;
         ibd.MiscFlags = 0;
 
-        std::vector<uint32_t> indices;
-        indices.insert(indices.end(), sphere.mIndices.begin(), sphere.mIndices.end());
-
         initData.pSysMem = &indices[0];
 
         result = device->CreateBuffer(&ibd, &initData, &mSkyBufferInfo->mIndexBuffer);
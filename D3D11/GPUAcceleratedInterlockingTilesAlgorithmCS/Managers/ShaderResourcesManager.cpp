@@ -140,10 +140,15 @@ namespace ShaderResourcesUtils
         const uint32_t heightMapDimension = 512;
         HeightMap heightMap(heightMapDimension);
         const float heightMapScaleFactor = 150.0f;
-        HeightMapUtils::loadFromRAWFile(
+        std::string errorMessage;
+        if(!HeightMapUtils::loadFromRAWFile(
             "Resources/Textures/terrainRaw.raw",
-            heightMapScaleFactor, 
-            heightMap);
+                heightMapScaleFactor, 
+                heightMap,
+                RAWFormat::UINT8,
+                &errorMessage)) {
+            MessageBoxA(0, errorMessage.c_str(), 0, 0);
+        }
 
         HeightMapUtils::applyNeighborsFilter(heightMap);
         shaderResources.mHeightMapSRV = HeightMapUtils::buildSRV(
@@ -47,8 +47,4 @@ struct GridPSPerFrameBuffer
     DirectX::XMFLOAT3 mEyePositionW;
     float mPad1;
     Material mMaterial;
-    float mTexelCellSpaceU;
-    float mTexelCellSpaceV;
-    float mWorldCellSpace;
-    float mPad2;
 };
\ No newline at end of file
@@ -5,9 +5,6 @@ cbuffer cbPerFrame : register(b0)
 	DirectionalLight gDirectionalLight[3];
 	float3 gEyePositionW;
     Material gMaterial;
-    float gTexelCellSpaceU;
-    float gTexelCellSpaceV;
-    float gWorldCellSpace;
 };
 
 SamplerState gHeightMapSampler : register(s0);
@@ -23,6 +20,15 @@ struct PSInput
 Texture2D gHeightMap : register(t0);
 Texture2DArray gLayerMapArray : register(t1);
 Texture2D gBlendMap : register(t2);
+Texture2D gNormalMap : register(t3);
+
+// Baked normals are octahedral encoded (x, z) in height map space, where
+// z grows with rows. They always point up, so they are never folded.
+float3 decodeNormal(in const float2 encodedNormal)
+{
+    const float3 normal = float3(encodedNormal.x, 1.0f - abs(encodedNormal.x) - abs(encodedNormal.y), encodedNormal.y);
+    return normalize(normal);
+}
 
 float4 main(in PSInput psInput) : SV_TARGET
 {
@@ -52,22 +58,9 @@ float4 main(in PSInput psInput) : SV_TARGET
     float4 diffuseContribution;
     float4 specularContribution;
 
-    //
-	// Estimate normal and tangent using central differences.
-	//
-	const float2 leftTexel = psInput.mTexCoord + float2(-gTexelCellSpaceU, 0.0f);
-	const float2 rightTexel = psInput.mTexCoord + float2(gTexelCellSpaceU, 0.0f);
-	const float2 bottomTexel = psInput.mTexCoord + float2(0.0f, gTexelCellSpaceV);
-	const float2 topTexel = psInput.mTexCoord + float2(0.0f, -gTexelCellSpaceV);
-	
-	const float leftTexelHeight = gHeightMap.SampleLevel(gHeightMapSampler, leftTexel, 0).r;
-	const float rightTexelHeight  = gHeightMap.SampleLevel(gHeightMapSampler, rightTexel, 0).r;
-	const float bottomTexelHeight = gHeightMap.SampleLevel(gHeightMapSampler, bottomTexel, 0).r;
-	const float topTexelHeight = gHeightMap.SampleLevel(gHeightMapSampler, topTexel, 0).r;
-	
-	const float3 tangent = normalize(float3(2.0f * gWorldCellSpace, rightTexelHeight - leftTexelHeight, 0.0f));
-	const float3 bitangent = normalize(float3(0.0f, bottomTexelHeight - topTexelHeight, 2.0f * gWorldCellSpace)); 
-	const float3 normalW = cross(tangent, bitangent);
+	// Baked normal. Grid rows go to -z in world space.
+	const float3 normalH = decodeNormal(gNormalMap.Sample(gHeightMapSampler, psInput.mTexCoord).rg);
+	const float3 normalW = float3(normalH.x, normalH.y, -normalH.z);
 
     [unroll]
     for(int i = 0; i < 3; ++i)
@@ -157,9 +157,6 @@ namespace TerrainSceneUtils
             );
         terrainScene.mGridPSPerFrameBuffer.mData.mEyePositionW = Globals::gCamera.mPosition;
         terrainScene.mGridPSPerFrameBuffer.mData.mMaterial = terrainScene.mTerrainMaterial;
-        terrainScene.mGridPSPerFrameBuffer.mData.mTexelCellSpaceU = heightMapTexelSize;
-        terrainScene.mGridPSPerFrameBuffer.mData.mTexelCellSpaceV = heightMapTexelSize;
-        terrainScene.mGridPSPerFrameBuffer.mData.mWorldCellSpace = 0.5f;
         ConstantBufferUtils::copyData(context, terrainScene.mGridPSPerFrameBuffer);
 
         // Set constant buffers
@@ -171,9 +168,10 @@ namespace TerrainSceneUtils
         { 
             Globals::gShaderResources.mHeightMapSRV,
             Globals::gShaderResources.mTerrainDiffuseMapArraySRV,
-            Globals::gShaderResources.mTerrainBlendMapSRV
+            Globals::gShaderResources.mTerrainBlendMapSRV,
+            Globals::gShaderResources.mTerrainNormalMapSRV
         };
-        context.PSSetShaderResources(0, 3, pixelShaderResources);
+        context.PSSetShaderResources(0, 4, pixelShaderResources);
 
         // Sampler state
         ID3D11SamplerState* const samplerStates[] =
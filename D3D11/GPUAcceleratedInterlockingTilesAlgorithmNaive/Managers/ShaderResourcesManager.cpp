@@ -8,6 +8,7 @@
 #include <DDSTextureLoader.h>
 #include <DxErrorChecker.h>
 #include <HeightMap.h>
+#include <TerrainMaps.h>
 
 namespace
 {
@@ -126,6 +127,7 @@ ShaderResources::ShaderResources()
     : mHeightMapSRV(nullptr)
     , mTerrainDiffuseMapArraySRV(nullptr)
     , mTerrainBlendMapSRV(nullptr)
+    , mTerrainNormalMapSRV(nullptr)
 {
 
 }
@@ -139,6 +141,7 @@ namespace ShaderResourcesUtils
         assert(shaderResources.mHeightMapSRV == nullptr);
         assert(shaderResources.mTerrainDiffuseMapArraySRV == nullptr);
         assert(shaderResources.mTerrainBlendMapSRV == nullptr);
+        assert(shaderResources.mTerrainNormalMapSRV == nullptr);
 
         ID3D11Resource* texture;
 
@@ -146,15 +149,32 @@ namespace ShaderResourcesUtils
         const uint32_t heightMapDimension = 512;
         HeightMap heightMap(heightMapDimension);
         const float heightMapScaleFactor = 150.0f;
-        HeightMapUtils::loadFromRAWFile("Resources/Textures/terrainRaw.raw",
-                                        heightMapScaleFactor, 
-                                        heightMap);
+        std::string errorMessage;
+        if(!HeightMapUtils::loadFromRAWFile("Resources/Textures/terrainRaw.raw",
+                                            heightMapScaleFactor, 
+                                            heightMap,
+                                            RAWFormat::UINT8,
+                                            &errorMessage)) {
+            MessageBoxA(0, errorMessage.c_str(), 0, 0);
+        }
 
         HeightMapUtils::applyNeighborsFilter(heightMap);
         shaderResources.mHeightMapSRV = HeightMapUtils::buildSRV(device,
                                                                  heightMap,
                                                                  D3D11_BIND_SHADER_RESOURCE);
 
+        // Normal map, baked once from the filtered height map and loaded on
+        // later runs. If the cache can not be written, the baked map is still
+        // used. The terrain grid is 512 world units wide.
+        const float cellSpacing = 512.0f / heightMapDimension;
+        TerrainMaps terrainMaps;
+        TerrainMapsUtils::loadOrBake("Resources/Textures/terrainRaw.maps",
+                                     heightMap,
+                                     cellSpacing,
+                                     GradientOperator::CENTRAL_DIFFERENCES,
+                                     terrainMaps);
+        shaderResources.mTerrainNormalMapSRV = TerrainMapsUtils::buildNormalMapSRV(device, terrainMaps);
+
         // Create terrain textures array.
         std::vector<std::wstring> texturesFilenames;
         texturesFilenames.push_back(L"Resources/Textures/grass.dds");
@@ -181,10 +201,12 @@ namespace ShaderResourcesUtils
         assert(shaderResources.mHeightMapSRV);
         assert(shaderResources.mTerrainDiffuseMapArraySRV);
         assert(shaderResources.mTerrainBlendMapSRV);
+        assert(shaderResources.mTerrainNormalMapSRV);
 
         shaderResources.mHeightMapSRV->Release();
         shaderResources.mTerrainDiffuseMapArraySRV->Release();
         shaderResources.mTerrainBlendMapSRV->Release();
+        shaderResources.mTerrainNormalMapSRV->Release();
 
     }
 }
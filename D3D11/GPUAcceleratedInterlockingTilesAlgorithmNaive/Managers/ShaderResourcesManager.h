@@ -19,6 +19,7 @@ struct ShaderResources
     ID3D11ShaderResourceView* mHeightMapSRV;
     ID3D11ShaderResourceView* mTerrainDiffuseMapArraySRV;
     ID3D11ShaderResourceView* mTerrainBlendMapSRV;
+    ID3D11ShaderResourceView* mTerrainNormalMapSRV;
 };
 
 namespace ShaderResourcesUtils
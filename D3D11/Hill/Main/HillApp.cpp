@@ -10,6 +10,7 @@
 #include <DxErrorChecker.h>
 #include <GeometryGenerator.h>
 #include <MathHelper.h>
+#include <MeshOptimizer.h>
 
 namespace 
 {
@@ -92,6 +93,9 @@ namespace Framework
         MeshData grid;
         GeometryGenerator::generateGrid(160.0f, 160.0f, 50, 50, grid);
 
+        // Reorder triangles and vertices for the post-transform vertex cache.
+        MeshOptimizer::optimize(grid);
+
         mGridIndexCount = grid.mIndices.size();
 
         //
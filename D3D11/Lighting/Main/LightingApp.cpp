@@ -9,6 +9,8 @@
 
 #include <GeometryGenerator.h>
 #include <MathHelper.h>
+#include <MeshOptimizer.h>
+#include <MeshSink.h>
 
 namespace 
 {
@@ -30,6 +32,19 @@ namespace
 
         return normal;
     }
+
+    // Land vertices are the grid vertices raised to the height
+    // function, with the normal of the height function.
+    struct LandVertexProjection
+    {
+        void operator()(const VertexData& vertex, Geometry::Vertex& landVertex) const
+        {
+            const float x = vertex.mPosition.x;
+            const float z = vertex.mPosition.z;
+            landVertex.mPosition = DirectX::XMFLOAT3(x, height(x, z), z);
+            landVertex.mNormal = normal(x, z);
+        }
+    };
 }
 
 namespace Framework
@@ -69,7 +84,7 @@ namespace Framework
             mWaves.disturb(randomRowIndex, randomColumnIndex, randomMagnitude);
         }
 
-        mWaves.update(dt);
+        mWaves.update(dt, &mThreadPool);
 
         //
         // Update the wave vertex buffer with the new solution.
@@ -244,11 +259,10 @@ namespace Framework
         // Calculate vertices and indices for the land.
         // Cache vertex offset, index count and offset
         //
-        MeshData grid;
-        GeometryGenerator::generateGrid(160.0f, 160.0f, 50, 50, grid);
+        const MeshSize gridSize = GeometryGenerator::computeGridSize(50, 50);
 
         // Cache the index count
-        mLandIndexCount = static_cast<uint32_t> (grid.mIndices.size());
+        mLandIndexCount = gridSize.mIndexCount;
 
         // Cache the starting index
         mLandIndexOffset = 0; 
@@ -265,28 +279,29 @@ namespace Framework
         mWavesIndexOffset = mLandIndexCount;
         
         // Compute the total number of vertices for the land
-        const uint32_t totalLandVertexCount = static_cast<uint32_t> (grid.mVertices.size());
+        const uint32_t totalLandVertexCount = gridSize.mVertexCount;
+
+        // Pack the indices of land and waves into one index buffer.
+        const uint32_t totalIndexCount = mLandIndexCount + mWavesIndexCount;
+        std::vector<uint32_t> indices(totalIndexCount);
 
         //
-        // Extract the vertex elements we are interested and apply the height function to
-        // each vertex. In addition, color the vertices based on their height so we have
-        // sandy looking beaches, grassy low hills, and snow mountain peaks.
-        //
-        // Pack the vertices of all the meshes into one vertex buffer.
+        // Generate the land straight into the vertex layout, applying the height function
+        // to each vertex, and its indices straight into the first ones of the index buffer.
         //
         std::vector<Geometry::Vertex> vertices(totalLandVertexCount);
-        {
-            uint32_t k = 0;
-            DirectX::XMFLOAT3 currentVertexPosition;
-            for(size_t i = 0; i < grid.mVertices.size(); ++i, ++k)
-            {
-                currentVertexPosition = grid.mVertices[k].mPosition;
-                const float y = height(currentVertexPosition.x, currentVertexPosition.z);
-                currentVertexPosition.y = y;
-                vertices[k].mPosition = currentVertexPosition;
-                vertices[k].mNormal = normal(currentVertexPosition.x, currentVertexPosition.z);
-            }      
-        } 
+        GeometryGenerator::generateGrid(160.0f, 
+                                        160.0f, 
+                                        50, 
+                                        50, 
+                                        GeometryGenerator::makeMeshSink(&vertices[0], 
+                                                                        totalLandVertexCount, 
+                                                                        &indices[0], 
+                                                                        mLandIndexCount, 
+                                                                        LandVertexProjection()));
+
+        // Reorder triangles and vertices for the post-transform vertex cache.
+        MeshOptimizer::optimize(&vertices[0], sizeof(Geometry::Vertex), totalLandVertexCount, &indices[0], mLandIndexCount);
 
         //
         // Create land vertex buffer
@@ -320,17 +335,11 @@ namespace Framework
         // Create general index buffer (land + waves)
         //
 
-        // Pack the indices of land and waves into one index buffer.
-        const uint32_t totalIndexCount = mLandIndexCount + mWavesIndexCount;
-        std::vector<uint32_t> indices;
-        indices.resize(totalIndexCount);
-        indices.insert(indices.begin(), grid.mIndices.begin(), grid.mIndices.end());
-
         // Iterate over each quad.
-        // We begin exactly next the last element copied from grid.
+        // We begin exactly next the last land index.
         const uint32_t rows = mWaves.rows();
         const uint32_t columns = mWaves.columns();
-        uint32_t k = static_cast<uint32_t> (grid.mIndices.size());
+        uint32_t k = mLandIndexCount;
         for(uint32_t i = 0; i < rows - 1; ++i)
         {
             for(uint32_t j = 0; j < columns - 1; ++j)
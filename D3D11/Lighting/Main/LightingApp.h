@@ -20,6 +20,7 @@
 #include <DxErrorChecker.h>
 #include <LightHelper.h>
 #include <MathHelper.h>
+#include <ThreadPool.h>
 
 namespace Framework
 {
@@ -53,6 +54,7 @@ namespace Framework
 
     private:
         Geometry::Waves mWaves;
+        ThreadPool mThreadPool;
 
         DirectionalLight mDirectionalLight;
         PointLight mPointLight;
@@ -171,6 +173,7 @@ namespace Framework
             return false;
 
         mWaves.init(200, 200, 0.8f, 0.03f, 3.25f, 0.4f);
+        ThreadPoolUtils::start(mThreadPool);
 
         buildGeometryBuffers();
         buildShaders();       
@@ -5,6 +5,7 @@
 #include <GeometryGenerator.h>
 #include <DxErrorChecker.h>
 #include <MathHelper.h>
+#include <MeshCache.h>
 
 namespace 
 {
@@ -77,26 +78,36 @@ namespace Managers
         const float width = 15.0f;
         const float height = 15.0f;
         const float depth = 15.0f;
-        MeshData box;
-        GeometryGenerator::generateBox(width, height, depth, box);
+        MappedMeshData box;
+        MeshCacheUtils::mapOrGenerate(MeshCacheUtils::computeDefaultDirectory(),
+                                      "Box",
+                                      {width, height, depth},
+                                      MeshCacheUtils::computeVertexDataLayout(),
+                                      [&](CachedMeshData& cachedMeshData) {
+                                          MeshData meshData;
+                                          GeometryGenerator::generateBox(width, height, depth, meshData);
+                                          MeshCacheUtils::fromMeshData(meshData, cachedMeshData);
+                                          return true;
+                                      },
+                                      box);
 
         // Create vertex buffer
         D3D11_BUFFER_DESC vertexBufferDesc;
         vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        vertexBufferDesc.ByteWidth = static_cast<uint32_t> (sizeof(VertexData) * box.mVertices.size());
+        vertexBufferDesc.ByteWidth = sizeof(VertexData) * box.mVertexCount;
         vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
         vertexBufferDesc.CPUAccessFlags = 0;
         vertexBufferDesc.MiscFlags = 0;
         vertexBufferDesc.StructureByteStride = 0;
 
         D3D11_SUBRESOURCE_DATA initData;
-        initData.pSysMem = &box.mVertices[0];
+        initData.pSysMem = box.mVertices;
 
         HRESULT result = device->CreateBuffer(&vertexBufferDesc, &initData, &mBoxBufferInfo->mVertexBuffer);
         DxErrorChecker(result);
 
         // Set index count
-        mBoxBufferInfo->mIndexCount = static_cast<uint32_t> (box.mIndices.size());
+        mBoxBufferInfo->mIndexCount = box.mIndexCount;
 
         // Create and fill index buffer
         D3D11_BUFFER_DESC ibd;
@@ -107,7 +118,7 @@ namespace Managers
         ibd.StructureByteStride = 0;
         ibd.MiscFlags = 0;
 
-        initData.pSysMem = &box.mIndices[0];
+        initData.pSysMem = box.mIndices;
 
         result = device->CreateBuffer(&ibd, &initData, &mBoxBufferInfo->mIndexBuffer);
         DxErrorChecker(result);
@@ -126,26 +137,36 @@ namespace Managers
         const float radius = 15.0f;
         const uint32_t sliceCount = 200;
         const uint32_t stackCount = 100;
-        MeshData sphere;
-        GeometryGenerator::generateSphere(radius, sliceCount, stackCount, sphere);
+        MappedMeshData sphere;
+        MeshCacheUtils::mapOrGenerate(MeshCacheUtils::computeDefaultDirectory(),
+                                      "Sphere",
+                                      {radius, static_cast<float> (sliceCount), static_cast<float> (stackCount)},
+                                      MeshCacheUtils::computeVertexDataLayout(),
+                                      [&](CachedMeshData& cachedMeshData) {
+                                          MeshData meshData;
+                                          GeometryGenerator::generateSphere(radius, sliceCount, stackCount, meshData);
+                                          MeshCacheUtils::fromMeshData(meshData, cachedMeshData);
+                                          return true;
+                                      },
+                                      sphere);
 
         // Create vertex buffer
         D3D11_BUFFER_DESC vertexBufferDesc;
         vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        vertexBufferDesc.ByteWidth = static_cast<uint32_t> (sizeof(VertexData) * sphere.mVertices.size());
+        vertexBufferDesc.ByteWidth = sizeof(VertexData) * sphere.mVertexCount;
         vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
         vertexBufferDesc.CPUAccessFlags = 0;
         vertexBufferDesc.MiscFlags = 0;
         vertexBufferDesc.StructureByteStride = 0;
 
         D3D11_SUBRESOURCE_DATA initData;
-        initData.pSysMem = &sphere.mVertices[0];
+        initData.pSysMem = sphere.mVertices;
 
         HRESULT result = device->CreateBuffer(&vertexBufferDesc, &initData, &mSphereBufferInfo->mVertexBuffer);
         DxErrorChecker(result);
 
         // Set index count
-        mSphereBufferInfo->mIndexCount = static_cast<uint32_t> (sphere.mIndices.size());
+        mSphereBufferInfo->mIndexCount = sphere.mIndexCount;
 
         // Create and fill index buffer
         D3D11_BUFFER_DESC ibd;
@@ -156,7 +177,7 @@ namespace Managers
         ibd.StructureByteStride = 0;
         ibd.MiscFlags = 0;
 
-        initData.pSysMem = &sphere.mIndices[0];
+        initData.pSysMem = sphere.mIndices;
 
         result = device->CreateBuffer(&ibd, &initData, &mSphereBufferInfo->mIndexBuffer);
         DxErrorChecker(result);
@@ -177,26 +198,36 @@ namespace Managers
         const float height = 50.0f;
         const uint32_t sliceCount = 200;
         const uint32_t stackCount = 100;
-        MeshData cylinder;
-        GeometryGenerator::generateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, cylinder);
+        MappedMeshData cylinder;
+        MeshCacheUtils::mapOrGenerate(MeshCacheUtils::computeDefaultDirectory(),
+                                      "Cylinder",
+                                      {bottomRadius, topRadius, height, static_cast<float> (sliceCount), static_cast<float> (stackCount)},
+                                      MeshCacheUtils::computeVertexDataLayout(),
+                                      [&](CachedMeshData& cachedMeshData) {
+                                          MeshData meshData;
+                                          GeometryGenerator::generateCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+                                          MeshCacheUtils::fromMeshData(meshData, cachedMeshData);
+                                          return true;
+                                      },
+                                      cylinder);
 
         // Create vertex buffer
         D3D11_BUFFER_DESC vertexBufferDesc;
         vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        vertexBufferDesc.ByteWidth = static_cast<uint32_t> (sizeof(VertexData) * cylinder.mVertices.size());
+        vertexBufferDesc.ByteWidth = sizeof(VertexData) * cylinder.mVertexCount;
         vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
         vertexBufferDesc.CPUAccessFlags = 0;
         vertexBufferDesc.MiscFlags = 0;
         vertexBufferDesc.StructureByteStride = 0;
 
         D3D11_SUBRESOURCE_DATA initData;
-        initData.pSysMem = &cylinder.mVertices[0];
+        initData.pSysMem = cylinder.mVertices;
 
         HRESULT result = device->CreateBuffer(&vertexBufferDesc, &initData, &mCylinderBufferInfo->mVertexBuffer);
         DxErrorChecker(result);
 
         // Set index count
-        mCylinderBufferInfo->mIndexCount = static_cast<uint32_t> (cylinder.mIndices.size());
+        mCylinderBufferInfo->mIndexCount = cylinder.mIndexCount;
 
         // Create and fill index buffer
         D3D11_BUFFER_DESC ibd;
@@ -207,7 +238,7 @@ namespace Managers
         ibd.StructureByteStride = 0;
         ibd.MiscFlags = 0;
 
-        initData.pSysMem = &cylinder.mIndices[0];
+        initData.pSysMem = cylinder.mIndices;
 
         result = device->CreateBuffer(&ibd, &initData, &mCylinderBufferInfo->mIndexBuffer);
         DxErrorChecker(result);
@@ -224,20 +255,30 @@ namespace Managers
         // Calculate vertices and indices
         // Cache vertex offset, index count and offset
         //
-        MeshData grid;
-        GeometryGenerator::generateGrid(400.0f, 400.0f, 100, 100, grid);
+        MappedMeshData grid;
+        MeshCacheUtils::mapOrGenerate(MeshCacheUtils::computeDefaultDirectory(),
+                                      "Grid",
+                                      {400.0f, 400.0f, 100.0f, 100.0f},
+                                      MeshCacheUtils::computeVertexDataLayout(),
+                                      [](CachedMeshData& cachedMeshData) {
+                                          MeshData meshData;
+                                          GeometryGenerator::generateGrid(400.0f, 400.0f, 100, 100, meshData);
+                                          MeshCacheUtils::fromMeshData(meshData, cachedMeshData);
+                                          return true;
+                                      },
+                                      grid);
 
         // Cache base vertex location
         mFloorBufferInfo->mBaseVertexLocation = 0;
 
         // Cache the index count
-        mFloorBufferInfo->mIndexCount = static_cast<uint32_t> (grid.mIndices.size());
+        mFloorBufferInfo->mIndexCount = grid.mIndexCount;
 
         // Cache the starting index
         mFloorBufferInfo->mStartIndexLocation = 0; 
 
         // Compute the total number of vertices
-        const uint32_t totalVertexCount = static_cast<uint32_t> (grid.mVertices.size());
+        const uint32_t totalVertexCount = grid.mVertexCount;
 
         // Create vertex buffer
         D3D11_BUFFER_DESC vertexBufferDesc;
@@ -248,7 +289,7 @@ namespace Managers
         vertexBufferDesc.MiscFlags = 0;
 
         D3D11_SUBRESOURCE_DATA initData;
-        initData.pSysMem = &grid.mVertices[0];
+        initData.pSysMem = grid.mVertices;
         HRESULT result = device->CreateBuffer(&vertexBufferDesc, &initData, &mFloorBufferInfo->mVertexBuffer);
         DxErrorChecker(result);
 
@@ -262,7 +303,7 @@ namespace Managers
         indexBufferDesc.CPUAccessFlags = 0;
         indexBufferDesc.MiscFlags = 0;
 
-        initData.pSysMem = &grid.mIndices[0];
+        initData.pSysMem = grid.mIndices;
         result = device->CreateBuffer(&indexBufferDesc, &initData, &mFloorBufferInfo->mIndexBuffer);
         DxErrorChecker(result);
     }
@@ -1,6 +1,8 @@
 #include "ShapesApp.h"
  
+#include <cstring>
 #include <fstream>
+#include <string>
 #include <DirectXColors.h>
 #include <DirectXMath.h>
 #include <vector>
@@ -9,6 +11,54 @@
 
 #include <GeometryGenerator.h>
 #include <MathHelper.h>
+#include <MeshCache.h>
+#include <MeshOptimizer.h>
+#include <MeshSink.h>
+
+namespace
+{
+    // Shapes are drawn in a single color, so only their positions are needed.
+    const DirectX::XMFLOAT4 sShapeColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    struct ShapeVertexProjection
+    {
+        void operator()(const VertexData& vertex, Geometry::Vertex& shapeVertex) const
+        {
+            shapeVertex.mPosition = vertex.mPosition;
+            shapeVertex.mColor = sShapeColor;
+        }
+    };
+
+    // Cached shapes are in the Geometry::Vertex layout, projected by ShapeVertexProjection.
+    // Change the name if either of them changes.
+    CachedVertexLayout computeShapeVertexLayout()
+    {
+        return CachedVertexLayout("Geometry::Vertex(position, color) ShapeVertexProjection",
+                                  sizeof(Geometry::Vertex),
+                                  {sShapeColor.x, sShapeColor.y, sShapeColor.z, sShapeColor.w});
+    }
+
+    // Sink that generates a shape of meshSize vertices and indices
+    // straight into the Geometry::Vertex layout of cachedMeshData.
+    MeshSink<Geometry::Vertex, ShapeVertexProjection> makeShapeSink(const MeshSize& meshSize,
+                                                                    CachedMeshData& cachedMeshData)
+    {
+        return MeshCacheUtils::makeMeshSink<Geometry::Vertex>(meshSize, 
+                                                              ShapeVertexProjection(), 
+                                                              cachedMeshData, 
+                                                              MeshStream::POSITION);
+    }
+
+    // Reorders the generated shape for the post-transform vertex cache.
+    void optimizeShape(CachedMeshData& cachedMeshData)
+    {
+        MeshOptimizer::optimize(&cachedMeshData.mVertices[0],
+                                cachedMeshData.mVertexStride,
+                                static_cast<uint32_t> (cachedMeshData.mVertices.size() / cachedMeshData.mVertexStride),
+                                &cachedMeshData.mIndices[0],
+                                static_cast<uint32_t> (cachedMeshData.mIndices.size()));
+    }
+}
 
 namespace Framework
 {
@@ -117,27 +167,74 @@ namespace Framework
 
     void ShapesApp::buildGeometryBuffers()
     {
-        MeshData box;
-        MeshData grid;
-        MeshData sphere;
-        MeshData cylinder;
-
-        GeometryGenerator::generateBox(1.0f, 1.0f, 1.0f, box);
-        GeometryGenerator::generateGrid(20.0f, 30.0f, 60, 40, grid);
-        GeometryGenerator::generateSphere(0.5f, 20, 20, sphere);
-        GeometryGenerator::generateCylinder(0.5f, 0.3f, 3.0f, 20, 20, cylinder);
+        // Generated meshes are cached in binary files and memory mapped on later runs.
+        // They are cached already optimized for the post-transform vertex cache
+        // and in the layout of the vertex buffer, so mapped files fill it directly.
+        const std::string cacheDirectory = MeshCacheUtils::computeDefaultDirectory();
+        const CachedVertexLayout vertexLayout = computeShapeVertexLayout();
+        const uint32_t vertexStride = vertexLayout.mVertexStride;
+
+        MappedMeshData box;
+        MappedMeshData grid;
+        MappedMeshData sphere;
+        MappedMeshData cylinder;
+
+        // Generators return false (and nothing is cached) if the shape does not fit its sink.
+        MeshCacheUtils::mapOrGenerate(cacheDirectory, "OptimizedBox", {1.0f, 1.0f, 1.0f}, vertexLayout,
+                                      [](CachedMeshData& cachedMeshData) {
+                                          if(!GeometryGenerator::generateBox(1.0f, 1.0f, 1.0f, makeShapeSink(GeometryGenerator::computeBoxSize(), cachedMeshData))) {
+                                              return false;
+                                          }
+
+                                          optimizeShape(cachedMeshData);
+                                          return true;
+                                      },
+                                      box);
+
+        MeshCacheUtils::mapOrGenerate(cacheDirectory, "OptimizedGrid", {20.0f, 30.0f, 60.0f, 40.0f}, vertexLayout,
+                                      [](CachedMeshData& cachedMeshData) {
+                                          if(!GeometryGenerator::generateGrid(20.0f, 30.0f, 60, 40, makeShapeSink(GeometryGenerator::computeGridSize(60, 40), cachedMeshData))) {
+                                              return false;
+                                          }
+
+                                          optimizeShape(cachedMeshData);
+                                          return true;
+                                      },
+                                      grid);
+
+        MeshCacheUtils::mapOrGenerate(cacheDirectory, "OptimizedSphere", {0.5f, 20.0f, 20.0f}, vertexLayout,
+                                      [](CachedMeshData& cachedMeshData) {
+                                          if(!GeometryGenerator::generateSphere(0.5f, 20, 20, makeShapeSink(GeometryGenerator::computeSphereSize(20, 20), cachedMeshData))) {
+                                              return false;
+                                          }
+
+                                          optimizeShape(cachedMeshData);
+                                          return true;
+                                      },
+                                      sphere);
+
+        MeshCacheUtils::mapOrGenerate(cacheDirectory, "OptimizedCylinder", {0.5f, 0.3f, 3.0f, 20.0f, 20.0f}, vertexLayout,
+                                      [](CachedMeshData& cachedMeshData) {
+                                          if(!GeometryGenerator::generateCylinder(0.5f, 0.3f, 3.0f, 20, 20, makeShapeSink(GeometryGenerator::computeCylinderSize(20, 20), cachedMeshData))) {
+                                              return false;
+                                          }
+
+                                          optimizeShape(cachedMeshData);
+                                          return true;
+                                      },
+                                      cylinder);
 
         // Cache the vertex offsets to each object in the concatenated vertex buffer.
         mBoxVertexOffset = 0;
-        mGridVertexOffset = static_cast<uint32_t> (box.mVertices.size());
-        mSphereVertexOffset = mGridVertexOffset + static_cast<uint32_t> (grid.mVertices.size());
-        mCylinderVertexOffset = mSphereVertexOffset + static_cast<uint32_t> (sphere.mVertices.size());
+        mGridVertexOffset = box.mVertexCount;
+        mSphereVertexOffset = mGridVertexOffset + grid.mVertexCount;
+        mCylinderVertexOffset = mSphereVertexOffset + sphere.mVertexCount;
 
         // Cache the index count of each object.
-        mBoxIndexCount = static_cast<uint32_t> (box.mIndices.size());
-        mGridIndexCount = static_cast<uint32_t> (grid.mIndices.size());
-        mSphereIndexCount = static_cast<uint32_t> (sphere.mIndices.size());
-        mCylinderIndexCount = static_cast<uint32_t> (cylinder.mIndices.size());
+        mBoxIndexCount = box.mIndexCount;
+        mGridIndexCount = grid.mIndexCount;
+        mSphereIndexCount = sphere.mIndexCount;
+        mCylinderIndexCount = cylinder.mIndexCount;
 
         // Cache the starting index for each object in the concatenated index buffer.
         mBoxIndexOffset = 0;
@@ -145,69 +242,48 @@ namespace Framework
         mSphereIndexOffset = mGridIndexOffset + mGridIndexCount;
         mCylinderIndexOffset = mSphereIndexOffset + mSphereIndexCount;
 
-        const uint64_t totalVertexCount = box.mVertices.size() + grid.mVertices.size() 
-            + sphere.mVertices.size() + cylinder.mVertices.size();
-
-        const uint64_t totalIndexCount = mBoxIndexCount + mGridIndexCount 
-            + mSphereIndexCount + mCylinderIndexCount;
-
-        // Extract the vertex elements we are interested in and pack the
-        // vertices of all the meshes into one vertex buffer.
-        std::vector<Geometry::Vertex> vertices(totalVertexCount);
-        DirectX::XMFLOAT4 black(0.0f, 0.0f, 0.0f, 1.0f);
-
-        uint32_t k = 0;
-        for(size_t i = 0; i < box.mVertices.size(); ++i, ++k)
-        {
-            vertices[k].mPosition = box.mVertices[i].mPosition;
-            vertices[k].mColor = black;
-        }
-
-        for(size_t i = 0; i < grid.mVertices.size(); ++i, ++k)
-        {
-            vertices[k].mPosition   = grid.mVertices[i].mPosition;
-            vertices[k].mColor = black;
-        }
-
-        for(size_t i = 0; i < sphere.mVertices.size(); ++i, ++k)
-        {
-            vertices[k].mPosition = sphere.mVertices[i].mPosition;
-            vertices[k].mColor = black;
-        }
-
-        for(size_t i = 0; i < cylinder.mVertices.size(); ++i, ++k)
-        {
-            vertices[k].mPosition = cylinder.mVertices[i].mPosition;
-            vertices[k].mColor = black;
+        const uint32_t totalVertexCount = mCylinderVertexOffset + cylinder.mVertexCount;
+        const uint32_t totalIndexCount = mCylinderIndexOffset + mCylinderIndexCount;
+
+        // Pack the vertices and the indices of all the meshes, copied straight from
+        // their mapped files, into one vertex buffer and one index buffer.
+        std::vector<uint8_t> vertices(vertexStride * totalVertexCount);
+        std::vector<uint32_t> indices(totalIndexCount);
+        const MappedMeshData* meshes[] = { &box, &grid, &sphere, &cylinder };
+        const uint32_t vertexOffsets[] = { mBoxVertexOffset, mGridVertexOffset, mSphereVertexOffset, mCylinderVertexOffset };
+        const uint32_t indexOffsets[] = { mBoxIndexOffset, mGridIndexOffset, mSphereIndexOffset, mCylinderIndexOffset };
+        for(size_t i = 0; i < 4; ++i) {
+            if(meshes[i]->mVertexCount > 0) {
+                memcpy(&vertices[vertexOffsets[i] * vertexStride], meshes[i]->mVertices, meshes[i]->mVertexCount * vertexStride);
+            }
+
+            if(meshes[i]->mIndexCount > 0) {
+                memcpy(&indices[indexOffsets[i]], meshes[i]->mIndices, meshes[i]->mIndexCount * sizeof(uint32_t));
+            }
         }
 
         D3D11_BUFFER_DESC vertexBufferDesc;
         vertexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        vertexBufferDesc.ByteWidth = static_cast<uint32_t> (sizeof(Geometry::Vertex) * totalVertexCount);
+        vertexBufferDesc.ByteWidth = static_cast<uint32_t> (vertices.size());
         vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
         vertexBufferDesc.CPUAccessFlags = 0;
         vertexBufferDesc.MiscFlags = 0;
 
         D3D11_SUBRESOURCE_DATA initData;
         initData.pSysMem = &vertices[0];
-        mDevice->CreateBuffer(&vertexBufferDesc, &initData, &mVertexBuffer);
-
-        // Pack the indices of all the meshes into one index buffer.
-        std::vector<uint32_t> indices;
-        indices.insert(indices.end(), box.mIndices.begin(), box.mIndices.end());
-        indices.insert(indices.end(), grid.mIndices.begin(), grid.mIndices.end());
-        indices.insert(indices.end(), sphere.mIndices.begin(), sphere.mIndices.end());
-        indices.insert(indices.end(), cylinder.mIndices.begin(), cylinder.mIndices.end());
+        HRESULT result = mDevice->CreateBuffer(&vertexBufferDesc, &initData, &mVertexBuffer);
+        DxErrorChecker(result);
 
         D3D11_BUFFER_DESC indexBufferDesc;
         indexBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-        indexBufferDesc.ByteWidth = static_cast<uint32_t> (sizeof(uint32_t) * totalIndexCount);
+        indexBufferDesc.ByteWidth = static_cast<uint32_t> (sizeof(uint32_t) * indices.size());
         indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
         indexBufferDesc.CPUAccessFlags = 0;
         indexBufferDesc.MiscFlags = 0;
 
         initData.pSysMem = &indices[0];
-        mDevice->CreateBuffer(&indexBufferDesc, &initData, &mIndexBuffer);
+        result = mDevice->CreateBuffer(&indexBufferDesc, &initData, &mIndexBuffer);
+        DxErrorChecker(result);
     }
 
     void ShapesApp::buildShaders()
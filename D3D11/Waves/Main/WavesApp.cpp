@@ -51,7 +51,7 @@ namespace Framework
             mWaves.disturb(randomRowIndex, randomColumnIndex, randomMagnitude);
         }
 
-        mWaves.update(dt);
+        mWaves.update(dt, &mThreadPool);
 
         //
         // Update the wave vertex buffer with the new solution.
@@ -20,6 +20,7 @@
 #include <D3DApplication.h>
 #include <DxErrorChecker.h>
 #include <MathHelper.h>
+#include <ThreadPool.h>
 
 namespace Framework
 {
@@ -55,6 +56,7 @@ namespace Framework
 
     private:
         Geometry::Waves mWaves;
+        ThreadPool mThreadPool;
 
         ID3D11Buffer* mLandVertexBuffer;
         ID3D11Buffer* mWavesVertexBuffer;
@@ -135,6 +137,7 @@ namespace Framework
             return false;
 
         mWaves.init(200, 200, 0.8f, 0.03f, 3.25f, 0.4f);
+        ThreadPoolUtils::start(mThreadPool);
 
         buildGeometryBuffers();
         buildShaders();            
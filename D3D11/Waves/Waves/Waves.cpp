@@ -2,6 +2,62 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+
+#include <ThreadPool.h>
+
+namespace
+{
+    // Parallel updates split interior rows in sBandsPerThread bands per thread
+    // (so threads that finish early steal from the others) of at least sMinBandRows rows.
+    const uint32_t sBandsPerThread = 4;
+    const uint32_t sMinBandRows = 8;
+
+    // Writes the next solution of the interior points of a row over its previous solution:
+    // previous = k1 * previous + k2 * current + k3 * (sum of the 4 current neighbors)
+    // top, center and bottom are the current solutions of the row and the rows around it.
+    // 4 columns are updated at a time, and the remaining ones one by one in the same
+    // operation order, so every column gets the same result.
+    void updateRow(const uint32_t columns,
+                   const float k1,
+                   const float k2,
+                   const float k3,
+                   const float* top,
+                   const float* center,
+                   const float* bottom,
+                   float* previous)
+    {
+        const DirectX::XMVECTOR k1Vector = DirectX::XMVectorReplicate(k1);
+        const DirectX::XMVECTOR k2Vector = DirectX::XMVectorReplicate(k2);
+        const DirectX::XMVECTOR k3Vector = DirectX::XMVectorReplicate(k3);
+
+        // Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+        // Moreover, our +z axis goes "down"; this is just to 
+        // keep consistent with our row indices going down.
+        const uint32_t lastColumn = columns - 1;
+        uint32_t j = 1;
+        for(; j + 4 <= lastColumn; j += 4)
+        {
+            const DirectX::XMVECTOR topHeights = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (top + j));
+            const DirectX::XMVECTOR bottomHeights = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (bottom + j));
+            const DirectX::XMVECTOR leftHeights = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (center + j - 1));
+            const DirectX::XMVECTOR centerHeights = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (center + j));
+            const DirectX::XMVECTOR rightHeights = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (center + j + 1));
+            const DirectX::XMVECTOR previousHeights = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*> (previous + j));
+
+            const DirectX::XMVECTOR neighbors = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMVectorAdd(bottomHeights, topHeights), rightHeights), leftHeights);
+            const DirectX::XMVECTOR heights = DirectX::XMVectorAdd(DirectX::XMVectorAdd(DirectX::XMVectorMultiply(k1Vector, previousHeights), 
+                                                                                        DirectX::XMVectorMultiply(k2Vector, centerHeights)), 
+                                                                   DirectX::XMVectorMultiply(k3Vector, neighbors));
+            DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*> (previous + j), heights);
+        }
+
+        for(; j < lastColumn; ++j)
+        {
+            previous[j] = k1 * previous[j] + k2 * center[j] + k3 * (bottom[j] + top[j] + center[j + 1] + center[j - 1]);
+        }
+    }
+}
 
 namespace Geometry
 {
@@ -26,86 +82,268 @@ namespace Geometry
         mK2 = (4.0f - 8.0f * e) / d;
         mK3 = (2.0f * e) / d;
 
-        // In case Init() called again.
-        delete[] mPreviousSolution;
-        delete[] mCurrentSolution;
+        // Grid points x and z are computed from these when requested.
+        mHalfWidth = (columns - 1) * dx * 0.5f;
+        mHalfDepth = (columns - 1) * dx * 0.5f;
 
-        mPreviousSolution = new DirectX::XMFLOAT3[rowsPerColumns];
-        mCurrentSolution = new DirectX::XMFLOAT3[rowsPerColumns];
+        // Flat water, also in case init() is called again.
+        mPreviousSolution.assign(rowsPerColumns, 0.0f);
+        mCurrentSolution.assign(rowsPerColumns, 0.0f);
+        mTime = 0.0f;
+    }
 
-        // Generate grid vertices in system memory.
-        const float halfWidth = (columns - 1) * dx * 0.5f;
-        const float halfDepth = (columns - 1) * dx * 0.5f;
-        for(size_t i = 0; i < rows; ++i)
+    void Waves::update(const float dt, ThreadPool* threadPool)
+    {
+        const std::vector<Waves*> waves(1, this);
+        std::vector<uint32_t> steps(1, advanceTime(dt));
+        takeSteps(waves, steps, threadPool);
+    }
+
+    void Waves::updateAll(const std::vector<Waves*>& waves, const float dt, ThreadPool& threadPool)
+    {
+        std::vector<uint32_t> steps(waves.size());
+        for(size_t i = 0; i < waves.size(); ++i)
         {
-            const float z = halfDepth - i * dx;
-            for(size_t j = 0; j < columns; ++j)
+            steps[i] = waves[i]->advanceTime(dt);
+        }
+
+        takeSteps(waves, steps, &threadPool);
+    }
+
+    void Waves::disturb(const uint32_t i, const uint32_t j, const float magnitude)
+    {
+        // Don't disturb boundaries.
+        assert(i > 1 && i < mRows - 2);
+        assert(j > 1 && j < mColumns - 2);
+
+        const float halfMagnitude = 0.5f * magnitude;
+
+        // Disturb the ijth vertex height and its neighbors.
+        mCurrentSolution[i * mColumns + j] += magnitude;
+        mCurrentSolution[i * mColumns + j + 1] += halfMagnitude;
+        mCurrentSolution[i * mColumns + j - 1] += halfMagnitude;
+        mCurrentSolution[(i + 1) * mColumns + j] += halfMagnitude;
+        mCurrentSolution[(i - 1) * mColumns + j] += halfMagnitude;
+    }
+
+    void Waves::takeSteps(const std::vector<Waves*>& waves, std::vector<uint32_t>& steps, ThreadPool* threadPool)
+    {
+        const uint32_t threadCount = threadPool == nullptr ? 1 : threadPool->mThreadCount;
+        std::vector<uint32_t> passSteps(waves.size());
+        std::vector<Task> tasks;
+        const auto runTasks = [threadPool, &tasks](const ThreadPoolTask& runTask)
+        {
+            if(threadPool == nullptr)
+            {
+                for(uint32_t taskIndex = 0; taskIndex < tasks.size(); ++taskIndex)
+                {
+                    runTask(taskIndex);
+                }
+            }
+            else
+            {
+                ThreadPoolUtils::run(*threadPool, static_cast<uint32_t> (tasks.size()), runTask);
+            }
+        };
+
+        for(;;)
+        {
+            tasks.clear();
+            bool copyHalos = false;
+            for(size_t i = 0; i < waves.size(); ++i)
             {
-                const float x = -halfWidth + j * dx;
+                passSteps[i] = std::min(steps[i], std::max(waves[i]->mStepsPerPass, 1U));
+                if(passSteps[i] > 0)
+                {
+                    waves[i]->appendTasks(passSteps[i], threadCount, tasks);
+                    copyHalos |= passSteps[i] > 1;
+                }
+            }
+
+            if(tasks.empty())
+            {
+                return;
+            }
 
-                const uint32_t currentIndex = static_cast<uint32_t> (i * columns + j); 
-                mPreviousSolution[currentIndex] = DirectX::XMFLOAT3(x, 0.0f, z);
-                mCurrentSolution[currentIndex] = DirectX::XMFLOAT3(x, 0.0f, z);
+            // Tasks of several steps update again rows that other tasks update,
+            // so they copy them before any task updates them.
+            if(copyHalos)
+            {
+                runTasks([&tasks](const uint32_t taskIndex)
+                {
+                    const Task& task = tasks[taskIndex];
+                    if(task.mSteps > 1)
+                    {
+                        task.mWaves->copyHalo(task);
+                    }
+                });
+            }
+
+            runTasks([&tasks](const uint32_t taskIndex)
+            {
+                const Task& task = tasks[taskIndex];
+                task.mWaves->updateBand(task);
+            });
+
+            for(size_t i = 0; i < waves.size(); ++i)
+            {
+                if(passSteps[i] > 0)
+                {
+                    waves[i]->finishPass(passSteps[i]);
+                    steps[i] -= passSteps[i];
+                }
             }
         }
     }
 
-    void Waves::update(const float dt)
+    uint32_t Waves::advanceTime(const float dt)
     {
-        static float t = 0;
-
         // Accumulate time.
-        t += dt;
+        mTime += dt;
 
         // Only update the simulation at the specified time step.
-        if( t >= mTimeStep )
+        uint32_t steps = 0;
+        while(mTime >= mTimeStep && steps < mMaxSubsteps)
+        {
+            mTime -= mTimeStep;
+            ++steps;
+        }
+
+        // Drop the steps past mMaxSubsteps, so a long frame does not make the next ones longer.
+        if(mTime >= mTimeStep)
+        {
+            mTime = std::fmod(mTime, mTimeStep);
+        }
+
+        return steps;
+    }
+
+    void Waves::appendTasks(const uint32_t steps, const uint32_t threadCount, std::vector<Task>& tasks)
+    {
+        // Split interior rows in sBandsPerThread bands per thread (so threads that
+        // finish early steal from the others) of at least sMinBandRows rows.
+        // Bands of several steps have at least 4 rows per step, so rows
+        // updated again around them are at most half of their rows.
+        const uint32_t interiorRows = mRows - 2;
+        const uint32_t bands = threadCount * sBandsPerThread;
+        const uint32_t minBandRows = steps == 1 ? sMinBandRows : std::max(sMinBandRows, 4 * steps);
+        const uint32_t bandRows = threadCount == 1 ? interiorRows : std::max((interiorRows + bands - 1) / bands, minBandRows);
+        size_t haloSize = 0;
+        for(uint32_t rowBegin = 1; rowBegin < mRows - 1; rowBegin += bandRows)
         {
-            // Only update interior points; we use zero boundary conditions.
-            for(size_t i = 1; i < mRows - 1; ++i)
+            const Task task(this, rowBegin, std::min(rowBegin + bandRows, mRows - 1), steps, haloSize);
+            if(steps > 1)
             {
-                for(size_t j = 1; j < mColumns - 1; ++j)
-                {
-                    // After this update we will be discarding the old previous
-                    // buffer, so overwrite that buffer with the new update.
-                    // Note how we can do this in place (read/write to same element) 
-                    // because we won't need prev_ij again and the assignment happens last.
-
-                    // Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-                    // Moreover, our +z axis goes "down"; this is just to 
-                    // keep consistent with our row indices going down.
-
-                    mPreviousSolution[i * mColumns + j].y = 
-                        mK1 * mPreviousSolution[i * mColumns + j].y +
-                        mK2 * mCurrentSolution[i * mColumns + j].y +
-                        mK3 * (mCurrentSolution[(i + 1) * mColumns + j].y + 
-                        mCurrentSolution[(i - 1) * mColumns + j].y + 
-                        mCurrentSolution[i * mColumns + j + 1].y + 
-                        mCurrentSolution[i * mColumns + j - 1].y);
-                }
+                haloSize += (task.mRowBegin - haloBegin(task) + haloEnd(task) - task.mRowEnd) * 2 * mColumns;
             }
 
-            // We just overwrote the previous buffer with the new data, so
-            // this data needs to become the current solution and the old
-            // current solution becomes the new previous solution.
-            std::swap(mPreviousSolution, mCurrentSolution);
+            tasks.push_back(task);
+        }
+
+        mHaloSolutions.resize(haloSize);
+    }
+
+    uint32_t Waves::haloBegin(const Task& task) const
+    {
+        return task.mRowBegin - std::min(task.mRowBegin, task.mSteps);
+    }
+
+    uint32_t Waves::haloEnd(const Task& task) const
+    {
+        return std::min(task.mRowEnd + task.mSteps, mRows);
+    }
 
-            t = 0.0f; // reset time
+    void Waves::copyHalo(const Task& task)
+    {
+        // Same layout updateBand reads: each halo row previous solution followed by its current solution.
+        float* halo = mHaloSolutions.data() + task.mHaloOffset;
+        for(uint32_t i = haloBegin(task); i < haloEnd(task); ++i)
+        {
+            if(i < task.mRowBegin || i >= task.mRowEnd)
+            {
+                std::copy(mPreviousSolution.begin() + i * mColumns, mPreviousSolution.begin() + (i + 1) * mColumns, halo);
+                std::copy(mCurrentSolution.begin() + i * mColumns, mCurrentSolution.begin() + (i + 1) * mColumns, halo + mColumns);
+                halo += 2 * mColumns;
+            }
         }
     }
 
-    void Waves::disturb(const uint32_t i, const uint32_t j, const float magnitude)
+    void Waves::updateBand(const Task& task)
     {
-        // Don't disturb boundaries.
-        assert(i > 1 && i < mRows - 2);
-        assert(j > 1 && j < mColumns - 2);
+        // Only update interior points; we use zero boundary conditions.
+        // After this update we will be discarding the old previous
+        // buffer, so overwrite that buffer with the new update.
+        // Note how we can do this in place (read/write to same element) 
+        // because we won't need prev_ij again and the assignment happens last.
+        if(task.mSteps == 1)
+        {
+            for(uint32_t i = task.mRowBegin; i < task.mRowEnd; ++i)
+            {
+                const float* center = mCurrentSolution.data() + i * mColumns;
+                updateRow(mColumns, mK1, mK2, mK3, center - mColumns, center, center + mColumns, mPreviousSolution.data() + i * mColumns);
+            }
 
-        const float halfMagnitude = 0.5f * magnitude;
+            return;
+        }
 
-        // Disturb the ijth vertex height and its neighbors.
-        mCurrentSolution[i * mColumns + j].y += magnitude;
-        mCurrentSolution[i * mColumns + j + 1].y += halfMagnitude;
-        mCurrentSolution[i * mColumns + j - 1].y += halfMagnitude;
-        mCurrentSolution[(i + 1) * mColumns + j].y += halfMagnitude;
-        mCurrentSolution[(i - 1) * mColumns + j].y += halfMagnitude;
+        // Rows within task.mSteps rows of the band are updated from their copies in
+        // mHaloSolutions, one less row each step, as the last one lacks a neighbor. 
+        // So after task.mSteps steps the band rows are the ones the whole grid would have.
+        // Odd steps update the previous solution and even steps the current one.
+        const uint32_t steps = task.mSteps;
+        const uint32_t begin = haloBegin(task);
+        const uint32_t end = haloEnd(task);
+        std::vector<float*> oddStepRows(end - begin);
+        std::vector<float*> evenStepRows(end - begin);
+        float* halo = mHaloSolutions.data() + task.mHaloOffset;
+        for(uint32_t i = begin; i < end; ++i)
+        {
+            if(i < task.mRowBegin || i >= task.mRowEnd)
+            {
+                oddStepRows[i - begin] = halo;
+                evenStepRows[i - begin] = halo + mColumns;
+                halo += 2 * mColumns;
+            }
+            else
+            {
+                oddStepRows[i - begin] = mPreviousSolution.data() + i * mColumns;
+                evenStepRows[i - begin] = mCurrentSolution.data() + i * mColumns;
+            }
+        }
+
+        // Rows are swept once, taking step s of row i - s + 1 after step 1 of row i,
+        // so all the steps of a row are taken while it and its neighbors are in cache.
+        // Step s of a row only needs step s - 1 of the rows around it, which were
+        // taken before, and step s - 2 of the row, which nothing needs anymore.
+        for(uint32_t position = begin + 1; position + 2 < end + steps; ++position)
+        {
+            for(uint32_t step = 1; step <= steps; ++step)
+            {
+                // Rows of the grid boundary are never updated, and other halo rows
+                // lose one row each step.
+                const uint32_t firstRow = begin == 0 ? 1 : begin + step;
+                const uint32_t lastRow = end == mRows ? mRows - 1 : end - step;
+                if(position + 1 < firstRow + step || position + 1 >= lastRow + step)
+                {
+                    continue;
+                }
+
+                const uint32_t row = position + 1 - step - begin;
+                float** updatedRows = step % 2 == 1 ? oddStepRows.data() : evenStepRows.data();
+                float** currentRows = step % 2 == 1 ? evenStepRows.data() : oddStepRows.data();
+                updateRow(mColumns, mK1, mK2, mK3, currentRows[row - 1], currentRows[row], currentRows[row + 1], updatedRows[row]);
+            }
+        }
+    }
+
+    void Waves::finishPass(const uint32_t steps)
+    {
+        // After an odd number of steps the new data is in the previous buffer, so
+        // this data needs to become the current solution and the old
+        // current solution becomes the new previous solution.
+        if(steps % 2 == 1)
+        {
+            mPreviousSolution.swap(mCurrentSolution);
+        }
     }
 }
@@ -2,11 +2,20 @@
 // Performs the calculations for the wave simulation.  After the simulation has been
 // updated, the client must copy the current solution into vertex buffers for rendering.
 // This class only does the calculations, it does not do any drawing.
+//
+// Only heights change during the simulation, so they are stored in row major float
+// arrays and the grid point x and z coordinates are computed when a position is requested.
+// Interior rows are updated 4 heights at a time with DirectXMath vectors. When several
+// steps are due, they can be taken in a single pass over the rows (see setStepsPerPass()).
 //////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <cstdint>
 #include <DirectXMath.h>
+#include <vector>
+
+struct ThreadPool;
 
 namespace Geometry
 {
@@ -14,7 +23,6 @@ namespace Geometry
     {
     public:
         inline Waves();
-        inline ~Waves();
 
         inline uint32_t rows() const;
         inline uint32_t columns() const;
@@ -22,12 +30,88 @@ namespace Geometry
         inline uint32_t triangles() const;
 
         // Returns the solution at the ith grid point.
-        inline const DirectX::XMFLOAT3& operator[](const uint32_t index) const;
+        inline DirectX::XMFLOAT3 operator[](const uint32_t index) const;
+
+        // Returns the solution height at the ith grid point.
+        inline float height(const uint32_t index) const;
+
+        // Returns the row major solution heights (vertices() heights).
+        inline const float* heights() const;
 
         void init(const uint32_t rows, const uint32_t columns, const float dx, const float dt, const float speed, const float damping);
-        void update(const float dt);
+
+        // Steps the simulation every init() dt seconds. Each instance keeps its own
+        // clock, and a long frame takes up to maxSubsteps() steps to catch up;
+        // time past them is dropped. Interior rows are split in bands updated by
+        // the threadPool threads if it is not nullptr. Results are the same either way.
+        void update(const float dt, ThreadPool* threadPool = nullptr);
+
+        // Updates every grid as update(dt, &threadPool) does, but the bands of all
+        // the grids that take the same substep are updated in a single run.
+        static void updateAll(const std::vector<Waves*>& waves, const float dt, ThreadPool& threadPool);
+
+        // 4 by default.
+        inline uint32_t maxSubsteps() const;
+        inline void setMaxSubsteps(const uint32_t maxSubsteps);
+
+        // Due steps are taken in passes of up to stepsPerPass steps (1 by default).
+        // A pass sweeps the rows once, taking all its steps on a few rows at a time
+        // while they are in cache, so the solutions are read from memory once per pass
+        // instead of once per step. With a thread pool, each band of rows also takes the
+        // steps on a halo of stepsPerPass rows around it, from copies of them, as its
+        // neighbor bands update them in parallel. Results are the same.
+        inline uint32_t stepsPerPass() const;
+        inline void setStepsPerPass(const uint32_t stepsPerPass);
+
         void disturb(const uint32_t i, const uint32_t j, const float magnitude);
 
+    private:
+        // Rows [mRowBegin, mRowEnd) of a grid updated by a thread pool task for mSteps steps.
+        // mHaloOffset is where the copies of the rows around them are in mHaloSolutions.
+        struct Task
+        {
+            Task(Waves* waves, const uint32_t rowBegin, const uint32_t rowEnd, const uint32_t steps, const size_t haloOffset)
+                : mWaves(waves)
+                , mRowBegin(rowBegin)
+                , mRowEnd(rowEnd)
+                , mSteps(steps)
+                , mHaloOffset(haloOffset)
+            {
+
+            }
+
+            Waves* mWaves;
+            uint32_t mRowBegin;
+            uint32_t mRowEnd;
+            uint32_t mSteps;
+            size_t mHaloOffset;
+        };
+
+        // Takes steps[i] steps of waves[i], in passes of up to stepsPerPass() steps.
+        // The tasks of every grid in a pass are run together.
+        static void takeSteps(const std::vector<Waves*>& waves, std::vector<uint32_t>& steps, ThreadPool* threadPool);
+
+        // Returns the number of steps due after dt more seconds.
+        uint32_t advanceTime(const float dt);
+
+        // Appends the tasks of a pass of steps steps split for threadCount threads.
+        void appendTasks(const uint32_t steps, const uint32_t threadCount, std::vector<Task>& tasks);
+
+        // Rows [haloBegin, haloEnd) are the ones a task needs: its rows and task.mSteps rows
+        // around them (clipped by the grid), which it updates again from their copies.
+        uint32_t haloBegin(const Task& task) const;
+        uint32_t haloEnd(const Task& task) const;
+
+        // Copies the solutions of the rows around the task rows to mHaloSolutions.
+        void copyHalo(const Task& task);
+
+        // Takes the task steps on the interior points of its rows.
+        void updateBand(const Task& task);
+
+        // Makes the solutions after a pass of steps steps the current ones,
+        // once every task of the pass was run.
+        void finishPass(const uint32_t steps);
+
     private:
         uint32_t mRows;
         uint32_t mColumns;
@@ -43,8 +127,21 @@ namespace Geometry
         float mTimeStep;
         float mSpatialStep;
 
-        DirectX::XMFLOAT3* mPreviousSolution;
-        DirectX::XMFLOAT3* mCurrentSolution;
+        // Time accumulated since the last step.
+        float mTime;
+        uint32_t mMaxSubsteps;
+
+        // The first column is at x = -mHalfWidth and the first row at z = mHalfDepth.
+        float mHalfWidth;
+        float mHalfDepth;
+
+        // Row major heights of the previous and current solutions.
+        std::vector<float> mPreviousSolution;
+        std::vector<float> mCurrentSolution;
+
+        // Copies of the rows around the tasks of a pass of several steps.
+        uint32_t mStepsPerPass;
+        std::vector<float> mHaloSolutions;
     };
 
     inline Waves::Waves()
@@ -57,18 +154,15 @@ namespace Geometry
         , mK3(0.0f)
         , mTimeStep(0.0f)
         , mSpatialStep(0.0f)
-        , mPreviousSolution(nullptr)
-        , mCurrentSolution(nullptr)
+        , mTime(0.0f)
+        , mMaxSubsteps(4)
+        , mHalfWidth(0.0f)
+        , mHalfDepth(0.0f)
+        , mStepsPerPass(1)
     {
 
     }
 
-    inline Waves::~Waves()
-    {
-        delete[] mPreviousSolution;
-        delete[] mCurrentSolution;
-    }
-
     inline uint32_t Waves::rows() const
     {
         return mRows;
@@ -90,8 +184,40 @@ namespace Geometry
     }
 
     // Returns the solution at the ith grid point.
-    inline const DirectX::XMFLOAT3& Waves::operator[](const uint32_t index) const 
+    inline DirectX::XMFLOAT3 Waves::operator[](const uint32_t index) const 
     { 
-        return mCurrentSolution[index]; 
+        const uint32_t row = index / mColumns;
+        const uint32_t column = index - row * mColumns;
+        return DirectX::XMFLOAT3(-mHalfWidth + column * mSpatialStep, mCurrentSolution[index], mHalfDepth - row * mSpatialStep);
+    }
+
+    inline uint32_t Waves::maxSubsteps() const
+    {
+        return mMaxSubsteps;
+    }
+
+    inline void Waves::setMaxSubsteps(const uint32_t maxSubsteps)
+    {
+        mMaxSubsteps = maxSubsteps;
+    }
+
+    inline uint32_t Waves::stepsPerPass() const
+    {
+        return mStepsPerPass;
+    }
+
+    inline void Waves::setStepsPerPass(const uint32_t stepsPerPass)
+    {
+        mStepsPerPass = stepsPerPass;
+    }
+
+    inline float Waves::height(const uint32_t index) const
+    {
+        return mCurrentSolution[index];
+    }
+
+    inline const float* Waves::heights() const
+    {
+        return mCurrentSolution.data();
     }
 }
\ No newline at end of file
@@ -0,0 +1,386 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// First checks that Waves::updateAll gives the same heights as updating
+// each grid on its own, for grids with different sizes, time steps,
+// steps per pass and maximum substeps, so their clocks take different
+// numbers of steps each frame.
+//
+// Then measures how Waves::update scales with the number of threads of its
+// thread pool, on 1024 x 1024 and 4096 x 4096 grids, with 1 to 16
+// threads. Heights after the timed steps are compared with the ones
+// of the serial update, as every thread count must give the same.
+//
+// Then measures frames of several steps taken in passes of 1 to 8 steps
+// (see Waves::setStepsPerPass()), serially and with every hardware
+// thread. Their heights are compared with the ones of passes of a single
+// step, and the bytes of the solutions read and written per step are
+// reported with the bandwidth they take.
+//
+// Last, compares the serial update with the scalar update Waves had
+// before it stored heights in float rows updated 4 at a time, on grids
+// from 200 x 200 to 4096 x 4096. Both must give the same heights.
+//
+// Build it in Release. Thread counts above the hardware threads of
+// the machine oversubscribe it, so they are marked in the output.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <ThreadPool.h>
+
+#include "../../Waves/Waves/Waves.h"
+
+namespace
+{
+    const uint32_t sGridDimensions[] = { 1024, 4096 };
+    const uint32_t sThreadCounts[] = { 1, 2, 3, 4, 6, 8, 12, 16 };
+    const uint32_t sStepsPerPass[] = { 1, 2, 4, 8 };
+    const uint32_t sScalarGridDimensions[] = { 200, 256, 512, 1024, 2048, 4096 };
+
+    // Same simulation constants as the Waves application
+    const float sSpatialStep = 0.8f;
+    const float sTimeStep = 0.03f;
+    const float sSpeed = 3.25f;
+    const float sDamping = 0.4f;
+
+    const uint32_t sWarmUpSteps = 3;
+
+    // Every update of the steps per pass runs takes sStepsPerFrame steps: it is
+    // half a time step longer than them, and the maximum substeps are as many,
+    // so the time left after an update never adds or drops a step.
+    const uint32_t sStepsPerFrame = 8;
+
+    // Grids of updateAll checks: rows, columns, time step, steps per pass and max substeps
+    struct CheckedGrid
+    {
+        uint32_t mRows;
+        uint32_t mColumns;
+        float mTimeStep;
+        uint32_t mStepsPerPass;
+        uint32_t mMaxSubsteps;
+    };
+
+    const CheckedGrid sCheckedGrids[] = {
+        { 64, 64, 0.03f, 1, 4 },
+        { 120, 200, 0.02f, 3, 4 },
+        { 257, 129, 0.045f, 2, 2 },
+        { 37, 301, 0.007f, 8, 16 },
+        { 300, 300, 0.03f, 4, 1 },
+    };
+
+    // Frame times from much shorter than the time steps to much longer
+    const float sCheckedFrameTimes[] = { 0.016f, 0.001f, 0.05f, 0.2f, 0.033f, 0.0f, 0.1f, 0.016f, 0.07f };
+
+    // Fewer steps on the larger grid, so both take a similar time.
+    uint32_t computeTimedSteps(const uint32_t gridDimension)
+    {
+        return gridDimension <= 1024 ? 200 : 20;
+    }
+
+    // Disturbs the same points on every run, so runs with any thread
+    // count take the same steps from the same solution.
+    void initWaves(const uint32_t gridDimension,
+                   Geometry::Waves& waves)
+    {
+        waves.init(gridDimension, gridDimension, sSpatialStep, sTimeStep, sSpeed, sDamping);
+        for(uint32_t i = 1; i < 64; ++i) {
+            const uint32_t row = 2 + (i * 7919U) % (gridDimension - 4);
+            const uint32_t column = 2 + (i * 104729U) % (gridDimension - 4);
+            waves.disturb(row, column, 0.5f);
+        }
+    }
+
+    void initCheckedWaves(const CheckedGrid& grid,
+                          Geometry::Waves& waves)
+    {
+        waves.init(grid.mRows, grid.mColumns, sSpatialStep, grid.mTimeStep, sSpeed, sDamping);
+        waves.setStepsPerPass(grid.mStepsPerPass);
+        waves.setMaxSubsteps(grid.mMaxSubsteps);
+        for(uint32_t i = 1; i < 16; ++i) {
+            const uint32_t row = 2 + (i * 7919U) % (grid.mRows - 4);
+            const uint32_t column = 2 + (i * 104729U) % (grid.mColumns - 4);
+            waves.disturb(row, column, 0.5f);
+        }
+    }
+
+    // Updates the checked grids, for several frames, with updateAll and
+    // on their own, and returns how many frames gave different heights.
+    uint32_t checkUpdateAll(ThreadPool& threadPool)
+    {
+        const size_t gridCount = sizeof(sCheckedGrids) / sizeof(sCheckedGrids[0]);
+        std::vector<Geometry::Waves> waves(gridCount);
+        std::vector<Geometry::Waves> separateWaves(gridCount);
+        std::vector<Geometry::Waves*> wavesPointers(gridCount);
+        for(size_t i = 0; i < gridCount; ++i) {
+            initCheckedWaves(sCheckedGrids[i], waves[i]);
+            initCheckedWaves(sCheckedGrids[i], separateWaves[i]);
+            wavesPointers[i] = &waves[i];
+        }
+
+        uint32_t wrongFrames = 0;
+        for(uint32_t frame = 0; frame < 40; ++frame) {
+            const float frameTime = sCheckedFrameTimes[frame % (sizeof(sCheckedFrameTimes) / sizeof(sCheckedFrameTimes[0]))];
+            Geometry::Waves::updateAll(wavesPointers, frameTime, threadPool);
+
+            bool sameHeights = true;
+            for(size_t i = 0; i < gridCount; ++i) {
+                separateWaves[i].update(frameTime);
+                sameHeights &= memcmp(waves[i].heights(), separateWaves[i].heights(), waves[i].vertices() * sizeof(float)) == 0;
+            }
+
+            if(!sameHeights) {
+                ++wrongFrames;
+            }
+        }
+
+        return wrongFrames;
+    }
+
+    // Returns the milliseconds per step. threadPool is nullptr for the serial update.
+    double measureStepTime(const uint32_t gridDimension,
+                           ThreadPool* threadPool,
+                           std::vector<float>& heights)
+    {
+        Geometry::Waves waves;
+        initWaves(gridDimension, waves);
+
+        // Update with exactly the time step, so every update takes a single step.
+        for(uint32_t i = 0; i < sWarmUpSteps; ++i) {
+            waves.update(sTimeStep, threadPool);
+        }
+
+        const uint32_t timedSteps = computeTimedSteps(gridDimension);
+        const std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+        for(uint32_t i = 0; i < timedSteps; ++i) {
+            waves.update(sTimeStep, threadPool);
+        }
+        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        heights.assign(waves.heights(), waves.heights() + waves.vertices());
+
+        return std::chrono::duration<double, std::milli>(end - begin).count() / timedSteps;
+    }
+
+    // Returns the milliseconds per step of frames of sStepsPerFrame steps
+    // taken in passes of stepsPerPass steps.
+    double measureFrameStepTime(const uint32_t gridDimension,
+                                const uint32_t stepsPerPass,
+                                ThreadPool* threadPool,
+                                std::vector<float>& heights)
+    {
+        Geometry::Waves waves;
+        initWaves(gridDimension, waves);
+        waves.setMaxSubsteps(sStepsPerFrame);
+        waves.setStepsPerPass(stepsPerPass);
+
+        const float frameTime = (sStepsPerFrame + 0.5f) * sTimeStep;
+        waves.update(frameTime, threadPool);
+
+        const uint32_t timedFrames = (computeTimedSteps(gridDimension) + sStepsPerFrame - 1) / sStepsPerFrame;
+        const std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+        for(uint32_t i = 0; i < timedFrames; ++i) {
+            waves.update(frameTime, threadPool);
+        }
+        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        heights.assign(waves.heights(), waves.heights() + waves.vertices());
+
+        return std::chrono::duration<double, std::milli>(end - begin).count() / (timedFrames * sStepsPerFrame);
+    }
+
+    // Returns the milliseconds per step of the update Waves had before its heights were
+    // float rows updated with SIMD: one point at a time, in grid points stored as positions.
+    double measureScalarStepTime(const uint32_t gridDimension,
+                                 std::vector<float>& heights)
+    {
+        Geometry::Waves waves;
+        initWaves(gridDimension, waves);
+
+        const uint32_t vertices = waves.vertices();
+        std::vector<DirectX::XMFLOAT3> previousSolution(vertices);
+        std::vector<DirectX::XMFLOAT3> currentSolution(vertices);
+        for(uint32_t i = 0; i < vertices; ++i) {
+            currentSolution[i] = waves[i];
+            previousSolution[i] = DirectX::XMFLOAT3(currentSolution[i].x, 0.0f, currentSolution[i].z);
+        }
+
+        // Same constants as Waves::init
+        const float d = sDamping * sTimeStep + 2.0f;
+        const float e = (sSpeed * sSpeed) * (sTimeStep * sTimeStep) / (sSpatialStep * sSpatialStep);
+        const float k1 = (sDamping * sTimeStep - 2.0f) / d;
+        const float k2 = (4.0f - 8.0f * e) / d;
+        const float k3 = (2.0f * e) / d;
+
+        const uint32_t columns = gridDimension;
+        const auto takeStep = [&]() {
+            for(uint32_t i = 1; i < gridDimension - 1; ++i) {
+                for(uint32_t j = 1; j < columns - 1; ++j) {
+                    previousSolution[i * columns + j].y =
+                        k1 * previousSolution[i * columns + j].y +
+                        k2 * currentSolution[i * columns + j].y +
+                        k3 * (currentSolution[(i + 1) * columns + j].y +
+                              currentSolution[(i - 1) * columns + j].y +
+                              currentSolution[i * columns + j + 1].y +
+                              currentSolution[i * columns + j - 1].y);
+                }
+            }
+
+            previousSolution.swap(currentSolution);
+        };
+
+        for(uint32_t i = 0; i < sWarmUpSteps; ++i) {
+            takeStep();
+        }
+
+        const uint32_t timedSteps = computeTimedSteps(gridDimension);
+        const std::chrono::high_resolution_clock::time_point begin = std::chrono::high_resolution_clock::now();
+        for(uint32_t i = 0; i < timedSteps; ++i) {
+            takeStep();
+        }
+        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+
+        heights.resize(vertices);
+        for(uint32_t i = 0; i < vertices; ++i) {
+            heights[i] = currentSolution[i].y;
+        }
+
+        return std::chrono::duration<double, std::milli>(end - begin).count() / timedSteps;
+    }
+
+    // A pass reads the previous and current solutions once and writes the
+    // previous one once, whatever its steps. Halo copies are not counted.
+    double computeBytesPerStep(const uint32_t gridDimension,
+                               const uint32_t stepsPerPass)
+    {
+        return 3.0 * sizeof(float) * gridDimension * gridDimension / stepsPerPass;
+    }
+}
+
+int main()
+{
+    const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    printf("%u hardware threads\n", hardwareThreads);
+
+    uint32_t wrongHeights = 0;
+    const uint32_t checkedThreadCounts[] = { 1, 3, 8 };
+    for(size_t i = 0; i < sizeof(checkedThreadCounts) / sizeof(checkedThreadCounts[0]); ++i) {
+        ThreadPool threadPool;
+        ThreadPoolUtils::start(threadPool, checkedThreadCounts[i]);
+        const uint32_t wrongFrames = checkUpdateAll(threadPool);
+        ThreadPoolUtils::stop(threadPool);
+
+        printf("updateAll of %u grids, %u threads: %u frames with wrong heights\n",
+               static_cast<uint32_t> (sizeof(sCheckedGrids) / sizeof(sCheckedGrids[0])),
+               checkedThreadCounts[i],
+               wrongFrames);
+        wrongHeights += wrongFrames;
+    }
+
+    for(size_t i = 0; i < sizeof(sGridDimensions) / sizeof(sGridDimensions[0]); ++i) {
+        const uint32_t gridDimension = sGridDimensions[i];
+        printf("%u x %u grid, %u steps\n", gridDimension, gridDimension, computeTimedSteps(gridDimension));
+
+        std::vector<float> serialHeights;
+        const double serialStepTime = measureStepTime(gridDimension, nullptr, serialHeights);
+        printf("    serial      %8.3f ms per step\n", serialStepTime);
+
+        double singleThreadStepTime = 0.0;
+        std::vector<float> heights;
+        for(size_t j = 0; j < sizeof(sThreadCounts) / sizeof(sThreadCounts[0]); ++j) {
+            const uint32_t threadCount = sThreadCounts[j];
+            ThreadPool threadPool;
+            ThreadPoolUtils::start(threadPool, threadCount);
+            const double stepTime = measureStepTime(gridDimension, &threadPool, heights);
+            ThreadPoolUtils::stop(threadPool);
+
+            if(threadCount == 1) {
+                singleThreadStepTime = stepTime;
+            }
+
+            const bool sameHeights = memcmp(&heights[0], &serialHeights[0], heights.size() * sizeof(float)) == 0;
+            if(!sameHeights) {
+                ++wrongHeights;
+            }
+
+            printf("    %2u threads  %8.3f ms per step, %5.2fx speedup, %5.1f%% efficiency%s%s\n",
+                   threadCount,
+                   stepTime,
+                   singleThreadStepTime / stepTime,
+                   100.0 * singleThreadStepTime / (stepTime * threadCount),
+                   threadCount > hardwareThreads ? ", oversubscribed" : "",
+                   sameHeights ? "" : ", WRONG HEIGHTS");
+        }
+    }
+
+    ThreadPool hardwareThreadPool;
+    ThreadPoolUtils::start(hardwareThreadPool, 0);
+    for(size_t i = 0; i < sizeof(sGridDimensions) / sizeof(sGridDimensions[0]); ++i) {
+        const uint32_t gridDimension = sGridDimensions[i];
+        printf("%u x %u grid, frames of %u steps\n", gridDimension, gridDimension, sStepsPerFrame);
+
+        std::vector<float> singleStepHeights;
+        std::vector<float> heights;
+        for(uint32_t threaded = 0; threaded < 2; ++threaded) {
+            ThreadPool* threadPool = threaded == 0 ? nullptr : &hardwareThreadPool;
+            double singleStepTime = 0.0;
+            for(size_t j = 0; j < sizeof(sStepsPerPass) / sizeof(sStepsPerPass[0]); ++j) {
+                const uint32_t stepsPerPass = sStepsPerPass[j];
+                const double stepTime = measureFrameStepTime(gridDimension, stepsPerPass, threadPool, heights);
+                if(threaded == 0 && stepsPerPass == 1) {
+                    singleStepHeights = heights;
+                }
+
+                if(stepsPerPass == 1) {
+                    singleStepTime = stepTime;
+                }
+
+                const bool sameHeights = memcmp(&heights[0], &singleStepHeights[0], heights.size() * sizeof(float)) == 0;
+                if(!sameHeights) {
+                    ++wrongHeights;
+                }
+
+                const double bytesPerStep = computeBytesPerStep(gridDimension, stepsPerPass);
+                printf("    %-6s %u steps per pass  %8.3f ms per step, %5.2fx speedup, %7.1f MB per step, %6.2f GB/s%s\n",
+                       threaded == 0 ? "serial" : "pool",
+                       stepsPerPass,
+                       stepTime,
+                       singleStepTime / stepTime,
+                       bytesPerStep / 1.0e6,
+                       bytesPerStep / (1.0e6 * stepTime),
+                       sameHeights ? "" : ", WRONG HEIGHTS");
+            }
+        }
+    }
+    ThreadPoolUtils::stop(hardwareThreadPool);
+
+    printf("Scalar and SIMD serial updates\n");
+    for(size_t i = 0; i < sizeof(sScalarGridDimensions) / sizeof(sScalarGridDimensions[0]); ++i) {
+        const uint32_t gridDimension = sScalarGridDimensions[i];
+
+        std::vector<float> scalarHeights;
+        std::vector<float> heights;
+        const double scalarStepTime = measureScalarStepTime(gridDimension, scalarHeights);
+        const double stepTime = measureStepTime(gridDimension, nullptr, heights);
+
+        const bool sameHeights = memcmp(&heights[0], &scalarHeights[0], heights.size() * sizeof(float)) == 0;
+        if(!sameHeights) {
+            ++wrongHeights;
+        }
+
+        printf("    %4u x %4u grid  scalar %8.3f ms per step, SIMD %8.3f ms per step, %5.2fx speedup, %7.1f M points/s%s\n",
+               gridDimension,
+               gridDimension,
+               scalarStepTime,
+               stepTime,
+               scalarStepTime / stepTime,
+               gridDimension * gridDimension / (1000.0 * stepTime),
+               sameHeights ? "" : ", WRONG HEIGHTS");
+    }
+
+    return wrongHeights == 0 ? 0 : 1;
+}